@@ -0,0 +1,156 @@
+import mmap
+import struct
+
+# Reader for the editor's binary project files (".tebin"). The layout is
+# defined by the structs in gui/binary_format.h; keep the two in sync.
+#
+# load_binary() returns the same nested dicts and lists that yaml.safe_load
+# gives for the YAML format, so the rest of the generator can't tell the
+# difference. The file is memory-mapped and its fixed-size records are
+# unpacked directly, with no text parsing.
+
+MAGIC = b'TEBINARY'
+VERSION = 1
+BYTE_ORDER_MARK = 0x01020304
+
+HEADER = struct.Struct('<8sIIQIIIIQQQ')
+LEVEL = struct.Struct('<IIIIddd12Q')
+VERTEX = struct.Struct('<ddIIII')
+EDGE = struct.Struct('<IIIIII')
+MODEL = struct.Struct('<dddIIII')
+POLYGON = struct.Struct('<IIII')
+PARAM = struct.Struct('<IIIIIIqd')
+
+# Edge::Type and Polygon::Type
+EDGE_SEQUENCES = {1: 'lanes', 2: 'walls', 3: 'measurements', 4: 'doors'}
+POLYGON_SEQUENCES = {1: 'floors'}
+
+# Param::Type
+PARAM_STRING = 1
+PARAM_INT = 2
+PARAM_DOUBLE = 3
+PARAM_BOOL = 4
+
+
+def is_binary_filename(filename):
+    return filename.lower().endswith('.tebin')
+
+
+class BinaryMap:
+    def __init__(self, buf):
+        self.buf = buf
+        h = HEADER.unpack_from(buf, 0)
+        (magic, version, byte_order, file_size,
+            name_offset, name_size, num_levels, _,
+            self.levels_offset, self.strings_offset, self.strings_size) = h
+        if magic != MAGIC:
+            raise ValueError('not a binary project file')
+        if version != VERSION:
+            raise ValueError(f'unsupported binary format version {version}')
+        if byte_order != BYTE_ORDER_MARK:
+            raise ValueError('wrong byte order')
+        if file_size != len(buf):
+            raise ValueError('file is truncated')
+        self.building_name = self.string(name_offset, name_size)
+        self.num_levels = num_levels
+
+    def string(self, offset, size):
+        if offset + size > self.strings_size:
+            raise ValueError('string outside the string table')
+        start = self.strings_offset + offset
+        return self.buf[start:start + size].decode('utf-8')
+
+    def table(self, record, offset, count):
+        if offset + count * record.size > len(self.buf):
+            raise ValueError('table outside the file')
+        return [record.unpack_from(self.buf, offset + i * record.size)
+                for i in range(count)]
+
+    def params(self, param_table, first, count):
+        params = {}
+        for p in param_table[first:first + count]:
+            (name_offset, name_size, param_type, value_bool,
+                string_offset, string_size, value_int, value_double) = p
+            if param_type == PARAM_STRING:
+                value = self.string(string_offset, string_size)
+            elif param_type == PARAM_INT:
+                value = value_int
+            elif param_type == PARAM_DOUBLE:
+                value = value_double
+            elif param_type == PARAM_BOOL:
+                value = bool(value_bool)
+            else:
+                raise ValueError(f'unknown parameter type {param_type}')
+            params[self.string(name_offset, name_size)] = [param_type, value]
+        return params
+
+    def level(self, level_idx):
+        """ Returns (name, dict in the same form as a YAML level) """
+        fields = LEVEL.unpack_from(
+            self.buf, self.levels_offset + level_idx * LEVEL.size)
+        (name_offset, name_size, drawing_offset, drawing_size,
+            x_meters, y_meters, elevation) = fields[:7]
+        tables = [(fields[7 + 2 * i], fields[8 + 2 * i]) for i in range(6)]
+        (vertices_t, edges_t, models_t,
+            polygons_t, polygon_vertices_t, params_t) = tables
+
+        y = {}
+        if drawing_size > 0:
+            y['drawing'] = {
+                'filename': self.string(drawing_offset, drawing_size)}
+        else:
+            y['x_meters'] = x_meters
+            y['y_meters'] = y_meters
+        y['elevation'] = elevation
+
+        param_table = self.table(PARAM, *params_t)
+
+        y['vertices'] = []
+        for x, vy, n_offset, n_size, first, count in \
+                self.table(VERTEX, *vertices_t):
+            v = [x, vy, 0.0, self.string(n_offset, n_size)]
+            if count > 0:
+                v.append(self.params(param_table, first, count))
+            y['vertices'].append(v)
+
+        for start, end, edge_type, first, count, _ in \
+                self.table(EDGE, *edges_t):
+            sequence = EDGE_SEQUENCES.get(edge_type)
+            if sequence is None:
+                raise ValueError(f'unknown edge type {edge_type}')
+            y.setdefault(sequence, []).append(
+                [start, end, self.params(param_table, first, count)])
+
+        models = self.table(MODEL, *models_t)
+        if models:
+            y['models'] = []
+        for x, my, yaw, mn_offset, mn_size, n_offset, n_size in models:
+            y['models'].append({
+                'x': x,
+                'y': my,
+                'yaw': yaw,
+                'name': self.string(n_offset, n_size),
+                'model_name': self.string(mn_offset, mn_size)})
+
+        polygon_vertices = self.table(
+            struct.Struct('<I'), *polygon_vertices_t)
+        for polygon_type, first, count, _ in self.table(POLYGON, *polygons_t):
+            sequence = POLYGON_SEQUENCES.get(polygon_type)
+            if sequence is None:
+                continue  # the YAML doesn't have these either
+            y.setdefault(sequence, []).append(
+                {'vertices': [v[0] for v in
+                              polygon_vertices[first:first + count]]})
+
+        return self.string(name_offset, name_size), y
+
+
+def load_binary(filename):
+    with open(filename, 'rb') as f:
+        with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as buf:
+            bm = BinaryMap(buf)
+            y = {'building_name': bm.building_name, 'levels': {}}
+            for level_idx in range(bm.num_levels):
+                name, level_yaml = bm.level(level_idx)
+                y['levels'][name] = level_yaml
+            return y
@@ -0,0 +1,391 @@
+import bisect
+import math
+import random
+
+# Finds where a level's lanes cross its walls, its doors, or each other,
+# with a Bentley-Ottmann sweep: O((n + k) log n) comparisons for n edges
+# and k intersections, instead of testing every pair. This is a port of
+# gui/edge_crossings.cpp; keep the two in step.
+#
+# Edges that share a vertex are connected on purpose and never reported.
+# Touching counts as crossing: a lane that ends on a wall is reported.
+
+LANE_WALL = 'wall'
+LANE_LANE = 'lane'
+LANE_DOOR = 'door'
+
+
+class Crossing:
+    def __init__(self, kind, lane, other, x, y):
+        self.kind = kind
+        self.lane = lane  # an Edge
+        self.other = other  # the wall, door or other lane
+        self.x = x
+        self.y = y
+
+
+class _Segment:
+    def __init__(self, edge, kind, p1, p2):
+        self.edge = edge
+        self.kind = kind
+        self.left = p1
+        self.right = p2
+        self.slope = 0.0
+
+
+class _Event:
+    def __init__(self):
+        self.starting = []
+        self.ending = []
+        self.crossing = []
+        self.at_vertex = False
+
+
+class _StatusNode:
+    def __init__(self, segment, height):
+        self.segment = segment
+        self.next = [None] * height
+        self.prev = [None] * height
+
+
+class _Status:
+    """ The segments on the sweep line, bottom to top, in a skip list, so
+    that inserting, finding and removing one are O(log n). Each segment's
+    node is kept in a dict, like the handles of gui/edge_crossings.cpp, so
+    that it can be removed and its neighbours found even where rounding
+    has left it a little out of order. """
+
+    MAX_HEIGHT = 32
+
+    def __init__(self, less):
+        self.less = less
+        self.head = _StatusNode(None, self.MAX_HEIGHT)
+        self.height = 1
+        self.nodes = {}  # segment index -> its node
+        self.random = random.Random(0)  # the same run every time
+
+    def __contains__(self, s):
+        return s in self.nodes
+
+    def predecessors(self, s):
+        # the last node on each level that is below s
+        preds = [self.head] * self.MAX_HEIGHT
+        node = self.head
+        for level in reversed(range(self.height)):
+            while node.next[level] is not None and \
+                    self.less(node.next[level].segment, s):
+                node = node.next[level]
+            preds[level] = node
+        return preds
+
+    def bounds(self, s):
+        """ Returns the last segment below s and the first one that isn't,
+        either of which may be None """
+        node = self.predecessors(s)[0]
+        after = node.next[0]
+        return (
+            node.segment if node is not self.head else None,
+            after.segment if after is not None else None)
+
+    def below(self, s):
+        node = self.nodes[s].prev[0]
+        return node.segment if node is not self.head else None
+
+    def above(self, s):
+        node = self.nodes[s].next[0]
+        return node.segment if node is not None else None
+
+    def insert(self, s):
+        height = 1
+        while height < self.MAX_HEIGHT and self.random.random() < 0.5:
+            height += 1
+        self.height = max(self.height, height)
+        preds = self.predecessors(s)
+        node = _StatusNode(s, height)
+        for level in range(height):
+            pred = preds[level]
+            node.prev[level] = pred
+            node.next[level] = pred.next[level]
+            if pred.next[level] is not None:
+                pred.next[level].prev[level] = node
+            pred.next[level] = node
+        self.nodes[s] = node
+
+    def remove(self, s):
+        node = self.nodes.pop(s)
+        for level in range(len(node.next)):
+            node.prev[level].next[level] = node.next[level]
+            if node.next[level] is not None:
+                node.next[level].prev[level] = node.prev[level]
+
+
+def find_crossings(vertices, lanes, walls, doors):
+    """ Returns a list of Crossing, sorted by lane """
+    return _Sweep(vertices, lanes, walls, doors).crossings
+
+
+class _Sweep:
+    def __init__(self, vertices, lanes, walls, doors):
+        self.crossings = []
+        self.segments = []
+        self.queue_keys = []  # sorted (x, y)
+        self.next_key = 0  # the keys before this one have been swept
+        self.queue = {}
+        self.status = _Status(self.status_less)
+        self.scheduled = set()
+        self.reported = set()
+        self.sweep_x = 0.0
+        self.sweep_y = 0.0
+
+        for kind, edges in [
+                (LANE_LANE, lanes), (LANE_WALL, walls), (LANE_DOOR, doors)]:
+            for edge in edges:
+                v1 = vertices[edge.start_idx]
+                v2 = vertices[edge.end_idx]
+                self.segments.append(
+                    _Segment(edge, kind, (v1.x, v1.y), (v2.x, v2.y)))
+        if not self.segments:
+            return
+
+        xs = sorted(
+            [c for s in self.segments for c in (s.left[0], s.right[0])])
+        ys = sorted(
+            [c for s in self.segments for c in (s.left[1], s.right[1])])
+        extent = max(1.0, xs[-1] - xs[0], ys[-1] - ys[0])
+        self.eps = 1e-10 * extent
+
+        # coordinates that only differ by rounding are made exactly equal,
+        # or a vertex a hair to the left of a vertical wall would be swept
+        # before the wall, and not seen to touch it
+        snapped_x = self.snap(xs)
+        snapped_y = self.snap(ys)
+        kept = []
+        for s in self.segments:
+            p1 = (snapped_x[s.left[0]], snapped_y[s.left[1]])
+            p2 = (snapped_x[s.right[0]], snapped_y[s.right[1]])
+            if p1 == p2:
+                continue  # nothing to cross
+            s.left, s.right = min(p1, p2), max(p1, p2)
+            dx = s.right[0] - s.left[0]
+            dy = s.right[1] - s.left[1]
+            s.slope = dy / dx if dx > 0.0 else math.inf
+            kept.append(s)
+        self.segments = kept
+
+        # the probe is a point at the event, below everything that passes
+        # through it, for finding those in the status
+        self.probe = len(self.segments)
+        self.segments.append(_Segment(None, None, (0.0, 0.0), (0.0, 0.0)))
+        self.segments[self.probe].slope = -math.inf
+
+        for i in range(self.probe):
+            self.event_at(self.segments[i].left, True).starting.append(i)
+            self.event_at(self.segments[i].right, True).ending.append(i)
+
+        while self.next_key < len(self.queue_keys):
+            key = self.queue_keys[self.next_key]
+            self.next_key += 1
+            self.handle_event(key, self.queue.pop(key))
+
+        self.crossings.sort(key=lambda c: (c.lane.start_idx, c.lane.end_idx))
+
+    def snap(self, values):
+        snapped = {}
+        prev = None
+        for v in values:
+            if prev is not None and v - prev <= self.eps:
+                snapped[v] = snapped[prev]
+            else:
+                snapped[v] = v
+            prev = v
+        return snapped
+
+    def event_at(self, point, at_vertex):
+        # merge with an event that is already there, give or take rounding
+        # new events are always ahead of the sweep
+        i = bisect.bisect_left(
+            self.queue_keys, (point[0] - self.eps, -math.inf), self.next_key)
+        while i < len(self.queue_keys):
+            key = self.queue_keys[i]
+            if key[0] > point[0] + self.eps:
+                break
+            i += 1
+            if abs(key[1] - point[1]) > self.eps:
+                continue
+            # Vertices are exact, so an event at one stays there. Between
+            # two computed points, the first one wins, so that the event
+            # isn't swept after a vertical segment through it has ended.
+            event = self.queue[key]
+            if event.at_vertex or (not at_vertex and not point < key):
+                return event
+            del self.queue_keys[i - 1]
+            del self.queue[key]
+            event.at_vertex = at_vertex
+            bisect.insort(self.queue_keys, point, self.next_key)
+            self.queue[point] = event
+            return event
+        event = _Event()
+        event.at_vertex = at_vertex
+        bisect.insort(self.queue_keys, point, self.next_key)
+        self.queue[point] = event
+        return event
+
+    def y_at_sweep(self, s):
+        # vertical segments (and the probe) are wherever the event is on them
+        y0 = min(s.left[1], s.right[1])
+        y1 = max(s.left[1], s.right[1])
+        if math.isinf(s.slope):
+            return max(y0, min(y1, self.sweep_y))
+        y = s.left[1] + (self.sweep_x - s.left[0]) * s.slope
+        return max(y0, min(y1, y))
+
+    def status_less(self, a, b):
+        if a == b:
+            return False
+        sa = self.segments[a]
+        sb = self.segments[b]
+        ya = self.y_at_sweep(sa)
+        yb = self.y_at_sweep(sb)
+        if abs(ya - yb) > self.eps:
+            return ya < yb
+        # they meet at the sweep line, so go by how they leave it
+        if sa.slope != sb.slope:
+            return sa.slope < sb.slope
+        return a < b
+
+    def near(self, a, b):
+        return abs(a[0] - b[0]) <= self.eps and abs(a[1] - b[1]) <= self.eps
+
+    def intersect(self, a, b):
+        sa = self.segments[a]
+        sb = self.segments[b]
+        rx = sa.right[0] - sa.left[0]
+        ry = sa.right[1] - sa.left[1]
+        sx = sb.right[0] - sb.left[0]
+        sy = sb.right[1] - sb.left[1]
+        qx = sb.left[0] - sa.left[0]
+        qy = sb.left[1] - sa.left[1]
+        d = rx * sy - ry * sx
+        if abs(d) <= 1e-12 * math.hypot(rx, ry) * math.hypot(sx, sy):
+            return None  # parallel; overlaps are found at the endpoint events
+
+        t = (qx * sy - qy * sx) / d
+        u = (qx * ry - qy * rx) / d
+        eps_t = 1e-9
+        if t < -eps_t or t > 1.0 + eps_t or u < -eps_t or u > 1.0 + eps_t:
+            return None
+
+        # at an endpoint, use it exactly, so the event lands on its own
+        if t <= eps_t:
+            return sa.left
+        if t >= 1.0 - eps_t:
+            return sa.right
+        if u <= eps_t:
+            return sb.left
+        if u >= 1.0 - eps_t:
+            return sb.right
+
+        # keep it inside both bounding boxes, so that crossing a vertical
+        # segment happens at exactly its x, and not just after its end
+        x0 = max(sa.left[0], sb.left[0])
+        x1 = min(sa.right[0], sb.right[0])
+        y0 = max(min(sa.left[1], sa.right[1]), min(sb.left[1], sb.right[1]))
+        y1 = min(max(sa.left[1], sa.right[1]), max(sb.left[1], sb.right[1]))
+        return (
+            max(x0, min(x1, sa.left[0] + t * rx)),
+            max(y0, min(y1, sa.left[1] + t * ry)))
+
+    def handle_event(self, p, event):
+        self.sweep_x, self.sweep_y = p
+        self.segments[self.probe].left = p
+        self.segments[self.probe].right = p
+        status = self.status
+
+        # the segments that pass through p are next to each other in the
+        # status, just above the probe
+        through = []
+        below, s = status.bounds(self.probe)
+        while s is not None and \
+                abs(self.y_at_sweep(self.segments[s]) - p[1]) <= self.eps:
+            through.append(s)
+            s = status.above(s)
+        touched = []  # left in the status, with new neighbours
+        if below is not None:
+            touched.append(below)
+        if s is not None:
+            touched.append(s)
+        for s in through:
+            status.remove(s)
+
+        # rounding may have put a segment that ends or crosses here just
+        # outside of that
+        passing = set(through)
+        for s in event.ending + event.crossing:
+            if s in passing or s not in status:
+                continue
+            for neighbour in (status.below(s), status.above(s)):
+                if neighbour is not None:
+                    touched.append(neighbour)
+            status.remove(s)
+            through.append(s)
+            passing.add(s)
+
+        involved = sorted(passing.union(event.starting))
+        for i in range(len(involved)):
+            for j in range(i + 1, len(involved)):
+                self.report(involved[i], involved[j], p)
+
+        # everything that carries on past p goes (back) in, in its order
+        # just past p, which swaps the ones that cross here
+        inserted = [
+            s for s in through if not self.near(self.segments[s].right, p)]
+        inserted += event.starting
+        for s in inserted:
+            status.insert(s)
+
+        # and only new neighbours can have crossings that aren't known yet
+        for s in touched + inserted:
+            if s not in status:
+                continue
+            below = status.below(s)
+            if below is not None:
+                self.check(below, s, p)
+            above = status.above(s)
+            if above is not None:
+                self.check(s, above, p)
+
+    def check(self, a, b, p):
+        point = self.intersect(a, b)
+        if point is None:
+            return
+        # no tolerance on x here: a nearly vertical segment can cross far
+        # below p within a rounding error of p's x
+        if self.near(point, p) or point < p:
+            self.report(a, b, point)  # they meet here (or already have)
+            return
+        pair = (min(a, b), max(a, b))
+        if pair in self.scheduled:
+            return
+        self.scheduled.add(pair)
+        sa = self.segments[a]
+        sb = self.segments[b]
+        at_vertex = point in (sa.left, sa.right, sb.left, sb.right)
+        self.event_at(point, at_vertex).crossing.extend([a, b])
+
+    def report(self, a, b, point):
+        lane = self.segments[a]
+        other = self.segments[b]
+        if lane.kind != LANE_LANE:
+            lane, other = other, lane
+        if lane.kind != LANE_LANE:
+            return  # only lanes are checked
+        lane_vertices = (lane.edge.start_idx, lane.edge.end_idx)
+        if other.edge.start_idx in lane_vertices or \
+                other.edge.end_idx in lane_vertices:
+            return  # connected on purpose
+        pair = (min(a, b), max(a, b))
+        if pair in self.reported:
+            return
+        self.reported.add(pair)
+        self.crossings.append(
+            Crossing(other.kind, lane.edge, other.edge, point[0], point[1]))
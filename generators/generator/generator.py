@@ -2,6 +2,7 @@ import math
 import os
 import yaml
 from xml.etree.ElementTree import tostring as ElementToString
+from .binary_map import is_binary_filename, load_binary
 from .building import Building
 from .etree_utils import indent_etree
 
@@ -14,6 +15,9 @@ class Generator:
         if not os.path.isfile(input_filename):
             raise FileNotFoundError(f'input file {input_filename} not found')
 
+        if is_binary_filename(input_filename):
+            return Building(load_binary(input_filename))
+
         with open(input_filename, 'r') as f:
             y = yaml.safe_load(f)
             return Building(y)
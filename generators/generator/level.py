@@ -6,6 +6,7 @@ import shutil
 from xml.etree.ElementTree import ElementTree, Element, SubElement
 from .etree_utils import indent_etree
 
+from .crossings import find_crossings, LANE_DOOR
 from .edge import Edge
 from .floor import Floor
 from .model import Model
@@ -55,12 +56,20 @@ class Level:
 
         if 'lanes' in yaml_node:
             self.lanes = self.parse_edge_sequence(yaml_node['lanes'])
+        else:
+            self.lanes = []
 
         if 'walls' in yaml_node:
             self.walls = self.parse_edge_sequence(yaml_node['walls'])
+        else:
+            self.walls = []
 
         if 'doors' in yaml_node:
             self.doors = self.parse_edge_sequence(yaml_node['doors'])
+        else:
+            self.doors = []
+
+        self.crossings = None  # found on first use; see lane_crossings()
 
         self.models = []
         if 'models' in yaml_node:
@@ -276,32 +285,20 @@ class Level:
         indent_etree(config_ele)
         config_tree.write(path, encoding='utf-8', xml_declaration=True)
 
-    def segments_intersect(self, v1, v2, v3, v4):
-        x1 = v1.x
-        y1 = v1.y
-        x2 = v2.x
-        y2 = v2.y
-        x3 = v3.x
-        y3 = v3.y
-        x4 = v4.x
-        y4 = v4.y
-        # line segments are (x1,y1),(x2,y2) and (x3,y3),(x4,y4)
-        det = (x1-x2)*(y3-y4) - (y1-y2)*(x3-x4)
-        if abs(det) < 0.01:
-            # print('  determinant is {}. precision is no bueno.'.format(det))
-            # print('    ({},{}),({},{}) and ({},{}),({},{})'.format(
-            #     x1, y1, x2, y2, x3, y3, x4, y4))
-            return False
-        t =  ((x1-x3)*(y3-y4)-(y1-y3)*(x3-x4)) / det
-        u = -((x1-x2)*(y1-y3)-(y1-y2)*(x1-x3)) / det
-        #print('  t = {}  u = {}'.format(round(t,3), round(u,3)))
-        if u < 0 or t < 0 or u > 1 or t > 1:
-            return False
-        print('hooray, we found an intersection: t={}, u={}'.format(
-            round(t,3), round(u,3)))
-        print('  ({},{}),({},{}) and ({},{}),({},{})'.format(
-            x1, y1, x2, y2, x3, y3, x4, y4))
-        return True
+    def lane_crossings(self):
+        """ Find (once) where lanes cross walls, doors or other lanes """
+        if self.crossings is not None:
+            return self.crossings
+        self.crossings = find_crossings(
+            self.vertices, self.lanes, self.walls, self.doors)
+        for c in self.crossings:
+            if c.kind == LANE_DOOR:
+                continue  # that's what lanes through doors do
+            print(f'WARNING! level {self.name}: lane '
+                  f'{c.lane.start_idx}-{c.lane.end_idx} crosses {c.kind} '
+                  f'{c.other.start_idx}-{c.other.end_idx} '
+                  f'at ({c.x:.3f}, {c.y:.3f})')
+        return self.crossings
 
     def generate_nav_graph(self, graph_idx):
         """ Generate a graph without unnecessary (non-lane) vertices """
@@ -333,27 +330,24 @@ class Level:
                 p[param_name] = param_value.value
             nav_data['vertices'].append([v.x, v.y, p])
 
+        doors_crossed = {}
+        for c in self.lane_crossings():
+            if c.kind == LANE_DOOR:
+                doors_crossed[c.lane] = c.other.params['name'].value
+
         nav_data['lanes'] = []
         for l in self.lanes:
             if l.params['graph_idx'].value != graph_idx:
                 continue
-            v1 = self.vertices[l.start_idx]
-            v2 = self.vertices[l.end_idx]
 
             start_idx = vidx_to_mapped_idx[l.start_idx]
             end_idx = vidx_to_mapped_idx[l.end_idx]
 
             p = {}  # params
 
-            # todo: calculate if this lane segment goes through
-            # any doors, and add the name of the door if so
-            for door in self.doors:
-                door_v1 = self.vertices[door.start_idx]
-                door_v2 = self.vertices[door.end_idx]
-                door_name = door.params['name'].value
-                if self.segments_intersect(v1, v2, door_v1, door_v2):
-                    print(f'found intersection with door {door_name}!')
-                    p['door_name'] = door_name
+            # add the name of the door, if this lane goes through one
+            if l in doors_crossed:
+                p['door_name'] = doors_crossed[l]
 
             if l.orientation():
                 p['orientation_constraint'] = l.orientation()
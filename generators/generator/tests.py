@@ -0,0 +1,154 @@
+import random
+import unittest
+from ddt import ddt, data
+from crossings import find_crossings, LANE_LANE, LANE_WALL, LANE_DOOR
+
+
+class Vertex(object):
+    def __init__(self, x, y):
+        self.x = x
+        self.y = y
+
+
+class Edge(object):
+    def __init__(self, start_idx, end_idx):
+        self.start_idx = start_idx
+        self.end_idx = end_idx
+
+
+class LevelData(object):
+    def __init__(self, name, seed, num_vertices, grid, num_edges):
+        self.name = name
+        rng = random.Random(seed)
+        if grid:
+            # few distinct coordinates, for lots of touching and overlaps
+            self.vertices = [
+                Vertex(rng.randint(0, grid), rng.randint(0, grid))
+                for _ in range(num_vertices)]
+        else:
+            self.vertices = [
+                Vertex(rng.uniform(-50.0, 50.0), rng.uniform(-50.0, 50.0))
+                for _ in range(num_vertices)]
+        self.lanes = []
+        self.walls = []
+        self.doors = []
+        for _ in range(num_edges):
+            start_idx = rng.randrange(num_vertices)
+            end_idx = rng.randrange(num_vertices)
+            edges = rng.choice([self.lanes, self.walls, self.doors])
+            edges.append(Edge(start_idx, end_idx))
+
+
+TEST_DATA = [
+    LevelData(name='Empty', seed=0, num_vertices=4, grid=0, num_edges=0),
+    LevelData(name='Sparse', seed=1, num_vertices=40, grid=0, num_edges=20),
+    LevelData(name='Dense', seed=2, num_vertices=60, grid=0, num_edges=120),
+    LevelData(name='Grid', seed=3, num_vertices=60, grid=6, num_edges=80),
+    LevelData(name='Tiny Grid', seed=4, num_vertices=30, grid=2, num_edges=60),
+    LevelData(name='Axes', seed=5, num_vertices=80, grid=10, num_edges=150),
+]
+
+
+def orientation(a, b, c):
+    d = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x)
+    return (d > 0) - (d < 0)
+
+
+def on_segment(a, b, c):
+    # c is known to be on the line through a and b
+    return min(a.x, b.x) <= c.x <= max(a.x, b.x) and \
+        min(a.y, b.y) <= c.y <= max(a.y, b.y)
+
+
+def segments_touch(p1, p2, q1, q2):
+    o1 = orientation(p1, p2, q1)
+    o2 = orientation(p1, p2, q2)
+    o3 = orientation(q1, q2, p1)
+    o4 = orientation(q1, q2, p2)
+    if o1 != o2 and o3 != o4:
+        return True
+    # collinear, or an end of one is on the other
+    return (o1 == 0 and on_segment(p1, p2, q1)) or \
+        (o2 == 0 and on_segment(p1, p2, q2)) or \
+        (o3 == 0 and on_segment(q1, q2, p1)) or \
+        (o4 == 0 and on_segment(q1, q2, p2))
+
+
+def brute_force(vertices, lanes, walls, doors):
+    """ Tests every pair, for comparing with the sweep """
+    found = set()
+    others = \
+        [(LANE_LANE, e) for e in lanes] + \
+        [(LANE_WALL, e) for e in walls] + \
+        [(LANE_DOOR, e) for e in doors]
+    for lane in lanes:
+        lane_vertices = (lane.start_idx, lane.end_idx)
+        for kind, other in others:
+            if other is lane:
+                continue
+            if other.start_idx in lane_vertices or \
+                    other.end_idx in lane_vertices:
+                continue  # connected on purpose
+            p1 = vertices[lane.start_idx]
+            p2 = vertices[lane.end_idx]
+            q1 = vertices[other.start_idx]
+            q2 = vertices[other.end_idx]
+            if (p1.x, p1.y) == (p2.x, p2.y) or (q1.x, q1.y) == (q2.x, q2.y):
+                continue  # nothing to cross
+            if segments_touch(p1, p2, q1, q2):
+                found.add(key(kind, lane, other))
+    return found
+
+
+def key(kind, lane, other):
+    # two lanes are the same crossing whichever one it was found from
+    if kind == LANE_LANE:
+        lane, other = sorted([lane, other], key=id)
+    return (kind, id(lane), id(other))
+
+
+@ddt
+class TestCrossings(unittest.TestCase):
+
+    @data(*TEST_DATA)
+    def test_crossings(self, level_data):
+        crossings = find_crossings(
+            level_data.vertices,
+            level_data.lanes,
+            level_data.walls,
+            level_data.doors)
+        found = set(key(c.kind, c.lane, c.other) for c in crossings)
+        self.assertEqual(
+            len(found), len(crossings),
+            '{}: a crossing was reported twice'.format(level_data.name))
+        expected = brute_force(
+            level_data.vertices,
+            level_data.lanes,
+            level_data.walls,
+            level_data.doors)
+        self.assertEqual(
+            found, expected,
+            '{}: missing {}, unexpected {}'.format(
+                level_data.name, expected - found, found - expected))
+
+        # the reported point is on both of the edges
+        for c in crossings:
+            for edge in (c.lane, c.other):
+                a = level_data.vertices[edge.start_idx]
+                b = level_data.vertices[edge.end_idx]
+                self.assertTrue(
+                    distance_to(a, b, c) < 1e-6,
+                    '{}: crossing at ({}, {}) is off an edge'.format(
+                        level_data.name, c.x, c.y))
+
+
+def distance_to(a, b, c):
+    dx = b.x - a.x
+    dy = b.y - a.y
+    t = ((c.x - a.x) * dx + (c.y - a.y) * dy) / float(dx * dx + dy * dy)
+    t = max(0.0, min(1.0, t))
+    return ((a.x + t * dx - c.x) ** 2 + (a.y + t * dy - c.y) ** 2) ** 0.5
+
+
+if __name__ == '__main__':
+    unittest.main()
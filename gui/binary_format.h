@@ -0,0 +1,145 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+/*
+ * On-disk layout of binary project files (".tebin"). They hold the same
+ * data as the YAML, but as fixed-layout tables that can be used straight
+ * from a memory-mapped file; see BinaryMap. The Python reader in
+ * generators/generator/binary_map.py mirrors these structs, so change
+ * both (and bump VERSION) together.
+ *
+ * Everything is little-endian and naturally aligned, and every table
+ * starts on an 8-byte boundary. A file is laid out as:
+ *
+ *   BinaryHeader
+ *   BinaryLevel[num_levels]
+ *   per level: vertices, edges, models, polygons, polygon vertices and
+ *     params, in that order
+ *   the string table
+ *
+ * Strings are stored once each in the string table, NUL-terminated, and
+ * referred to by offset and size (not counting the NUL). Vertex and edge
+ * parameters live in the level's params table, and floor outlines in its
+ * polygon vertices table; the records refer to ranges of those.
+ */
+
+#include <cstdint>
+
+
+namespace binary_format {
+
+const char MAGIC[8] = { 'T', 'E', 'B', 'I', 'N', 'A', 'R', 'Y' };
+const uint32_t VERSION = 1;
+const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct BinaryString
+{
+  uint32_t offset;  // into the string table
+  uint32_t size;
+};
+
+struct BinaryTable
+{
+  uint64_t offset;  // from the start of the file
+  uint64_t count;  // records, not bytes
+};
+
+struct BinaryHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;  // BYTE_ORDER_MARK, as the writer saw it
+  uint64_t file_size;
+  BinaryString building_name;
+  uint32_t num_levels;
+  uint32_t reserved;
+  uint64_t levels_offset;
+  uint64_t strings_offset;
+  uint64_t strings_size;
+};
+
+struct BinaryLevel
+{
+  BinaryString name;
+  BinaryString drawing_filename;  // empty if there is no drawing
+  double x_meters, y_meters;  // only used if there is no drawing
+  double elevation;
+  BinaryTable vertices;  // BinaryVertex
+  BinaryTable edges;  // BinaryEdge
+  BinaryTable models;  // BinaryModel
+  BinaryTable polygons;  // BinaryPolygon
+  BinaryTable polygon_vertices;  // uint32_t vertex indices
+  BinaryTable params;  // BinaryParam
+};
+
+struct BinaryVertex
+{
+  double x, y;
+  BinaryString name;
+  uint32_t first_param;
+  uint32_t num_params;
+};
+
+struct BinaryEdge
+{
+  uint32_t start_idx, end_idx;
+  uint32_t type;  // Edge::Type
+  uint32_t first_param;
+  uint32_t num_params;
+  uint32_t reserved;
+};
+
+struct BinaryModel
+{
+  double x, y, yaw;
+  BinaryString model_name;
+  BinaryString instance_name;
+};
+
+struct BinaryPolygon
+{
+  uint32_t type;  // Polygon::Type
+  uint32_t first_vertex;
+  uint32_t num_vertices;
+  uint32_t reserved;
+};
+
+struct BinaryParam
+{
+  BinaryString name;
+  uint32_t type;  // Param::Type; says which of the values below is used
+  uint32_t value_bool;
+  BinaryString value_string;
+  int64_t value_int;
+  double value_double;
+};
+
+// the Python reader depends on these
+static_assert(sizeof(BinaryHeader) == 64, "BinaryHeader layout changed");
+static_assert(sizeof(BinaryLevel) == 136, "BinaryLevel layout changed");
+static_assert(sizeof(BinaryVertex) == 32, "BinaryVertex layout changed");
+static_assert(sizeof(BinaryEdge) == 24, "BinaryEdge layout changed");
+static_assert(sizeof(BinaryModel) == 40, "BinaryModel layout changed");
+static_assert(sizeof(BinaryPolygon) == 16, "BinaryPolygon layout changed");
+static_assert(sizeof(BinaryParam) == 40, "BinaryParam layout changed");
+
+}  // namespace binary_format
+
+#endif
@@ -0,0 +1,437 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "binary_map.h"
+#include "map.h"
+using std::string;
+using std::vector;
+using binary_format::BinaryEdge;
+using binary_format::BinaryHeader;
+using binary_format::BinaryLevel;
+using binary_format::BinaryModel;
+using binary_format::BinaryParam;
+using binary_format::BinaryPolygon;
+using binary_format::BinaryString;
+using binary_format::BinaryTable;
+using binary_format::BinaryVertex;
+
+
+const char *BinaryMap::SUFFIX = "tebin";
+
+BinaryMap::BinaryMap()
+: data(nullptr),
+  size(0)
+{
+}
+
+BinaryMap::~BinaryMap()
+{
+}
+
+bool BinaryMap::is_binary_filename(const QString &filename)
+{
+  return filename.endsWith(
+      QString(".") + SUFFIX,
+      Qt::CaseInsensitive);
+}
+
+bool BinaryMap::open(const QString &filename, string &error)
+{
+  data = nullptr;
+  size = 0;
+  buffer.clear();
+  file.close();
+
+  file.setFileName(filename);
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = "couldn't open " + filename.toStdString();
+    return false;
+  }
+  size = file.size();
+  data = file.map(0, size);
+  if (!data) {
+    // some file systems can't be mapped; reading it all is the fallback
+    buffer = file.readAll();
+    data = reinterpret_cast<const uchar *>(buffer.constData());
+    size = buffer.size();
+  }
+
+  if (size < static_cast<qint64>(sizeof(BinaryHeader))) {
+    error = filename.toStdString() + " is too short";
+    return false;
+  }
+  const BinaryHeader &h = header();
+  if (memcmp(h.magic, binary_format::MAGIC, sizeof(h.magic)) != 0) {
+    error = filename.toStdString() + " is not a binary project file";
+    return false;
+  }
+  if (h.version != binary_format::VERSION) {
+    error = filename.toStdString() + " is binary format version " +
+        std::to_string(h.version) + ", but this editor only reads version " +
+        std::to_string(binary_format::VERSION);
+    return false;
+  }
+  if (h.byte_order != binary_format::BYTE_ORDER_MARK) {
+    error = filename.toStdString() + " has the wrong byte order";
+    return false;
+  }
+  if (h.file_size != static_cast<uint64_t>(size)) {
+    error = filename.toStdString() + " is truncated";
+    return false;
+  }
+  if (h.strings_offset > h.file_size ||
+      h.strings_size > h.file_size - h.strings_offset) {
+    error = filename.toStdString() + " has a bad string table";
+    return false;
+  }
+
+  BinaryTable levels_table;
+  levels_table.offset = h.levels_offset;
+  levels_table.count = h.num_levels;
+  if (!check_table(levels_table, sizeof(BinaryLevel))) {
+    error = filename.toStdString() + " has a bad level table";
+    return false;
+  }
+  for (int i = 0; i < num_levels(); i++) {
+    const BinaryLevel &bl = get_level(i);
+    if (!check_table(bl.vertices, sizeof(BinaryVertex)) ||
+        !check_table(bl.edges, sizeof(BinaryEdge)) ||
+        !check_table(bl.models, sizeof(BinaryModel)) ||
+        !check_table(bl.polygons, sizeof(BinaryPolygon)) ||
+        !check_table(bl.polygon_vertices, sizeof(uint32_t)) ||
+        !check_table(bl.params, sizeof(BinaryParam))) {
+      error = filename.toStdString() + " has a bad table in level " +
+          std::to_string(i);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool BinaryMap::check_table(
+    const BinaryTable &t,
+    const size_t record_size) const
+{
+  const uint64_t file_size = static_cast<uint64_t>(size);
+  // records are used in place, so they have to be aligned
+  return t.offset % 8 == 0 &&
+      t.offset <= file_size &&
+      t.count <= (file_size - t.offset) / record_size;
+}
+
+const BinaryLevel &BinaryMap::get_level(const int level_idx) const
+{
+  return reinterpret_cast<const BinaryLevel *>(
+      data + header().levels_offset)[level_idx];
+}
+
+string BinaryMap::get_string(const BinaryString &s) const
+{
+  const BinaryHeader &h = header();
+  if (s.offset > h.strings_size || s.size > h.strings_size - s.offset)
+    throw std::runtime_error("BinaryMap: string outside the string table");
+  return string(
+      reinterpret_cast<const char *>(data + h.strings_offset + s.offset),
+      s.size);
+}
+
+void BinaryMap::read_params(
+    const BinaryLevel &bl,
+    const uint32_t first_param,
+    const uint32_t num_params,
+    std::map<string, Param> &params) const
+{
+  if (first_param > bl.params.count ||
+      num_params > bl.params.count - first_param)
+    throw std::runtime_error("BinaryMap: parameters outside the table");
+
+  const BinaryParam *bp = table<BinaryParam>(bl.params) + first_param;
+  for (uint32_t i = 0; i < num_params; i++, bp++) {
+    Param p(static_cast<Param::Type>(bp->type));
+    if (p.type == Param::STRING)
+      p.value_string = get_string(bp->value_string);
+    else if (p.type == Param::INT)
+      p.value_int = static_cast<int>(bp->value_int);
+    else if (p.type == Param::DOUBLE)
+      p.value_double = bp->value_double;
+    else if (p.type == Param::BOOL)
+      p.value_bool = bp->value_bool != 0;
+    else
+      throw std::runtime_error("BinaryMap: unknown parameter type");
+    params[get_string(bp->name)] = p;
+  }
+}
+
+bool BinaryMap::to_level(
+    const int level_idx,
+    Level &level,
+    const QString &project_dir,
+    JobProgress *progress) const
+{
+  const BinaryLevel &bl = get_level(level_idx);
+  level.name = get_string(bl.name);
+  printf("reading level [%s]\n", level.name.c_str());
+  level.drawing_filename = get_string(bl.drawing_filename);
+  level.x_meters = bl.x_meters;
+  level.y_meters = bl.y_meters;
+  level.elevation = bl.elevation;
+  if (!level.load_drawing(project_dir, progress))
+    return false;
+  if (progress)
+    progress->check_cancelled();
+
+  const BinaryVertex *bv = table<BinaryVertex>(bl.vertices);
+  level.vertices.clear();
+  level.vertices.reserve(bl.vertices.count);
+  for (uint64_t i = 0; i < bl.vertices.count; i++, bv++) {
+    level.vertices.push_back(Vertex(bv->x, bv->y, get_string(bv->name)));
+    read_params(
+        bl,
+        bv->first_param,
+        bv->num_params,
+        level.vertices.back().params);
+  }
+
+  const BinaryEdge *be = table<BinaryEdge>(bl.edges);
+  level.edges.clear();
+  level.edges.reserve(bl.edges.count);
+  for (uint64_t i = 0; i < bl.edges.count; i++, be++) {
+    if (be->start_idx >= bl.vertices.count || be->end_idx >= bl.vertices.count)
+      throw std::runtime_error("BinaryMap: edge refers to a missing vertex");
+    if (be->type < static_cast<uint32_t>(Edge::LANE) ||
+        be->type > static_cast<uint32_t>(Edge::DOOR))
+      throw std::runtime_error("BinaryMap: unknown edge type");
+    Edge e;
+    e.start_idx = static_cast<int>(be->start_idx);
+    e.end_idx = static_cast<int>(be->end_idx);
+    e.type = static_cast<Edge::Type>(be->type);
+    read_params(bl, be->first_param, be->num_params, e.params);
+    e.create_required_parameters();  // just like Edge::from_yaml()
+    level.edges.push_back(e);
+  }
+
+  const BinaryModel *bm = table<BinaryModel>(bl.models);
+  level.models.clear();
+  level.models.reserve(bl.models.count);
+  for (uint64_t i = 0; i < bl.models.count; i++, bm++) {
+    level.models.push_back(
+        Model(
+          bm->x,
+          bm->y,
+          bm->yaw,
+          get_string(bm->model_name),
+          get_string(bm->instance_name)));
+  }
+
+  const BinaryPolygon *bp = table<BinaryPolygon>(bl.polygons);
+  const uint32_t *polygon_vertices = table<uint32_t>(bl.polygon_vertices);
+  level.polygons.clear();
+  level.polygons.reserve(bl.polygons.count);
+  for (uint64_t i = 0; i < bl.polygons.count; i++, bp++) {
+    if (bp->first_vertex > bl.polygon_vertices.count ||
+        bp->num_vertices > bl.polygon_vertices.count - bp->first_vertex)
+      throw std::runtime_error("BinaryMap: polygon outside the vertex table");
+    Polygon p;
+    p.type = static_cast<Polygon::Type>(bp->type);
+    p.vertices.assign(
+        polygon_vertices + bp->first_vertex,
+        polygon_vertices + bp->first_vertex + bp->num_vertices);
+    level.polygons.push_back(p);
+  }
+
+  level.calculate_scale();
+  return true;
+}
+
+/// Collects the strings of a file being written, storing each one once
+class BinaryStringTable
+{
+public:
+  BinaryString add(const string &s)
+  {
+    auto it = index.find(s);
+    if (it != index.end())
+      return it->second;
+    BinaryString bs;
+    bs.offset = static_cast<uint32_t>(bytes.size());
+    bs.size = static_cast<uint32_t>(s.size());
+    bytes.append(s.data(), static_cast<int>(s.size()));
+    bytes.push_back('\0');
+    index[s] = bs;
+    return bs;
+  }
+
+  QByteArray bytes;
+
+private:
+  std::map<string, BinaryString> index;
+};
+
+static void pad_to_8(QByteArray &out)
+{
+  while (out.size() % 8)
+    out.append('\0');
+}
+
+template <typename T>
+static BinaryTable append_table(QByteArray &out, const vector<T> &records)
+{
+  pad_to_8(out);
+  BinaryTable t;
+  t.offset = static_cast<uint64_t>(out.size());
+  t.count = records.size();
+  if (!records.empty())
+    out.append(
+        reinterpret_cast<const char *>(records.data()),
+        static_cast<int>(records.size() * sizeof(T)));
+  return t;
+}
+
+static void append_params(
+    const std::map<string, Param> &params,
+    BinaryStringTable &strings,
+    vector<BinaryParam> &table,
+    uint32_t &first_param,
+    uint32_t &num_params)
+{
+  first_param = static_cast<uint32_t>(table.size());
+  num_params = static_cast<uint32_t>(params.size());
+  for (const auto &param : params) {
+    BinaryParam bp;
+    memset(&bp, 0, sizeof(bp));
+    bp.name = strings.add(param.first);
+    bp.type = static_cast<uint32_t>(param.second.type);
+    bp.value_bool = param.second.value_bool ? 1 : 0;
+    bp.value_string = strings.add(param.second.value_string);
+    bp.value_int = param.second.value_int;
+    bp.value_double = param.second.value_double;
+    table.push_back(bp);
+  }
+}
+
+QByteArray BinaryMap::write(const MapSnapshot &snapshot, JobProgress *progress)
+{
+  BinaryStringTable strings;
+
+  BinaryHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, binary_format::MAGIC, sizeof(h.magic));
+  h.version = binary_format::VERSION;
+  h.byte_order = binary_format::BYTE_ORDER_MARK;
+  h.building_name = strings.add(snapshot.building_name);
+  h.num_levels = static_cast<uint32_t>(snapshot.levels.size());
+  h.levels_offset = sizeof(BinaryHeader);
+
+  // the header and level table are filled in at the end, once the
+  // offsets of everything else are known
+  vector<BinaryLevel> levels(snapshot.levels.size());
+  QByteArray out(
+      static_cast<int>(
+        sizeof(BinaryHeader) + levels.size() * sizeof(BinaryLevel)),
+      '\0');
+
+  for (size_t level_idx = 0; level_idx < snapshot.levels.size(); level_idx++) {
+    const Level &level = *snapshot.levels[level_idx];
+    if (progress) {
+      progress->check_cancelled();
+      progress->set_progress(
+          static_cast<double>(level_idx) / snapshot.levels.size(),
+          QString::fromStdString(level.name));
+    }
+
+    BinaryLevel &bl = levels[level_idx];
+    memset(&bl, 0, sizeof(bl));
+    bl.name = strings.add(level.name);
+    bl.drawing_filename = strings.add(level.drawing_filename);
+    bl.x_meters = level.x_meters;
+    bl.y_meters = level.y_meters;
+    bl.elevation = level.elevation;
+
+    vector<BinaryParam> params;
+
+    vector<BinaryVertex> vertices(level.vertices.size());
+    for (size_t i = 0; i < level.vertices.size(); i++) {
+      const Vertex &v = level.vertices[i];
+      BinaryVertex &bv = vertices[i];
+      bv.x = v.x;
+      bv.y = v.y;
+      bv.name = strings.add(v.name);
+      append_params(v.params, strings, params, bv.first_param, bv.num_params);
+    }
+
+    vector<BinaryEdge> edges(level.edges.size());
+    for (size_t i = 0; i < level.edges.size(); i++) {
+      const Edge &e = level.edges[i];
+      BinaryEdge &be = edges[i];
+      be.start_idx = static_cast<uint32_t>(e.start_idx);
+      be.end_idx = static_cast<uint32_t>(e.end_idx);
+      be.type = static_cast<uint32_t>(e.type);
+      be.reserved = 0;
+      append_params(e.params, strings, params, be.first_param, be.num_params);
+    }
+
+    vector<BinaryModel> models(level.models.size());
+    for (size_t i = 0; i < level.models.size(); i++) {
+      const Model &m = level.models[i];
+      BinaryModel &bm = models[i];
+      bm.x = m.x;
+      bm.y = m.y;
+      bm.yaw = m.yaw;
+      bm.model_name = strings.add(m.model_name);
+      bm.instance_name = strings.add(m.instance_name);
+    }
+
+    vector<BinaryPolygon> polygons(level.polygons.size());
+    vector<uint32_t> polygon_vertices;
+    for (size_t i = 0; i < level.polygons.size(); i++) {
+      const Polygon &p = level.polygons[i];
+      BinaryPolygon &bp = polygons[i];
+      bp.type = static_cast<uint32_t>(p.type);
+      bp.first_vertex = static_cast<uint32_t>(polygon_vertices.size());
+      bp.num_vertices = static_cast<uint32_t>(p.vertices.size());
+      bp.reserved = 0;
+      for (const int vertex_idx : p.vertices)
+        polygon_vertices.push_back(static_cast<uint32_t>(vertex_idx));
+    }
+
+    bl.vertices = append_table(out, vertices);
+    bl.edges = append_table(out, edges);
+    bl.models = append_table(out, models);
+    bl.polygons = append_table(out, polygons);
+    bl.polygon_vertices = append_table(out, polygon_vertices);
+    bl.params = append_table(out, params);
+  }
+
+  pad_to_8(out);
+  h.strings_offset = static_cast<uint64_t>(out.size());
+  h.strings_size = static_cast<uint64_t>(strings.bytes.size());
+  out.append(strings.bytes);
+  pad_to_8(out);
+  h.file_size = static_cast<uint64_t>(out.size());
+
+  memcpy(out.data(), &h, sizeof(h));
+  if (!levels.empty())
+    memcpy(
+        out.data() + sizeof(BinaryHeader),
+        levels.data(),
+        levels.size() * sizeof(BinaryLevel));
+  return out;
+}
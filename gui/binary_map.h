@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef BINARY_MAP_H
+#define BINARY_MAP_H
+
+/*
+ * Reads and writes binary project files (see binary_format.h). A
+ * BinaryMap maps the file into memory and hands out pointers into it,
+ * so tools that only need to look at a few tables don't have to parse
+ * the whole building. to_level() converts a level for the editor, and
+ * write() goes the other way.
+ *
+ * open() checks the header and that every table lies inside the file,
+ * which is cheap however big the building is. Strings, and the ranges
+ * that records refer to, are checked when they are used.
+ */
+
+#include <map>
+#include <string>
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "binary_format.h"
+#include "job.h"
+#include "level.h"
+class MapSnapshot;
+
+
+class BinaryMap
+{
+public:
+  BinaryMap();
+  ~BinaryMap();
+
+  static const char *SUFFIX;  // "tebin"
+
+  /// Is this the name of a binary project file, going by its suffix?
+  static bool is_binary_filename(const QString &filename);
+
+  /// Map the file and check its structure. Returns false and sets error
+  /// if it isn't a binary project file this version can read.
+  bool open(const QString &filename, std::string &error);
+
+  const binary_format::BinaryHeader &header() const
+  { return *reinterpret_cast<const binary_format::BinaryHeader *>(data); }
+
+  int num_levels() const { return static_cast<int>(header().num_levels); }
+  const binary_format::BinaryLevel &get_level(const int level_idx) const;
+
+  /// The records of a table, which has table.count of them
+  template <typename T>
+  const T *table(const binary_format::BinaryTable &t) const
+  { return reinterpret_cast<const T *>(data + t.offset); }
+
+  /// Throws if the string isn't inside the string table
+  std::string get_string(const binary_format::BinaryString &s) const;
+
+  /// Fill in a Level from one of the levels in the file, including its
+  /// drawing. Throws if the level refers to things that aren't there.
+  bool to_level(
+      const int level_idx,
+      Level &level,
+      const QString &project_dir = QString(),
+      JobProgress *progress = nullptr) const;
+
+  /// Serialize a snapshot into the contents of a binary project file
+  static QByteArray write(
+      const MapSnapshot &snapshot,
+      JobProgress *progress = nullptr);
+
+private:
+  QFile file;
+  QByteArray buffer;  // only used if the file can't be mapped
+  const uchar *data;
+  qint64 size;
+
+  bool check_table(
+      const binary_format::BinaryTable &t,
+      const size_t record_size) const;
+  void read_params(
+      const binary_format::BinaryLevel &bl,
+      const uint32_t first_param,
+      const uint32_t num_params,
+      std::map<std::string, Param> &params) const;
+};
+
+#endif
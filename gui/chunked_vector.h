@@ -0,0 +1,262 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef CHUNKED_VECTOR_H
+#define CHUNKED_VECTOR_H
+
+/*
+ * A vector that keeps its elements in fixed-size chunks, each of which
+ * can be shared by several copies of the vector. Copying one only copies
+ * the chunk pointers; a chunk is copied the first time a copy that shares
+ * it is written to, so two versions of a level cost memory in proportion
+ * to what changed between them.
+ *
+ * Any access through a non-const ChunkedVector (operator[], iterators,
+ * back()) counts as a write, so code that only reads should do so through
+ * a const reference to avoid copying chunks needlessly.
+ *
+ * A copy can be read on another thread while the original is changed,
+ * as long as each ChunkedVector object is only used by one thread at a
+ * time: shared chunks are never written to.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+template <typename T>
+class ChunkedVector
+{
+public:
+  typedef T value_type;
+  typedef size_t size_type;
+  typedef ptrdiff_t difference_type;
+  typedef T &reference;
+  typedef const T &const_reference;
+
+  const static size_t CHUNK_BITS = 8;
+  const static size_t CHUNK_SIZE = size_t(1) << CHUNK_BITS;
+
+  ChunkedVector() : num_elements(0) {}
+
+  /// Random access to a ChunkedVector by index. Dereferencing an iterator
+  /// of a non-const vector is a write, in the same way as operator[].
+  template <typename Vec, typename Ref>
+  class Iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef ptrdiff_t difference_type;
+    typedef Ref reference;
+    typedef typename std::remove_reference<Ref>::type *pointer;
+
+    Iterator() : vec(nullptr), idx(0) {}
+    Iterator(Vec *_vec, const size_t _idx) : vec(_vec), idx(_idx) {}
+
+    // iterator converts to const_iterator
+    template <typename V, typename R>
+    Iterator(const Iterator<V, R> &other) : vec(other.vec), idx(other.idx) {}
+
+    reference operator*() const { return (*vec)[idx]; }
+    pointer operator->() const { return &(*vec)[idx]; }
+    reference operator[](const difference_type n) const
+    {
+      return (*vec)[idx + n];
+    }
+
+    Iterator &operator++() { ++idx; return *this; }
+    Iterator &operator--() { --idx; return *this; }
+    Iterator operator++(int) { Iterator it(*this); ++idx; return it; }
+    Iterator operator--(int) { Iterator it(*this); --idx; return it; }
+    Iterator &operator+=(const difference_type n) { idx += n; return *this; }
+    Iterator &operator-=(const difference_type n) { idx -= n; return *this; }
+    Iterator operator+(const difference_type n) const
+    {
+      return Iterator(vec, idx + n);
+    }
+    Iterator operator-(const difference_type n) const
+    {
+      return Iterator(vec, idx - n);
+    }
+    friend Iterator operator+(const difference_type n, const Iterator &it)
+    {
+      return it + n;
+    }
+    difference_type operator-(const Iterator &other) const
+    {
+      return static_cast<difference_type>(idx) -
+          static_cast<difference_type>(other.idx);
+    }
+
+    bool operator==(const Iterator &other) const { return idx == other.idx; }
+    bool operator!=(const Iterator &other) const { return idx != other.idx; }
+    bool operator<(const Iterator &other) const { return idx < other.idx; }
+    bool operator>(const Iterator &other) const { return idx > other.idx; }
+    bool operator<=(const Iterator &other) const { return idx <= other.idx; }
+    bool operator>=(const Iterator &other) const { return idx >= other.idx; }
+
+  private:
+    template <typename V, typename R> friend class Iterator;
+    friend class ChunkedVector;
+    Vec *vec;
+    size_t idx;
+  };
+
+  typedef Iterator<ChunkedVector, T &> iterator;
+  typedef Iterator<const ChunkedVector, const T &> const_iterator;
+
+  size_t size() const { return num_elements; }
+  bool empty() const { return num_elements == 0; }
+
+  const T &operator[](const size_t idx) const
+  {
+    return (*chunks[idx >> CHUNK_BITS])[idx & (CHUNK_SIZE - 1)];
+  }
+
+  T &operator[](const size_t idx)
+  {
+    return writable_chunk(idx >> CHUNK_BITS)[idx & (CHUNK_SIZE - 1)];
+  }
+
+  const T &back() const { return (*this)[num_elements - 1]; }
+  T &back() { return (*this)[num_elements - 1]; }
+
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, num_elements); }
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, num_elements); }
+
+  void push_back(const T &value)
+  {
+    last_chunk_with_room().push_back(value);
+    num_elements++;
+  }
+
+  void push_back(T &&value)
+  {
+    last_chunk_with_room().push_back(std::move(value));
+    num_elements++;
+  }
+
+  void pop_back()
+  {
+    resize(num_elements - 1);
+  }
+
+  void clear()
+  {
+    chunks.clear();
+    num_elements = 0;
+  }
+
+  /// Only the chunk pointers are reserved; chunks are allocated whole.
+  void reserve(const size_t n)
+  {
+    chunks.reserve((n + CHUNK_SIZE - 1) >> CHUNK_BITS);
+  }
+
+  void resize(const size_t n, const T &value = T())
+  {
+    if (n < num_elements) {
+      const size_t num_chunks = (n + CHUNK_SIZE - 1) >> CHUNK_BITS;
+      chunks.resize(num_chunks);
+      if (n & (CHUNK_SIZE - 1))
+        writable_chunk(num_chunks - 1).resize(n & (CHUNK_SIZE - 1));
+      num_elements = n;
+    }
+    while (num_elements < n)
+      push_back(value);
+  }
+
+  void swap(ChunkedVector &other)
+  {
+    chunks.swap(other.chunks);
+    std::swap(num_elements, other.num_elements);
+  }
+
+  /// Linear in the number of elements after pos, as for std::vector
+  template <typename InputIt>
+  iterator insert(const_iterator pos, InputIt first, InputIt last)
+  {
+    const size_t idx = pos.idx;
+    const size_t old_size = num_elements;
+    for (; first != last; ++first)
+      push_back(*first);
+    std::rotate(begin() + idx, begin() + old_size, end());
+    return begin() + idx;
+  }
+
+  iterator insert(const_iterator pos, const T &value)
+  {
+    return insert(pos, &value, &value + 1);
+  }
+
+  iterator erase(const_iterator first, const_iterator last)
+  {
+    const size_t idx = first.idx;
+    if (first != last) {
+      std::move(begin() + last.idx, end(), begin() + idx);
+      resize(num_elements - (last.idx - idx));
+    }
+    return begin() + idx;
+  }
+
+  iterator erase(const_iterator pos)
+  {
+    return erase(pos, pos + 1);
+  }
+
+private:
+  typedef std::vector<T> Chunk;
+  std::vector<std::shared_ptr<Chunk> > chunks;
+  size_t num_elements;
+
+  Chunk &writable_chunk(const size_t chunk_idx)
+  {
+    std::shared_ptr<Chunk> &chunk = chunks[chunk_idx];
+    if (chunk.use_count() == 1) {
+      // whoever else had it has let go; see their writes before ours
+      std::atomic_thread_fence(std::memory_order_acquire);
+    }
+    else {
+      std::shared_ptr<Chunk> copy = std::make_shared<Chunk>();
+      copy->reserve(CHUNK_SIZE);
+      copy->insert(copy->end(), chunk->begin(), chunk->end());
+      chunk = copy;
+    }
+    return *chunk;
+  }
+
+  Chunk &last_chunk_with_room()
+  {
+    if (num_elements == (chunks.size() << CHUNK_BITS)) {
+      chunks.push_back(std::make_shared<Chunk>());
+      chunks.back()->reserve(CHUNK_SIZE);
+      return *chunks.back();
+    }
+    return writable_chunk(chunks.size() - 1);
+  }
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+
+#include <QFileInfo>
+#include <QImageReader>
+#include <QPainter>
+#include <QSettings>
+
+#include "drawing.h"
+#include "preferences_keys.h"
+using std::vector;
+
+const int Drawing::TILE_SIZE;
+
+
+Drawing::Drawing()
+: drawing_width(0),
+  drawing_height(0),
+  tiles_x(0),
+  tiles_y(0),
+  serial(0),
+  overview_factor(1)
+{
+}
+
+Drawing::~Drawing()
+{
+}
+
+Drawing::Storage Drawing::storage_from_settings()
+{
+  QSettings settings;
+  const int storage = settings.value(
+      preferences_keys::drawing_storage, STORAGE_AUTO).toInt();
+  if (storage < STORAGE_AUTO || storage > STORAGE_MONO)
+    return STORAGE_AUTO;
+  return static_cast<Storage>(storage);
+}
+
+bool Drawing::load(
+    const QString &filename,
+    const Storage storage,
+    JobProgress *progress)
+{
+  static std::atomic<qint64> next_serial(1);
+
+  if (progress)
+    progress->set_progress(0.0, "decoding " + QFileInfo(filename).fileName());
+
+  QImageReader image_reader(filename);
+  image_reader.setAutoTransform(true);
+  QImage image = image_reader.read();
+  if (image.isNull()) {
+    qWarning("unable to read %s: %s",
+        qUtf8Printable(filename),
+        qUtf8Printable(image_reader.errorString()));
+    return false;
+  }
+
+  drawing_width = image.width();
+  drawing_height = image.height();
+  tiles_x = (drawing_width + TILE_SIZE - 1) / TILE_SIZE;
+  tiles_y = (drawing_height + TILE_SIZE - 1) / TILE_SIZE;
+  serial = next_serial++;
+
+  // the overview is box-filtered from the grayscale tiles as they go by,
+  // so the grayscale version of the whole drawing never exists at once
+  overview_factor = std::max(
+      1,
+      (std::max(drawing_width, drawing_height) + OVERVIEW_SIZE - 1) /
+        OVERVIEW_SIZE);
+  const int ow = (drawing_width + overview_factor - 1) / overview_factor;
+  const int oh = (drawing_height + overview_factor - 1) / overview_factor;
+  vector<uint32_t> overview_sums;
+  if (overview_factor > 1)
+    overview_sums.resize(static_cast<size_t>(ow) * oh, 0);
+
+  tiles.clear();
+  tiles.reserve(static_cast<size_t>(tiles_x) * tiles_y);
+  const int n = tiles_x * tiles_y;
+  if (progress)
+    progress->set_progress(0.0, "tiling " + QFileInfo(filename).fileName());
+  for (int tile_idx = 0; tile_idx < n; tile_idx++) {
+    if (progress && tile_idx % tiles_x == 0) {
+      progress->check_cancelled();
+      progress->set_progress(static_cast<double>(tile_idx) / n);
+    }
+    const QRect r = tile_rect(tile_idx);
+    QImage gray = image.copy(r);
+    if (gray.format() != QImage::Format_Grayscale8)
+      gray = gray.convertToFormat(QImage::Format_Grayscale8);
+
+    if (!overview_sums.empty()) {
+      for (int y = 0; y < r.height(); y++) {
+        const uchar *line = gray.constScanLine(y);
+        const size_t oy = static_cast<size_t>(r.y() + y) / overview_factor;
+        uint32_t *sums = &overview_sums[oy * ow];
+        for (int x = 0; x < r.width(); x++)
+          sums[(r.x() + x) / overview_factor] += line[x];
+      }
+    }
+
+    tiles.push_back(compress_tile(gray, storage));
+  }
+  image = QImage();  // the decoded file can be huge; let it go now
+
+  overview = QImage();
+  if (!overview_sums.empty()) {
+    overview = QImage(ow, oh, QImage::Format_Grayscale8);
+    for (int oy = 0; oy < oh; oy++) {
+      // the last row and column of the overview cover fewer pixels
+      const int ny =
+          std::min(overview_factor, drawing_height - oy * overview_factor);
+      uchar *line = overview.scanLine(oy);
+      for (int ox = 0; ox < ow; ox++) {
+        const int nx =
+            std::min(overview_factor, drawing_width - ox * overview_factor);
+        line[ox] = static_cast<uchar>(
+            overview_sums[static_cast<size_t>(oy) * ow + ox] / (nx * ny));
+      }
+    }
+  }
+
+  printf("  drawing %dx%d: %d tiles, %.1f MB\n",
+      drawing_width,
+      drawing_height,
+      num_tiles(),
+      memory_bytes() / (1024.0 * 1024.0));
+  return true;
+}
+
+Drawing::Tile Drawing::compress_tile(const QImage &gray, const Storage storage)
+{
+  const uchar first = gray.constScanLine(0)[0];
+  bool uniform = true;
+  bool bilevel = true;
+  for (int y = 0; y < gray.height() && (uniform || bilevel); y++) {
+    const uchar *line = gray.constScanLine(y);
+    for (int x = 0; x < gray.width(); x++) {
+      if (line[x] != first)
+        uniform = false;
+      if (line[x] != 0 && line[x] != 255)
+        bilevel = false;
+    }
+  }
+
+  Tile tile;
+  if (uniform) {
+    // no image needed at all
+    if (storage == STORAGE_MONO)
+      tile.fill_gray = first >= 128 ? 255 : 0;
+    else
+      tile.fill_gray = first;
+    return tile;
+  }
+
+  tile.fill_gray = 0;
+
+  if (storage == STORAGE_MONO || (storage == STORAGE_AUTO && bilevel))
+    tile.image = gray.convertToFormat(QImage::Format_Mono, Qt::ThresholdDither);
+  else
+    tile.image = gray;
+  return tile;
+}
+
+QRect Drawing::tile_rect(const int tile_idx) const
+{
+  const int x = (tile_idx % tiles_x) * TILE_SIZE;
+  const int y = (tile_idx / tiles_x) * TILE_SIZE;
+  return QRect(
+      x,
+      y,
+      std::min(TILE_SIZE, drawing_width - x),
+      std::min(TILE_SIZE, drawing_height - y));
+}
+
+bool Drawing::use_overview(const double view_scale) const
+{
+  // only once the overview has at least one pixel per screen pixel
+  return !overview.isNull() && view_scale * overview_factor <= 1.0;
+}
+
+QRectF Drawing::overview_rect(const QRectF &rect) const
+{
+  // the overview is stretched over the whole drawing, so that its last
+  // (partial) row and column line up with the drawing's edges
+  const double fx = static_cast<double>(drawing_width) / overview.width();
+  const double fy = static_cast<double>(drawing_height) / overview.height();
+  return QRectF(
+      rect.x() / fx,
+      rect.y() / fy,
+      rect.width() / fx,
+      rect.height() / fy);
+}
+
+void Drawing::tiles_in_rect(const QRectF &rect, vector<int> &tile_indices) const
+{
+  tile_indices.clear();
+  if (tiles.empty())
+    return;
+  const int x0 = std::max(
+      0, static_cast<int>(std::floor(rect.left() / TILE_SIZE)));
+  const int y0 = std::max(
+      0, static_cast<int>(std::floor(rect.top() / TILE_SIZE)));
+  const int x1 = std::min(
+      tiles_x - 1, static_cast<int>(std::floor(rect.right() / TILE_SIZE)));
+  const int y1 = std::min(
+      tiles_y - 1, static_cast<int>(std::floor(rect.bottom() / TILE_SIZE)));
+  for (int y = y0; y <= y1; y++)
+    for (int x = x0; x <= x1; x++)
+      tile_indices.push_back(y * tiles_x + x);
+}
+
+std::size_t Drawing::memory_bytes() const
+{
+  std::size_t bytes = overview.byteCount();
+  for (const Tile &tile : tiles)
+    bytes += tile.image.byteCount();
+  return bytes;
+}
+
+void Drawing::paint(
+    QPainter *painter,
+    const QRectF &exposed,
+    const double view_scale) const
+{
+  const QRectF target = exposed & QRectF(0, 0, drawing_width, drawing_height);
+  if (target.isEmpty())
+    return;
+
+  if (use_overview(view_scale)) {
+    painter->drawImage(target, overview, overview_rect(target));
+    return;
+  }
+
+  vector<int> visible;
+  tiles_in_rect(target, visible);
+  for (const int tile_idx : visible) {
+    const Tile &tile = tiles[tile_idx];
+    if (tile.image.isNull()) {
+      painter->fillRect(
+          tile_rect(tile_idx),
+          QColor(tile.fill_gray, tile.fill_gray, tile.fill_gray));
+    }
+    else
+      painter->drawImage(tile_rect(tile_idx).topLeft(), tile.image);
+  }
+}
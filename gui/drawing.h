@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef DRAWING_H
+#define DRAWING_H
+
+/*
+ * A level drawing, kept in memory as compact tiles instead of one big
+ * QPixmap (which is 32 bits per pixel on most backends). Each tile is
+ * stored in the smallest form that holds it exactly:
+ *
+ *   - a single gray value, if the tile is blank (margins, empty rooms)
+ *   - 1 bit per pixel, if the tile is only black and white
+ *   - 8 bits per pixel otherwise
+ *
+ * Tiles are only expanded for display when they are on screen; see
+ * DrawingItem. A small grayscale overview is kept for zoomed-out views,
+ * so those don't have to touch every tile.
+ *
+ * A Drawing is immutable once loaded, and safe to paint from any thread.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include <QImage>
+#include <QRectF>
+#include <QString>
+
+#include "job.h"
+class QPainter;
+
+
+class Drawing
+{
+public:
+  enum Storage {
+    STORAGE_AUTO = 0,  // 1 bit per pixel where it is lossless
+    STORAGE_GRAYSCALE,  // never drop below 8 bits per pixel
+    STORAGE_MONO  // threshold everything to 1 bit per pixel
+  };
+
+  static const int TILE_SIZE = 512;
+  static const int OVERVIEW_SIZE = 2048;
+
+  Drawing();
+  ~Drawing();
+
+  /// Read the storage preference
+  static Storage storage_from_settings();
+
+  /// Decode an image file and split it into tiles. Returns false (after
+  /// printing a warning) if the file can't be read. Progress is reported
+  /// while tiling; the decoding itself can't be interrupted.
+  bool load(
+      const QString &filename,
+      const Storage storage,
+      JobProgress *progress = nullptr);
+
+  int width() const { return drawing_width; }
+  int height() const { return drawing_height; }
+
+  /// Unique for every loaded drawing, for use in cache keys
+  qint64 get_serial() const { return serial; }
+
+  int num_tiles() const { return static_cast<int>(tiles.size()); }
+  QRect tile_rect(const int tile_idx) const;
+
+  /// The tile's image, or a null image if the whole tile is fill_gray
+  const QImage &tile_image(const int tile_idx) const
+  { return tiles[tile_idx].image; }
+  int tile_fill_gray(const int tile_idx) const
+  { return tiles[tile_idx].fill_gray; }
+
+  const QImage &get_overview() const { return overview; }
+
+  /// Use the overview instead of the tiles at this view scale?
+  bool use_overview(const double view_scale) const;
+
+  /// The part of the overview image that covers this drawing rectangle
+  QRectF overview_rect(const QRectF &rect) const;
+
+  /// Indices of the tiles that intersect this rectangle
+  void tiles_in_rect(const QRectF &rect, std::vector<int> &tile_indices) const;
+
+  /// Bytes used by the tiles and the overview
+  std::size_t memory_bytes() const;
+
+  /// Paint the part of the drawing in the exposed rectangle straight
+  /// from the stored images. This is what the tile renderers use; the
+  /// UI thread goes through DrawingItem and its pixmap cache instead.
+  void paint(
+      QPainter *painter,
+      const QRectF &exposed,
+      const double view_scale) const;
+
+private:
+  struct Tile
+  {
+    QImage image;
+    int fill_gray;  // only used if image is null
+  };
+
+  int drawing_width, drawing_height;
+  int tiles_x, tiles_y;
+  qint64 serial;
+  std::vector<Tile> tiles;
+
+  QImage overview;  // Format_Grayscale8, at most OVERVIEW_SIZE square
+  int overview_factor;  // drawing pixels per overview pixel
+
+  static Tile compress_tile(const QImage &gray, const Storage storage);
+};
+
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <vector>
+
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+#include "drawing_item.h"
+
+
+DrawingItem::DrawingItem(
+    const std::shared_ptr<const Drawing> &_drawing,
+    DrawingPixmapCache &_pixmap_cache)
+: drawing(_drawing),
+  pixmap_cache(_pixmap_cache)
+{
+  // exposedRect is only filled in with this flag set
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+DrawingItem::~DrawingItem()
+{
+}
+
+QRectF DrawingItem::boundingRect() const
+{
+  return QRectF(0, 0, drawing->width(), drawing->height());
+}
+
+void DrawingItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *option,
+    QWidget *)
+{
+  const QRectF target = option->exposedRect & boundingRect();
+  if (target.isEmpty())
+    return;
+
+  const double view_scale =
+      QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform());
+  if (drawing->use_overview(view_scale)) {
+    painter->drawPixmap(
+        target,
+        pixmap_cache.overview(*drawing),
+        drawing->overview_rect(target));
+    return;
+  }
+
+  std::vector<int> visible;
+  drawing->tiles_in_rect(target, visible);
+  for (const int tile_idx : visible) {
+    const QRect r = drawing->tile_rect(tile_idx);
+    if (drawing->tile_image(tile_idx).isNull()) {
+      const int gray = drawing->tile_fill_gray(tile_idx);
+      painter->fillRect(r, QColor(gray, gray, gray));
+    }
+    else
+      painter->drawPixmap(r.topLeft(), pixmap_cache.tile(*drawing, tile_idx));
+  }
+}
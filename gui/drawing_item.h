@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef DRAWING_ITEM_H
+#define DRAWING_ITEM_H
+
+/*
+ * The level drawing in the scene. Only the tiles in the exposed
+ * rectangle are drawn, converted to pixmaps on demand through a
+ * DrawingPixmapCache, and the overview is used instead when zoomed out.
+ */
+
+#include <memory>
+
+#include <QGraphicsItem>
+
+#include "drawing.h"
+#include "drawing_pixmap_cache.h"
+
+
+class DrawingItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 4 };
+
+  DrawingItem(
+      const std::shared_ptr<const Drawing> &_drawing,
+      DrawingPixmapCache &_pixmap_cache);
+  ~DrawingItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+private:
+  std::shared_ptr<const Drawing> drawing;
+  DrawingPixmapCache &pixmap_cache;
+};
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include "drawing_pixmap_cache.h"
+
+
+DrawingPixmapCache::DrawingPixmapCache()
+{
+  set_memory_budget(128);
+}
+
+DrawingPixmapCache::~DrawingPixmapCache()
+{
+}
+
+void DrawingPixmapCache::set_memory_budget(const int megabytes)
+{
+  pixmaps.setMaxCost(std::max(1, megabytes) * 1024);
+}
+
+void DrawingPixmapCache::clear()
+{
+  pixmaps.clear();
+}
+
+QPixmap DrawingPixmapCache::tile(const Drawing &drawing, const int tile_idx)
+{
+  // tile 0 is key 1, leaving key 0 of every drawing for the overview
+  const qint64 key = (drawing.get_serial() << 32) | (tile_idx + 1);
+  const QPixmap *cached = pixmaps.object(key);
+  if (cached)
+    return *cached;
+  return insert(key, drawing.tile_image(tile_idx));
+}
+
+QPixmap DrawingPixmapCache::overview(const Drawing &drawing)
+{
+  const qint64 key = drawing.get_serial() << 32;
+  const QPixmap *cached = pixmaps.object(key);
+  if (cached)
+    return *cached;
+  return insert(key, drawing.get_overview());
+}
+
+QPixmap DrawingPixmapCache::insert(const qint64 key, const QImage &image)
+{
+  QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+  const QPixmap result(*pixmap);
+  const qint64 bytes =
+      static_cast<qint64>(pixmap->width()) * pixmap->height() *
+      std::max(8, pixmap->depth()) / 8;
+  const int cost = static_cast<int>(std::max<qint64>(1, bytes / 1024));
+  pixmaps.insert(key, pixmap, std::min(cost, pixmaps.maxCost()));
+  return result;
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef DRAWING_PIXMAP_CACHE_H
+#define DRAWING_PIXMAP_CACHE_H
+
+/*
+ * Display copies of drawing tiles. Drawings are stored as compact
+ * 1- and 8-bit tiles (see Drawing), which the UI thread can't draw
+ * quickly; this keeps QPixmap versions of the tiles that were on screen
+ * recently, bounded by a memory budget.
+ */
+
+#include <QCache>
+#include <QPixmap>
+
+#include "drawing.h"
+
+
+class DrawingPixmapCache
+{
+public:
+  DrawingPixmapCache();
+  ~DrawingPixmapCache();
+
+  void set_memory_budget(const int megabytes);
+  void clear();
+
+  /// The pixmap of a tile that has an image (see Drawing::tile_image())
+  QPixmap tile(const Drawing &drawing, const int tile_idx);
+
+  /// The pixmap of the drawing's overview
+  QPixmap overview(const Drawing &drawing);
+
+private:
+  QCache<qint64, QPixmap> pixmaps;  // cost is in kilobytes
+
+  QPixmap insert(const qint64 key, const QImage &image);
+};
+
+#endif
@@ -0,0 +1,424 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <limits>
+
+#include "edge_crossings.h"
+using std::vector;
+
+
+EdgeCrossings::EdgeCrossings()
+: probe(-1),
+  eps(0.0),
+  sweep_x(0.0),
+  sweep_y(0.0),
+  status(StatusOrder{this})
+{
+}
+
+EdgeCrossings::~EdgeCrossings()
+{
+}
+
+int EdgeCrossings::count(const Kind kind) const
+{
+  int n = 0;
+  for (const Crossing &crossing : crossings) {
+    if (crossing.kind == kind)
+      n++;
+  }
+  return n;
+}
+
+uint64_t EdgeCrossings::pair_key(const int a, const int b)
+{
+  return (static_cast<uint64_t>(std::min(a, b)) << 32) |
+      static_cast<uint32_t>(std::max(a, b));
+}
+
+void EdgeCrossings::find(const Level &level)
+{
+  const double inf = std::numeric_limits<double>::infinity();
+  segments.clear();
+  queue.clear();
+  status.clear();
+  scheduled.clear();
+  reported.clear();
+  crossings.clear();
+
+  const int num_vertices = static_cast<int>(level.vertices.size());
+  double min_x = inf, min_y = inf, max_x = -inf, max_y = -inf;
+  vector<double> xs, ys;
+  for (size_t i = 0; i < level.edges.size(); i++) {
+    const Edge &edge = level.edges[i];
+    if (edge.type != Edge::LANE &&
+        edge.type != Edge::WALL &&
+        edge.type != Edge::DOOR)
+      continue;
+    if (edge.start_idx < 0 || edge.start_idx >= num_vertices ||
+        edge.end_idx < 0 || edge.end_idx >= num_vertices)
+      continue;
+    const Vertex &v1 = level.vertices[edge.start_idx];
+    const Vertex &v2 = level.vertices[edge.end_idx];
+
+    Segment segment;
+    segment.left = QPointF(v1.x, v1.y);
+    segment.right = QPointF(v2.x, v2.y);
+    segment.edge_idx = static_cast<int>(i);
+    segment.start_idx = edge.start_idx;
+    segment.end_idx = edge.end_idx;
+    segment.type = edge.type;
+    segments.push_back(segment);
+
+    xs.push_back(v1.x);
+    xs.push_back(v2.x);
+    ys.push_back(v1.y);
+    ys.push_back(v2.y);
+    min_x = std::min(min_x, std::min(v1.x, v2.x));
+    min_y = std::min(min_y, std::min(v1.y, v2.y));
+    max_x = std::max(max_x, std::max(v1.x, v2.x));
+    max_y = std::max(max_y, std::max(v1.y, v2.y));
+  }
+  if (segments.empty())
+    return;
+
+  // points closer than this are the same point; it is far below
+  // anything that can be drawn, but well above the rounding error of
+  // the computed intersections
+  eps = 1e-10 * std::max(1.0, std::max(max_x - min_x, max_y - min_y));
+
+  // Coordinates that only differ by rounding are made exactly equal.
+  // Otherwise the sweep would see a vertex a hair to the left of a
+  // vertical wall as coming before the wall, and miss that they touch.
+  std::sort(xs.begin(), xs.end());
+  std::sort(ys.begin(), ys.end());
+  vector<double> snapped_xs(xs), snapped_ys(ys);
+  for (size_t i = 1; i < xs.size(); i++) {
+    if (xs[i] - xs[i - 1] <= eps)
+      snapped_xs[i] = snapped_xs[i - 1];
+    if (ys[i] - ys[i - 1] <= eps)
+      snapped_ys[i] = snapped_ys[i - 1];
+  }
+  auto snap = [&](const QPointF &point) {
+    return QPointF(
+        snapped_xs[std::lower_bound(xs.begin(), xs.end(), point.x()) -
+          xs.begin()],
+        snapped_ys[std::lower_bound(ys.begin(), ys.end(), point.y()) -
+          ys.begin()]);
+  };
+
+  size_t num_kept = 0;
+  for (Segment &segment : segments) {
+    segment.left = snap(segment.left);
+    segment.right = snap(segment.right);
+    const QPointF &l = segment.left;
+    const QPointF &r = segment.right;
+    if (l.x() == r.x() && l.y() == r.y())
+      continue;  // nothing to cross
+    if (r.x() < l.x() || (r.x() == l.x() && r.y() < l.y()))
+      std::swap(segment.left, segment.right);
+    const double dx = segment.right.x() - segment.left.x();
+    const double dy = segment.right.y() - segment.left.y();
+    segment.slope = dx > 0.0 ? dy / dx : inf;
+    segments[num_kept++] = segment;
+  }
+  segments.resize(num_kept);
+
+  // the probe is a point at the event, below everything that passes
+  // through it, for finding those in the status
+  Segment probe_segment;
+  probe_segment.slope = -inf;
+  probe_segment.edge_idx = -1;
+  probe_segment.start_idx = probe_segment.end_idx = -1;
+  probe_segment.type = Edge::UNDEFINED;
+  segments.push_back(probe_segment);
+  probe = static_cast<int>(segments.size()) - 1;
+
+  handles.assign(segments.size(), status.end());
+  in_status.assign(segments.size(), false);
+  for (int i = 0; i < probe; i++) {
+    event_at(segments[i].left, true).starting.push_back(i);
+    event_at(segments[i].right, true).ending.push_back(i);
+  }
+
+  while (!queue.empty()) {
+    EventQueue::iterator it = queue.begin();
+    const QPointF p(it->first.first, it->first.second);
+    Event event;
+    std::swap(event, it->second);
+    queue.erase(it);
+    handle_event(p, event);
+  }
+  status.clear();
+
+  std::sort(
+      crossings.begin(),
+      crossings.end(),
+      [](const Crossing &a, const Crossing &b) {
+        return a.lane_idx < b.lane_idx ||
+            (a.lane_idx == b.lane_idx && a.other_idx < b.other_idx);
+      });
+}
+
+EdgeCrossings::Event &EdgeCrossings::event_at(
+    const QPointF &point,
+    const bool at_vertex)
+{
+  // merge with an event that is already there, give or take rounding
+  const std::pair<double, double> key(point.x(), point.y());
+  EventQueue::iterator it = queue.lower_bound(
+      std::make_pair(
+        point.x() - eps, -std::numeric_limits<double>::infinity()));
+  for (; it != queue.end() && it->first.first <= point.x() + eps; ++it) {
+    if (std::fabs(it->first.second - point.y()) > eps)
+      continue;
+
+    // Vertices are exact, so an event at one stays there. Between two
+    // computed points, the first one wins, so that the event isn't
+    // swept after a vertical segment through it has ended.
+    if (it->second.at_vertex || (!at_vertex && !(key < it->first)))
+      return it->second;
+    Event event;
+    std::swap(event, it->second);
+    queue.erase(it);
+    Event &moved = queue[key];
+    std::swap(moved, event);
+    moved.at_vertex = at_vertex;
+    return moved;
+  }
+  Event &event = queue[key];
+  event.at_vertex = at_vertex;
+  return event;
+}
+
+double EdgeCrossings::y_at_sweep(const Segment &segment) const
+{
+  // vertical segments (and the probe) are wherever the event is on them
+  const double y0 = std::min(segment.left.y(), segment.right.y());
+  const double y1 = std::max(segment.left.y(), segment.right.y());
+  if (std::isinf(segment.slope))
+    return std::max(y0, std::min(y1, sweep_y));
+  const double y =
+      segment.left.y() + (sweep_x - segment.left.x()) * segment.slope;
+  return std::max(y0, std::min(y1, y));
+}
+
+bool EdgeCrossings::status_less(const int a, const int b) const
+{
+  if (a == b)
+    return false;
+  const Segment &sa = segments[a];
+  const Segment &sb = segments[b];
+  const double ya = y_at_sweep(sa);
+  const double yb = y_at_sweep(sb);
+  if (std::fabs(ya - yb) > eps)
+    return ya < yb;
+  // they meet at the sweep line, so go by how they leave it
+  if (sa.slope != sb.slope)
+    return sa.slope < sb.slope;
+  return a < b;
+}
+
+bool EdgeCrossings::passes_through_sweep(const int segment_idx) const
+{
+  return std::fabs(y_at_sweep(segments[segment_idx]) - sweep_y) <= eps;
+}
+
+bool EdgeCrossings::near(const QPointF &a, const QPointF &b) const
+{
+  return std::fabs(a.x() - b.x()) <= eps && std::fabs(a.y() - b.y()) <= eps;
+}
+
+bool EdgeCrossings::intersect(const int a, const int b, QPointF &point) const
+{
+  const Segment &sa = segments[a];
+  const Segment &sb = segments[b];
+  const QPointF r = sa.right - sa.left;
+  const QPointF s = sb.right - sb.left;
+  const QPointF q = sb.left - sa.left;
+  const double d = r.x() * s.y() - r.y() * s.x();
+  const double rs = std::hypot(r.x(), r.y()) * std::hypot(s.x(), s.y());
+  if (std::fabs(d) <= 1e-12 * rs)
+    return false;  // parallel; overlaps are found at the endpoint events
+
+  const double t = (q.x() * s.y() - q.y() * s.x()) / d;
+  const double u = (q.x() * r.y() - q.y() * r.x()) / d;
+  const double eps_t = 1e-9;
+  if (t < -eps_t || t > 1.0 + eps_t || u < -eps_t || u > 1.0 + eps_t)
+    return false;
+
+  // at an endpoint, use it exactly, so the event lands on its own
+  if (t <= eps_t)
+    point = sa.left;
+  else if (t >= 1.0 - eps_t)
+    point = sa.right;
+  else if (u <= eps_t)
+    point = sb.left;
+  else if (u >= 1.0 - eps_t)
+    point = sb.right;
+  else {
+    // keep it inside both bounding boxes, so that crossing a vertical
+    // segment happens at exactly its x, and not just after its end
+    point = sa.left + t * r;
+    const double x0 = std::max(sa.left.x(), sb.left.x());
+    const double x1 = std::min(sa.right.x(), sb.right.x());
+    const double y0 = std::max(
+        std::min(sa.left.y(), sa.right.y()),
+        std::min(sb.left.y(), sb.right.y()));
+    const double y1 = std::min(
+        std::max(sa.left.y(), sa.right.y()),
+        std::max(sb.left.y(), sb.right.y()));
+    point = QPointF(
+        std::max(x0, std::min(x1, point.x())),
+        std::max(y0, std::min(y1, point.y())));
+  }
+  return true;
+}
+
+void EdgeCrossings::handle_event(const QPointF &p, const Event &event)
+{
+  sweep_x = p.x();
+  sweep_y = p.y();
+  segments[probe].left = segments[probe].right = p;
+
+  // the segments that pass through p are next to each other in the
+  // status, just above the probe
+  Status::iterator first = status.lower_bound(probe);
+  Status::iterator last = first;
+  vector<int> through;
+  while (last != status.end() && passes_through_sweep(*last))
+    through.push_back(*last++);
+  vector<int> touched;  // left in the status, with new neighbours
+  if (first != status.begin())
+    touched.push_back(*std::prev(first));
+  if (last != status.end())
+    touched.push_back(*last);
+  status.erase(first, last);
+  for (const int s : through)
+    in_status[s] = false;
+
+  // rounding may have put a segment that ends or crosses here just
+  // outside of that
+  for (const vector<int> *list : { &event.ending, &event.crossing }) {
+    for (const int s : *list) {
+      if (!in_status[s])
+        continue;
+      const Status::iterator it = handles[s];
+      if (it != status.begin())
+        touched.push_back(*std::prev(it));
+      if (std::next(it) != status.end())
+        touched.push_back(*std::next(it));
+      status.erase(it);
+      in_status[s] = false;
+      through.push_back(s);
+    }
+  }
+
+  vector<int> involved(through);
+  involved.insert(
+      involved.end(), event.starting.begin(), event.starting.end());
+  std::sort(involved.begin(), involved.end());
+  involved.erase(
+      std::unique(involved.begin(), involved.end()), involved.end());
+  for (size_t i = 0; i < involved.size(); i++)
+    for (size_t j = i + 1; j < involved.size(); j++)
+      report(involved[i], involved[j], p);
+
+  // everything that carries on past p goes (back) in, in its order just
+  // past p, which swaps the ones that cross here
+  vector<int> inserted;
+  for (const int s : through) {
+    if (!near(segments[s].right, p))
+      inserted.push_back(s);
+  }
+  inserted.insert(
+      inserted.end(), event.starting.begin(), event.starting.end());
+  for (const int s : inserted) {
+    handles[s] = status.insert(s).first;
+    in_status[s] = true;
+  }
+
+  // and only new neighbours can have crossings that aren't known yet
+  touched.insert(touched.end(), inserted.begin(), inserted.end());
+  for (const int s : touched) {
+    if (!in_status[s])
+      continue;
+    const Status::iterator it = handles[s];
+    if (it != status.begin())
+      check(*std::prev(it), s, p);
+    const Status::iterator next = std::next(it);
+    if (next != status.end())
+      check(s, *next, p);
+  }
+}
+
+void EdgeCrossings::check(const int a, const int b, const QPointF &p)
+{
+  QPointF point;
+  if (!intersect(a, b, point))
+    return;
+  // no tolerance on x here: a nearly vertical segment can cross far
+  // below p within a rounding error of p's x
+  const bool ahead = !near(point, p) &&
+      (point.x() > p.x() || (point.x() == p.x() && point.y() > p.y()));
+  if (!ahead) {
+    report(a, b, point);  // they meet here (or already have)
+    return;
+  }
+  if (!scheduled.insert(pair_key(a, b)).second)
+    return;
+  const Segment &sa = segments[a];
+  const Segment &sb = segments[b];
+  const bool at_vertex =
+      point == sa.left || point == sa.right ||
+      point == sb.left || point == sb.right;
+  Event &event = event_at(point, at_vertex);
+  event.crossing.push_back(a);
+  event.crossing.push_back(b);
+}
+
+void EdgeCrossings::report(const int a, const int b, const QPointF &point)
+{
+  const Segment *lane = &segments[a];
+  const Segment *other = &segments[b];
+  if (lane->type != Edge::LANE)
+    std::swap(lane, other);
+  if (lane->type != Edge::LANE)
+    return;  // only lanes are checked
+  if (lane->start_idx == other->start_idx ||
+      lane->start_idx == other->end_idx ||
+      lane->end_idx == other->start_idx ||
+      lane->end_idx == other->end_idx)
+    return;  // connected on purpose
+  if (!reported.insert(pair_key(a, b)).second)
+    return;
+
+  Crossing crossing;
+  if (other->type == Edge::WALL)
+    crossing.kind = LANE_WALL;
+  else if (other->type == Edge::DOOR)
+    crossing.kind = LANE_DOOR;
+  else
+    crossing.kind = LANE_LANE;
+  crossing.lane_idx = lane->edge_idx;
+  crossing.other_idx = other->edge_idx;
+  crossing.point = point;
+  crossings.push_back(crossing);
+}
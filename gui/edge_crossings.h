@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef EDGE_CROSSINGS_H
+#define EDGE_CROSSINGS_H
+
+/*
+ * Finds the places where a level's lanes cross its walls, its doors, or
+ * each other, with a Bentley-Ottmann sweep over the lane, wall and door
+ * edges: O((n + k) log n) for n edges and k intersections, instead of
+ * testing every pair. The other edge types can't block a lane, so they
+ * are left out of the sweep.
+ *
+ * A vertical line sweeps from left to right, stopping at every edge
+ * endpoint and every intersection found so far. The edges that cross
+ * the line are kept in bottom-to-top order, and only edges that become
+ * neighbours in that order are tested against each other, which is
+ * enough to find every intersection before the sweep reaches it.
+ *
+ * Edges that share a vertex are connected on purpose, so they are never
+ * reported. Touching counts as crossing: a lane that ends on a wall is
+ * reported, the same as one that goes through it.
+ *
+ * The Python generators have a port of this in generator/crossings.py,
+ * which should be kept in step with it.
+ */
+
+#include <cstdint>
+#include <map>
+#include <set>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <QPointF>
+
+#include "level.h"
+
+
+class EdgeCrossings
+{
+public:
+  enum Kind {
+    LANE_WALL = 0,
+    LANE_LANE,
+    LANE_DOOR,
+    NUM_KINDS
+  };
+
+  struct Crossing
+  {
+    Kind kind;
+    int lane_idx;  // index into Level::edges
+    int other_idx;  // the wall, door or other lane
+    QPointF point;
+  };
+
+  EdgeCrossings();
+  ~EdgeCrossings();
+
+  /// Sweep the level's edges. Replaces the results of the last call.
+  void find(const Level &level);
+
+  /// Sorted by lane, then by the other edge
+  const std::vector<Crossing> &get_crossings() const { return crossings; }
+
+  int count(const Kind kind) const;
+
+private:
+  struct Segment
+  {
+    QPointF left, right;  // left is lexicographically (x, y) smaller
+    double slope;  // +infinity if vertical
+    int edge_idx;
+    int start_idx, end_idx;  // vertices, to skip connected edges
+    Edge::Type type;
+  };
+
+  /// What the sweep knows is at an event point. The edges crossing
+  /// there are found in the status, but the ones that were scheduled
+  /// are kept too, in case rounding leaves them just out of reach.
+  struct Event
+  {
+    std::vector<int> starting, ending, crossing;
+    bool at_vertex;  // exactly, rather than at a computed intersection
+  };
+
+  /// Bottom-to-top order along the sweep line, just past the event
+  struct StatusOrder
+  {
+    const EdgeCrossings *sweep;
+    bool operator()(const int a, const int b) const
+    { return sweep->status_less(a, b); }
+  };
+
+  typedef std::set<int, StatusOrder> Status;
+  typedef std::map<std::pair<double, double>, Event> EventQueue;
+
+  std::vector<Segment> segments;  // the last one is the search probe
+  int probe;
+  double eps;
+  double sweep_x, sweep_y;
+  EventQueue queue;
+  Status status;
+  std::vector<Status::iterator> handles;  // where each segment is
+  std::vector<bool> in_status;
+  std::unordered_set<uint64_t> scheduled;  // pairs with a crossing event
+  std::unordered_set<uint64_t> reported;
+  std::vector<Crossing> crossings;
+
+  bool status_less(const int a, const int b) const;
+  double y_at_sweep(const Segment &segment) const;
+  bool passes_through_sweep(const int segment_idx) const;
+  bool near(const QPointF &a, const QPointF &b) const;
+  bool intersect(const int a, const int b, QPointF &point) const;
+
+  Event &event_at(const QPointF &point, const bool at_vertex);
+  void handle_event(const QPointF &p, const Event &event);
+  void check(const int a, const int b, const QPointF &p);
+  void report(const int a, const int b, const QPointF &point);
+
+  static uint64_t pair_key(const int a, const int b);
+};
+
+#endif
@@ -0,0 +1,659 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <QPainter>
+
+#include "edge_layer.h"
+#include "level.h"
+using std::vector;
+
+
+// Clips the segment to the rectangle (Liang-Barsky). Returns false if
+// it misses the rectangle entirely, otherwise the parametric range of
+// the segment which is inside it.
+static bool clip_segment(
+    const QLineF &line,
+    const QRectF &rect,
+    double &t0,
+    double &t1)
+{
+  const double dx = line.dx();
+  const double dy = line.dy();
+  const double p[4] = { -dx, dx, -dy, dy };
+  const double q[4] = {
+    line.x1() - rect.left(),
+    rect.right() - line.x1(),
+    line.y1() - rect.top(),
+    rect.bottom() - line.y1()
+  };
+  t0 = 0.0;
+  t1 = 1.0;
+  for (int i = 0; i < 4; i++) {
+    if (p[i] == 0.0) {
+      if (q[i] < 0.0)
+        return false;  // parallel to this side, and outside of it
+      continue;
+    }
+    const double t = q[i] / p[i];
+    if (p[i] < 0.0)
+      t0 = std::max(t0, t);
+    else
+      t1 = std::min(t1, t);
+  }
+  return t0 <= t1;
+}
+
+static double point_to_segment_distance(const QPointF &p, const QLineF &line)
+{
+  const double dx = line.dx();
+  const double dy = line.dy();
+  const double len_sq = dx * dx + dy * dy;
+  double t = 0.0;
+  if (len_sq > 0.0) {
+    t = ((p.x() - line.x1()) * dx + (p.y() - line.y1()) * dy) / len_sq;
+    t = std::max(0.0, std::min(1.0, t));
+  }
+  const double ex = line.x1() + t * dx - p.x();
+  const double ey = line.y1() + t * dy - p.y();
+  return std::sqrt(ex * ex + ey * ey);
+}
+
+
+EdgeLayer::EdgeLayer(
+    const Level &level,
+    const Edge::Type _edge_type,
+    const int _graph_idx,
+    const vector<int> &edge_indices,
+    const LevelOfDetail &_lod)
+: edge_type(_edge_type),
+  graph_idx(_graph_idx),
+  meters_per_pixel(level.drawing_meters_per_pixel),
+  lod(_lod),
+  grid(5.0 / level.drawing_meters_per_pixel),  // 5-meter cells
+  pen_width(0.0)
+{
+  switch (edge_type) {
+    case Edge::LANE: pen_width = 1.0 / meters_per_pixel; break;
+    case Edge::WALL: pen_width = 0.2 / meters_per_pixel; break;
+    case Edge::MEAS: pen_width = 0.5 / meters_per_pixel; break;
+    case Edge::DOOR: pen_width = 0.2 / meters_per_pixel; break;
+    default: break;
+  }
+
+  geometries.reserve(edge_indices.size());
+  for (const int edge_idx : edge_indices) {
+    const Edge &edge = level.edges[edge_idx];
+    const Vertex &v_start = level.vertices[edge.start_idx];
+    const Vertex &v_end = level.vertices[edge.end_idx];
+
+    EdgeGeometry g;
+    g.line = QLineF(v_start.x, v_start.y, v_end.x, v_end.y);
+    g.edge_idx = edge_idx;
+    g.selected = edge.selected;
+    g.bidirectional = edge.is_bidirectional();
+    g.orientation = ORIENTATION_NONE;
+
+    auto orientation_it = edge.params.find("orientation");
+    if (orientation_it != edge.params.end()) {
+      if (orientation_it->second.value_string == "forward")
+        g.orientation = ORIENTATION_FORWARD;
+      else if (orientation_it->second.value_string == "backward")
+        g.orientation = ORIENTATION_BACKWARD;
+    }
+
+    if (edge_type == Edge::DOOR)
+      g.door_motion_path = door_motion_path(level, edge);
+
+    geometries.push_back(g);
+  }
+
+  for (size_t i = 0; i < geometries.size(); i++) {
+    const EdgeGeometry &g = geometries[i];
+    const double m = margin(g);
+    grid.insert_segment(
+        static_cast<int>(i),
+        g.line.x1(), g.line.y1(),
+        g.line.x2(), g.line.y2(),
+        m);
+
+    QRectF r = QRectF(g.line.p1(), g.line.p2()).normalized();
+    r.adjust(-m, -m, m, m);
+    if (!g.door_motion_path.isEmpty()) {
+      const double motion_pen = 0.05 / meters_per_pixel;
+      const QRectF door_rect = g.door_motion_path.boundingRect().adjusted(
+          -motion_pen, -motion_pen, motion_pen, motion_pen);
+      grid.insert_box(
+          static_cast<int>(i),
+          door_rect.left(),
+          door_rect.top(),
+          door_rect.right(),
+          door_rect.bottom());
+      r |= door_rect;
+    }
+    bounds |= r;
+  }
+}
+
+EdgeLayer::~EdgeLayer()
+{
+}
+
+double EdgeLayer::margin(const EdgeGeometry &g) const
+{
+  // The round caps, and the arrowheads of lanes, stay within half a pen
+  // width of the line. The orientation box and its heading indicator
+  // reach out to a meter from the middle of the lane.
+  if (g.orientation != ORIENTATION_NONE)
+    return std::max(pen_width / 2.0, 1.0 / meters_per_pixel + 5.0);
+  return pen_width / 2.0;
+}
+
+QColor EdgeLayer::lane_color(const int lane_graph_idx, const bool selected)
+{
+  QColor color;
+  switch (lane_graph_idx) {
+    case 0: color.setRgbF(0.0, 0.5, 0.0); break;
+    case 1: color.setRgbF(0.0, 0.0, 0.5); break;
+    case 2: color.setRgbF(0.0, 0.5, 0.5); break;
+    case 3: color.setRgbF(0.5, 0.5, 0.0); break;
+    case 4: color.setRgbF(0.5, 0.0, 0.5); break;
+    case 5: color.setRgbF(0.5, 0.5, 0.5); break;
+    default: break;  // will render as dark grey
+  }
+
+  // always draw lane as red if it's selected
+  if (selected)
+    color.setRgbF(0.5, 0.0, 0.0);
+
+  // always draw lanes somewhat transparent
+  color.setAlphaF(0.5);
+  return color;
+}
+
+void EdgeLayer::paint(
+    QPainter *painter,
+    const QRectF &exposed,
+    const double view_scale) const
+{
+  vector<int> visible;
+  grid.query_box(
+      exposed.left(),
+      exposed.top(),
+      exposed.right(),
+      exposed.bottom(),
+      visible);
+  if (visible.empty())
+    return;
+
+  LevelOfDetail view_lod(lod);
+  view_lod.view_scale = view_scale;
+
+  switch (edge_type) {
+    case Edge::LANE:
+      paint_lanes(painter, visible, exposed, view_lod);
+      break;
+    case Edge::WALL:
+      paint_lines(
+          painter,
+          visible,
+          QColor::fromRgbF(0.0, 0.0, 0.5, 0.5),
+          QColor::fromRgbF(0.5, 0.0, 0.0, 0.5));
+      break;
+    case Edge::MEAS:
+      paint_lines(
+          painter,
+          visible,
+          QColor::fromRgbF(0.5, 0.0, 0.5, 0.5),
+          QColor::fromRgbF(0.5, 0.0, 0.0, 0.5));
+      break;
+    case Edge::DOOR:
+      paint_lines(
+          painter,
+          visible,
+          QColor::fromRgbF(1.0, 0.0, 0.0, 0.5),
+          QColor::fromRgbF(1.0, 1.0, 0.0, 0.5));
+      paint_door_motion(painter, visible, view_lod);
+      break;
+    default:
+      break;
+  }
+}
+
+void EdgeLayer::paint_lines(
+    QPainter *painter,
+    const vector<int> &visible,
+    const QColor &color,
+    const QColor &selected_color) const
+{
+  // all the lines of the same color go out in a single drawLines() call
+  QVector<QLineF> lines, selected_lines;
+  lines.reserve(static_cast<int>(visible.size()));
+  for (const int i : visible) {
+    const EdgeGeometry &g = geometries[i];
+    (g.selected ? selected_lines : lines).append(g.line);
+  }
+
+  QPen pen(QBrush(color), pen_width, Qt::SolidLine, Qt::RoundCap);
+  painter->setPen(pen);
+  painter->drawLines(lines);
+  if (!selected_lines.isEmpty()) {
+    pen.setColor(selected_color);
+    painter->setPen(pen);
+    painter->drawLines(selected_lines);
+  }
+}
+
+void EdgeLayer::paint_lanes(
+    QPainter *painter,
+    const vector<int> &visible,
+    const QRectF &exposed,
+    const LevelOfDetail &view_lod) const
+{
+  const QColor color = lane_color(graph_idx, false);
+  const QColor selected_color = lane_color(graph_idx, true);
+
+  // When zoomed out far enough, lanes are drawn as thin lines of a fixed
+  // screen width, without arrowheads or orientation boxes.
+  if (view_lod.thin_lanes(pen_width)) {
+    QVector<QLineF> lines, selected_lines;
+    for (const int i : visible)
+      (geometries[i].selected ? selected_lines : lines)
+          .append(geometries[i].line);
+    QPen pen(color, 2.0);
+    pen.setCosmetic(true);  // width is in screen pixels
+    painter->setPen(pen);
+    painter->drawLines(lines);
+    pen.setColor(selected_color);
+    painter->setPen(pen);
+    painter->drawLines(selected_lines);
+    return;
+  }
+
+  paint_lines(painter, visible, color, selected_color);
+
+  // arrowheads (and the orientation box) are dropped when zoomed out
+  const double arrow_spacing = pen_width / 2.0;
+  if (!view_lod.draw_arrows(arrow_spacing))
+    return;
+
+  QVector<QLineF> arrows;
+  QPainterPath orientation_paths;
+  for (const int i : visible) {
+    const EdgeGeometry &g = geometries[i];
+    add_lane_arrows(arrows, g, exposed);
+    if (g.orientation != ORIENTATION_NONE)
+      orientation_paths.addPath(orientation_path(g));
+  }
+  painter->setPen(
+      QPen(QBrush(QColor::fromRgbF(0.0, 0.0, 0.0, 0.5)), pen_width / 8));
+  painter->drawLines(arrows);
+
+  if (!orientation_paths.isEmpty()) {
+    painter->setPen(QPen(Qt::white, 5.0));
+    painter->setBrush(Qt::NoBrush);
+    painter->drawPath(orientation_paths);
+  }
+}
+
+void EdgeLayer::add_lane_arrows(
+    QVector<QLineF> &arrows,
+    const EdgeGeometry &g,
+    const QRectF &exposed) const
+{
+  const double len = g.line.length();
+  if (len <= 0.0)
+    return;
+
+  // dimensions for the direction indicators along this path
+  const double arrow_w = pen_width / 2.5;  // width of arrowheads
+  const double arrow_l = pen_width / 2.5;  // length of arrowheads
+  const double arrow_spacing = pen_width / 2.0;
+
+  // only generate the arrowheads on the exposed part of long lanes
+  double t0 = 0.0, t1 = 1.0;
+  const QRectF clip = exposed.adjusted(
+      -pen_width, -pen_width, pen_width, pen_width);
+  if (!clip_segment(g.line, clip, t0, t1))
+    return;
+  const double d_start = std::floor(t0 * len / arrow_spacing) * arrow_spacing;
+  const double d_end = t1 * len;
+
+  const double norm_x = g.line.dx() / len;
+  const double norm_y = g.line.dy() / len;
+
+  for (double d = d_start; d < len && d <= d_end; d += arrow_spacing) {
+    // first calculate the center vertex of this arrowhead
+    const double cx = g.line.x1() + d * norm_x;
+    const double cy = g.line.y1() + d * norm_y;
+    // the two edge vertices of arrowhead
+    const QPointF e1(cx - arrow_w * norm_y, cy + arrow_w * norm_x);
+    const QPointF e2(cx + arrow_w * norm_y, cy - arrow_w * norm_x);
+    // tip of arrowhead
+    const QPointF tip(cx + arrow_l * norm_x, cy + arrow_l * norm_y);
+    arrows.append(QLineF(e1, tip));
+    arrows.append(QLineF(e2, tip));
+
+    if (d > 0.0 && g.bidirectional) {
+      const QPointF back_tip(cx - arrow_l * norm_x, cy - arrow_l * norm_y);
+      arrows.append(QLineF(e1, back_tip));
+      arrows.append(QLineF(e2, back_tip));
+    }
+  }
+}
+
+QPainterPath EdgeLayer::orientation_path(const EdgeGeometry &g) const
+{
+  // draw robot-outline box midway down this lane
+  const double mx = (g.line.x1() + g.line.x2()) / 2.0;
+  const double my = (g.line.y1() + g.line.y2()) / 2.0;
+  const double yaw = atan2(g.line.dy(), g.line.dx());
+
+  // robot-box half-dimensions in meters
+  const double rw = 0.4 / meters_per_pixel;
+  const double rl = 0.5 / meters_per_pixel;
+
+  // calculate the corners of the 'robot' box
+
+  // front-left
+  // |mx| + |cos -sin| | rl|
+  // |my|   |sin  cos| | rw|
+  const double flx = mx + rl * cos(yaw) - rw * sin(yaw);
+  const double fly = my + rl * sin(yaw) + rw * cos(yaw);
+
+  // front-right
+  // |mx| + |cos -sin| | rl|
+  // |my|   |sin  cos| |-rw|
+  const double frx = mx + rl * cos(yaw) + rw * sin(yaw);
+  const double fry = my + rl * sin(yaw) - rw * cos(yaw);
+
+  // back-left
+  // |mx| + |cos -sin| |-rl|
+  // |my|   |sin  cos| | rw|
+  const double blx = mx - rl * cos(yaw) - rw * sin(yaw);
+  const double bly = my - rl * sin(yaw) + rw * cos(yaw);
+
+  // back-right
+  // |mx| + |cos -sin| |-rl|
+  // |my|   |sin  cos| |-rw|
+  const double brx = mx - rl * cos(yaw) + rw * sin(yaw);
+  const double bry = my - rl * sin(yaw) - rw * cos(yaw);
+
+  QPainterPath pp;
+  pp.moveTo(QPointF(flx, fly));
+  pp.lineTo(QPointF(frx, fry));
+  pp.lineTo(QPointF(brx, bry));
+  pp.lineTo(QPointF(blx, bly));
+  pp.lineTo(QPointF(flx, fly));
+  pp.moveTo(QPointF(mx, my));
+
+  // heading indicator
+  const double heading = g.orientation == ORIENTATION_FORWARD ? 1.0 : -1.0;
+  pp.lineTo(
+      QPointF(
+        mx + heading * cos(yaw) / meters_per_pixel,
+        my + heading * sin(yaw) / meters_per_pixel));
+  return pp;
+}
+
+void EdgeLayer::paint_door_motion(
+    QPainter *painter,
+    const vector<int> &visible,
+    const LevelOfDetail &view_lod) const
+{
+  // the motion path is just clutter if the door is only a few pixels long
+  QPainterPath paths;
+  for (const int i : visible) {
+    const EdgeGeometry &g = geometries[i];
+    if (view_lod.draw_door_motion(g.line.length()))
+      paths.addPath(g.door_motion_path);
+  }
+  if (paths.isEmpty())
+    return;
+
+  const double door_motion_thickness = 0.05;  // meters
+  painter->setPen(QPen(Qt::black, door_motion_thickness / meters_per_pixel));
+  painter->setBrush(Qt::NoBrush);
+  painter->drawPath(paths);
+}
+
+int EdgeLayer::edge_at(const QPointF &point, const double tolerance) const
+{
+  const double r = pen_width / 2.0 + tolerance;
+  vector<int> candidates;
+  grid.query_box(
+      point.x() - r,
+      point.y() - r,
+      point.x() + r,
+      point.y() + r,
+      candidates);
+
+  int nearest_idx = -1;
+  double nearest_dist = r;
+  for (const int i : candidates) {
+    const double dist = point_to_segment_distance(point, geometries[i].line);
+    if (dist <= nearest_dist) {
+      nearest_idx = geometries[i].edge_idx;
+      nearest_dist = dist;
+    }
+  }
+  return nearest_idx;
+}
+
+void EdgeLayer::edges_in(
+    const QPolygonF &region,
+    vector<int> &edge_indices) const
+{
+  const QRectF rect = region.boundingRect();
+  vector<int> candidates;
+  grid.query_box(
+      rect.left(),
+      rect.top(),
+      rect.right(),
+      rect.bottom(),
+      candidates);
+
+  // long edges are in several cells
+  std::sort(candidates.begin(), candidates.end());
+  candidates.erase(
+      std::unique(candidates.begin(), candidates.end()),
+      candidates.end());
+
+  for (const int i : candidates) {
+    const QLineF &line = geometries[i].line;
+    if (region.containsPoint(line.p1(), Qt::OddEvenFill) &&
+        region.containsPoint(line.p2(), Qt::OddEvenFill))
+      edge_indices.push_back(geometries[i].edge_idx);
+  }
+}
+
+QPainterPath EdgeLayer::door_motion_path(
+    const Level &level,
+    const Edge &edge) const
+{
+  const auto &v_start = level.vertices[edge.start_idx];
+  const auto &v_end = level.vertices[edge.end_idx];
+
+  const double door_dx = v_end.x - v_start.x;
+  const double door_dy = v_end.y - v_start.y;
+  const double door_length = sqrt(door_dx * door_dx + door_dy * door_dy);
+  const double door_angle = atan2(door_dy, door_dx);
+
+  auto door_axis_it = edge.params.find("motion_axis");
+  std::string door_axis("start");
+  if (door_axis_it != edge.params.end())
+    door_axis = door_axis_it->second.value_string;
+
+  if (door_axis != "start" && door_axis != "end")
+    printf("unknown door axis: [%s]\n", door_axis.c_str());
+
+  double motion_degrees = 90;
+  auto motion_degrees_it = edge.params.find("motion_degrees");
+  if (motion_degrees_it != edge.params.end())
+    motion_degrees = motion_degrees_it->second.value_double;
+
+  int motion_dir = 1;
+  auto motion_dir_it = edge.params.find("motion_direction");
+  if (motion_dir_it != edge.params.end())
+    motion_dir = motion_dir_it->second.value_int;
+
+  QPainterPath door_motion_path;
+
+  auto door_type_it = edge.params.find("type");
+  if (door_type_it != edge.params.end())
+  {
+    const double DEG2RAD = M_PI / 180.0;
+
+    const std::string &door_type = door_type_it->second.value_string;
+    if (door_type == "hinged")
+    {
+      const double hinge_x = door_axis == "start" ? v_start.x : v_end.x;
+      const double hinge_y = door_axis == "start" ? v_start.y : v_end.y;
+      const double angle_offset = door_axis == "start" ? 0.0 : M_PI;
+
+      add_door_swing_path(
+          door_motion_path,
+          hinge_x,
+          hinge_y,
+          door_length,
+          door_angle + angle_offset,
+          door_angle + angle_offset + DEG2RAD * motion_dir * motion_degrees);
+    }
+    else if (door_type == "double_hinged")
+    {
+      // each door section is half as long as door_length
+      add_door_swing_path(
+          door_motion_path,
+          v_start.x,
+          v_start.y,
+          door_length / 2,
+          door_angle,
+          door_angle + DEG2RAD * motion_dir * motion_degrees);
+
+      add_door_swing_path(
+          door_motion_path,
+          v_end.x,
+          v_end.y,
+          door_length / 2,
+          door_angle + M_PI,
+          door_angle + M_PI - DEG2RAD * motion_dir * motion_degrees);
+    }
+    else if (door_type == "sliding")
+    {
+      add_door_slide_path(
+          door_motion_path,
+          v_start.x,
+          v_start.y,
+          door_length,
+          door_angle);
+    }
+    else if (door_type == "double_sliding")
+    {
+      // each door section is half as long as door_length
+      add_door_slide_path(
+          door_motion_path,
+          v_start.x,
+          v_start.y,
+          door_length / 2,
+          door_angle);
+      add_door_slide_path(
+          door_motion_path,
+          v_end.x,
+          v_end.y,
+          door_length / 2,
+          door_angle + M_PI);
+    }
+    else
+    {
+      printf("tried to draw unknown door type: [%s]\n", door_type.c_str());
+    }
+  }
+  return door_motion_path;
+}
+
+void EdgeLayer::add_door_slide_path(
+    QPainterPath &path,
+    double hinge_x,
+    double hinge_y,
+    double door_length,
+    double door_angle) const
+{
+  // first draw the door as a thin line
+  path.moveTo(hinge_x, hinge_y);
+  path.lineTo(
+      hinge_x + door_length * cos(door_angle),
+      hinge_y + door_length * sin(door_angle));
+
+  // now draw a box around where it slides (in the wall, usually)
+  const double th = door_angle;  // makes expressions below single-line...
+  const double pi_2 = M_PI / 2.0;
+  const double s = 0.15 / meters_per_pixel;  // sliding panel thickness
+
+  const QPointF p1(
+      hinge_x - s * cos(th + pi_2),
+      hinge_y - s * sin(th + pi_2));
+
+  const QPointF p2(
+      hinge_x - s * cos(th + pi_2) - door_length * cos(th),
+      hinge_y - s * sin(th + pi_2) - door_length * sin(th));
+
+  const QPointF p3(
+      hinge_x + s * cos(th + pi_2) - door_length * cos(th),
+      hinge_y + s * sin(th + pi_2) - door_length * sin(th));
+
+  const QPointF p4(
+      hinge_x + s * cos(th + pi_2),
+      hinge_y + s * sin(th + pi_2));
+
+
+  path.moveTo(p1);
+  path.lineTo(p2);
+  path.lineTo(p3);
+  path.lineTo(p4);
+  path.lineTo(p1);
+}
+
+void EdgeLayer::add_door_swing_path(
+    QPainterPath &path,
+    double hinge_x,
+    double hinge_y,
+    double door_length,
+    double start_angle,
+    double end_angle) const
+{
+  path.moveTo(hinge_x, hinge_y);
+  path.lineTo(
+      hinge_x + door_length * cos(start_angle),
+      hinge_y + door_length * sin(start_angle));
+
+  const int NUM_MOTION_STEPS = 10;
+  const double angle_inc = (end_angle - start_angle) / (NUM_MOTION_STEPS-1);
+  for (int i = 0; i < NUM_MOTION_STEPS; i++)
+  {
+    // compute door opening angle at this motion step
+    const double a = start_angle + i * angle_inc;
+
+    path.lineTo(
+        hinge_x + door_length * cos(a),
+        hinge_y + door_length * sin(a));
+  }
+
+  path.lineTo(hinge_x, hinge_y);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef EDGE_LAYER_H
+#define EDGE_LAYER_H
+
+/*
+ * The edges of one type (and, for lanes, one graph index) on a level,
+ * copied into a flat array with a spatial grid over it. The layer is
+ * immutable once built and paint() only reads it, so the same layer can
+ * be painted by the scene (through EdgeLayerItem) and by the static
+ * tile renderers on worker threads at the same time.
+ */
+
+#include <vector>
+
+#include <QColor>
+#include <QLineF>
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QRectF>
+
+#include "edge.h"
+#include "level_of_detail.h"
+#include "spatial_grid.h"
+class Level;
+class QPainter;
+
+
+class EdgeLayer
+{
+public:
+  /// Copies the geometry of these edges (indices into level.edges),
+  /// which must all have the given type and, for lanes, graph index.
+  EdgeLayer(
+      const Level &level,
+      const Edge::Type _edge_type,
+      const int _graph_idx,
+      const std::vector<int> &edge_indices,
+      const LevelOfDetail &_lod);
+  ~EdgeLayer();
+
+  const QRectF &bounding_rect() const { return bounds; }
+
+  /// Paint the edges near the exposed rectangle (in scene coordinates),
+  /// with the level of detail for this many screen pixels per scene unit
+  void paint(
+      QPainter *painter,
+      const QRectF &exposed,
+      const double view_scale) const;
+
+  /// Returns the index (in Level::edges) of the edge closest to this
+  /// point, if it is within 'tolerance' of the edge's stroke, or -1.
+  int edge_at(const QPointF &point, const double tolerance) const;
+
+  /// Appends the indices (in Level::edges) of the edges with both ends
+  /// inside this region
+  void edges_in(
+      const QPolygonF &region,
+      std::vector<int> &edge_indices) const;
+
+  Edge::Type get_edge_type() const { return edge_type; }
+  int get_graph_idx() const { return graph_idx; }
+
+  static QColor lane_color(const int lane_graph_idx, const bool selected);
+
+private:
+  enum Orientation {
+    ORIENTATION_NONE = 0,
+    ORIENTATION_FORWARD,
+    ORIENTATION_BACKWARD
+  };
+
+  struct EdgeGeometry
+  {
+    QLineF line;
+    int edge_idx;  // in Level::edges
+    bool selected;
+    bool bidirectional;
+    Orientation orientation;
+    QPainterPath door_motion_path;  // empty except for doors
+  };
+
+  const Edge::Type edge_type;
+  const int graph_idx;
+  const double meters_per_pixel;
+  const LevelOfDetail lod;  // thresholds only; the scale comes with paint()
+
+  std::vector<EdgeGeometry> geometries;
+  SpatialGrid grid;  // indices into 'geometries'
+  QRectF bounds;
+  double pen_width;
+
+  double margin(const EdgeGeometry &g) const;
+
+  void paint_lanes(
+      QPainter *painter,
+      const std::vector<int> &visible,
+      const QRectF &exposed,
+      const LevelOfDetail &view_lod) const;
+  void paint_lines(
+      QPainter *painter,
+      const std::vector<int> &visible,
+      const QColor &color,
+      const QColor &selected_color) const;
+  void paint_door_motion(
+      QPainter *painter,
+      const std::vector<int> &visible,
+      const LevelOfDetail &view_lod) const;
+
+  void add_lane_arrows(
+      QVector<QLineF> &arrows,
+      const EdgeGeometry &g,
+      const QRectF &exposed) const;
+  QPainterPath orientation_path(const EdgeGeometry &g) const;
+
+  QPainterPath door_motion_path(const Level &level, const Edge &edge) const;
+  void add_door_swing_path(
+      QPainterPath &path,
+      double hinge_x,
+      double hinge_y,
+      double door_length,
+      double start_angle,
+      double end_angle) const;
+  void add_door_slide_path(
+      QPainterPath &path,
+      double hinge_x,
+      double hinge_y,
+      double door_length,
+      double door_angle) const;
+};
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cmath>
+
+#include <QStyleOptionGraphicsItem>
+
+#include "edge_layer_item.h"
+
+
+EdgeLayerItem::EdgeLayerItem(const std::shared_ptr<const EdgeLayer> &_layer)
+: layer(_layer)
+{
+  // exposedRect is only filled in with this flag set
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+EdgeLayerItem::~EdgeLayerItem()
+{
+}
+
+QRectF EdgeLayerItem::boundingRect() const
+{
+  return layer->bounding_rect();
+}
+
+void EdgeLayerItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *option,
+    QWidget *)
+{
+  layer->paint(
+      painter,
+      option->exposedRect,
+      QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform()));
+}
+
+int EdgeLayerItem::edge_at(const QPointF &point, const double tolerance) const
+{
+  return layer->edge_at(point, tolerance);
+}
+
+void EdgeLayerItem::edges_in(
+    const QPolygonF &region,
+    std::vector<int> &edge_indices) const
+{
+  layer->edges_in(region, edge_indices);
+}
+
+bool EdgeLayerItem::contains(const QPointF &point) const
+{
+  return layer->edge_at(point, 0.0) >= 0;
+}
+
+bool EdgeLayerItem::collidesWithPath(
+    const QPainterPath &path,
+    Qt::ItemSelectionMode mode) const
+{
+  // The default implementation would test the path against shape(),
+  // which for a whole layer is far too coarse. For the (small) paths
+  // used by itemAt() and friends, test against the edges near it.
+  if (mode != Qt::IntersectsItemShape)
+    return QGraphicsItem::collidesWithPath(path, mode);
+
+  const QRectF rect = path.boundingRect();
+  const double r = std::sqrt(
+      rect.width() * rect.width() + rect.height() * rect.height()) / 2.0;
+  return layer->edge_at(rect.center(), r) >= 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef EDGE_LAYER_ITEM_H
+#define EDGE_LAYER_ITEM_H
+
+/*
+ * One QGraphicsItem for a whole EdgeLayer. Instead of a line item per
+ * wall and several per lane arrowhead, the layer is painted in one
+ * paint() call, restricted to the exposed rectangle, and the level of
+ * detail is decided at paint time from the painter's transform. Picking
+ * goes through the layer's spatial grid rather than the scene's BSP tree.
+ */
+
+#include <memory>
+
+#include <QGraphicsItem>
+
+#include "edge_layer.h"
+
+
+class EdgeLayerItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 1 };
+
+  EdgeLayerItem(const std::shared_ptr<const EdgeLayer> &_layer);
+  ~EdgeLayerItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+  bool contains(const QPointF &point) const override;
+  bool collidesWithPath(
+      const QPainterPath &path,
+      Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+  /// see EdgeLayer::edge_at()
+  int edge_at(const QPointF &point, const double tolerance) const;
+
+  /// see EdgeLayer::edges_in()
+  void edges_in(
+      const QPolygonF &region,
+      std::vector<int> &edge_indices) const;
+
+private:
+  std::shared_ptr<const EdgeLayer> layer;
+};
+
+#endif
@@ -17,23 +17,36 @@
 
 #include <algorithm>
 #include <cmath>
+#include <numeric>
 #include <string>
+#include <utility>
 
 #include <QtWidgets>
 
 #include <QInputDialog>
 #include <QLabel>
-#include <QListWidget>
+#include <QListView>
 #include <QToolBar>
 
 #include <yaml-cpp/yaml.h>
 
 #include "add_param_dialog.h"
+#include "binary_map.h"
+#include "drawing_item.h"
+#include "edge_crossings.h"
+#include "edge_layer_item.h"
 #include "editor.h"
+#include "find_dialog.h"
+#include "job_status_widget.h"
+#include "lane_clearance_item.h"
 #include "level_dialog.h"
 #include "preferences_dialog.h"
 #include "preferences_keys.h"
+#include "snap_guide_item.h"
+#include "static_layers.h"
+#include "static_tile_item.h"
 #include "map_view.h"
+#include "vertex_layer_item.h"
 using std::string;
 
 
@@ -44,22 +57,46 @@ Editor::Editor(QWidget *parent)
   level_idx(0),
   clicked_idx(-1),
   polygon_idx(-1),
+  load_job_id(-1),
+  save_job_id(-1),
+  autosave_job_id(-1),
+  import_job_id(-1),
+  extract_job_id(-1),
+  export_job_id(-1),
   mouse_motion_line(nullptr),
   mouse_motion_ellipse(nullptr),
   mouse_motion_model(nullptr),
   mouse_motion_polygon(nullptr),
   mouse_motion_polygon_vertex_idx(-1),
-  tool_id(SELECT)
+  tool_id(SELECT),
+  static_tiles_valid(false),
+  static_tiles_level_idx(-1),
+  static_drag_active(false),
+  rubber_band_item(nullptr),
+  rubber_band_lasso(false),
+  rubber_band_mode(Selection::REPLACE),
+  thumbnail_generation(0),
+  snap_guide_item(nullptr),
+  mouse_move_interval_ms(16)
 {
   instance = this;
 
   QSettings settings;
   qDebug("settings filename: [%s]", qUtf8Printable(settings.fileName()));
+  lod.load_settings();
+  snap_engine.load_settings();
+  level_scene_cache.set_memory_budget(
+      settings.value(preferences_keys::scene_cache_size, 256).toInt());
+  map.change_bus.subscribe(
+      [this](const std::vector<MapChange> &changes) { map_changed(changes); });
 
   scene = new QGraphicsScene(this);
 
   map_view = new MapView(this);
   map_view->setScene(scene);
+  connect(
+      map_view, &MapView::zoom_changed,
+      this, &Editor::map_view_zoom_changed);
 
   level_button_group = new QButtonGroup(this);
   connect(
@@ -73,12 +110,17 @@ Editor::Editor(QWidget *parent)
   map_layout->addLayout(level_button_hbox_layout);
   map_layout->addWidget(map_view);
 
-  property_editor = new QTableWidget();
-  property_editor->setStyleSheet("QTableWidget { background-color: #e0e0e0; color: black; gridline-color: #606060; } QLineEdit { background:white; }");
+  property_model = new PropertyTableModel(this);
+  connect(
+      property_model, &PropertyTableModel::edited,
+      this, &Editor::property_edited);
+
+  property_editor = new QTableView();
+  property_editor->setModel(property_model);
+  property_editor->setStyleSheet("QTableView { background-color: #e0e0e0; color: black; gridline-color: #606060; } QLineEdit { background:white; }");
   property_editor->setMinimumSize(400, 200);
   //property_editor->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::Ignored);
   property_editor->setSizePolicy(QSizePolicy::Fixed, QSizePolicy::MinimumExpanding);
-  property_editor->setColumnCount(2);
   property_editor->horizontalHeader()->setVisible(false);
   property_editor->verticalHeader()->setVisible(false);
   property_editor->horizontalHeader()->setSectionResizeMode(
@@ -88,9 +130,6 @@ Editor::Editor(QWidget *parent)
   property_editor->verticalHeader()->setSectionResizeMode(
       QHeaderView::ResizeToContents);
   property_editor->setAutoFillBackground(true);
-  connect(
-      property_editor, &QTableWidget::cellChanged,
-      this, &Editor::property_editor_cell_changed);
 
   QHBoxLayout *param_button_layout = new QHBoxLayout;
 
@@ -139,6 +178,13 @@ Editor::Editor(QWidget *parent)
       file_menu->addAction("&Save Project", this, &Editor::save);
   save_action->setShortcut(tr("Ctrl+S"));
 
+  QAction *save_as_action =
+      file_menu->addAction("Save Project &As...", this, &Editor::save_as);
+  save_as_action->setShortcut(QKeySequence::SaveAs);
+
+  file_menu->addAction(
+      "Export &Occupancy Grids...", this, &Editor::export_occupancy_grids);
+
   file_menu->addSeparator();
 
   QAction *exit_action = file_menu->addAction("E&xit", this, &QWidget::close);
@@ -146,6 +192,15 @@ Editor::Editor(QWidget *parent)
 
   // EDIT MENU
   QMenu *edit_menu = menuBar()->addMenu("&Edit");
+  QAction *find_action =
+      edit_menu->addAction("&Find by Name...", this, &Editor::find_by_name);
+  find_action->setShortcut(tr("Ctrl+G"));
+  edit_menu->addSeparator();
+  snap_action = edit_menu->addAction("&Snap Vertices");
+  snap_action->setCheckable(true);
+  snap_action->setChecked(true);
+  snap_action->setToolTip("Hold Shift to place a vertex without snapping");
+  edit_menu->addSeparator();
   edit_menu->addAction("&Preferences...", this, &Editor::edit_preferences);
 
   // LEVEL MENU
@@ -153,6 +208,12 @@ Editor::Editor(QWidget *parent)
   level_menu->addAction("&Add...", this, &Editor::level_add);
   level_menu->addSeparator();
   level_menu->addAction("&Edit...", this, &Editor::level_edit);
+  level_menu->addAction(
+      "&Import Floorplan...", this, &Editor::level_import_floorplan);
+  level_menu->addAction(
+      "E&xtract Walls from Drawing", this, &Editor::level_extract_walls);
+  level_menu->addAction(
+      "Check &Lane Crossings", this, &Editor::level_check_lane_crossings);
 
   // VIEW MENU
   QMenu *view_menu = menuBar()->addMenu("&View");
@@ -178,6 +239,12 @@ Editor::Editor(QWidget *parent)
   zoom_fit_action->setCheckable(true);
   zoom_fit_action->setShortcut(tr("Ctrl+F"));
 
+  view_menu->addSeparator();
+
+  lane_clearance_action = view_menu->addAction(
+      "Lane &Clearance", this, &Editor::lane_clearance_toggled);
+  lane_clearance_action->setCheckable(true);
+
   // HELP MENU
   QMenu *help_menu = menuBar()->addMenu("&Help");
 
@@ -216,14 +283,36 @@ Editor::Editor(QWidget *parent)
       this,
       &Editor::model_name_line_edited);
 
-  model_name_list_widget = new QListWidget;
-  populate_model_name_list_widget();
-  toolbar->addWidget(model_name_list_widget);
+  thumbnail_cache = new ThumbnailCache(model_catalog, this);
+  connect(
+      thumbnail_cache,
+      &ThumbnailCache::thumbnail_loaded,
+      this,
+      &Editor::thumbnail_loaded);
+  model_list_model = new ModelListModel(model_catalog, *thumbnail_cache, this);
+  model_sprite_cache.reset(new ModelSpriteCache(*thumbnail_cache));
+  static_tile_cache = new StaticTileCache(this);
+
+  // Icon grid over the model catalog. Uniform item sizes let the view
+  // lay out thousands of rows without asking for (and thus decoding)
+  // the thumbnails of rows that aren't visible.
+  const int icon_size = ThumbnailCache::ICON_SIZE;
+  model_name_list_view = new QListView;
+  model_name_list_view->setModel(model_list_model);
+  model_name_list_view->setViewMode(QListView::IconMode);
+  model_name_list_view->setUniformItemSizes(true);
+  model_name_list_view->setIconSize(QSize(icon_size, icon_size));
+  model_name_list_view->setGridSize(QSize(icon_size + 40, icon_size + 30));
+  model_name_list_view->setMovement(QListView::Static);
+  model_name_list_view->setResizeMode(QListView::Adjust);
+  model_name_list_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+  populate_model_catalog();
+  toolbar->addWidget(model_name_list_view);
   connect(
-      model_name_list_widget,
-      &QListWidget::currentRowChanged,
+      model_name_list_view->selectionModel(),
+      &QItemSelectionModel::currentRowChanged,
       this,
-      &Editor::model_name_list_widget_changed);
+      &Editor::model_name_list_view_changed);
 
   model_preview_label = new QLabel("preview");
   model_preview_label->setSizePolicy(
@@ -240,6 +329,27 @@ Editor::Editor(QWidget *parent)
   toolbar->setStyleSheet("QToolBar {background-color: #404040; border: none; spacing: 5px} QToolButton {background-color: #c0c0c0; color: blue; border: 1px solid black;} QToolButton:checked {background-color: #808080; color: red; border: 1px solid black;}");
   addToolBar(Qt::LeftToolBarArea, toolbar);
 
+  job_scheduler = new JobScheduler(this);
+  connect(
+      job_scheduler, &JobScheduler::finished,
+      this, &Editor::job_finished);
+  statusBar()->addPermanentWidget(new JobStatusWidget(job_scheduler));
+
+  autosave_timer = new QTimer(this);
+  connect(
+      autosave_timer, &QTimer::timeout,
+      this, &Editor::autosave);
+  update_autosave_interval();
+
+  mouse_move_timer = new QTimer(this);
+  mouse_move_timer->setSingleShot(true);
+  connect(
+      mouse_move_timer, &QTimer::timeout,
+      this, &Editor::flush_mouse_move);
+  const double refresh_rate = QGuiApplication::primaryScreen()->refreshRate();
+  if (refresh_rate > 0.0)
+    mouse_move_interval_ms = std::max(1, qRound(1000.0 / refresh_rate));
+
   // SET SIZE
   resize(QGuiApplication::primaryScreen()->availableSize() / 2);
   map_view->adjustSize();
@@ -248,7 +358,7 @@ Editor::Editor(QWidget *parent)
   tool_button_group->button(SELECT)->click();
 }
 
-void Editor::populate_model_name_list_widget()
+void Editor::populate_model_catalog()
 {
   // This function may throw exceptions. Caller should be ready for them!
 
@@ -266,6 +376,12 @@ void Editor::populate_model_name_list_widget()
         );
     settings.setValue(preferences_keys::thumbnail_path, thumbnail_path);
   }
+  // the thumbnails get the budget and their mipmapped sprites get half
+  // as much again, which is what a full mip chain of all of them needs
+  const int thumbnail_budget =
+      settings.value(preferences_keys::thumbnail_cache_size, 256).toInt();
+  thumbnail_cache->set_memory_budget(thumbnail_budget);
+  model_sprite_cache->set_memory_budget(thumbnail_budget / 2);
 
   QString model_list_path = QDir(thumbnail_path).filePath("model_list.yaml");
 
@@ -282,11 +398,39 @@ void Editor::populate_model_name_list_widget()
 
   const double model_meters_per_pixel = y["meters_per_pixel"].as<double>();
   const YAML::Node ym = y["models"];
-  model_name_list_widget->clear();
+  model_catalog.clear();
   for (YAML::const_iterator it = ym.begin(); it != ym.end(); ++it) {
     std::string model_name = it->as<std::string>();
-    model_name_list_widget->addItem(model_name.c_str());
-    models.push_back(EditorModel(model_name, model_meters_per_pixel));
+    model_catalog.add(model_name, model_meters_per_pixel);
+  }
+  thumbnail_cache->clear();
+  thumbnail_cache->set_thumbnail_path(thumbnail_path);
+  model_sprite_cache->clear();
+  model_list_model->reset();
+
+  // the IDs of the previous catalog (if any) are no longer meaningful.
+  // As in resolve_model_ids(), only the models that change are written.
+  for (Level &level : map.levels) {
+    const Level &const_level = level;
+    for (size_t i = 0; i < const_level.models.size(); i++)
+      if (const_level.models[i].model_id >= 0)
+        level.models[i].model_id = -1;
+  }
+}
+
+void Editor::resolve_model_ids()
+{
+  if (map.levels.empty())
+    return;
+  // read through a const reference, and write only the models that
+  // need an ID, so that the other chunks stay shared with snapshots
+  Level &level = map.levels[level_idx];
+  const Level &const_level = level;
+  for (size_t i = 0; i < const_level.models.size(); i++) {
+    if (const_level.models[i].model_id >= 0)
+      continue;
+    Model &model = level.models[i];
+    model.model_id = model_catalog.find_id(model.model_name);
   }
 }
 
@@ -308,17 +452,81 @@ Editor *Editor::get_instance()
 
 bool Editor::load_project(const QString &filename)
 {
-  const std::string filename_std_string = filename.toStdString();
-  try {
-    map.load_yaml(filename_std_string);
-    qInfo("parsed %s successfully", qUtf8Printable(filename));
+  // a newer request supersedes a load that is still running; its result
+  // will be ignored when it finishes
+  if (load_job_id >= 0)
+    job_scheduler->cancel(load_job_id);
+
+  load_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(new LoadProjectJob(filename)));
+  return true;
+}
+
+void Editor::job_finished(int job_id)
+{
+  std::unique_ptr<Job> job = job_scheduler->take(job_id);
+  if (!job)
+    return;
+
+  if (job_id == load_job_id) {
+    load_job_id = -1;
+    project_loaded(static_cast<LoadProjectJob &>(*job));
   }
-  catch (const std::exception &e) {
+  else if (job_id == save_job_id) {
+    save_job_id = -1;
+    project_saved(static_cast<SaveProjectJob &>(*job));
+  }
+  else if (job_id == autosave_job_id) {
+    autosave_job_id = -1;
+    journal_appended(static_cast<JournalAppendJob &>(*job));
+  }
+  else if (job_id == import_job_id) {
+    import_job_id = -1;
+    floorplan_imported(static_cast<ImportFloorplanJob &>(*job));
+  }
+  else if (job_id == extract_job_id) {
+    extract_job_id = -1;
+    walls_extracted(static_cast<ExtractWallsJob &>(*job));
+  }
+  else if (job_id == export_job_id) {
+    export_job_id = -1;
+    occupancy_grids_exported(static_cast<ExportOccupancyGridsJob &>(*job));
+  }
+}
+
+std::shared_ptr<const MapSnapshot> Editor::take_snapshot()
+{
+  return map.snapshot();
+}
+
+void Editor::project_loaded(LoadProjectJob &job)
+{
+  if (job.status == Job::CANCELLED) {
+    statusBar()->showMessage("Loading cancelled", 5000);
+    return;
+  }
+  if (job.status != Job::SUCCEEDED) {
     qWarning("couldn't parse %s: %s",
-        qUtf8Printable(filename),
-        e.what());
-    return false;
+        qUtf8Printable(job.filename),
+        job.error.c_str());
+    statusBar()->showMessage("Couldn't open " + job.filename, 5000);
+    return;
   }
+  qInfo("parsed %s successfully", qUtf8Printable(job.filename));
+
+  // relative paths recorded in the file are relative to the file
+  const QString dir(QFileInfo(job.filename).absolutePath());
+  qDebug("changing directory to [%s]", qUtf8Printable(dir));
+  QDir::setCurrent(dir);
+
+  map.swap(job.map);
+  journal = job.journal;
+  // replayed edits haven't been compacted into the project file yet
+  map.changed = job.num_replayed > 0;
+
+  // the previous map's drawing tiles and scenes can't be on screen anymore
+  drawing_pixmap_cache.clear();
+  level_scene_cache.clear();
 
   level_idx = 0;
   update_level_buttons();
@@ -331,13 +539,64 @@ bool Editor::load_project(const QString &filename)
   }
 
   create_scene();
-  project_filename = filename;
+  project_filename = job.filename;
   map_view->zoom_fit(map, level_idx);
 
   QSettings settings;
-  settings.setValue(preferences_keys::previous_project_path, filename);
+  settings.setValue(
+      preferences_keys::previous_project_path,
+      job.filename);
 
-  return true;
+  if (job.num_replayed > 0)
+    statusBar()->showMessage(
+        QString("Replayed %1 edits from the journal").arg(job.num_replayed),
+        5000);
+}
+
+void Editor::project_saved(SaveProjectJob &job)
+{
+  if (job.status != Job::SUCCEEDED) {
+    map.changed = true;  // the changes are still only in memory
+    QMessageBox::critical(
+        this,
+        "Project not saved",
+        QString::fromStdString(job.error));
+    return;
+  }
+  statusBar()->showMessage("Saved " + job.filename, 5000);
+}
+
+void Editor::update_autosave_interval()
+{
+  QSettings settings;
+  const int minutes =
+      settings.value(preferences_keys::autosave_minutes, 2).toInt();
+  if (minutes > 0)
+    autosave_timer->start(minutes * 60 * 1000);
+  else
+    autosave_timer->stop();
+}
+
+void Editor::autosave()
+{
+  if (!journal || map.levels.empty() || !map.changed)
+    return;
+  if (load_job_id >= 0 || save_job_id >= 0 || autosave_job_id >= 0)
+    return;  // try again next time
+
+  // Map::snapshot() copies again only the levels whose cached copies an
+  // edit has reset, and those copies share their unchanged 256-element
+  // chunks with the old ones. The journal then writes only the entities
+  // that changed since the last append, so this is cheap even for a big
+  // building.
+  autosave_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(new JournalAppendJob(journal, take_snapshot())));
+}
+
+void Editor::journal_appended(JournalAppendJob &job)
+{
+  if (job.status == Job::FAILED)
+    qWarning("autosave failed: %s", job.error.c_str());
 }
 
 bool Editor::load_previous_project()
@@ -389,6 +648,8 @@ void Editor::new_map()
   QDir::setCurrent(dir_path);
 
   map.clear();
+  journal.reset();
+  level_scene_cache.clear();
   update_level_buttons();
   save();
 
@@ -402,7 +663,8 @@ void Editor::open()
 {
   QFileDialog file_dialog(this, "Open Project");
   file_dialog.setFileMode(QFileDialog::ExistingFile);
-  file_dialog.setNameFilter("*.yaml");
+  file_dialog.setNameFilter(
+      QString("Projects (*.yaml *.%1)").arg(BinaryMap::SUFFIX));
 
   if (file_dialog.exec() != QDialog::Accepted)
     return;
@@ -442,8 +704,121 @@ void Editor::save()
     QString dir_path = file_info.dir().path();
     QDir::setCurrent(dir_path);
   }
-  const std::string filename_std_string = project_filename.toStdString();
-  map.save_yaml(filename_std_string);
+  if (save_job_id >= 0) {
+    // two saves racing to the same file could finish in either order
+    statusBar()->showMessage(
+        "Still saving the previous version; please try again", 5000);
+    return;
+  }
+
+  // an autosave still running is about to be made redundant
+  if (autosave_job_id >= 0)
+    job_scheduler->cancel(autosave_job_id);
+
+  // a new project, or one saved under a new name, starts a new journal
+  const std::string journal_filename =
+      Journal::filename_for_project(project_filename);
+  if (!journal || journal->get_filename() != journal_filename)
+    journal = std::make_shared<Journal>(journal_filename);
+
+  // the job gets a snapshot, so editing can carry on while it saves. The
+  // filename is made absolute now in case the current directory changes.
+  save_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(
+        new SaveProjectJob(
+          QFileInfo(project_filename).absoluteFilePath(),
+          take_snapshot(),
+          journal)));
+  map.changed = false;  // edits from here on aren't in this save
+}
+
+void Editor::save_as()
+{
+  // the format follows the suffix, so this is also how a project is
+  // converted between YAML and the binary format
+  QFileDialog dialog(this, "Save Project As");
+  dialog.setNameFilters(
+      QStringList()
+        << "YAML project (*.yaml)"
+        << QString("Binary project (*.%1)").arg(BinaryMap::SUFFIX));
+  dialog.setAcceptMode(QFileDialog::AcceptMode::AcceptSave);
+  dialog.setConfirmOverwrite(true);
+  if (dialog.exec() != QDialog::Accepted)
+    return;
+
+  // no default suffix on the dialog, since it depends on the filter
+  QString filename = dialog.selectedFiles().first();
+  if (!BinaryMap::is_binary_filename(filename) &&
+      !filename.endsWith(".yaml", Qt::CaseInsensitive)) {
+    if (dialog.selectedNameFilter().startsWith("Binary"))
+      filename += QString(".") + BinaryMap::SUFFIX;
+    else
+      filename += ".yaml";
+  }
+
+  if (save_job_id >= 0) {
+    statusBar()->showMessage(
+        "Still saving the previous version; please try again", 5000);
+    return;
+  }
+  project_filename = QFileInfo(filename).absoluteFilePath();
+  QDir::setCurrent(QFileInfo(filename).absolutePath());
+  save();
+
+  QSettings settings;
+  settings.setValue(
+      preferences_keys::previous_project_path,
+      project_filename);
+}
+
+void Editor::export_occupancy_grids()
+{
+  if (map.levels.empty()) {
+    QMessageBox::critical(
+        this,
+        "No levels to export",
+        "Please use Level->Add... first to add a level");
+    return;
+  }
+  if (export_job_id >= 0) {
+    statusBar()->showMessage("Still exporting; please wait", 5000);
+    return;
+  }
+
+  QFileDialog file_dialog(this, "Export Occupancy Grids");
+  file_dialog.setFileMode(QFileDialog::Directory);
+  file_dialog.setOption(QFileDialog::ShowDirsOnly);
+  if (file_dialog.exec() != QDialog::Accepted)
+    return;
+
+  QSettings settings;
+  export_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(
+        new ExportOccupancyGridsJob(
+          take_snapshot(),
+          file_dialog.selectedFiles().first(),
+          settings.value(
+            preferences_keys::occupancy_resolution, 0.05).toDouble(),
+          settings.value(
+            preferences_keys::occupancy_inflation_radius, 0.5).toDouble())));
+}
+
+void Editor::occupancy_grids_exported(ExportOccupancyGridsJob &job)
+{
+  if (job.status == Job::CANCELLED)
+    return;
+  if (job.status != Job::SUCCEEDED) {
+    QMessageBox::critical(
+        this,
+        "Occupancy grids not exported",
+        QString::fromStdString(job.error));
+    return;
+  }
+  statusBar()->showMessage(
+      QString("Exported occupancy grids of %1 levels to %2")
+        .arg(job.snapshot->levels.size())
+        .arg(job.directory),
+      5000);
 }
 
 void Editor::about()
@@ -463,6 +838,8 @@ void Editor::level_edit()
 
   LevelDialog level_dialog(this, map.levels[level_idx]);
   if (level_dialog.exec() == QDialog::Accepted) {
+    map.notify(
+        MapChange(MapChange::MODIFIED, MapChange::LEVEL, level_idx, -1));
     QMessageBox::about(
         this,
         "work in progress", "TODO: use this data...sorry.");
@@ -473,8 +850,123 @@ void Editor::edit_preferences()
 {
   PreferencesDialog preferences_dialog(this);
 
-  if (preferences_dialog.exec() == QDialog::Accepted)
-    populate_model_name_list_widget();
+  if (preferences_dialog.exec() == QDialog::Accepted) {
+    lod.load_settings();
+    snap_engine.load_settings();
+    QSettings settings;
+    level_scene_cache.clear();  // may have been drawn with the old LOD
+    level_scene_cache.set_memory_budget(
+        settings.value(preferences_keys::scene_cache_size, 256).toInt());
+    update_autosave_interval();
+    populate_model_catalog();
+    create_scene();
+  }
+}
+
+void Editor::map_changed(const std::vector<MapChange> &changes)
+{
+  // the journal only writes what these name, from the next snapshot on
+  if (journal)
+    journal->changed(changes, map.next_snapshot_serial());
+
+  // The selection holds indices, which move down after a removal. Things
+  // are removed from the back, so the indices in a run of removals of one
+  // kind that keep going down are all numbered as before the run, and
+  // the selection is shifted once for the whole run.
+  const Selection::Kind kinds[] = {
+    Selection::NUM_KINDS,  // LEVEL
+    Selection::VERTEX,
+    Selection::EDGE,
+    Selection::MODEL,
+    Selection::POLYGON
+  };
+  Selection::Kind removed_kind = Selection::NUM_KINDS;
+  std::vector<int> removed_idx;
+  auto shift_selection = [&]() {
+    std::reverse(removed_idx.begin(), removed_idx.end());
+    if (removed_kind != Selection::NUM_KINDS)
+      selection.removed(removed_kind, removed_idx);
+    removed_kind = Selection::NUM_KINDS;
+    removed_idx.clear();
+  };
+
+  for (const MapChange &change : changes) {
+    if (change.action == MapChange::RESET) {
+      shift_selection();
+      level_scene_cache.clear();
+      name_index.clear();
+      name_index_dirty_levels.clear();
+      selection.reset();
+      continue;
+    }
+
+    if (change.action == MapChange::REMOVED &&
+        change.level_idx == level_idx &&
+        change.entity != MapChange::LEVEL) {
+      const Selection::Kind kind = kinds[change.entity];
+      if (kind != removed_kind || change.idx >= removed_idx.back())
+        shift_selection();
+      removed_kind = kind;
+      removed_idx.push_back(change.idx);
+    }
+    else if (change.level_idx == level_idx)
+      shift_selection();
+
+    // a parked scene would still show the level as it was
+    if (change.level_idx != level_idx)
+      delete level_scene_cache.take(change.level_idx);
+
+    const unsigned name_fields =
+        MapChange::NAME | MapChange::PARAMS | MapChange::TYPE;
+    const bool new_names =
+        change.action != MapChange::MODIFIED ||
+        (change.fields & name_fields) != 0;
+    if (change.entity != MapChange::POLYGON && new_names)
+      name_index_dirty_levels.insert(change.level_idx);
+  }
+  shift_selection();
+}
+
+void Editor::find_by_name()
+{
+  if (map.levels.empty())
+    return;
+  // all of the levels the first time, then only those that changed
+  name_index.update(map, -1);
+  for (const int dirty_level_idx : name_index_dirty_levels)
+    name_index.update(map, dirty_level_idx);
+  name_index_dirty_levels.clear();
+
+  FindDialog dialog(this, map, name_index);
+  if (dialog.exec() != QDialog::Accepted || !dialog.get_entry())
+    return;
+  const NameIndex::Entry entry = *dialog.get_entry();
+  double x = 0.0, y = 0.0;
+  if (!NameIndex::locate(map, entry, x, y))
+    return;
+
+  if (entry.level_idx != level_idx)
+    level_button_group->button(entry.level_idx)->click();
+
+  Selection::Handle handle = { Selection::VERTEX, entry.idx };
+  if (entry.kind == NameIndex::DOOR_NAME)
+    handle.kind = Selection::EDGE;
+  else if (entry.kind == NameIndex::MODEL_NAME)
+    handle.kind = Selection::MODEL;
+  tool_button_group->button(SELECT)->click();
+  selection.apply(
+      map.levels[level_idx],
+      std::vector<Selection::Handle>(1, handle),
+      Selection::REPLACE);
+  create_scene();
+  update_property_editor();
+  map_view->centerOn(x, y);
+
+  statusBar()->showMessage(
+      QString("Found %1 on %2")
+        .arg(QString::fromStdString(entry.name))
+        .arg(QString::fromStdString(map.levels[level_idx].name)),
+      5000);
 }
 
 void Editor::level_add()
@@ -495,20 +987,256 @@ void Editor::level_add()
   }
 }
 
+void Editor::level_import_floorplan()
+{
+  if (level_idx >= static_cast<int>(map.levels.size())) {
+    QMessageBox::critical(
+        this,
+        "No level to import into",
+        "Please use Level->Add... first to add a level");
+    return;
+  }
+  if (import_job_id >= 0) {
+    statusBar()->showMessage("Still importing; please wait", 5000);
+    return;
+  }
+
+  QFileDialog file_dialog(this, "Import Floorplan");
+  file_dialog.setFileMode(QFileDialog::ExistingFile);
+  file_dialog.setNameFilter("Floorplans (*.dxf *.svg)");
+  if (file_dialog.exec() != QDialog::Accepted)
+    return;
+
+  const Level &level = map.levels[level_idx];
+  import_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(
+        new ImportFloorplanJob(
+          file_dialog.selectedFiles().first(),
+          level.name,
+          level.drawing_meters_per_pixel)));
+}
+
+void Editor::floorplan_imported(ImportFloorplanJob &job)
+{
+  if (job.status == Job::CANCELLED)
+    return;
+  if (job.status != Job::SUCCEEDED) {
+    QMessageBox::critical(
+        this,
+        "Floorplan not imported",
+        QString::fromStdString(job.error));
+    return;
+  }
+
+  // the user may have switched levels (or projects) in the meantime
+  int idx = -1;
+  for (size_t i = 0; i < map.levels.size(); i++) {
+    if (map.levels[i].name == job.level_name)
+      idx = static_cast<int>(i);
+  }
+  if (idx < 0)
+    return;
+
+  Level &level = map.levels[idx];
+  const int first_vertex_idx = static_cast<int>(level.vertices.size());
+  const int first_edge_idx = static_cast<int>(level.edges.size());
+  level.vertices.insert(
+      level.vertices.end(), job.vertices.begin(), job.vertices.end());
+  level.edges.reserve(level.edges.size() + job.edges.size());
+  for (Edge edge : job.edges) {
+    edge.start_idx += first_vertex_idx;
+    edge.end_idx += first_vertex_idx;
+    level.edges.push_back(edge);
+  }
+
+  // a level without a drawing grows to fit the plan
+  map.change_bus.begin_transaction();
+  if (level.drawing_filename.empty()) {
+    level.x_meters = std::max(level.x_meters, job.width_meters);
+    level.y_meters = std::max(level.y_meters, job.height_meters);
+    level.load_drawing();
+    map.notify(MapChange(MapChange::MODIFIED, MapChange::LEVEL, idx, -1));
+  }
+  map.notify_range(
+      MapChange::ADDED,
+      MapChange::VERTEX,
+      idx,
+      first_vertex_idx,
+      static_cast<int>(level.vertices.size()));
+  map.notify_range(
+      MapChange::ADDED,
+      MapChange::EDGE,
+      idx,
+      first_edge_idx,
+      static_cast<int>(level.edges.size()));
+  map.change_bus.end_transaction();
+  if (idx == level_idx)
+    create_scene();
+  statusBar()->showMessage(
+      QString("Imported %1 walls from %2")
+        .arg(job.edges.size())
+        .arg(QFileInfo(job.filename).fileName()),
+      5000);
+}
+
+void Editor::level_extract_walls()
+{
+  if (level_idx >= static_cast<int>(map.levels.size()) ||
+      !map.levels[level_idx].drawing) {
+    QMessageBox::critical(
+        this,
+        "No drawing to extract walls from",
+        "Please use Level->Edit... to give this level a drawing first");
+    return;
+  }
+  if (extract_job_id >= 0) {
+    statusBar()->showMessage("Still extracting walls; please wait", 5000);
+    return;
+  }
+
+  // the drawing is immutable, so the job can share it
+  const Level &level = map.levels[level_idx];
+  extract_job_id = job_scheduler->start(
+      std::unique_ptr<Job>(
+        new ExtractWallsJob(
+          level.name,
+          level.drawing,
+          level.drawing_meters_per_pixel)));
+}
+
+void Editor::walls_extracted(ExtractWallsJob &job)
+{
+  if (job.status == Job::CANCELLED)
+    return;
+  if (job.status != Job::SUCCEEDED) {
+    QMessageBox::critical(
+        this,
+        "Walls not extracted",
+        QString::fromStdString(job.error));
+    return;
+  }
+
+  int idx = -1;
+  for (size_t i = 0; i < map.levels.size(); i++) {
+    if (map.levels[i].name == job.level_name)
+      idx = static_cast<int>(i);
+  }
+  if (idx < 0 || map.levels[idx].drawing != job.drawing)
+    return;  // gone, or the drawing has changed since
+
+  // the proposed walls come in selected, and nothing else is, so they
+  // can be looked over and thrown out with one press of Delete. Another
+  // level's selection is only in its flags until it is switched to.
+  Level &level = map.levels[idx];
+  Selection other_selection;
+  Selection &level_selection =
+      idx == level_idx ? selection : other_selection;
+  if (idx != level_idx)
+    other_selection.rebuild(level);
+  level_selection.clear(level);
+
+  const int first_vertex_idx = static_cast<int>(level.vertices.size());
+  const int first_edge_idx = static_cast<int>(level.edges.size());
+  level.vertices.insert(
+      level.vertices.end(), job.vertices.begin(), job.vertices.end());
+  level.edges.reserve(level.edges.size() + job.edges.size());
+  for (Edge edge : job.edges) {
+    edge.start_idx += first_vertex_idx;
+    edge.end_idx += first_vertex_idx;
+    level.edges.push_back(edge);
+  }
+
+  map.change_bus.begin_transaction();
+  map.notify_range(
+      MapChange::ADDED,
+      MapChange::VERTEX,
+      idx,
+      first_vertex_idx,
+      static_cast<int>(level.vertices.size()));
+  map.notify_range(
+      MapChange::ADDED,
+      MapChange::EDGE,
+      idx,
+      first_edge_idx,
+      static_cast<int>(level.edges.size()));
+  map.change_bus.end_transaction();
+
+  Selection::Handle handle;
+  handle.kind = Selection::VERTEX;
+  for (size_t i = 0; i < job.vertices.size(); i++) {
+    handle.idx = first_vertex_idx + static_cast<int>(i);
+    level_selection.set(level, handle, true);
+  }
+  handle.kind = Selection::EDGE;
+  for (size_t i = 0; i < job.edges.size(); i++) {
+    handle.idx = first_edge_idx + static_cast<int>(i);
+    level_selection.set(level, handle, true);
+  }
+  if (idx == level_idx)
+    create_scene();
+  statusBar()->showMessage(
+      QString("Proposed %1 walls on %2; they are selected for review")
+        .arg(job.edges.size())
+        .arg(QString::fromStdString(job.level_name)),
+      5000);
+}
+
+void Editor::level_check_lane_crossings()
+{
+  if (level_idx >= static_cast<int>(map.levels.size()))
+    return;
+  const Level &level = map.levels[level_idx];
+  EdgeCrossings edge_crossings;
+  edge_crossings.find(level);
+
+  // lanes through doors are fine; select the ones that need a look
+  clear_selection();
+  const char *kind_names[] = { "wall", "lane", "door" };
+  for (const EdgeCrossings::Crossing &c : edge_crossings.get_crossings()) {
+    if (c.kind == EdgeCrossings::LANE_DOOR)
+      continue;
+    const Edge &lane = level.edges[c.lane_idx];
+    const Edge &other = level.edges[c.other_idx];
+    printf("lane %d-%d crosses %s %d-%d at (%.1f, %.1f)\n",
+        lane.start_idx,
+        lane.end_idx,
+        kind_names[c.kind],
+        other.start_idx,
+        other.end_idx,
+        c.point.x(),
+        c.point.y());
+    Selection::Handle handle = { Selection::EDGE, c.lane_idx };
+    selection.set(map.levels[level_idx], handle, true);
+    if (c.kind == EdgeCrossings::LANE_LANE) {
+      handle.idx = c.other_idx;
+      selection.set(map.levels[level_idx], handle, true);
+    }
+  }
+  update_property_editor();
+  create_scene();
+
+  statusBar()->showMessage(
+      QString("Lanes cross %1 walls and %2 other lanes (and %3 doors)")
+        .arg(edge_crossings.count(EdgeCrossings::LANE_WALL))
+        .arg(edge_crossings.count(EdgeCrossings::LANE_LANE))
+        .arg(edge_crossings.count(EdgeCrossings::LANE_DOOR)),
+      5000);
+}
+
 void Editor::zoom_normal()
 {
   //map_view->set_absolute_scale(1.0);
-  map_view->resetMatrix();
+  map_view->reset_zoom();
 }
 
 void Editor::zoom_in()
 {
-  map_view->scale(1.25, 1.25);
+  map_view->zoom_by(1.25);
 }
 
 void Editor::zoom_out()
 {
-  map_view->scale(0.8, 0.8);
+  map_view->zoom_by(0.8);
 }
 
 void Editor::zoom_fit()
@@ -540,6 +1268,9 @@ void Editor::mouse_event(const MouseType t, QMouseEvent *e)
     }
     return;
   }
+  if (tool_id != ADD_VERTEX && tool_id != MOVE_VERTEX)
+    remove_snap_guides();
+
   // dispatch to individual mouse handler functions to save indenting...
   switch (tool_id) {
     case SELECT:       mouse_select(t, e, p); break;
@@ -561,17 +1292,44 @@ void Editor::mouse_event(const MouseType t, QMouseEvent *e)
 
 void Editor::mousePressEvent(QMouseEvent *e)
 {
+  flush_mouse_move();  // catch up with the cursor first
   mouse_event(PRESS, e);
 }
 
 void Editor::mouseReleaseEvent(QMouseEvent *e)
 {
+  flush_mouse_move();  // so a drag ends exactly where it was let go
   mouse_event(RELEASE, e);
 }
 
 void Editor::mouseMoveEvent(QMouseEvent *e)
 {
-  mouse_event(MOVE, e);
+  // The tool handlers only look at where the cursor is, not the path
+  // it took, so any move that is still waiting can simply be replaced.
+  pending_mouse_move.reset(new QMouseEvent(*e));
+  if (mouse_move_timer->isActive())
+    return;
+
+  // right away if the last frame is over, so slow moves don't lag
+  qint64 wait_ms = 0;
+  if (mouse_move_clock.isValid())
+    wait_ms = mouse_move_interval_ms - mouse_move_clock.elapsed();
+  if (wait_ms <= 0)
+    flush_mouse_move();
+  else
+    mouse_move_timer->start(static_cast<int>(wait_ms));
+}
+
+void Editor::flush_mouse_move()
+{
+  mouse_move_timer->stop();
+  if (!pending_mouse_move)
+    return;
+  std::unique_ptr<QMouseEvent> e(std::move(pending_mouse_move));
+  // the clock starts before the handler runs, so a handler that takes
+  // longer than a frame gets the next move as soon as it is done
+  mouse_move_clock.start();
+  mouse_event(MOVE, e.get());
 }
 
 int Editor::get_polygon_idx(const double x, const double y)
@@ -609,6 +1367,7 @@ void Editor::keyPressEvent(QKeyEvent *e)
     case Qt::Key_Delete:
       map.delete_keypress(level_idx);
       create_scene();
+      update_property_editor();
       break;
     case Qt::Key_S:
     case Qt::Key_Escape:
@@ -652,14 +1411,7 @@ void Editor::keyPressEvent(QKeyEvent *e)
       tool_button_group->button(ADD_ZONE)->click();
       break;
     case Qt::Key_B:
-      for (auto &edge : map.levels[level_idx].edges) {
-        if (edge.type == Edge::LANE && edge.selected) {
-          // toggle bidirectional flag
-          edge.set_param("bidirectional",
-              edge.is_bidirectional() ? "false" : "true");
-          create_scene();
-        }
-      }
+      toggle_bidirectional();
       break;
     case Qt::Key_0: number_key_pressed(0); break;
     case Qt::Key_1: number_key_pressed(1); break;
@@ -715,7 +1467,10 @@ void Editor::tool_toggled(int id, bool checked)
   // set the status bar
   switch (id) {
     case SELECT:
-      statusBar()->showMessage("Click an item to select it.");
+      statusBar()->showMessage(
+          "Click an item to select it, or drag a box around items "
+          "(Alt: draw around them). Shift adds, Ctrl toggles, "
+          "Shift+Ctrl removes.");
       break;
     case ADD_LANE:
     case ADD_WALL:
@@ -742,95 +1497,67 @@ void Editor::tool_toggled(int id, bool checked)
 
 void Editor::update_property_editor()
 {
-  add_param_button->setEnabled(false);
-  delete_param_button->setEnabled(false);
-
-  if (map.levels.empty())
-    return;
-
-  for (const auto &p : map.levels[level_idx].polygons) {
-    if (p.selected) {
-      printf("found a selected polygon\n");
-      // todo: populate property editor
-      return;
-    }
-  }
-  for (const auto &e : map.levels[level_idx].edges) {
-    if (e.selected) {
-      printf("found a selected edge\n");
-      populate_property_editor(e);
-      return;  // stop after finding the first one
-    }
-  }
-  for (const auto &m : map.levels[level_idx].models) {
-    if (m.selected) {
-      printf("found a selected model\n");
-      populate_property_editor(m);
-      return;  // stop after finding the first one
-    }
-  }
-  for (const auto &v : map.levels[level_idx].vertices) {
-    if (v.selected) {
-      printf("found a selected vertex\n");
-      populate_property_editor(v);
-      return;  // stop after finding the first one
-    }
-  }
-  // if we get here, we never found anything :(
-  clear_property_editor();
-}
+  property_model->update(map, level_idx, selection);
 
-QTableWidgetItem *Editor::create_table_item(
-    const QString &str, bool editable)
-{
-  QTableWidgetItem *item = new QTableWidgetItem(str);
-  if (!editable)
-    item->setFlags(Qt::NoItemFlags);
-  else
-    item->setBackground(QBrush(Qt::white));
-  return item;
+  // parameters can only be added to vertices so far
+  add_param_button->setEnabled(
+      property_model->get_target() == PropertyTableModel::VERTICES);
+  add_param_button->setProperty("object_type", QVariant("vertex"));
+  delete_param_button->setEnabled(false);
 }
 
-void Editor::property_editor_set_row(
-    const int row_idx,
-    const QString &label,
-    const QString &value,
-    const bool editable)
+void Editor::property_edited(PropertyTableModel::Target target)
 {
-  QTableWidgetItem *label_item = new QTableWidgetItem(label);
-  label_item->setFlags(Qt::NoItemFlags);
-
-  QTableWidgetItem *value_item = new QTableWidgetItem(value);
-  if (!editable)
-    value_item->setFlags(Qt::NoItemFlags);
-  else
-    value_item->setBackground(QBrush(Qt::white));
-
-  property_editor->setItem(row_idx, 0, label_item);
-  property_editor->setItem(row_idx, 1, value_item);
+  // Only names and parameters can be edited, so nothing moved: just
+  // the labels or the lane colors need to be redrawn
+  if (static_drag_active)
+    create_scene();
+  else if (target == PropertyTableModel::EDGES)
+    redraw_layer_items(EdgeLayerItem::Type);
+  else if (target == PropertyTableModel::VERTICES)
+    redraw_layer_items(VertexLayerItem::Type);
 }
 
-void Editor::property_editor_set_row(
-    const int row_idx,
-    const QString &label,
-    const int &value,
-    const bool editable)
+void Editor::redraw_layer_items(const int item_type)
 {
-  property_editor_set_row(row_idx, label, QString::number(value), editable);
-}
+  // the new items go where the old ones were in the stacking order
+  std::vector<QGraphicsItem *> old_items;
+  QGraphicsItem *next_item = nullptr;
+  for (QGraphicsItem *item : scene->items(Qt::AscendingOrder)) {
+    if (item->parentItem())
+      continue;
+    if (item->type() == item_type) {
+      old_items.push_back(item);
+      next_item = nullptr;
+    }
+    else if (!old_items.empty() && !next_item)
+      next_item = item;
+  }
+  for (QGraphicsItem *item : old_items) {
+    scene->removeItem(item);
+    delete item;
+  }
 
-void Editor::property_editor_set_row(
-    const int row_idx,
-    const QString &label,
-    const double &value,
-    const int num_decimal_places,
-    const bool editable)
-{
-  property_editor_set_row(
-      row_idx,
-      label,
-      QString::number(value, 'g', num_decimal_places + 1),
-      editable);
+  const Level &level = map.levels[level_idx];
+  std::vector<QGraphicsItem *> new_items;
+  if (item_type == EdgeLayerItem::Type) {
+    std::vector<int> edge_indices(level.edges.size());
+    std::iota(edge_indices.begin(), edge_indices.end(), 0);
+    for (const auto &layer : level.create_edge_layers(edge_indices, lod))
+      new_items.push_back(new EdgeLayerItem(layer));
+  }
+  else if (item_type == VertexLayerItem::Type) {
+    std::vector<int> vertex_indices(level.vertices.size());
+    std::iota(vertex_indices.begin(), vertex_indices.end(), 0);
+    new_items.push_back(
+        new VertexLayerItem(
+          std::make_shared<const VertexLayer>(level, vertex_indices, lod)));
+  }
+  for (QGraphicsItem *item : new_items) {
+    scene->addItem(item);
+    if (next_item)
+      item->stackBefore(next_item);
+  }
 }
 
 void Editor::add_param_button_clicked()
@@ -845,15 +1572,24 @@ void Editor::add_param_button_clicked()
     if (dialog.exec() != QDialog::Accepted)
       return;
 
-    for (auto &v : map.levels[level_idx].vertices)
-    {
-      if (v.selected)
-      {
-        v.params[dialog.get_param_name()] = Param(dialog.get_param_type());
-        populate_property_editor(v);
-        return;  // stop after finding the first one
-      }
+    // to all of the selected vertices, so it can be edited for all of
+    // them at once. The ones that have it already keep their value.
+    MapChangeBus::Transaction transaction(map.change_bus);
+    Level &level = map.levels[level_idx];
+    for (const int vertex_idx : selection.get(Selection::VERTEX)) {
+      Vertex &v = level.vertices[vertex_idx];
+      if (v.params.count(dialog.get_param_name()))
+        continue;
+      v.params[dialog.get_param_name()] = Param(dialog.get_param_type());
+      map.notify(
+          MapChange(
+              MapChange::MODIFIED,
+              MapChange::VERTEX,
+              level_idx,
+              vertex_idx,
+              MapChange::PARAMS));
     }
+    update_property_editor();
   }
 }
 
@@ -865,193 +1601,170 @@ void Editor::delete_param_button_clicked()
       "TODO: something...sorry.");
 }
 
-void Editor::populate_property_editor(const Edge &edge)
+void Editor::model_name_line_edited(const QString &text)
 {
-  const Level &level = map.levels[level_idx];
-  const double scale = level.drawing_meters_per_pixel;
-  const Vertex &sv = level.vertices[edge.start_idx];
-  const Vertex &ev = level.vertices[edge.end_idx];
-
-  const double sx = sv.x * scale;
-  const double sy = sv.y * scale;
-  const double ex = ev.x * scale;
-  const double ey = ev.y * scale;
-
-  const double dx = ex - sx;
-  const double dy = ey - sy;
-  const double len = sqrt(dx*dx + dy*dy);
-
-  property_editor->blockSignals(true);  // otherwise we get tons of callbacks
-  property_editor->setRowCount(8 + edge.params.size());
-
-  property_editor_set_row(0, "edge_type", edge.type_to_qstring());
-  property_editor_set_row(1, "start_idx", edge.start_idx);
-  property_editor_set_row(2, "end_idx", edge.end_idx);
-  property_editor_set_row(3, "start x (m)", sx);
-  property_editor_set_row(4, "start y (m)", sy);
-  property_editor_set_row(5, "end x (m)", ex);
-  property_editor_set_row(6, "end y (m)", ey);
-  property_editor_set_row(7, "length (m)", len);
+  //qDebug("model_name_line_edited(%s)", qUtf8Printable(text));
+  const int num_models = model_list_model->rowCount();
+  if (num_models == 0) {
+    qWarning("model name list is empty :(");
+    return;  // nothing to do; there is no available model list
+  }
 
-  int row = 8;
-  for (const auto &param : edge.params) {
-    property_editor_set_row(
-        row,
-        QString::fromStdString(param.first),
-        param.second.to_qstring(),
-        true);
-    row++;
+  if (text.isEmpty()) {
+    for (int i = 0; i < num_models; i++)
+      model_name_list_view->setRowHidden(i, false);
+    return;
   }
 
-  property_editor->blockSignals(false);  // re-enable callbacks
-}
+  // only show the models that match, and select the best match
+  const std::vector<int> matches =
+      model_catalog.fuzzy_search(text.toStdString(), num_models);
+  std::vector<bool> visible(num_models, false);
+  for (const int id : matches)
+    visible[id] = true;
+  for (int i = 0; i < num_models; i++)
+    model_name_list_view->setRowHidden(i, !visible[i]);
 
-void Editor::populate_property_editor(const Vertex &vertex)
-{
-  const Level &level = map.levels[level_idx];
-  const double scale = level.drawing_meters_per_pixel;
- 
-  property_editor->blockSignals(true);  // otherwise we get tons of callbacks
-  property_editor->setRowCount(5 + vertex.params.size());
-
-  property_editor_set_row(0, "x (pixels)", vertex.x);
-  property_editor_set_row(1, "y (pixels)", vertex.y);
-  property_editor_set_row(2, "x (m)", vertex.x * scale);
-  property_editor_set_row(3, "x (m)", vertex.y * scale);
-  property_editor_set_row(
-      4,
-      "name",
-      QString::fromStdString(vertex.name),
-      true);
-
-  int row = 5;
-  for (const auto &param : vertex.params) {
-    property_editor_set_row(
-        row,
-        QString::fromStdString(param.first),
-        param.second.to_qstring(),
-        true);
-    row++;
-  }
-
-  add_param_button->setEnabled(true);
-  add_param_button->setProperty("object_type", QVariant("vertex"));
-
-  property_editor->blockSignals(false);  // re-enable callbacks
+  if (matches.empty())
+    return;
+  const QModelIndex index = model_list_model->index(matches[0]);
+  model_name_list_view->setCurrentIndex(index);
+  model_name_list_view->scrollTo(index, QAbstractItemView::PositionAtTop);
 }
 
-void Editor::populate_property_editor(const Model &model)
+void Editor::model_name_list_view_changed(
+    const QModelIndex &current,
+    const QModelIndex &)
 {
-  printf("populate_property_editor(model)\n");
-  property_editor->blockSignals(true);  // otherwise we get tons of callbacks
-
-  property_editor->setRowCount(2);
-
-  property_editor_set_row(
-      0,
-      "name",
-      QString::fromStdString(model.instance_name));
-
-  property_editor_set_row(
-      2,
-      "model_name",
-      QString::fromStdString(model.model_name));
-      
-  property_editor->blockSignals(false);  // re-enable callbacks
+  qDebug("model_name_list_view_changed(%d)", current.row());
+  update_model_preview();
 }
 
-void Editor::clear_property_editor()
+void Editor::update_model_preview()
 {
-  property_editor->setRowCount(0);
-  add_param_button->setEnabled(false);
-  delete_param_button->setEnabled(false);
+  const int row = model_name_list_view->currentIndex().row();
+  if (row < 0 || row >= static_cast<int>(model_catalog.models.size()))
+    return;  // list was cleared, or nothing is selected
+  // this will be the placeholder until the thumbnail is decoded;
+  // thumbnail_loaded() will call us again when it's ready.
+  const QPixmap model_pixmap(thumbnail_cache->pixmap(row));
+  if (model_pixmap.isNull())
+    return;  // we don't have a pixmap to draw :(
+  // scale the pixmap so it fits within the currently allotted space
+  const int w = model_preview_label->width();
+  const int h = model_preview_label->height();
+  model_preview_label->setPixmap(
+      model_pixmap.scaled(w, h, Qt::KeepAspectRatio));
 }
 
-void Editor::property_editor_cell_changed(int row, int column)
+void Editor::thumbnail_loaded(int model_id)
 {
-  std::string name = property_editor->item(row, 0)->text().toStdString();
-  std::string value = property_editor->item(row, 1)->text().toStdString();
-  printf("property_editor_cell_changed(%d, %d) = param %s\n",
-      row, column, name.c_str());
-
-  for (auto &v : map.levels[level_idx].vertices) {
-    if (!v.selected)
-      continue;
-    if (name == "name")
-      v.name = value;
-    else
-      v.set_param(name, value);
-    create_scene();
-    return;  // stop after finding the first one
-  }
+  thumbnail_generation++;  // parked scenes still show the placeholder
+  if (model_name_list_view->currentIndex().row() == model_id)
+    update_model_preview();
 
-  for (auto &e : map.levels[level_idx].edges) {
-    if (!e.selected)
+  // swap the placeholders of this model for the real thumbnail
+  if (map.levels.empty())
+    return;
+  const Level &level = map.levels[level_idx];
+  for (size_t i = 0; i < model_pixmap_items.size(); i++) {
+    if (model_pixmap_items[i] == nullptr ||
+        i >= level.models.size() ||
+        level.models[i].model_id != model_id)
       continue;
-    e.set_param(name, value);
-    create_scene();
-    return;  // stop after finding the first one
+    set_model_item_pixmap(model_pixmap_items[i], model_id);
   }
 }
 
-void Editor::model_name_line_edited(const QString &text)
+bool Editor::set_model_item_pixmap(
+    QGraphicsPixmapItem *item,
+    const int model_id)
 {
-  //qDebug("model_name_line_edited(%s)", qUtf8Printable(text));
-  if (model_name_list_widget->count() == 0) {
-    qWarning("model name list widget is empty :(");
-    return;  // nothing to do; there is no available model list
-  }
-
-  // see if we can auto-complete with anything in the list box
-  // scroll the list box to the first thing
-  std::string user_text_lower(text.toLower().toStdString());
-  // could become super fancy but for now let's just do linear search...
-  size_t closest_idx = 0;
-  for (size_t i = 0; i < models.size(); i++) {
-    if (user_text_lower < models[i].name_lowercase) {
-      closest_idx = i;
-      break;
-    }
-  }
-  QListWidgetItem *item = model_name_list_widget->item(closest_idx);
-  model_name_list_widget->setCurrentItem(item);
-  model_name_list_widget->scrollToItem(
-      item,
-      QAbstractItemView::PositionAtTop);
+  if (map.levels.empty() || model_id < 0)
+    return false;
+  const QPixmap thumbnail(thumbnail_cache->pixmap(model_id));
+  if (thumbnail.isNull())
+    return false;  // couldn't load the pixmap
+
+  // Use the smallest pre-scaled sprite that still has at least one
+  // sprite pixel per screen pixel, and scale the item up by however
+  // much that sprite was shrunk, so it covers the same area on the map.
+  const EditorModel &model = model_catalog.models[model_id];
+  const double model_scale =
+      model.meters_per_pixel / map.levels[level_idx].drawing_meters_per_pixel;
+  const int requested_level =
+      ModelSpriteCache::mip_level(model_scale * map_view->get_scale());
+  int level = 0;
+  const QPixmap pixmap(
+      model_sprite_cache->sprite(model_id, requested_level, level));
+
+  item->setPixmap(pixmap);
+  item->setOffset(-pixmap.width()/2, -pixmap.height()/2);
+  item->setScale(
+      model_scale * thumbnail.width() / std::max(1, pixmap.width()));
+  item->setData(MIP_LEVEL_DATA_KEY, requested_level);
+  return true;
 }
 
-void Editor::model_name_list_widget_changed(int row)
+void Editor::map_view_zoom_changed(double scale)
 {
-  qDebug("model_name_list_widget_changed(%d)", row);
-  const QPixmap &model_pixmap = models[row].get_pixmap();
-  if (model_pixmap.isNull())
-    return;  // we don't have a pixmap to draw :(
-  // scale the pixmap so it fits within the currently allotted space
-  const int w = model_preview_label->width();
-  const int h = model_preview_label->height();
-  model_preview_label->setPixmap(
-      model_pixmap.scaled(w, h, Qt::KeepAspectRatio));
+  if (map.levels.empty())
+    return;
+
+  // swap in a differently-sized sprite for the models whose mip level
+  // changed. The others keep their pixmaps, so this is cheap when the
+  // zoom only changed a little.
+  const Level &level = map.levels[level_idx];
+  for (size_t i = 0; i < model_pixmap_items.size(); i++) {
+    QGraphicsPixmapItem *item = model_pixmap_items[i];
+    if (item == nullptr || i >= level.models.size())
+      continue;
+    const int model_id = level.models[i].model_id;
+    const double model_scale =
+        model_catalog.models[model_id].meters_per_pixel /
+        level.drawing_meters_per_pixel;
+    const int requested_level = ModelSpriteCache::mip_level(model_scale * scale);
+    if (item->data(MIP_LEVEL_DATA_KEY).toInt() != requested_level)
+      set_model_item_pixmap(item, model_id);
+  }
 }
 
-bool Editor::create_scene()
+void Editor::clear_scene()
 {
   scene->clear();  // destroys the mouse_motion_* items if they are there
+  model_pixmap_items.clear();
   mouse_motion_line = nullptr;
   mouse_motion_model = nullptr;
   mouse_motion_ellipse = nullptr;
   mouse_motion_polygon = nullptr;
+  snap_guide_item = nullptr;
+  rubber_band_item = nullptr;
+  drag_items.clear();
+  static_drag_active = false;
+}
+
+bool Editor::create_scene()
+{
+  clear_scene();
+
+  // something other than a drag may have changed the level, so the
+  // static tiles can't be trusted anymore. See end_static_drag().
+  static_tiles_valid = false;
+  snap_engine.clear();
 
   if (map.levels.empty()) {
     printf("nothing to draw!\n");
     return false;
   }
 
+  resolve_model_ids();
   const Level &level = map.levels[level_idx];
 
   if (level.drawing_filename.size()) {
     scene->setSceneRect(
         QRectF(0, 0, level.drawing_width, level.drawing_height));
-    scene->addPixmap(level.pixmap);
+    if (level.drawing)
+      scene->addItem(new DrawingItem(level.drawing, drawing_pixmap_cache));
   }
   else {
     const double w = level.x_meters / level.drawing_meters_per_pixel;
@@ -1061,31 +1774,11 @@ bool Editor::create_scene()
   }
 
   level.draw_polygons(scene);
-  level.draw_edges(scene);
-
-  // now draw all the models
-  for (const auto &nav_model : level.models) {
-    // find the pixmap we need for this model
-    QPixmap pixmap;
-    double model_meters_per_pixel = 1.0;  // will get overridden
-    for (auto &model : models) {
-      if (model.name == nav_model.model_name) {
-        pixmap = model.get_pixmap();
-        model_meters_per_pixel = model.meters_per_pixel;
-        break;
-      }
-    }
-    if (pixmap.isNull())
-      continue;  // couldn't load the pixmap; ignore it.
-
-    QGraphicsPixmapItem *item = scene->addPixmap(pixmap);
-    item->setOffset(-pixmap.width()/2, -pixmap.height()/2);
-    item->setScale(model_meters_per_pixel / level.drawing_meters_per_pixel);
-    item->setPos(nav_model.x, nav_model.y);
-    item->setRotation(-nav_model.yaw * 180.0 / M_PI);
-  }
-
-  level.draw_vertices(scene);
+  if (lane_clearance_action->isChecked())
+    draw_lane_clearance(level);
+  level.draw_edges(scene, lod);
+  draw_models(level);
+  level.draw_vertices(scene, lod);
 
 #if 0
   // ahhhhh only for debugging...
@@ -1106,18 +1799,204 @@ bool Editor::create_scene()
   return true;
 }
 
-void Editor::clear_selection()
+void Editor::draw_models(const Level &level)
+{
+  // Thumbnails that are still loading are drawn as placeholders and
+  // swapped out in thumbnail_loaded()
+  model_pixmap_items.resize(level.models.size(), nullptr);
+  for (size_t i = 0; i < level.models.size(); i++) {
+    const Model &nav_model = level.models[i];
+    QGraphicsPixmapItem *item = new QGraphicsPixmapItem;
+    if (!set_model_item_pixmap(item, nav_model.model_id)) {
+      delete item;
+      continue;  // couldn't load the pixmap; ignore it.
+    }
+    scene->addItem(item);
+    item->setPos(nav_model.x, nav_model.y);
+    item->setRotation(-nav_model.yaw * 180.0 / M_PI);
+    model_pixmap_items[i] = item;
+  }
+}
+
+void Editor::draw_lane_clearance(const Level &level)
+{
+  // model footprints come from their thumbnails, which are drawn to
+  // scale; the ones that aren't loaded yet are left out
+  std::vector<QPolygonF> model_footprints(level.models.size());
+  for (size_t i = 0; i < level.models.size(); i++) {
+    const Model &nav_model = level.models[i];
+    if (nav_model.model_id < 0 ||
+        !thumbnail_cache->is_loaded(nav_model.model_id))
+      continue;
+    const QPixmap thumbnail(thumbnail_cache->pixmap(nav_model.model_id));
+    const double model_scale =
+        model_catalog.models[nav_model.model_id].meters_per_pixel /
+        level.drawing_meters_per_pixel;
+    const double hw = model_scale * thumbnail.width() / 2.0;
+    const double hh = model_scale * thumbnail.height() / 2.0;
+
+    // same placement as the pixmap items in draw_models()
+    QTransform transform;
+    transform.translate(nav_model.x, nav_model.y);
+    transform.rotateRadians(-nav_model.yaw);
+    model_footprints[i] =
+        transform.map(QPolygonF(QRectF(-hw, -hh, 2 * hw, 2 * hh)));
+  }
+
+  QSettings settings;
+  lane_clearance.update(
+      level,
+      settings.value(preferences_keys::lane_clearance_radius, 0.5).toDouble(),
+      model_footprints);
+  if (!lane_clearance.get_violations().empty())
+    scene->addItem(new LaneClearanceItem(lane_clearance));
+}
+
+void Editor::lane_clearance_toggled(bool checked)
+{
+  level_scene_cache.clear();  // parked scenes have the old overlay
+  if (!checked)
+    lane_clearance.clear();
+  create_scene();
+  if (checked && !map.levels.empty()) {
+    statusBar()->showMessage(
+        QString("%1 lane stretches are too close to an obstacle")
+            .arg(lane_clearance.get_violations().size()),
+        5000);
+  }
+}
+
+void Editor::begin_static_drag(const int vertex_idx)
 {
   if (map.levels.empty())
     return;
-  for (auto &vertex: map.levels[level_idx].vertices)
-    vertex.selected = false;
-  for (auto &edge: map.levels[level_idx].edges)
-    edge.selected = false;
-  for (auto &model: map.levels[level_idx].models)
-    model.selected = false;
-  for (auto &polygon: map.levels[level_idx].polygons)
-    polygon.selected = false;
+  const Level &level = map.levels[level_idx];
+
+  // find everything that has to be redrawn when this vertex moves:
+  // its edges and polygons, and the vertices drawn on top of those
+  std::vector<bool> vertex_moves(level.vertices.size(), false);
+  std::vector<bool> edge_moves(level.edges.size(), false);
+  std::vector<bool> polygon_moves(level.polygons.size(), false);
+  if (vertex_idx >= 0) {
+    vertex_moves[vertex_idx] = true;
+    for (size_t i = 0; i < level.edges.size(); i++) {
+      const Edge &edge = level.edges[i];
+      if (edge.start_idx == vertex_idx || edge.end_idx == vertex_idx) {
+        edge_moves[i] = true;
+        vertex_moves[edge.start_idx] = true;
+        vertex_moves[edge.end_idx] = true;
+      }
+    }
+    for (size_t i = 0; i < level.polygons.size(); i++) {
+      const Polygon &polygon = level.polygons[i];
+      if (std::find(
+          polygon.vertices.begin(),
+          polygon.vertices.end(),
+          vertex_idx) == polygon.vertices.end())
+        continue;
+      polygon_moves[i] = true;
+      for (const int polygon_vertex_idx : polygon.vertices)
+        vertex_moves[polygon_vertex_idx] = true;
+    }
+  }
+
+  // and snapshot everything else for the tile renderers
+  std::shared_ptr<StaticLayers> layers = std::make_shared<StaticLayers>();
+  layers->scene_rect = scene->sceneRect();
+  layers->drawing = level.drawing;
+
+  drag_polygons.clear();
+  for (size_t i = 0; i < level.polygons.size(); i++) {
+    if (polygon_moves[i]) {
+      drag_polygons.push_back(static_cast<int>(i));
+      continue;
+    }
+    layers->polygons.push_back(level.polygon_shape(level.polygons[i]));
+    layers->polygon_brushes.push_back(
+        Level::polygon_brush(level.polygons[i].selected));
+  }
+
+  std::vector<int> static_edges;
+  drag_edges.clear();
+  for (size_t i = 0; i < level.edges.size(); i++)
+    (edge_moves[i] ? drag_edges : static_edges).push_back(static_cast<int>(i));
+  layers->edge_layers = level.create_edge_layers(static_edges, lod);
+
+  std::vector<int> static_vertices;
+  drag_vertices.clear();
+  for (size_t i = 0; i < level.vertices.size(); i++) {
+    (vertex_moves[i] ? drag_vertices : static_vertices)
+        .push_back(static_cast<int>(i));
+  }
+  layers->vertex_layer =
+      std::make_shared<const VertexLayer>(level, static_vertices, lod);
+
+  // The tiles left over from the previous drag are still good if
+  // nothing else happened since then (see end_static_drag).
+  if (!static_tiles_valid || static_tiles_level_idx != level_idx)
+    static_tile_cache->clear();
+  static_tiles_level_idx = level_idx;
+
+  clear_scene();
+  scene->addItem(
+      new StaticTileItem(*static_tile_cache, layers->bounding_rect()));
+  draw_models(level);
+  static_drag_active = true;
+  update_static_drag_items();
+
+  // the old tiles still have the moving things painted into them
+  static_tile_cache->invalidate(drag_items_bounds);
+  static_tile_cache->set_layers(layers);
+}
+
+void Editor::update_static_drag_items()
+{
+  for (QGraphicsItem *item : drag_items) {
+    scene->removeItem(item);
+    delete item;
+  }
+  drag_items.clear();
+
+  const Level &level = map.levels[level_idx];
+  for (const int i : drag_polygons)
+    drag_items.push_back(level.draw_polygon(scene, level.polygons[i]));
+
+  for (const auto &layer : level.create_edge_layers(drag_edges, lod)) {
+    EdgeLayerItem *item = new EdgeLayerItem(layer);
+    scene->addItem(item);
+    drag_items.push_back(item);
+  }
+
+  if (!drag_vertices.empty()) {
+    VertexLayerItem *item = new VertexLayerItem(
+        std::make_shared<const VertexLayer>(level, drag_vertices, lod));
+    scene->addItem(item);
+    drag_items.push_back(item);
+  }
+
+  drag_items_bounds = QRectF();
+  for (const QGraphicsItem *item : drag_items)
+    drag_items_bounds |= item->sceneBoundingRect();
+}
+
+void Editor::end_static_drag()
+{
+  // The tiles are still good except where the moving things ended up,
+  // so they can be reused by the next drag if nothing else changes.
+  const bool was_active = static_drag_active;
+  const QRectF dirty = drag_items_bounds;
+  create_scene();
+  if (was_active) {
+    static_tile_cache->invalidate(dirty);
+    static_tiles_valid = true;
+  }
+}
+
+void Editor::clear_selection()
+{
+  if (level_idx >= static_cast<int>(map.levels.size()))
+    return;
+  selection.clear(map.levels[level_idx]);
 }
 
 void Editor::draw_mouse_motion_line_item(
@@ -1153,12 +2032,19 @@ void Editor::draw_mouse_motion_line_item(
 
 void Editor::remove_mouse_motion_item()
 {
+  remove_snap_guides();
   if (mouse_motion_line) {
     scene->removeItem(mouse_motion_line);
     delete mouse_motion_line;
     mouse_motion_line = nullptr;
   }
   if (mouse_motion_model) {
+    // this may have been one of the placed models (see mouse_move_model)
+    std::replace(
+        model_pixmap_items.begin(),
+        model_pixmap_items.end(),
+        mouse_motion_model,
+        static_cast<QGraphicsPixmapItem *>(nullptr));
     scene->removeItem(mouse_motion_model);
     delete mouse_motion_model;
     mouse_motion_model = nullptr;
@@ -1173,87 +2059,114 @@ void Editor::remove_mouse_motion_item()
     delete mouse_motion_polygon;
     mouse_motion_polygon = nullptr;
   }
+  if (rubber_band_item) {
+    scene->removeItem(rubber_band_item);
+    delete rubber_band_item;
+    rubber_band_item = nullptr;
+  }
 }
 
-void Editor::set_selected_line_item(QGraphicsLineItem *line_item)
+void Editor::selection_handles_at(
+    const QPointF &p,
+    QMouseEvent *e,
+    std::vector<Selection::Handle> &handles)
 {
-  clear_selection();
-
-  if (line_item == nullptr)
+  const QPoint p_global = mapToGlobal(e->pos());
+  const QPoint p_map = map_view->mapFromGlobal(p_global);
+  QGraphicsItem *item = map_view->itemAt(p_map.x(), p_map.y());
+  if (!item)
     return;
 
-  // find if any of our lanes match those vertices
-  for (auto &edge : map.levels[level_idx].edges) {
-    const auto &v_start = map.levels[level_idx].vertices[edge.start_idx];
-    const auto &v_end = map.levels[level_idx].vertices[edge.end_idx];
-    if (line_vertices_match(line_item, v_start, v_end, 10.0)) {
-      edge.selected = true;
-      return;  // stop after first one is found, don't select multiple
-    }
+  Selection::Handle handle = { Selection::VERTEX, -1 };
+  if (item->type() == EdgeLayerItem::Type) {
+    // a few screen pixels of slack, since some edges are very thin
+    const double tolerance = 3.0 / map_view->get_scale();
+    handle.kind = Selection::EDGE;
+    handle.idx =
+        qgraphicsitem_cast<EdgeLayerItem *>(item)->edge_at(p, tolerance);
+  }
+  else if (item->type() == VertexLayerItem::Type) {
+    handle.idx =
+        qgraphicsitem_cast<VertexLayerItem *>(item)->vertex_at(p, 0.0);
+  }
+  else if (item->type() == QGraphicsPixmapItem::Type) {
+    auto it = std::find(
+        model_pixmap_items.begin(),
+        model_pixmap_items.end(),
+        qgraphicsitem_cast<QGraphicsPixmapItem *>(item));
+    handle.kind = Selection::MODEL;
+    if (it != model_pixmap_items.end())
+      handle.idx = static_cast<int>(it - model_pixmap_items.begin());
+  }
+  else if (item->type() == QGraphicsPolygonItem::Type) {
+    polygon_idx = get_polygon_idx(p.x(), p.y());
+    if (polygon_idx < 0)
+      return;  // didn't click on a polygon
+    // the polygon comes with its vertices, so they can be dragged
+    handle.kind = Selection::POLYGON;
+    handle.idx = polygon_idx;
+    const Polygon &polygon = map.levels[level_idx].polygons[polygon_idx];
+    for (const int vertex_idx : polygon.vertices)
+      handles.push_back(Selection::Handle{ Selection::VERTEX, vertex_idx });
+  }
+  if (handle.idx >= 0)
+    handles.push_back(handle);
+}
+
+void Editor::update_rubber_band_item()
+{
+  QPainterPath path;
+  path.addPolygon(rubber_band);
+  path.closeSubpath();
+  if (!rubber_band_item) {
+    QPen pen(Qt::DashLine);
+    pen.setCosmetic(true);
+    rubber_band_item = scene->addPath(
+        path,
+        pen,
+        QBrush(QColor::fromRgbF(0.0, 0.5, 1.0, 0.1)));
+    rubber_band_item->setZValue(1.0);  // over the items of the level
   }
-}
-
-void Editor::set_selected_pixmap_item(QGraphicsPixmapItem *item)
-{
-  clear_selection();
-  if (item == nullptr)
-    return;
-  // find which model matches the vertex
-  for (auto &model : map.levels[level_idx].models) {
-    const double dx = item->pos().x() - model.x;
-    const double dy = item->pos().y() - model.y;
-    const double dist = sqrt(dx*dx + dy*dy);
-    // should be exactly the same vertex, but give some room for
-    // floating-point roundoff and stuff.
-    if (dist < 1.0) {
-      model.selected = true;
-      return;
+  else
+    rubber_band_item->setPath(path);
+}
+
+void Editor::select_in_rubber_band()
+{
+  Level &level = map.levels[level_idx];
+  std::vector<Selection::Handle> handles;
+
+  // only the layers near the rubber band have to look through their
+  // spatial grids, and then only at the cells that it covers
+  std::vector<int> indices;
+  const QRectF rect = rubber_band.boundingRect();
+  for (QGraphicsItem *item :
+       scene->items(rect, Qt::IntersectsItemBoundingRect)) {
+    Selection::Kind kind = Selection::VERTEX;
+    indices.clear();
+    if (item->type() == EdgeLayerItem::Type) {
+      kind = Selection::EDGE;
+      qgraphicsitem_cast<EdgeLayerItem *>(item)->edges_in(
+          rubber_band, indices);
+    }
+    else if (item->type() == VertexLayerItem::Type) {
+      qgraphicsitem_cast<VertexLayerItem *>(item)->vertices_in(
+          rubber_band, indices);
     }
+    for (const int idx : indices)
+      handles.push_back(Selection::Handle{ kind, idx });
   }
-}
 
-void Editor::set_selected_ellipse_item(QGraphicsEllipseItem *item)
-{
-  clear_selection();
-  if (item == nullptr)
-    return;
-  for (auto &vertex : map.levels[level_idx].vertices) {
-    const double dx = item->rect().center().x() - vertex.x;
-    const double dy = item->rect().center().y() - vertex.y;
-    const double dist = sqrt(dx*dx + dy*dy);
-    // should be exactly the same vertex, but give some room for
-    // floating-point roundoff and stuff.
-    if (dist < 1.0) {
-      vertex.selected = true;
-      return;
+  // there are few enough models to just check them all
+  for (size_t i = 0; i < level.models.size(); i++) {
+    const QPointF p(level.models[i].x, level.models[i].y);
+    if (rubber_band.containsPoint(p, Qt::OddEvenFill)) {
+      handles.push_back(
+          Selection::Handle{ Selection::MODEL, static_cast<int>(i) });
     }
   }
-}
-
-bool Editor::line_vertices_match(
-    const QGraphicsLineItem *line_item,
-    const Vertex &v1,
-    const Vertex &v2,
-    const double max_dist)
-{
-  if (!line_item)
-    return false;
 
-  // look up the line's vertices
-  const double x1 = line_item->line().x1();
-  const double y1 = line_item->line().y1();
-  const double x2 = line_item->line().x2();
-  const double y2 = line_item->line().y2();
-
-  // calculate distances
-  const double dx1 = v1.x - x1;
-  const double dy1 = v1.y - y1;
-  const double dx2 = v2.x - x2;
-  const double dy2 = v2.y - y2;
-  const double v1_dist = sqrt(dx1*dx1 + dy1*dy1);
-  const double v2_dist = sqrt(dx2*dx2 + dy2*dy2);
-
-  return v1_dist < max_dist && v2_dist < max_dist;
+  selection.apply(level, handles, rubber_band_mode);
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -1263,34 +2176,52 @@ bool Editor::line_vertices_match(
 void Editor::mouse_select(
     const MouseType type, QMouseEvent *e, const QPointF &p)
 {
-  if (type != PRESS)
-    return;
-  clear_selection();
-  const QPoint p_global = mapToGlobal(e->pos());
-  const QPoint p_map = map_view->mapFromGlobal(p_global);
-  QGraphicsItem *item = map_view->itemAt(p_map.x(), p_map.y());
-  if (item) {
-    if (item->type() == QGraphicsLineItem::Type) {
-      set_selected_line_item(
-          qgraphicsitem_cast<QGraphicsLineItem *>(item));
-    }
-    else if (item->type() == QGraphicsEllipseItem::Type) {
-      set_selected_ellipse_item(
-          qgraphicsitem_cast<QGraphicsEllipseItem *>(item));
+  if (type == PRESS) {
+    remove_mouse_motion_item();  // a rubber band whose release was lost
+    const Selection::Mode mode = Selection::mode_from_keys(
+        e->modifiers() & Qt::ShiftModifier,
+        e->modifiers() & Qt::ControlModifier);
+    std::vector<Selection::Handle> handles;
+    selection_handles_at(p, e, handles);
+    if (handles.empty()) {
+      // nothing here, so start dragging out a rubber band
+      rubber_band_mode = mode;
+      rubber_band_lasso = e->modifiers() & Qt::AltModifier;
+      rubber_band.clear();
+      rubber_band.append(p);
+      if (!rubber_band_lasso)
+        rubber_band << p << p << p;  // the corners of a rectangle
+      update_rubber_band_item();
+      return;
     }
-    else if (item->type() == QGraphicsPixmapItem::Type) {
-      set_selected_pixmap_item(
-          qgraphicsitem_cast<QGraphicsPixmapItem *>(item));
+    selection.apply(map.levels[level_idx], handles, mode);
+  }
+  else if (type == MOVE) {
+    if (!rubber_band_item)
+      return;
+    if (!rubber_band_lasso) {
+      const QPointF &start = rubber_band[0];
+      rubber_band[1] = QPointF(p.x(), start.y());
+      rubber_band[2] = p;
+      rubber_band[3] = QPointF(start.x(), p.y());
     }
-    else if (item->type() == QGraphicsPolygonItem::Type) {
-      polygon_idx = get_polygon_idx(p.x(), p.y());
-      if (polygon_idx < 0)
-        return;  // didn't click on a polygon
-      Polygon &polygon = map.levels[level_idx].polygons[polygon_idx];
-      polygon.selected = true;
-      for (const auto &vertex_idx : polygon.vertices)
-        map.levels[level_idx].vertices[vertex_idx].selected = true;
+    else {
+      // skip points less than a couple of screen pixels apart
+      const QPointF d = p - rubber_band.back();
+      const double min_dist = 2.0 / map_view->get_scale();
+      if (d.x() * d.x() + d.y() * d.y() < min_dist * min_dist)
+        return;
+      rubber_band.append(p);
     }
+    update_rubber_band_item();
+    return;
+  }
+  else if (type == RELEASE) {
+    if (!rubber_band_item)
+      return;
+    remove_mouse_motion_item();
+    select_in_rubber_band();
+    rubber_band.clear();
   }
   // todo: be smarter and go find the actual GraphicsItem to avoid
   // a full repaint here...
@@ -1299,31 +2230,88 @@ void Editor::mouse_select(
 }
 
 void Editor::mouse_add_vertex(
-    const MouseType t, QMouseEvent *, const QPointF &p)
+    const MouseType t, QMouseEvent *e, const QPointF &p)
 {
-  if (t == PRESS) {
-    map.add_vertex(level_idx, p.x(), p.y());
+  const SnapEngine::Snap snap = snap_vertex(p, -1, e);
+  if (t == MOVE)
+    show_snap_guides(snap);  // where a click would put it
+  else if (t == PRESS) {
+    if (snap.kind == SnapEngine::VERTEX) {
+      statusBar()->showMessage("There is a vertex there already", 2000);
+      return;
+    }
+    map.add_vertex(level_idx, snap.point.x(), snap.point.y());
     create_scene();
   }
 }
 
 void Editor::mouse_move_vertex(
-    const MouseType t, QMouseEvent *, const QPointF &p)
+    const MouseType t, QMouseEvent *e, const QPointF &p)
 {
   if (t == PRESS) {
     clicked_idx = map.nearest_item_index_if_within_distance(
         level_idx, p.x(), p.y(), 10.0, Map::VERTEX);
+    if (clicked_idx >= 0)
+      begin_static_drag(clicked_idx);
   }
   else if (t == RELEASE) {
+    if (clicked_idx >= 0)
+      end_static_drag();
     clicked_idx = -1;
   }
   else if (t == MOVE) {
     if (clicked_idx < 0)
       return;
+    const SnapEngine::Snap snap = snap_vertex(p, clicked_idx, e);
     Vertex *pt = &map.levels[level_idx].vertices[clicked_idx];
-    pt->x = p.x();
-    pt->y = p.y();
-    create_scene();
+    pt->x = snap.point.x();
+    pt->y = snap.point.y();
+    map.notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::VERTEX,
+            level_idx,
+            clicked_idx,
+            MapChange::POSITION));
+    if (static_drag_active)
+      update_static_drag_items();
+    else
+      create_scene();
+    show_snap_guides(snap);
+  }
+}
+
+SnapEngine::Snap Editor::snap_vertex(
+    const QPointF &p,
+    const int moving_vertex_idx,
+    const QMouseEvent *e)
+{
+  // holding Shift puts the vertex right under the cursor
+  if (!snap_action->isChecked() || (e->modifiers() & Qt::ShiftModifier))
+    return SnapEngine::unsnapped(p);
+
+  // built once per drag (or per edit, for new vertices), not per event
+  if (!snap_engine.is_built() ||
+      snap_engine.get_moving_vertex_idx() != moving_vertex_idx)
+    snap_engine.build(map.levels[level_idx], moving_vertex_idx);
+  return snap_engine.snap(p, map_view->get_scale());
+}
+
+void Editor::show_snap_guides(const SnapEngine::Snap &snap)
+{
+  remove_snap_guides();
+  if (snap.kind == SnapEngine::NONE)
+    return;
+  snap_guide_item = new SnapGuideItem(snap, 3.0 / map_view->get_scale());
+  scene->addItem(snap_guide_item);
+}
+
+void Editor::remove_snap_guides()
+{
+  if (snap_guide_item) {
+    scene->removeItem(snap_guide_item);
+    delete snap_guide_item;
+    snap_guide_item = nullptr;
   }
 }
 
@@ -1387,24 +2375,21 @@ void Editor::mouse_add_model(
     const MouseType t, QMouseEvent *, const QPointF &p)
 {
   if (t == PRESS) {
-    const int model_row = model_name_list_widget->currentRow();
+    const int model_row = model_name_list_view->currentIndex().row();
     if (model_row < 0)
       return;  // nothing currently selected. nothing to do.
-    map.add_model(level_idx, p.x(), p.y(), 0.0, models[model_row].name);
+    map.add_model(
+        level_idx, p.x(), p.y(), 0.0, model_catalog.models[model_row].name);
     create_scene();
   }
   else if (t == MOVE) {
-    const int model_row = model_name_list_widget->currentRow();
+    const int model_row = model_name_list_view->currentIndex().row();
     if (model_row < 0)
       return;  // nothing currently selected. nothing to do.
-    EditorModel &model = models[model_row];
     if (mouse_motion_model == nullptr) {
-      const QPixmap pixmap(model.get_pixmap());
-      mouse_motion_model = scene->addPixmap(pixmap);
-      mouse_motion_model->setOffset(-pixmap.width()/2, -pixmap.height()/2);
-      mouse_motion_model->setScale(
-          model.meters_per_pixel /
-          map.levels[level_idx].drawing_meters_per_pixel);
+      mouse_motion_model = new QGraphicsPixmapItem;
+      set_model_item_pixmap(mouse_motion_model, model_row);
+      scene->addItem(mouse_motion_model);
     }
     mouse_motion_model->setPos(p.x(), p.y());
   }
@@ -1482,28 +2467,15 @@ void Editor::mouse_move_model(
         level_idx, p.x(), p.y(), click_distance, Map::MODEL);
     if (clicked_idx < 0)
       return;  // didn't click close to an existing model
+    begin_static_drag(-1);  // everything but the models stays put
     // Now we need to find the pixmap item for this model.
-    // todo: use fancier calls if the scene graph gets so big that a linear
-    // search becomes intolerably slow
-    const QList <QGraphicsItem *> items = scene->items();
     mouse_motion_model = nullptr;
-    double min_dist = 1.0e9;
-    QPointF mp(
-        map.levels[level_idx].models[clicked_idx].x,
-        map.levels[level_idx].models[clicked_idx].y);
-    for (const auto item : items) {
-      if (item->type() != QGraphicsPixmapItem::Type)
-        continue;  // ignore anything other than the pixmaps (models)
-      const double model_click_distance = QLineF(mp, item->pos()).length();
-      if (model_click_distance < min_dist) {
-        min_dist = model_click_distance;
-        mouse_motion_model = qgraphicsitem_cast<QGraphicsPixmapItem *>(item);
-      }
-    }
+    if (clicked_idx < static_cast<int>(model_pixmap_items.size()))
+      mouse_motion_model = model_pixmap_items[clicked_idx];
   }
   else if (t == RELEASE) {
     clicked_idx = -1;
-    create_scene();
+    end_static_drag();
   }
   else if (t == MOVE) {
     if (!(e->buttons() & Qt::LeftButton))
@@ -1513,6 +2485,13 @@ void Editor::mouse_move_model(
     // update both the nav_model data and the pixmap in the scene
     map.levels[level_idx].models[clicked_idx].x = p.x();
     map.levels[level_idx].models[clicked_idx].y = p.y();
+    map.notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::MODEL,
+            level_idx,
+            clicked_idx,
+            MapChange::POSITION));
     mouse_motion_model->setPos(p);
   }
 }
@@ -1531,7 +2510,9 @@ void Editor::mouse_add_polygon(
         return; // nothing to do. click wasn't on a vertex.
 
       Vertex &v = map.levels[level_idx].vertices[clicked_idx];
-      v.selected = true;  // todo: find graphics item for vertex and colorize it
+      // todo: find graphics item for vertex and colorize it
+      const Selection::Handle handle = { Selection::VERTEX, clicked_idx };
+      selection.set(map.levels[level_idx], handle, true);
     
       if (mouse_motion_polygon == nullptr) {
         QVector<QPointF> polygon_vertices;
@@ -1561,6 +2542,12 @@ void Editor::mouse_add_polygon(
         for (const auto &i : mouse_motion_polygon_vertices)
           polygon.vertices.push_back(i);
         map.levels[level_idx].polygons.push_back(polygon);
+        map.notify(
+            MapChange(
+                MapChange::ADDED,
+                MapChange::POLYGON,
+                level_idx,
+                static_cast<int>(map.levels[level_idx].polygons.size()) - 1));
       }
       scene->removeItem(mouse_motion_polygon);
       delete mouse_motion_polygon;
@@ -1619,6 +2606,8 @@ void Editor::mouse_edit_polygon(
       if (vertex_idx < 0)
         return;  // Nothing to do. Click wasn't near a vertex.
       // first mark the vertex as no longer selected
+      const Selection::Handle handle = { Selection::VERTEX, vertex_idx };
+      selection.set(map.levels[level_idx], handle, false);
       map.remove_polygon_vertex(level_idx, polygon_idx, vertex_idx);
       create_scene();
     }
@@ -1687,6 +2676,13 @@ void Editor::mouse_edit_polygon(
     existing.vertices.insert(
         existing.vertices.begin() + mouse_motion_polygon_vertex_idx,
         release_vertex_idx);
+    map.notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::POLYGON,
+            level_idx,
+            polygon_idx,
+            MapChange::VERTICES));
   
     create_scene();
   }
@@ -1708,15 +2704,94 @@ void Editor::level_button_toggled(int button_idx, bool checked)
   qInfo("level button toggled: %d, %d", button_idx, checked ? 1 : 0);
   if (!checked)
     return;
-  level_idx = button_idx;
+  if (button_idx == level_idx || map.levels.empty()) {
+    create_scene();
+    return;
+  }
+  switch_level(button_idx);
+}
+
+void Editor::switch_level(const int new_level_idx)
+{
+  // Park the scene of the level being left, without anything that
+  // belongs to the tool or drag in progress
+  if (static_drag_active)
+    create_scene();
+  remove_mouse_motion_item();
+  LevelSceneCache::LevelScene *parked = new LevelSceneCache::LevelScene;
+  parked->scene = scene;
+  parked->model_pixmap_items.swap(model_pixmap_items);
+  parked->thumbnail_generation = thumbnail_generation;
+  level_scene_cache.insert(level_idx, map.levels[level_idx], parked);
+
+  level_idx = new_level_idx;
+  snap_engine.clear();
+  selection.rebuild(map.levels[level_idx]);
+  LevelSceneCache::LevelScene *cached = level_scene_cache.take(level_idx);
+  if (!cached) {
+    scene = new QGraphicsScene(this);
+    map_view->setScene(scene);
+    create_scene();
+    return;
+  }
+
+  scene = cached->scene;
+  cached->scene = nullptr;  // so that deleting the entry leaves it alone
+  model_pixmap_items.swap(cached->model_pixmap_items);
+  const bool stale_thumbnails =
+      cached->thumbnail_generation != thumbnail_generation;
+  delete cached;
+  map_view->setScene(scene);
+
+  // the zoom and thumbnails may have changed while it was parked
+  if (stale_thumbnails) {
+    const Level &level = map.levels[level_idx];
+    for (size_t i = 0; i < model_pixmap_items.size(); i++) {
+      if (model_pixmap_items[i] && i < level.models.size())
+        set_model_item_pixmap(model_pixmap_items[i], level.models[i].model_id);
+    }
+  }
+  map_view_zoom_changed(map_view->get_scale());
+}
+
+void Editor::toggle_bidirectional()
+{
+  MapChangeBus::Transaction transaction(map.change_bus);
+  Level &level = map.levels[level_idx];
+  for (const int edge_idx : selection.get(Selection::EDGE)) {
+    Edge &edge = level.edges[edge_idx];
+    if (edge.type != Edge::LANE)
+      continue;
+    edge.set_param("bidirectional",
+        edge.is_bidirectional() ? "false" : "true");
+    map.notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::EDGE,
+            level_idx,
+            edge_idx,
+            MapChange::PARAMS));
+  }
   create_scene();
+  update_property_editor();
 }
 
 void Editor::number_key_pressed(const int n)
 {
-  for (auto &edge : map.levels[level_idx].edges) {
-    if (edge.selected && edge.type == Edge::LANE)
-      edge.set_graph_idx(n);
+  MapChangeBus::Transaction transaction(map.change_bus);
+  Level &level = map.levels[level_idx];
+  for (const int edge_idx : selection.get(Selection::EDGE)) {
+    Edge &edge = level.edges[edge_idx];
+    if (edge.type != Edge::LANE)
+      continue;
+    edge.set_graph_idx(n);
+    map.notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::EDGE,
+            level_idx,
+            edge_idx,
+            MapChange::TYPE));
   }
   create_scene();
   update_property_editor();
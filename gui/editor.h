@@ -19,37 +19,56 @@
 #define EDITOR_H
 
 #include <map>
+#include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
+#include <QElapsedTimer>
 #include <QGraphicsItem>
 #include <QGraphicsEllipseItem>
 #include <QGraphicsPixmapItem>
 #include <QGraphicsPolygonItem>
 #include <QGraphicsScene>
 #include <QMainWindow>
+#include <QMouseEvent>
 #include <QSettings>
 
 
 class MapView;
 class Level;
+class SnapGuideItem;
 #include "./map.h"
-#include "editor_model.h"
+#include "drawing_pixmap_cache.h"
+#include "job_scheduler.h"
+#include "lane_clearance.h"
+#include "level_of_detail.h"
+#include "level_scene_cache.h"
+#include "model_catalog.h"
+#include "model_list_model.h"
+#include "model_sprite_cache.h"
+#include "name_index.h"
+#include "project_jobs.h"
+#include "property_table_model.h"
+#include "selection.h"
+#include "snap_engine.h"
+#include "static_tile_cache.h"
+#include "thumbnail_cache.h"
 
 QT_BEGIN_NAMESPACE
 class QAction;
 class QMenu;
 class QGraphicsView;
+class QGraphicsPathItem;
 class QToolButton;
 class QButtonGroup;
-class QTableWidget;
-class QTableWidgetItem;
+class QTableView;
 class QLabel;
 class QLineEdit;
-class QListWidget;
-class QMouseEvent;
+class QListView;
 class QHBoxLayout;
 class QPushButton;
+class QTimer;
 QT_END_NAMESPACE
 
 
@@ -61,8 +80,9 @@ public:
   Editor(QWidget *parent = nullptr);
   static Editor *get_instance();
 
-  /// Load a project, replacing the current Map with a Map inflated from
-  /// the YAML filename provided to this function.
+  /// Start loading a project in the background. Once it has loaded, the
+  /// current Map is replaced with a Map inflated from the YAML filename
+  /// provided to this function. Returns false if it couldn't be started.
   bool load_project(const QString &filename);
 
   /// Attempt to load the most recently saved project, just for convenience
@@ -95,13 +115,27 @@ private slots:
   void new_map();
   void open();
   void save();
+  void save_as();
+  void export_occupancy_grids();
   void about();
 
 private:
   void edit_preferences();
 
+  // every named thing in the building, for finding it by name. Levels
+  // are re-indexed before a search if their names may have changed.
+  NameIndex name_index;
+  std::set<int> name_index_dirty_levels;
+  void find_by_name();
+
+  // keeps the caches above in step with edits; see Map::change_bus
+  void map_changed(const std::vector<MapChange> &changes);
+
   void level_add();
   void level_edit();
+  void level_import_floorplan();
+  void level_extract_walls();
+  void level_check_lane_crossings();
   void update_level_buttons();
 
   void zoom_normal();
@@ -131,54 +165,80 @@ private:
   QAction *save_action;
   QAction *zoom_in_action, *zoom_out_action;
   QAction *zoom_normal_action, *zoom_fit_action;
+  QAction *lane_clearance_action;
+  QAction *snap_action;
 
   QString project_filename;
 
+  // loading and saving run as jobs, so the window stays responsive
+  JobScheduler *job_scheduler;
+  int load_job_id, save_job_id, autosave_job_id;  // -1 if not running
+  int import_job_id, extract_job_id, export_job_id;
+  void job_finished(int job_id);
+  void project_loaded(LoadProjectJob &job);
+  void project_saved(SaveProjectJob &job);
+  void floorplan_imported(ImportFloorplanJob &job);
+  void walls_extracted(ExtractWallsJob &job);
+  void occupancy_grids_exported(ExportOccupancyGridsJob &job);
+  std::shared_ptr<const MapSnapshot> take_snapshot();
+
+  // edits are appended to a journal next to the project file every few
+  // minutes, and replayed over the project file when it is opened again
+  std::shared_ptr<Journal> journal;
+  QTimer *autosave_timer;
+  void update_autosave_interval();
+  void autosave();
+  void journal_appended(JournalAppendJob &job);
+
   const QString tool_id_to_string(const int id);
   QButtonGroup *tool_button_group;
 
-  QTableWidget *property_editor;
+  QTableView *property_editor;
+  PropertyTableModel *property_model;
   void update_property_editor();
-  void populate_property_editor(const Edge &edge);
-  void populate_property_editor(const Model &model);
-  void populate_property_editor(const Vertex &vertex);
-  void clear_property_editor();
-  QTableWidgetItem *create_table_item(const QString &str, bool editable=false);
-  void property_editor_cell_changed(int row, int column);
-  void property_editor_set_row(
-      const int row_idx,
-      const QString &label,
-      const QString &value,
-      const bool editable = false);
-  void property_editor_set_row(
-      const int row_idx,
-      const QString &label,
-      const int &value,
-      const bool editable = false);
-  void property_editor_set_row(
-      const int row_idx,
-      const QString &label,
-      const double &value,
-      const int max_decimal_places = 3,
-      const bool editable = false);
+  void property_edited(PropertyTableModel::Target target);
+  void redraw_layer_items(const int item_type);
   QPushButton *add_param_button, *delete_param_button;
   void add_param_button_clicked();
   void delete_param_button_clicked();
 
-  std::vector<EditorModel> models;
+  ModelCatalog model_catalog;
+  ThumbnailCache *thumbnail_cache;
+  std::unique_ptr<ModelSpriteCache> model_sprite_cache;
+  ModelListModel *model_list_model;
+  void resolve_model_ids();
   void model_name_line_edited(const QString &text);
   QLineEdit *model_name_line_edit;
-  QListWidget *model_name_list_widget;
-  void populate_model_name_list_widget();
+  QListView *model_name_list_view;
+  void populate_model_catalog();
   QLabel *model_preview_label;
-  void model_name_list_widget_changed(int row);
+  void model_name_list_view_changed(
+      const QModelIndex &current,
+      const QModelIndex &previous);
+  void update_model_preview();
+  void thumbnail_loaded(int model_id);
+
+  // the pixmap items of the models on the current level, in the same
+  // order as Level::models. Entries are nullptr for models not drawn.
+  std::vector<QGraphicsPixmapItem *> model_pixmap_items;
+  bool set_model_item_pixmap(QGraphicsPixmapItem *item, const int model_id);
+  void map_view_zoom_changed(double scale);
 
   int get_polygon_idx(const double x, const double y);
 
+  LevelOfDetail lod;
   bool create_scene();
+  void clear_scene();
+  void draw_models(const Level &level);
+
+  // what is selected on the current level, kept up to date by each edit
+  // and by map_changed(); read back from the level's flags only by
+  // switch_level()
+  Selection selection;
   void clear_selection();
 
   const static int ROTATION_INDICATOR_RADIUS = 50;
+  const static int MIP_LEVEL_DATA_KEY = 0;  // QGraphicsItem::data() key
   QGraphicsLineItem *mouse_motion_line;
   QGraphicsEllipseItem *mouse_motion_ellipse;
   QGraphicsPixmapItem *mouse_motion_model;
@@ -188,21 +248,63 @@ private:
 
   int tool_id;
 
+  DrawingPixmapCache drawing_pixmap_cache;
+
+  // While a vertex or model is dragged, everything that doesn't move is
+  // painted from cached tiles, and only the items that move are redrawn
+  StaticTileCache *static_tile_cache;
+  bool static_tiles_valid;  // false once the level changed outside a drag
+  int static_tiles_level_idx;
+  bool static_drag_active;
+  std::vector<int> drag_vertices, drag_edges, drag_polygons;
+  std::vector<QGraphicsItem *> drag_items;
+  QRectF drag_items_bounds;
+  void begin_static_drag(const int vertex_idx);
+  void update_static_drag_items();
+  void end_static_drag();
+
   void draw_mouse_motion_line_item(const double mouse_x, const double mouse_y);
   void remove_mouse_motion_item();
-  void set_selected_line_item(QGraphicsLineItem *line_item);
-  void set_selected_pixmap_item(QGraphicsPixmapItem *item);
-  void set_selected_ellipse_item(QGraphicsEllipseItem *item);
+  void selection_handles_at(
+      const QPointF &p,
+      QMouseEvent *e,
+      std::vector<Selection::Handle> &handles);
 
-  bool line_vertices_match(
-      const QGraphicsLineItem *line_item,
-      const Vertex &v1,
-      const Vertex &v2,
-      const double max_dist);
+  // a press on nothing drags out a rectangle (or, with Alt, a lasso) and
+  // the release selects what is inside it
+  QGraphicsPathItem *rubber_band_item;
+  QPolygonF rubber_band;  // in scene coordinates
+  bool rubber_band_lasso;
+  Selection::Mode rubber_band_mode;
+  void update_rubber_band_item();
+  void select_in_rubber_band();
 
   void level_button_toggled(int button_idx, bool checked);
 
+  // the scenes of recently visited levels, so switching back is instant
+  LevelSceneCache level_scene_cache;
+  int thumbnail_generation;  // bumped by every thumbnail_loaded()
+  void switch_level(const int new_level_idx);
+
+  // lanes that leave too little room for the robot, re-checked for the
+  // current level whenever its scene is drawn
+  LaneClearance lane_clearance;
+  void lane_clearance_toggled(bool checked);
+  void draw_lane_clearance(const Level &level);
+
+  // where new and dragged vertices snap to; rebuilt on demand after the
+  // level changes
+  SnapEngine snap_engine;
+  SnapGuideItem *snap_guide_item;
+  SnapEngine::Snap snap_vertex(
+      const QPointF &p,
+      const int moving_vertex_idx,
+      const QMouseEvent *e);
+  void show_snap_guides(const SnapEngine::Snap &snap);
+  void remove_snap_guides();
+
   void number_key_pressed(const int n);
+  void toggle_bidirectional();  // of the selected lanes
 
   // mouse handlers for various tools
   enum MouseType {
@@ -214,6 +316,15 @@ private:
 
   void mouse_event(const MouseType t, QMouseEvent *e);
 
+  // Mouse moves are coalesced: only the latest one is handled, at most
+  // once per display frame, so a fast drag can't queue up more redraws
+  // than the screen can show. See mouseMoveEvent().
+  QTimer *mouse_move_timer;
+  std::unique_ptr<QMouseEvent> pending_mouse_move;
+  QElapsedTimer mouse_move_clock;  // since the last move was handled
+  int mouse_move_interval_ms;
+  void flush_mouse_move();
+
   // helper function to avoid repeating lots of "add edge" code
   void mouse_add_edge(
       const MouseType t,
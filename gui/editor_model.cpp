@@ -17,11 +17,6 @@
 
 #include <algorithm>
 
-#include <QDir>
-#include <QImage>
-#include <QImageReader>
-#include <QSettings>
-
 #include "editor_model.h"
 
 using std::string;
@@ -43,33 +38,3 @@ EditorModel::EditorModel(const string _name, const double _meters_per_pixel)
 EditorModel::~EditorModel()
 {
 }
-
-QPixmap EditorModel::get_pixmap()
-{
-  if (!pixmap.isNull())
-    return pixmap;
-
-  // if we get here, we have to load the image from disk and generate pixmap
-
-  const QString THUMBNAIL_PATH_KEY("editor/thumbnail_path");
-  QSettings settings;
-  QString thumbnail_path(settings.value(THUMBNAIL_PATH_KEY).toString());
-
-  string filename =
-      thumbnail_path.toStdString() +
-      "/images/cropped/" +
-      name +
-      string(".png");
-  qInfo("loading: [%s]", filename.c_str());
-  QImageReader image_reader(QString::fromStdString(filename));
-  image_reader.setAutoTransform(true);  // not sure what this does
-  QImage image = image_reader.read();
-  if (image.isNull()) {
-    qWarning("unable to read %s: %s",
-        filename.c_str(),
-        qUtf8Printable(image_reader.errorString()));
-    return QPixmap();
-  }
-  pixmap = QPixmap::fromImage(image);
-  return pixmap;
-}
@@ -19,11 +19,11 @@
 #define EDITOR_MODEL_H
 
 /*
- * Represents a simulation model class and related helpers for rendering.
+ * Represents a simulation model class. Its thumbnail is loaded on demand
+ * by the ThumbnailCache.
  */
 
 #include <string>
-#include <QPixmap>
 
 class EditorModel
 {
@@ -32,10 +32,7 @@ public:
   ~EditorModel();
 
   std::string name, name_lowercase;
-  QPixmap pixmap;
   double meters_per_pixel;
-  
-  QPixmap get_pixmap();  // will load if needed
 };
 
 #endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include "find_dialog.h"
+#include <QtWidgets>
+
+
+FindDialog::FindDialog(
+    QWidget *parent,
+    const Map &_map,
+    const NameIndex &_name_index)
+: QDialog(parent),
+  map(_map),
+  name_index(_name_index)
+{
+  setWindowTitle("Find");
+
+  ok_button = new QPushButton("Go", this);  // first button = [enter] button
+  cancel_button = new QPushButton("Cancel", this);
+
+  QHBoxLayout *query_hbox_layout = new QHBoxLayout;
+  query_line_edit = new QLineEdit(this);
+  query_line_edit->setPlaceholderText(
+      "vertex, workcell, door or model name");
+  query_hbox_layout->addWidget(new QLabel("name:"));
+  query_hbox_layout->addWidget(query_line_edit);
+  connect(
+      query_line_edit,
+      &QLineEdit::textEdited,
+      this,
+      &FindDialog::query_line_edited);
+
+  results_list_widget = new QListWidget(this);
+  results_list_widget->setMinimumWidth(400);
+  connect(
+      results_list_widget, &QListWidget::itemActivated,
+      this, &FindDialog::ok_button_clicked);
+
+  QHBoxLayout *bottom_buttons_layout = new QHBoxLayout;
+  bottom_buttons_layout->addWidget(cancel_button);
+  bottom_buttons_layout->addWidget(ok_button);
+  connect(
+      ok_button, &QAbstractButton::clicked,
+      this, &FindDialog::ok_button_clicked);
+  connect(
+      cancel_button, &QAbstractButton::clicked,
+      this, &QDialog::reject);
+
+  QVBoxLayout *vbox_layout = new QVBoxLayout;
+  vbox_layout->addLayout(query_hbox_layout);
+  vbox_layout->addWidget(results_list_widget);
+  vbox_layout->addLayout(bottom_buttons_layout);
+  setLayout(vbox_layout);
+
+  ok_button->setEnabled(false);
+  query_line_edit->setFocus();
+}
+
+FindDialog::~FindDialog()
+{
+}
+
+void FindDialog::query_line_edited(const QString &text)
+{
+  name_index.find(text.toStdString(), MAX_RESULTS, results);
+
+  results_list_widget->clear();
+  for (const NameIndex::Entry *entry : results) {
+    results_list_widget->addItem(
+        QString("%1  (%2 on %3)")
+          .arg(QString::fromStdString(entry->name))
+          .arg(NameIndex::kind_name(entry->kind))
+          .arg(QString::fromStdString(map.levels[entry->level_idx].name)));
+  }
+  if (!results.empty())
+    results_list_widget->setCurrentRow(0);
+  ok_button->setEnabled(!results.empty());
+}
+
+void FindDialog::ok_button_clicked()
+{
+  if (get_entry())
+    accept();
+}
+
+const NameIndex::Entry *FindDialog::get_entry() const
+{
+  const int row = results_list_widget->currentRow();
+  if (row < 0 || row >= static_cast<int>(results.size()))
+    return nullptr;
+  return results[row];
+}
@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef FIND_DIALOG_H
+#define FIND_DIALOG_H
+
+#include <vector>
+#include <QDialog>
+#include "name_index.h"
+class QLineEdit;
+class QListWidget;
+
+
+/// Looks up named things in the building as the user types, for the
+/// editor to jump to the one that is picked
+class FindDialog : public QDialog
+{
+public:
+  FindDialog(QWidget *parent, const Map &_map, const NameIndex &_name_index);
+  ~FindDialog();
+
+  /// The entry that was picked, or null if none was
+  const NameIndex::Entry *get_entry() const;
+
+private:
+  const Map &map;
+  const NameIndex &name_index;
+  std::vector<const NameIndex::Entry *> results;
+
+  QLineEdit *query_line_edit;
+  QListWidget *results_list_widget;
+  QPushButton *ok_button, *cancel_button;
+
+  static const int MAX_RESULTS = 100;
+
+private slots:
+  void query_line_edited(const QString &text);
+  void ok_button_clicked();
+};
+
+#endif
@@ -0,0 +1,570 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QTransform>
+#include <QXmlStreamReader>
+
+#include "floorplan_importer.h"
+using std::string;
+using std::vector;
+
+
+FloorplanImporter::FloorplanImporter(const double _weld_meters)
+: weld_meters(_weld_meters),
+  meters_per_unit(1.0),
+  y_up(false),
+  weld_distance(-1.0),
+  min_x(std::numeric_limits<double>::max()),
+  min_y(std::numeric_limits<double>::max()),
+  max_x(std::numeric_limits<double>::lowest()),
+  max_y(std::numeric_limits<double>::lowest()),
+  num_welded(0)
+{
+}
+
+FloorplanImporter::~FloorplanImporter()
+{
+}
+
+bool FloorplanImporter::can_import(const QString &filename)
+{
+  const QString suffix = QFileInfo(filename).suffix().toLower();
+  return suffix == "dxf" || suffix == "svg";
+}
+
+void FloorplanImporter::read(const QString &filename, JobProgress *progress)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly))
+    throw std::runtime_error("couldn't open " + filename.toStdString());
+
+  if (progress)
+    progress->set_progress(0.0, "reading " + QFileInfo(filename).fileName());
+  if (QFileInfo(filename).suffix().toLower() == "dxf")
+    read_dxf(file, progress);
+  else
+    read_svg(file, progress);
+
+  printf("imported %s: %d vertices (%d welded), %d segments\n",
+      qUtf8Printable(filename),
+      static_cast<int>(points.size()),
+      num_welded,
+      static_cast<int>(segments.size()));
+}
+
+QRectF FloorplanImporter::get_bounds() const
+{
+  if (points.empty())
+    return QRectF();
+  return QRectF(min_x, min_y, max_x - min_x, max_y - min_y);
+}
+
+int FloorplanImporter::add_point(const QPointF &p)
+{
+  if (weld_distance < 0.0) {
+    // the units are known by the time the first point shows up
+    weld_distance = weld_meters / meters_per_unit;
+    // small cells keep the candidate lists short, but not so small that
+    // cell coordinates overflow on a big building
+    grid.clear(std::max(weld_distance * 4.0, 0.01 / meters_per_unit));
+  }
+
+  weld_candidates.clear();
+  grid.query_box(
+      p.x() - weld_distance,
+      p.y() - weld_distance,
+      p.x() + weld_distance,
+      p.y() + weld_distance,
+      weld_candidates);
+  int nearest_idx = -1;
+  double nearest_dist = weld_distance;
+  for (const int i : weld_candidates) {
+    const double dist =
+        std::hypot(points[i].x() - p.x(), points[i].y() - p.y());
+    if (dist <= nearest_dist) {
+      nearest_idx = i;
+      nearest_dist = dist;
+    }
+  }
+  if (nearest_idx >= 0) {
+    num_welded++;
+    return nearest_idx;
+  }
+
+  const int idx = static_cast<int>(points.size());
+  points.push_back(p);
+  grid.insert_point(idx, p.x(), p.y());
+  min_x = std::min(min_x, p.x());
+  min_y = std::min(min_y, p.y());
+  max_x = std::max(max_x, p.x());
+  max_y = std::max(max_y, p.y());
+  return idx;
+}
+
+void FloorplanImporter::add_segment(const QPointF &a, const QPointF &b)
+{
+  if (!std::isfinite(a.x()) || !std::isfinite(a.y()) ||
+      !std::isfinite(b.x()) || !std::isfinite(b.y()))
+    return;
+  const int a_idx = add_point(a);
+  const int b_idx = add_point(b);
+  if (a_idx == b_idx)
+    return;  // shorter than the weld distance
+
+  // the same wall is often drawn more than once, in either direction
+  const uint64_t key =
+      (static_cast<uint64_t>(std::min(a_idx, b_idx)) << 32) |
+      static_cast<uint64_t>(std::max(a_idx, b_idx));
+  if (!segment_keys.insert(key).second)
+    return;
+  segments.push_back(std::make_pair(a_idx, b_idx));
+}
+
+/////////////////////////////////////////////////////////////////////////
+// DXF
+
+static double dxf_meters_per_unit(const int insunits)
+{
+  switch (insunits) {
+    case 1: return 0.0254;  // inches
+    case 2: return 0.3048;  // feet
+    case 4: return 0.001;  // millimeters
+    case 5: return 0.01;  // centimeters
+    case 6: return 1.0;  // meters
+    case 14: return 0.1;  // decimeters
+    default: return 1.0;  // unitless, or something exotic
+  }
+}
+
+void FloorplanImporter::read_dxf(QIODevice &file, JobProgress *progress)
+{
+  // An ASCII DXF file is a flat sequence of (group code, value) line
+  // pairs. Entities start with code 0, so each one is complete when the
+  // next code 0 comes along; only the current entity is kept.
+  y_up = true;
+  meters_per_unit = 1.0;
+  const double file_size = std::max<qint64>(1, file.size());
+
+  enum { NO_SECTION, HEADER_SECTION, ENTITIES_SECTION, OTHER_SECTION }
+      section = NO_SECTION;
+  bool section_name_next = false;
+  QByteArray entity;
+  QByteArray header_variable;
+
+  double x0 = 0.0, y0 = 0.0, x1 = 0.0, y1 = 0.0;  // LINE
+  double vertex_x = 0.0;  // polyline vertex whose y hasn't come yet
+  bool in_polyline = false;  // between POLYLINE and SEQEND
+  bool closed = false;
+  bool have_prev = false;
+  QPointF first, prev;
+
+  auto polyline_vertex = [&](const QPointF &p) {
+    if (have_prev)
+      add_segment(prev, p);
+    else
+      first = p;
+    prev = p;
+    have_prev = true;
+  };
+  auto end_polyline = [&]() {
+    if (closed && have_prev)
+      add_segment(prev, first);
+    have_prev = false;
+    closed = false;
+  };
+
+  for (int64_t num_pairs = 0; ; num_pairs++) {
+    const QByteArray code_line = file.readLine();
+    if (code_line.isEmpty())
+      break;  // end of file, even without an EOF marker
+    const QByteArray value = file.readLine().trimmed();
+    if (num_pairs == 0 && code_line.startsWith("AutoCAD Binary DXF"))
+      throw std::runtime_error("binary DXF files aren't supported");
+    bool ok = false;
+    const int code = code_line.trimmed().toInt(&ok);
+    if (!ok)
+      throw std::runtime_error(
+          "not a DXF file: bad group code " +
+          code_line.trimmed().toStdString());
+
+    if (progress && num_pairs % 65536 == 0) {
+      progress->check_cancelled();
+      progress->set_progress(file.pos() / file_size);
+    }
+
+    if (code == 0) {
+      // the previous entity is complete
+      if (section == ENTITIES_SECTION) {
+        if (entity == "LINE")
+          add_segment(QPointF(x0, y0), QPointF(x1, y1));
+        else if (entity == "LWPOLYLINE")
+          end_polyline();
+      }
+
+      entity = value;
+      if (entity == "SECTION")
+        section_name_next = true;
+      else if (entity == "ENDSEC")
+        section = NO_SECTION;
+      else if (entity == "EOF")
+        break;
+
+      if (in_polyline && entity != "VERTEX") {
+        end_polyline();  // at SEQEND, or whatever comes instead of it
+        in_polyline = false;
+      }
+      if (entity == "POLYLINE") {
+        in_polyline = true;
+        have_prev = false;
+        closed = false;
+      }
+      else if (entity == "LWPOLYLINE") {
+        have_prev = false;
+        closed = false;
+      }
+      continue;
+    }
+
+    if (section_name_next && code == 2) {
+      section_name_next = false;
+      if (value == "HEADER")
+        section = HEADER_SECTION;
+      else if (value == "ENTITIES")
+        section = ENTITIES_SECTION;
+      else
+        section = OTHER_SECTION;
+      continue;
+    }
+
+    if (section == HEADER_SECTION) {
+      if (code == 9)
+        header_variable = value;
+      else if (code == 70 && header_variable == "$INSUNITS")
+        meters_per_unit = dxf_meters_per_unit(value.toInt());
+      continue;
+    }
+    if (section != ENTITIES_SECTION)
+      continue;
+
+    const double v = value.toDouble();
+    if (entity == "LINE") {
+      switch (code) {
+        case 10: x0 = v; break;
+        case 20: y0 = v; break;
+        case 11: x1 = v; break;
+        case 21: y1 = v; break;
+        default: break;
+      }
+    }
+    else if (entity == "LWPOLYLINE" || entity == "VERTEX") {
+      // each vertex is a 10 (x) followed by a 20 (y)
+      if (code == 10)
+        vertex_x = v;
+      else if (code == 20)
+        polyline_vertex(QPointF(vertex_x, v));
+      else if (code == 70 && entity == "LWPOLYLINE")
+        closed = (value.toInt() & 1) != 0;
+    }
+    else if (entity == "POLYLINE" && code == 70)
+      closed = (value.toInt() & 1) != 0;
+  }
+  if (in_polyline)
+    end_polyline();
+}
+
+/////////////////////////////////////////////////////////////////////////
+// SVG
+
+int FloorplanImporter::scan_number(const QString &s, int i, double &value)
+{
+  // SVG numbers can run into each other ("1-2", "0.5.5"), so they have
+  // to be scanned by hand rather than split on separators
+  const int start = i;
+  const int n = s.size();
+  if (i < n && (s[i] == '-' || s[i] == '+'))
+    i++;
+  bool seen_dot = false;
+  while (i < n && (s[i].isDigit() || (s[i] == '.' && !seen_dot))) {
+    if (s[i] == '.')
+      seen_dot = true;
+    i++;
+  }
+  if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+    int j = i + 1;
+    if (j < n && (s[j] == '-' || s[j] == '+'))
+      j++;
+    if (j < n && s[j].isDigit()) {
+      while (j < n && s[j].isDigit())
+        j++;
+      i = j;
+    }
+  }
+  value = s.midRef(start, i - start).toDouble();
+  return i;
+}
+
+vector<double> FloorplanImporter::parse_numbers(const QString &s)
+{
+  vector<double> numbers;
+  int i = 0;
+  while (i < s.size()) {
+    const QChar c = s[i];
+    if (c.isDigit() || c == '-' || c == '+' || c == '.') {
+      double value = 0.0;
+      i = scan_number(s, i, value);
+      numbers.push_back(value);
+    }
+    else
+      i++;
+  }
+  return numbers;
+}
+
+QTransform FloorplanImporter::parse_svg_transform(const QString &s)
+{
+  // "A B" means B is applied first, then A
+  static const QRegularExpression re("(\\w+)\\s*\\(([^)]*)\\)");
+  QTransform result;
+  QRegularExpressionMatchIterator it = re.globalMatch(s);
+  while (it.hasNext()) {
+    const QRegularExpressionMatch match = it.next();
+    const QString name = match.captured(1);
+    const vector<double> a = parse_numbers(match.captured(2));
+    QTransform t;
+    if (name == "matrix" && a.size() >= 6)
+      t = QTransform(a[0], a[1], a[2], a[3], a[4], a[5]);
+    else if (name == "translate" && !a.empty())
+      t.translate(a[0], a.size() > 1 ? a[1] : 0.0);
+    else if (name == "scale" && !a.empty())
+      t.scale(a[0], a.size() > 1 ? a[1] : a[0]);
+    else if (name == "rotate" && !a.empty()) {
+      const double cx = a.size() > 2 ? a[1] : 0.0;
+      const double cy = a.size() > 2 ? a[2] : 0.0;
+      t.translate(cx, cy);
+      t.rotate(a[0]);
+      t.translate(-cx, -cy);
+    }
+    else if (name == "skewX" && !a.empty())
+      t = QTransform(1, 0, std::tan(a[0] * M_PI / 180.0), 1, 0, 0);
+    else if (name == "skewY" && !a.empty())
+      t = QTransform(1, std::tan(a[0] * M_PI / 180.0), 0, 1, 0, 0);
+    result = t * result;
+  }
+  return result;
+}
+
+double FloorplanImporter::svg_length(
+    const QXmlStreamAttributes &attributes,
+    const char *name)
+{
+  // user units, possibly with a "px" on the end; anything else
+  // (percentages, for example) isn't supported and reads as 0
+  const vector<double> numbers =
+      parse_numbers(attributes.value(name).toString());
+  return numbers.empty() ? 0.0 : numbers[0];
+}
+
+void FloorplanImporter::read_svg_path(
+    const QString &d,
+    const QTransform &transform)
+{
+  QChar command('M');
+  vector<double> args;
+  QPointF current, start;
+
+  auto num_args = [](const QChar c) {
+    switch (c.toUpper().toLatin1()) {
+      case 'M': case 'L': case 'T': return 2;
+      case 'H': case 'V': return 1;
+      case 'S': case 'Q': return 4;
+      case 'C': return 6;
+      case 'A': return 7;
+      default: return 0;
+    }
+  };
+  auto line_to = [&](const QPointF &p) {
+    add_segment(transform.map(current), transform.map(p));
+    current = p;
+  };
+
+  int i = 0;
+  while (i < d.size()) {
+    const QChar c = d[i];
+    if (c.isLetter() && c != 'e' && c != 'E') {
+      command = c;
+      args.clear();
+      i++;
+      if (command == 'Z' || command == 'z') {
+        line_to(start);
+      }
+      continue;
+    }
+    if (!(c.isDigit() || c == '-' || c == '+' || c == '.')) {
+      i++;
+      continue;
+    }
+
+    double value = 0.0;
+    i = scan_number(d, i, value);
+    args.push_back(value);
+    const int n = num_args(command);
+    if (n == 0 || static_cast<int>(args.size()) < n)
+      continue;
+
+    // curves are replaced by a straight line to their end point
+    const bool relative = command.isLower();
+    const QPointF origin = relative ? current : QPointF(0, 0);
+    const QPointF end(args[n - 2], args[n - 1]);
+    switch (command.toUpper().toLatin1()) {
+      case 'M':
+        current = start = origin + end;
+        // further coordinate pairs are implicit line-tos
+        command = relative ? 'l' : 'L';
+        break;
+      case 'H':
+        line_to(QPointF((relative ? current.x() : 0.0) + args[0], current.y()));
+        break;
+      case 'V':
+        line_to(QPointF(current.x(), (relative ? current.y() : 0.0) + args[0]));
+        break;
+      default:
+        line_to(origin + end);
+        break;
+    }
+    args.clear();
+  }
+}
+
+void FloorplanImporter::read_svg(QIODevice &file, JobProgress *progress)
+{
+  y_up = false;
+  meters_per_unit = 0.0254 / 96.0;  // CSS pixels, unless the root says
+  const double file_size = std::max<qint64>(1, file.size());
+
+  QXmlStreamReader xml(&file);
+  // the transform of each open element, and whether it is inside
+  // something that isn't drawn directly (defs, clip paths and so on)
+  vector<QTransform> transforms(1);
+  vector<bool> hidden(1, false);
+  int64_t num_elements = 0;
+
+  while (!xml.atEnd()) {
+    xml.readNext();
+    if (xml.isEndElement()) {
+      if (transforms.size() > 1) {
+        transforms.pop_back();
+        hidden.pop_back();
+      }
+      continue;
+    }
+    if (!xml.isStartElement())
+      continue;
+
+    if (progress && ++num_elements % 4096 == 0) {
+      progress->check_cancelled();
+      progress->set_progress(xml.characterOffset() / file_size);
+    }
+
+    const QXmlStreamAttributes a = xml.attributes();
+    const QStringRef name = xml.name();
+    QTransform t = transforms.back();
+    if (a.hasAttribute("transform"))
+      t = parse_svg_transform(a.value("transform").toString()) * t;
+    const bool is_hidden = hidden.back() ||
+        name == "defs" || name == "symbol" || name == "clipPath" ||
+        name == "mask" || name == "marker" || name == "pattern";
+    transforms.push_back(t);
+    hidden.push_back(is_hidden);
+
+    if (name == "svg" && transforms.size() == 2) {
+      // a root width like "420mm" with a viewBox gives the real scale
+      static const QRegularExpression length_re(
+          "^\\s*([-+.0-9eE]+)\\s*(mm|cm|in|pt|pc|px)?\\s*$");
+      const QRegularExpressionMatch m =
+          length_re.match(a.value("width").toString());
+      const vector<double> view_box =
+          parse_numbers(a.value("viewBox").toString());
+      if (m.hasMatch() && view_box.size() == 4 && view_box[2] > 0) {
+        const QString unit = m.captured(2);
+        double unit_meters = 0.0254 / 96.0;
+        if (unit == "mm")
+          unit_meters = 0.001;
+        else if (unit == "cm")
+          unit_meters = 0.01;
+        else if (unit == "in")
+          unit_meters = 0.0254;
+        else if (unit == "pt")
+          unit_meters = 0.0254 / 72.0;
+        else if (unit == "pc")
+          unit_meters = 0.0254 / 6.0;
+        meters_per_unit = m.captured(1).toDouble() * unit_meters / view_box[2];
+      }
+      continue;
+    }
+    if (is_hidden)
+      continue;
+
+    if (name == "line") {
+      add_segment(
+          t.map(QPointF(svg_length(a, "x1"), svg_length(a, "y1"))),
+          t.map(QPointF(svg_length(a, "x2"), svg_length(a, "y2"))));
+    }
+    else if (name == "polyline" || name == "polygon") {
+      const vector<double> xy = parse_numbers(a.value("points").toString());
+      for (size_t i = 2; i + 1 < xy.size(); i += 2) {
+        add_segment(
+            t.map(QPointF(xy[i - 2], xy[i - 1])),
+            t.map(QPointF(xy[i], xy[i + 1])));
+      }
+      if (name == "polygon" && xy.size() >= 6) {
+        add_segment(
+            t.map(QPointF(xy[xy.size() - 2], xy[xy.size() - 1])),
+            t.map(QPointF(xy[0], xy[1])));
+      }
+    }
+    else if (name == "rect") {
+      const double x = svg_length(a, "x");
+      const double y = svg_length(a, "y");
+      const double w = svg_length(a, "width");
+      const double h = svg_length(a, "height");
+      if (w > 0 && h > 0) {
+        const QPointF corners[4] = {
+          t.map(QPointF(x, y)),
+          t.map(QPointF(x + w, y)),
+          t.map(QPointF(x + w, y + h)),
+          t.map(QPointF(x, y + h))
+        };
+        for (int i = 0; i < 4; i++)
+          add_segment(corners[i], corners[(i + 1) % 4]);
+      }
+    }
+    else if (name == "path")
+      read_svg_path(a.value("d").toString(), t);
+  }
+
+  if (xml.hasError())
+    throw std::runtime_error(
+        "couldn't parse SVG: " + xml.errorString().toStdString());
+}
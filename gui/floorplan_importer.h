@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef FLOORPLAN_IMPORTER_H
+#define FLOORPLAN_IMPORTER_H
+
+/*
+ * Reads the line work of an architectural floorplan (DXF or SVG) as
+ * wall segments, without rasterizing it first. Files are read in one
+ * streaming pass: SVG with QXmlStreamReader rather than a DOM, and DXF
+ * one group code/value pair at a time. Memory use grows with the number
+ * of distinct vertices and segments, not with the size of the file.
+ *
+ * Endpoints closer together than the weld distance become one vertex
+ * (found through a SpatialGrid), and duplicate and zero-length segments
+ * are dropped, since CAD exports repeat geometry a lot.
+ *
+ * What is read:
+ *   DXF: LINE, LWPOLYLINE and POLYLINE/VERTEX entities in the ENTITIES
+ *        section, and $INSUNITS from the header. Blocks (INSERT) are not
+ *        expanded, and arcs and bulges are replaced by their chords.
+ *   SVG: line, polyline, polygon, rect and path elements, with their
+ *        transforms. Curves in paths are replaced by their chords.
+ */
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+
+#include "job.h"
+#include "spatial_grid.h"
+class QIODevice;
+class QXmlStreamAttributes;
+class QTransform;
+
+
+class FloorplanImporter
+{
+public:
+  FloorplanImporter(const double _weld_meters = 0.01);
+  ~FloorplanImporter();
+
+  /// Can this file be imported, going by its suffix?
+  static bool can_import(const QString &filename);
+
+  /// Read a DXF or SVG file. Throws std::runtime_error if it can't be
+  /// read, and JobCancelled if progress is cancelled.
+  void read(const QString &filename, JobProgress *progress = nullptr);
+
+  /// Meters per drawing unit. DXF files usually say; SVG user units are
+  /// taken to be CSS pixels (1/96 inch). 1.0 for unitless DXF files.
+  double get_meters_per_unit() const { return meters_per_unit; }
+
+  /// true for DXF, whose y axis points up (unlike the editor's)
+  bool is_y_up() const { return y_up; }
+
+  /// In drawing units
+  const std::vector<QPointF> &get_points() const { return points; }
+  const std::vector<std::pair<int, int> > &get_segments() const
+  { return segments; }
+  QRectF get_bounds() const;
+
+  int get_num_welded() const { return num_welded; }
+
+private:
+  const double weld_meters;
+  double meters_per_unit;
+  bool y_up;
+  double weld_distance;  // in drawing units; set by the first point
+
+  std::vector<QPointF> points;
+  std::vector<std::pair<int, int> > segments;
+  SpatialGrid grid;
+  std::vector<int> weld_candidates;  // reused by every add_point()
+  std::unordered_set<uint64_t> segment_keys;
+  double min_x, min_y, max_x, max_y;
+  int num_welded;
+
+  int add_point(const QPointF &p);
+  void add_segment(const QPointF &a, const QPointF &b);
+
+  void read_dxf(QIODevice &file, JobProgress *progress);
+  void read_svg(QIODevice &file, JobProgress *progress);
+  void read_svg_path(const QString &d, const QTransform &transform);
+  static QTransform parse_svg_transform(const QString &s);
+  static std::vector<double> parse_numbers(const QString &s);
+  static int scan_number(const QString &s, int i, double &value);
+  static double svg_length(
+      const QXmlStreamAttributes &attributes,
+      const char *name);
+};
+
+#endif
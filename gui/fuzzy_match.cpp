@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#include <algorithm>
+#include <cctype>
+
+#include "fuzzy_match.h"
+using std::string;
+
+
+string FuzzyMatch::to_lowercase(const string &s)
+{
+  string lower(s);
+  std::transform(
+      lower.begin(),
+      lower.end(),
+      lower.begin(),
+      [](unsigned char c) { return std::tolower(c); });
+  return lower;
+}
+
+uint64_t FuzzyMatch::char_mask(const string &s_lower)
+{
+  // a-z get their own bits, 0-9 get their own bits, everything else
+  // is folded into the last bit. Good enough to prune most candidates.
+  uint64_t mask = 0;
+  for (const unsigned char c : s_lower) {
+    if (c >= 'a' && c <= 'z')
+      mask |= uint64_t(1) << (c - 'a');
+    else if (c >= '0' && c <= '9')
+      mask |= uint64_t(1) << (26 + c - '0');
+    else
+      mask |= uint64_t(1) << 63;
+  }
+  return mask;
+}
+
+int FuzzyMatch::score(
+    const string &query_lower,
+    const string &candidate_lower)
+{
+  if (query_lower.empty())
+    return 0;
+  if (query_lower.size() > candidate_lower.size())
+    return -1;
+
+  // shorter candidates are slightly preferred among equally-good matches
+  const int length_penalty =
+      static_cast<int>(candidate_lower.size() - query_lower.size());
+
+  const size_t pos = candidate_lower.find(query_lower);
+  if (pos == 0)
+    return 3000 - length_penalty;
+  if (pos != string::npos) {
+    // substrings starting on a "word" boundary (after a separator or
+    // a digit) are more likely to be what the user meant
+    const unsigned char prev = candidate_lower[pos - 1];
+    const int boundary_bonus = std::isalnum(prev) ? 0 : 500;
+    return 2000 + boundary_bonus - static_cast<int>(pos) - length_penalty;
+  }
+
+  // subsequence match: all query characters appear in order
+  size_t ci = 0;
+  int gaps = 0;
+  for (const char qc : query_lower) {
+    const size_t found = candidate_lower.find(qc, ci);
+    if (found == string::npos)
+      return -1;
+    gaps += static_cast<int>(found - ci);
+    ci = found + 1;
+  }
+  return std::max(1, 1000 - 10 * gaps - length_penalty);
+}
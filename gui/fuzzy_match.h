@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+#ifndef FUZZY_MATCH_H
+#define FUZZY_MATCH_H
+
+/*
+ * The matching behind both searches by name, of the model catalog and of
+ * the names on the map, so that a query ranks names the same way in
+ * either. Everything is compared in lowercase.
+ */
+
+#include <cstdint>
+#include <string>
+
+
+class FuzzyMatch
+{
+public:
+  static std::string to_lowercase(const std::string &s);
+
+  /// Bitmask of the characters present in a lowercase string, used to
+  /// reject most candidates before running the full scoring function.
+  static uint64_t char_mask(const std::string &s_lower);
+
+  /// Score how well the lowercase query matches the lowercase candidate,
+  /// higher is better: prefixes rank above substrings, which rank above
+  /// scattered subsequences of the query characters. Returns a negative
+  /// number if it doesn't match at all.
+  static int score(
+      const std::string &query_lower,
+      const std::string &candidate_lower);
+};
+
+#endif
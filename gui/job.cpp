@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include <QMutexLocker>
+
+#include "job.h"
+
+
+JobProgress::JobProgress()
+: cancelled(false),
+  permille(0),
+  range_start(0.0),
+  range_end(1.0)
+{
+}
+
+JobProgress::~JobProgress()
+{
+}
+
+void JobProgress::set_range(const double start, const double end)
+{
+  range_start = std::min(std::max(start, 0.0), 1.0);
+  range_end = std::min(std::max(end, range_start), 1.0);
+}
+
+void JobProgress::set_progress(const double fraction)
+{
+  const double f = std::min(std::max(fraction, 0.0), 1.0);
+  permille = static_cast<int>(
+      1000.0 * (range_start + f * (range_end - range_start)));
+}
+
+void JobProgress::set_progress(const double fraction, const QString &_message)
+{
+  set_progress(fraction);
+  QMutexLocker locker(&message_mutex);
+  message = _message;
+}
+
+void JobProgress::cancel()
+{
+  cancelled = true;
+}
+
+void JobProgress::check_cancelled() const
+{
+  if (cancelled)
+    throw JobCancelled();
+}
+
+QString JobProgress::get_message() const
+{
+  QMutexLocker locker(&message_mutex);
+  return message;
+}
+
+
+Job::Job(const QString &_title, const bool _can_cancel)
+: title(_title),
+  can_cancel(_can_cancel),
+  status(PENDING)
+{
+}
+
+Job::~Job()
+{
+}
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef JOB_H
+#define JOB_H
+
+/*
+ * A long-running operation (loading, saving, decoding...) that runs on a
+ * JobScheduler worker thread. Subclasses do their work in run(), report
+ * progress through the JobProgress they are handed, and call
+ * check_cancelled() often enough that a cancel takes effect promptly.
+ * A job must not touch anything the UI thread might be using: it works
+ * on its own copies, and the UI thread picks up the result once the
+ * scheduler reports that the job has finished.
+ */
+
+#include <atomic>
+#include <exception>
+#include <string>
+
+#include <QMutex>
+#include <QString>
+
+
+/// Thrown by JobProgress::check_cancelled() to unwind a cancelled job
+class JobCancelled : public std::exception
+{
+public:
+  const char *what() const noexcept override { return "cancelled"; }
+};
+
+
+class JobProgress
+{
+public:
+  JobProgress();
+  ~JobProgress();
+
+  /// Map the fractions passed to set_progress() from now on into this
+  /// part of the whole job, so that nested steps (a drawing inside a
+  /// level inside a map) can report 0..1 without knowing about each
+  /// other. Worker thread only.
+  void set_range(const double start, const double end);
+
+  /// Worker thread only. The message is kept if none is given.
+  void set_progress(const double fraction);
+  void set_progress(const double fraction, const QString &_message);
+
+  void cancel();
+  bool is_cancelled() const { return cancelled; }
+
+  /// Throw JobCancelled if cancel() has been called
+  void check_cancelled() const;
+
+  int get_percent() const { return permille / 10; }
+  QString get_message() const;
+
+private:
+  std::atomic<bool> cancelled;
+  std::atomic<int> permille;
+  double range_start, range_end;
+
+  mutable QMutex message_mutex;
+  QString message;
+};
+
+
+class Job
+{
+public:
+  enum Status {
+    PENDING = 0,
+    RUNNING,
+    SUCCEEDED,
+    FAILED,
+    CANCELLED
+  };
+
+  Job(const QString &_title, const bool _can_cancel = true);
+  virtual ~Job();
+
+  /// Called on a worker thread. Throw to fail the job.
+  virtual void run(JobProgress &_progress) = 0;
+
+  const QString title;
+
+  // Jobs that can't be cancelled (saves, which must not be dropped
+  // halfway) are also waited for when the scheduler shuts down
+  const bool can_cancel;
+
+  // written by the worker thread; only read once the job has finished
+  Status status;
+  std::string error;
+
+  JobProgress progress;
+};
+
+#endif
@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include <QRunnable>
+#include <QThread>
+#include <QTimer>
+
+#include "job_scheduler.h"
+
+
+/*
+ * Worker-thread half of the scheduler. The job stays owned by the
+ * scheduler, which doesn't touch it again until job_done() arrives.
+ */
+class JobTask : public QRunnable
+{
+public:
+  JobTask(JobScheduler *_scheduler, Job *_job, const int _job_id)
+  : scheduler(_scheduler),
+    job(_job),
+    job_id(_job_id)
+  {
+  }
+
+  void run() override
+  {
+    job->status = Job::RUNNING;
+    try {
+      job->progress.check_cancelled();  // it may never have started
+      job->run(job->progress);
+      job->status = Job::SUCCEEDED;
+    }
+    catch (const JobCancelled &) {
+      job->status = Job::CANCELLED;
+    }
+    catch (const std::exception &e) {
+      job->status = Job::FAILED;
+      job->error = e.what();
+    }
+
+    QMetaObject::invokeMethod(
+        scheduler,
+        "job_done",
+        Qt::QueuedConnection,
+        Q_ARG(int, job_id));
+  }
+
+private:
+  JobScheduler *scheduler;
+  Job *job;
+  const int job_id;
+};
+
+
+JobScheduler::JobScheduler(QObject *parent)
+: QObject(parent),
+  next_job_id(1)
+{
+  // the tile and thumbnail pools are busy while the user is editing, so
+  // a couple of threads is plenty for the odd load or save
+  pool.setMaxThreadCount(std::max(1, std::min(2, QThread::idealThreadCount())));
+
+  progress_timer = new QTimer(this);
+  progress_timer->setInterval(100);
+  connect(
+      progress_timer, &QTimer::timeout,
+      this, &JobScheduler::progress_changed);
+}
+
+JobScheduler::~JobScheduler()
+{
+  // the workers hold raw pointers into 'jobs', so they have to be done
+  // before it goes away
+  cancel_all();
+  pool.waitForDone();
+}
+
+int JobScheduler::start(std::unique_ptr<Job> job)
+{
+  const int job_id = next_job_id++;
+  Job *j = job.get();
+  active[job_id] = j->can_cancel;
+  jobs[job_id] = std::move(job);
+  pool.start(new JobTask(this, j, job_id));
+
+  if (!progress_timer->isActive())
+    progress_timer->start();
+  emit progress_changed();
+  return job_id;
+}
+
+void JobScheduler::cancel(const int job_id)
+{
+  auto it = jobs.find(job_id);
+  if (it != jobs.end() && it->second->can_cancel)
+    it->second->progress.cancel();
+}
+
+void JobScheduler::cancel_all()
+{
+  for (const auto &a : active)
+    cancel(a.first);
+}
+
+void JobScheduler::job_done(int job_id)
+{
+  active.erase(job_id);
+  if (active.empty())
+    progress_timer->stop();
+  emit progress_changed();
+  emit finished(job_id);
+
+  // nobody wanted the result
+  jobs.erase(job_id);
+}
+
+std::unique_ptr<Job> JobScheduler::take(const int job_id)
+{
+  auto it = jobs.find(job_id);
+  if (it == jobs.end() || active.count(job_id))
+    return nullptr;
+  std::unique_ptr<Job> job = std::move(it->second);
+  jobs.erase(it);
+  return job;
+}
+
+int JobScheduler::num_active() const
+{
+  return static_cast<int>(active.size());
+}
+
+bool JobScheduler::can_cancel_active() const
+{
+  for (const auto &a : active)
+    if (!a.second)
+      return false;
+  return true;
+}
+
+int JobScheduler::get_percent() const
+{
+  if (active.empty())
+    return 100;
+  int sum = 0;
+  for (const auto &a : active)
+    sum += jobs.at(a.first)->progress.get_percent();
+  return sum / static_cast<int>(active.size());
+}
+
+QString JobScheduler::get_message() const
+{
+  if (active.empty())
+    return QString();
+  const Job &job = *jobs.at(active.begin()->first);
+  const QString message = job.progress.get_message();
+  if (message.isEmpty())
+    return job.title;
+  return job.title + ": " + message;
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef JOB_SCHEDULER_H
+#define JOB_SCHEDULER_H
+
+/*
+ * Runs Jobs on a pool of worker threads and hands them back to the UI
+ * thread when they are done: finished() is emitted on the UI thread,
+ * and the slot connected to it take()s the job to read its result.
+ * While jobs are running, progress_changed() is emitted a few times a
+ * second, for whatever is showing their progress.
+ */
+
+#include <map>
+#include <memory>
+
+#include <QObject>
+#include <QString>
+#include <QThreadPool>
+
+#include "job.h"
+class QTimer;
+
+
+class JobScheduler : public QObject
+{
+  Q_OBJECT
+
+public:
+  JobScheduler(QObject *parent = nullptr);
+
+  /// Cancels what can be cancelled and waits for the rest
+  ~JobScheduler();
+
+  /// Queue a job. Returns its ID, which finished() will be emitted with.
+  int start(std::unique_ptr<Job> job);
+
+  void cancel(const int job_id);
+  void cancel_all();
+
+  /// Remove a finished job and return it, or nullptr if it is unknown
+  /// or still running
+  std::unique_ptr<Job> take(const int job_id);
+
+  /// Number of jobs that have been started and haven't finished yet
+  int num_active() const;
+
+  /// Can all of the active jobs be cancelled?
+  bool can_cancel_active() const;
+
+  /// Progress of the active jobs: the average of their percentages, and
+  /// the title and message of the oldest one
+  int get_percent() const;
+  QString get_message() const;
+
+signals:
+  void finished(int job_id);
+  void progress_changed();
+
+private:
+  QThreadPool pool;
+  int next_job_id;
+  std::map<int, std::unique_ptr<Job> > jobs;
+  std::map<int, bool> active;  // job ID -> can be cancelled
+  QTimer *progress_timer;
+
+  // called through a queued connection from the worker threads
+  Q_INVOKABLE void job_done(int job_id);
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QtWidgets>
+
+#include "job_status_widget.h"
+
+
+JobStatusWidget::JobStatusWidget(JobScheduler *_scheduler, QWidget *parent)
+: QWidget(parent),
+  scheduler(_scheduler)
+{
+  message_label = new QLabel(this);
+
+  progress_bar = new QProgressBar(this);
+  progress_bar->setRange(0, 100);
+  progress_bar->setMaximumWidth(200);
+
+  cancel_button = new QPushButton("Cancel", this);
+  connect(
+      cancel_button, &QAbstractButton::clicked,
+      this, &JobStatusWidget::cancel_button_clicked);
+
+  QHBoxLayout *hbox_layout = new QHBoxLayout;
+  hbox_layout->setContentsMargins(0, 0, 0, 0);
+  hbox_layout->addWidget(message_label);
+  hbox_layout->addWidget(progress_bar);
+  hbox_layout->addWidget(cancel_button);
+  setLayout(hbox_layout);
+
+  connect(
+      scheduler, &JobScheduler::progress_changed,
+      this, &JobStatusWidget::update_progress);
+  update_progress();
+}
+
+JobStatusWidget::~JobStatusWidget()
+{
+}
+
+void JobStatusWidget::update_progress()
+{
+  if (scheduler->num_active() == 0) {
+    hide();
+    return;
+  }
+  message_label->setText(scheduler->get_message());
+  progress_bar->setValue(scheduler->get_percent());
+  cancel_button->setEnabled(scheduler->can_cancel_active());
+  show();
+}
+
+void JobStatusWidget::cancel_button_clicked()
+{
+  scheduler->cancel_all();
+  message_label->setText("cancelling...");
+  cancel_button->setEnabled(false);
+}
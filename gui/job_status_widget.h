@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef JOB_STATUS_WIDGET_H
+#define JOB_STATUS_WIDGET_H
+
+/*
+ * Status bar widget showing what the JobScheduler is doing, with a
+ * button to cancel it. It hides itself while no jobs are running.
+ */
+
+#include <QWidget>
+
+#include "job_scheduler.h"
+class QLabel;
+class QProgressBar;
+class QPushButton;
+
+
+class JobStatusWidget : public QWidget
+{
+public:
+  JobStatusWidget(JobScheduler *_scheduler, QWidget *parent = nullptr);
+  ~JobStatusWidget();
+
+private:
+  JobScheduler *scheduler;
+  QLabel *message_label;
+  QProgressBar *progress_bar;
+  QPushButton *cancel_button;
+
+  void update_progress();
+  void cancel_button_clicked();
+};
+
+#endif
@@ -0,0 +1,622 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include "journal.h"
+using std::string;
+using std::vector;
+
+
+static const char JOURNAL_MAGIC[8] = { 'T', 'E', 'J', 'O', 'U', 'R', 'N', 'L' };
+
+// the MapChange::Entity kept in each Journal::Table
+static const int TABLE_ENTITIES[Journal::NUM_TABLES] = {
+  MapChange::VERTEX,
+  MapChange::EDGE,
+  MapChange::EDGE,
+  MapChange::EDGE,
+  MapChange::EDGE,
+  MapChange::MODEL,
+  MapChange::POLYGON
+};
+
+static string dump(const YAML::Node &node)
+{
+  YAML::Emitter emitter;
+  emitter << node;
+  return string(emitter.c_str(), emitter.size());
+}
+
+static QByteArray to_bytes(const string &s)
+{
+  return QByteArray(s.data(), static_cast<int>(s.size()));
+}
+
+
+Journal::Journal(const string &_filename)
+: filename(_filename),
+  is_open(false),
+  serial(0)
+{
+}
+
+Journal::~Journal()
+{
+}
+
+Journal::LevelEdits::LevelEdits()
+{
+  for (int e = 0; e < NUM_ENTITIES; e++)
+    first_moved[e] = INT_MAX;
+}
+
+std::string Journal::filename_for_project(const QString &project_filename)
+{
+  return QFileInfo(project_filename).absoluteFilePath().toStdString() +
+      ".journal";
+}
+
+QByteArray Journal::file_hash(const QByteArray &file_data)
+{
+  return QCryptographicHash::hash(file_data, QCryptographicHash::Sha1);
+}
+
+quint32 Journal::crc32(const QByteArray &data)
+{
+  // the usual reflected CRC-32 (as in zlib), table-driven. The table is
+  // built once, by whichever thread gets here first.
+  static const std::array<quint32, 256> table = []() {
+    std::array<quint32, 256> t;
+    for (quint32 i = 0; i < 256; i++) {
+      quint32 c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? (0xedb88320u ^ (c >> 1)) : (c >> 1);
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  quint32 crc = 0xffffffffu;
+  const uchar *p = reinterpret_cast<const uchar *>(data.constData());
+  for (int i = 0; i < data.size(); i++)
+    crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffffu;
+}
+
+QByteArray Journal::header(const QByteArray &base_hash)
+{
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out.writeRawData(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+  out << VERSION;
+  out << base_hash;
+  return data;
+}
+
+QByteArray Journal::record(const QByteArray &payload)
+{
+  QByteArray data;
+  QDataStream out(&data, QIODevice::WriteOnly);
+  out << static_cast<quint32>(payload.size());
+  out << crc32(payload);
+  out.writeRawData(payload.constData(), payload.size());
+  return data;
+}
+
+int Journal::table_of(const Level &level, const int entity, const int idx)
+{
+  // the same split into sequences as Level::to_yaml()
+  switch (entity) {
+    case MapChange::VERTEX:
+      return VERTICES;
+    case MapChange::EDGE:
+      switch (level.edges[idx].type) {
+        case Edge::LANE: return LANES;
+        case Edge::WALL: return WALLS;
+        case Edge::MEAS: return MEASUREMENTS;
+        case Edge::DOOR: return DOORS;
+        default: return -1;  // not saved to the YAML either
+      }
+    case MapChange::MODEL:
+      return MODELS;
+    case MapChange::POLYGON:
+      return level.polygons[idx].type == Polygon::FLOOR ? FLOORS : -1;
+    default:
+      return -1;
+  }
+}
+
+string Journal::dump_row(const Level &level, const int table, const int idx)
+{
+  // the same text as Level::to_yaml()
+  switch (TABLE_ENTITIES[table]) {
+    case MapChange::VERTEX:
+      return dump(level.vertices[idx].to_yaml());
+    case MapChange::EDGE:
+      return dump(level.edges[idx].to_yaml());
+    case MapChange::MODEL:
+      return dump(level.models[idx].to_yaml());
+    default:
+      return dump(level.polygons[idx].to_yaml());
+  }
+}
+
+void Journal::add_rows(
+    const Level &level,
+    const int entity,
+    const int first_idx,
+    LevelState &state)
+{
+  // drop the rows of this entity from first_idx on, then put them back
+  for (int t = 0; t < NUM_TABLES; t++) {
+    if (TABLE_ENTITIES[t] != entity)
+      continue;
+    vector<int> &rows = state.rows[t];
+    rows.erase(
+        std::lower_bound(rows.begin(), rows.end(), first_idx),
+        rows.end());
+  }
+
+  int num_entities = 0;
+  switch (entity) {
+    case MapChange::VERTEX:
+      num_entities = static_cast<int>(level.vertices.size());
+      break;
+    case MapChange::EDGE:
+      num_entities = static_cast<int>(level.edges.size());
+      break;
+    case MapChange::MODEL:
+      num_entities = static_cast<int>(level.models.size());
+      break;
+    case MapChange::POLYGON:
+      num_entities = static_cast<int>(level.polygons.size());
+      break;
+    default:
+      break;
+  }
+  for (int idx = first_idx; idx < num_entities; idx++) {
+    const int table = table_of(level, entity, idx);
+    if (table >= 0)
+      state.rows[table].push_back(idx);
+  }
+}
+
+void Journal::set_state(const MapSnapshot &snapshot)
+{
+  levels.clear();
+  for (const auto &level : snapshot.levels) {
+    LevelState &state = levels[level->name];
+    state.header = dump(level->header_to_yaml());
+    for (int e = MapChange::VERTEX; e < NUM_ENTITIES; e++)
+      add_rows(*level, e, 0, state);
+    for (int t = 0; t < NUM_TABLES; t++)
+      for (const int idx : state.rows[t])
+        state.row_hashes[t].push_back(
+            std::hash<string>()(dump_row(*level, t, idx)));
+  }
+  serial = snapshot.serial;
+
+  // the snapshot already has the changes made before it was taken
+  QMutexLocker locker(&pending_mutex);
+  pending.erase(pending.begin(), pending.upper_bound(serial));
+}
+
+bool Journal::open(
+    const QByteArray &base_hash,
+    const MapSnapshot &snapshot,
+    const qint64 keep_bytes)
+{
+  QMutexLocker locker(&mutex);
+  set_state(snapshot);
+  is_open = false;
+
+  const QString qfilename = QString::fromStdString(filename);
+  if (keep_bytes > 0) {
+    if (!QFile::resize(qfilename, keep_bytes)) {
+      qWarning("couldn't truncate %s", filename.c_str());
+      return false;
+    }
+  }
+  else {
+    QSaveFile file(qfilename);
+    const QByteArray data = header(base_hash);
+    if (!file.open(QIODevice::WriteOnly) ||
+        file.write(data) != data.size() ||
+        !file.commit()) {
+      qWarning("couldn't write %s: %s",
+          filename.c_str(),
+          qUtf8Printable(file.errorString()));
+      return false;
+    }
+  }
+  is_open = true;
+  return true;
+}
+
+void Journal::changed(
+    const vector<MapChange> &changes,
+    const uint64_t snapshot_serial)
+{
+  QMutexLocker locker(&pending_mutex);
+  Edits &edits = pending[snapshot_serial];
+  for (const MapChange &change : changes) {
+    if (change.action == MapChange::RESET) {
+      edits.reset = true;
+      continue;
+    }
+    // the header is compared on every append of the level anyway
+    LevelEdits &level_edits = edits.levels[change.level_idx];
+    if (change.entity == MapChange::LEVEL)
+      continue;
+
+    const bool moved =
+        change.action != MapChange::MODIFIED ||
+        ((change.entity == MapChange::EDGE ||
+          change.entity == MapChange::POLYGON) &&
+         (change.fields & MapChange::TYPE) != 0);
+    int &first_moved = level_edits.first_moved[change.entity];
+    if (moved)
+      first_moved = std::min(first_moved, change.idx);
+    else
+      level_edits.modified[change.entity].insert(change.idx);
+  }
+}
+
+int Journal::append(const MapSnapshot &snapshot)
+{
+  QMutexLocker locker(&mutex);
+  if (!is_open)
+    return -1;
+  if (snapshot.serial <= serial)
+    return 0;  // already have this, or something newer
+
+  // everything that was changed before this snapshot was taken
+  Edits edits;
+  {
+    QMutexLocker pending_locker(&pending_mutex);
+    const auto end = pending.upper_bound(snapshot.serial);
+    for (auto it = pending.begin(); it != end; ++it) {
+      edits.reset = edits.reset || it->second.reset;
+      for (const auto &level_it : it->second.levels) {
+        LevelEdits &level_edits = edits.levels[level_it.first];
+        for (int e = 0; e < NUM_ENTITIES; e++) {
+          level_edits.first_moved[e] = std::min(
+              level_edits.first_moved[e],
+              level_it.second.first_moved[e]);
+          level_edits.modified[e].insert(
+              level_it.second.modified[e].begin(),
+              level_it.second.modified[e].end());
+        }
+      }
+    }
+    pending.erase(pending.begin(), end);
+  }
+
+  LevelEdits everything;
+  for (int e = 0; e < NUM_ENTITIES; e++)
+    everything.first_moved[e] = 0;
+
+  QByteArray data;
+  int num_records = 0;
+  for (size_t i = 0; i < snapshot.levels.size(); i++) {
+    const auto edits_it = edits.levels.find(static_cast<int>(i));
+    if (!edits.reset && edits_it == edits.levels.end())
+      continue;  // unchanged
+
+    const Level &level = *snapshot.levels[i];
+    const bool is_new = levels.find(level.name) == levels.end();
+    LevelState &state = levels[level.name];
+    const LevelEdits &level_edits =
+        edits.reset || is_new ? everything : edits_it->second;
+    const QByteArray name = QByteArray::fromStdString(level.name);
+
+    const string header = dump(level.header_to_yaml());
+    if (is_new || state.header != header) {
+      QByteArray payload;
+      QDataStream out(&payload, QIODevice::WriteOnly);
+      out << static_cast<quint8>(OP_LEVEL) << name << to_bytes(header);
+      data += record(payload);
+      num_records++;
+      state.header = header;
+    }
+
+    // the rows from the first one that moved are worked out again
+    size_t first_moved_row[NUM_TABLES];
+    for (int t = 0; t < NUM_TABLES; t++) {
+      const vector<int> &rows = state.rows[t];
+      first_moved_row[t] = std::lower_bound(
+          rows.begin(),
+          rows.end(),
+          level_edits.first_moved[TABLE_ENTITIES[t]]) - rows.begin();
+    }
+    for (int e = MapChange::VERTEX; e < NUM_ENTITIES; e++)
+      if (level_edits.first_moved[e] < INT_MAX)
+        add_rows(level, e, level_edits.first_moved[e], state);
+
+    for (int t = 0; t < NUM_TABLES; t++) {
+      const vector<int> &rows = state.rows[t];
+      vector<size_t> &hashes = state.row_hashes[t];
+      const size_t num_rows = hashes.size();
+      if (rows.size() != num_rows) {
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << static_cast<quint8>(OP_RESIZE) << name
+            << static_cast<quint8>(t)
+            << static_cast<quint32>(rows.size());
+        data += record(payload);
+        num_records++;
+        hashes.resize(rows.size());
+      }
+
+      // and of the ones before it, those that were modified
+      vector<size_t> changed_rows;
+      for (const int idx : level_edits.modified[TABLE_ENTITIES[t]]) {
+        const auto it = std::lower_bound(
+            rows.begin(), rows.begin() + first_moved_row[t], idx);
+        if (it != rows.begin() + first_moved_row[t] && *it == idx)
+          changed_rows.push_back(it - rows.begin());
+      }
+      for (size_t row = first_moved_row[t]; row < rows.size(); row++)
+        changed_rows.push_back(row);
+
+      for (const size_t row : changed_rows) {
+        const string yaml = dump_row(level, t, rows[row]);
+        const size_t hash = std::hash<string>()(yaml);
+        if (row < num_rows && hashes[row] == hash)
+          continue;
+        hashes[row] = hash;
+        QByteArray payload;
+        QDataStream out(&payload, QIODevice::WriteOnly);
+        out << static_cast<quint8>(OP_SET) << name
+            << static_cast<quint8>(t)
+            << static_cast<quint32>(row)
+            << to_bytes(yaml);
+        data += record(payload);
+        num_records++;
+      }
+    }
+  }
+  serial = snapshot.serial;
+  if (num_records == 0)
+    return 0;
+
+  QByteArray commit;
+  QDataStream out(&commit, QIODevice::WriteOnly);
+  out << static_cast<quint8>(OP_COMMIT);
+  data += record(commit);
+
+  QFile file(QString::fromStdString(filename));
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Append) ||
+      file.write(data) != data.size() ||
+      !file.flush()) {
+    // the state above already has these edits, so carrying on would
+    // lose them. Stop journaling until the next save starts over.
+    qWarning("couldn't append to %s: %s",
+        filename.c_str(),
+        qUtf8Printable(file.errorString()));
+    is_open = false;
+    return -1;
+  }
+  return num_records;
+}
+
+qint64 Journal::size() const
+{
+  QMutexLocker locker(&mutex);
+  return QFileInfo(QString::fromStdString(filename)).size();
+}
+
+int Journal::replay(
+    const string &_filename,
+    const QByteArray &base_hash,
+    const QString &project_dir,
+    Map &map,
+    qint64 &valid_size,
+    string &error)
+{
+  valid_size = 0;
+  QFile file(QString::fromStdString(_filename));
+  if (!file.exists())
+    return 0;
+  if (!file.open(QIODevice::ReadOnly)) {
+    error = "couldn't open " + _filename;
+    return -1;
+  }
+  const QByteArray data = file.readAll();
+
+  QDataStream in(data);
+  char magic[sizeof(JOURNAL_MAGIC)];
+  quint32 version = 0;
+  QByteArray hash;
+  in.readRawData(magic, sizeof(magic));
+  in >> version >> hash;
+  if (in.status() != QDataStream::Ok ||
+      memcmp(magic, JOURNAL_MAGIC, sizeof(magic)) != 0 ||
+      version != VERSION) {
+    error = _filename + " is not a journal this version can read";
+    return -1;
+  }
+  if (hash != base_hash) {
+    error = _filename + " is for a different version of the project";
+    return -1;
+  }
+
+  qint64 pos = in.device()->pos();
+  valid_size = pos;
+  vector<QByteArray> pending;  // records of an append not committed yet
+  EdgeTables edge_tables;
+  int num_applied = 0;
+  try {
+    while (pos + 8 <= data.size()) {
+      const uchar *p = reinterpret_cast<const uchar *>(data.constData() + pos);
+      const quint32 payload_size = qFromBigEndian<quint32>(p);
+      const quint32 crc = qFromBigEndian<quint32>(p + 4);
+      if (pos + 8 + payload_size > static_cast<qint64>(data.size()))
+        break;  // torn write at the end
+      const QByteArray payload = data.mid(pos + 8, payload_size);
+      if (payload.isEmpty() || crc32(payload) != crc)
+        break;  // corrupt; nothing after this can be trusted
+      pos += 8 + payload_size;
+
+      if (static_cast<quint8>(payload[0]) != OP_COMMIT) {
+        pending.push_back(payload);
+        continue;
+      }
+      for (const QByteArray &r : pending)
+        apply(r, project_dir, map, edge_tables);
+      num_applied += static_cast<int>(pending.size());
+      pending.clear();
+      valid_size = pos;
+    }
+  }
+  catch (const std::exception &e) {
+    error = _filename + ": " + e.what();
+    return -1;
+  }
+
+  // put the edges of the levels that were touched back together, in the
+  // order the YAML would have them
+  for (auto &tables : edge_tables) {
+    for (Level &level : map.levels) {
+      if (level.name != tables.first)
+        continue;
+      level.edges.clear();
+      for (const vector<Edge> &table : tables.second)
+        level.edges.insert(level.edges.end(), table.begin(), table.end());
+      level.calculate_scale();  // measurements may have changed
+    }
+  }
+  return num_applied;
+}
+
+void Journal::apply(
+    const QByteArray &payload,
+    const QString &project_dir,
+    Map &map,
+    EdgeTables &edge_tables)
+{
+  QDataStream in(payload);
+  quint8 op = 0;
+  QByteArray name_bytes;
+  in >> op >> name_bytes;
+  const string name = name_bytes.toStdString();
+
+  Level *level = nullptr;
+  for (Level &l : map.levels)
+    if (l.name == name)
+      level = &l;
+
+  if (op == OP_LEVEL) {
+    QByteArray header_yaml;
+    in >> header_yaml;
+    Level new_level;
+    new_level.from_yaml(
+        name,
+        YAML::Load(header_yaml.toStdString()),
+        project_dir);
+    if (level) {
+      // keep everything but the header
+      new_level.vertices.swap(level->vertices);
+      new_level.edges.swap(level->edges);
+      new_level.models.swap(level->models);
+      new_level.polygons.swap(level->polygons);
+      *level = new_level;
+    }
+    else
+      map.levels.push_back(new_level);
+    return;
+  }
+
+  if (!level)
+    throw std::runtime_error("edit of unknown level " + name);
+
+  quint8 table = 0;
+  quint32 idx = 0;
+  in >> table >> idx;
+  if (table >= NUM_TABLES)
+    throw std::runtime_error("unknown table");
+
+  vector<Edge> *edges = nullptr;
+  if (table >= LANES && table <= DOORS) {
+    auto it = edge_tables.find(name);
+    if (it == edge_tables.end()) {
+      // split this level's edges into their tables on first use
+      vector<vector<Edge> > &t = edge_tables[name];
+      t.resize(DOORS - LANES + 1);
+      for (const Edge &edge : level->edges) {
+        if (edge.type >= Edge::LANE && edge.type <= Edge::DOOR)
+          t[edge.type - Edge::LANE].push_back(edge);
+      }
+      it = edge_tables.find(name);
+    }
+    edges = &it->second[table - LANES];
+  }
+
+  if (op == OP_RESIZE) {
+    if (table == VERTICES)
+      level->vertices.resize(idx);
+    else if (edges)
+      edges->resize(idx);
+    else if (table == MODELS)
+      level->models.resize(idx);
+    else
+      level->polygons.resize(idx);
+    return;
+  }
+  if (op != OP_SET)
+    throw std::runtime_error("unknown record");
+
+  QByteArray yaml;
+  in >> yaml;
+  const YAML::Node node = YAML::Load(yaml.toStdString());
+  if (table == VERTICES && idx < level->vertices.size()) {
+    Vertex vertex;
+    vertex.from_yaml(node);
+    level->vertices[idx] = vertex;
+  }
+  else if (edges && idx < edges->size()) {
+    Edge edge;
+    edge.from_yaml(node, static_cast<Edge::Type>(Edge::LANE + table - LANES));
+    (*edges)[idx] = edge;
+  }
+  else if (table == MODELS && idx < level->models.size()) {
+    Model model;
+    model.from_yaml(node);
+    level->models[idx] = model;
+  }
+  else if (table == FLOORS && idx < level->polygons.size()) {
+    Polygon polygon;
+    polygon.from_yaml(node, Polygon::FLOOR);
+    level->polygons[idx] = polygon;
+  }
+  else
+    throw std::runtime_error("edit past the end of a table");
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+/*
+ * An append-only binary log of edits, kept next to the project file
+ * ("building.yaml.journal"). Appending only writes what changed since
+ * the last append, so it costs the same however big the building is;
+ * the project file itself is only rewritten (compacted) on an explicit
+ * save. Reopening a project replays the journal over the project file.
+ *
+ * What changed is told to the journal with the map's own MapChanges, as
+ * they are posted (see changed()). An append then only serializes the
+ * entities that those name, taken from the snapshot it is given.
+ *
+ * The file is a header (magic, version, and the SHA-1 of the project
+ * file it applies to) followed by records:
+ *
+ *   quint32 payload size, quint32 CRC-32 of the payload, payload
+ *
+ * Edits are described per level and per YAML sequence ("table"), with
+ * each entity stored as its own YAML text, so a journal holds exactly
+ * what a save would have written. Each append ends with a COMMIT record,
+ * and replay only applies complete, intact appends: a crash halfway
+ * through writing one loses that append and nothing else.
+ *
+ * A Journal is used from job threads; all of its methods lock.
+ */
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QMutex>
+#include <QString>
+
+#include "map.h"
+
+
+class Journal
+{
+public:
+  Journal(const std::string &_filename);
+  ~Journal();
+
+  static const quint32 VERSION = 1;
+
+  /// The journal that goes with a project file
+  static std::string filename_for_project(const QString &project_filename);
+
+  const std::string &get_filename() const { return filename; }
+
+  /// SHA-1 of a project file (YAML or binary), to tie a journal to the
+  /// file it applies to
+  static QByteArray file_hash(const QByteArray &file_data);
+
+  /// Start journaling on top of a project file with this hash, whose
+  /// content (after any replay) is the snapshot. If keep_bytes is
+  /// nonzero, that much of the existing file is kept: the part that was
+  /// just replayed. Anything after it (a torn append) is cut off.
+  /// Otherwise the file is started over.
+  bool open(
+      const QByteArray &base_hash,
+      const MapSnapshot &snapshot,
+      const qint64 keep_bytes);
+
+  /// Note changes posted by the map's change bus, to be appended with
+  /// the first snapshot whose serial is at least this (that is, the next
+  /// one the map takes). Called from the thread that edits the map.
+  void changed(
+      const std::vector<MapChange> &changes,
+      const uint64_t snapshot_serial);
+
+  /// Append the changes that this snapshot has and the journal doesn't.
+  /// Snapshots older than the previous one are ignored, so jobs can
+  /// finish in any order; changes they would have had wait for the next.
+  /// Returns the number of records appended (0 if nothing changed), or
+  /// -1 on error or if the journal isn't open.
+  int append(const MapSnapshot &snapshot);
+
+  /// Size of the file on disk, in bytes
+  qint64 size() const;
+
+  /// Apply the committed records of a journal to a map just loaded from
+  /// a project file with this hash. Returns the number of records
+  /// applied, 0 if there is no journal, or -1 (and an error message) if the
+  /// journal is for a different version of the file or can't be read.
+  /// In that last case the map may have been partly changed. valid_size
+  /// is set to the length of the part of the file that was applied.
+  static int replay(
+      const std::string &filename,
+      const QByteArray &base_hash,
+      const QString &project_dir,
+      Map &map,
+      qint64 &valid_size,
+      std::string &error);
+
+  enum Table {
+    VERTICES = 0,
+    LANES,
+    WALLS,
+    MEASUREMENTS,
+    DOORS,
+    MODELS,
+    FLOORS,
+    NUM_TABLES
+  };
+
+private:
+  enum Op {
+    OP_LEVEL = 1,  // create a level, or replace its header
+    OP_RESIZE,  // grow or shrink a table
+    OP_SET,  // replace one entity of a table
+    OP_COMMIT  // end of an append
+  };
+
+  static const int NUM_ENTITIES = MapChange::POLYGON + 1;
+
+  // where the journal (and the YAML under it) has each level's entities
+  struct LevelState
+  {
+    std::string header;
+    // the indices in the level's vector of the entities in each table
+    std::vector<int> rows[NUM_TABLES];
+    // and hashes of their YAML text, to skip writing rows that come out
+    // the same (as rows after a removal often do)
+    std::vector<size_t> row_hashes[NUM_TABLES];
+  };
+
+  // what has to be written again of a level
+  struct LevelEdits
+  {
+    LevelEdits();
+    // from here on, entities were added or removed or moved to another
+    // table, so the rows after it have to be worked out again
+    int first_moved[NUM_ENTITIES];
+    std::set<int> modified[NUM_ENTITIES];
+  };
+
+  struct Edits
+  {
+    Edits() : reset(false) {}
+    bool reset;  // everything
+    std::map<int, LevelEdits> levels;  // by level index
+  };
+
+  mutable QMutex mutex;
+  const std::string filename;
+  bool is_open;
+  uint64_t serial;  // of the last snapshot appended
+  std::map<std::string, LevelState> levels;
+
+  // changed() is called while appends are running, so it has its own
+  // lock. The changes are kept by the serial of the first snapshot that
+  // has them.
+  QMutex pending_mutex;
+  std::map<uint64_t, Edits> pending;
+
+  void set_state(const MapSnapshot &snapshot);
+  static void add_rows(
+      const Level &level,
+      const int entity,
+      const int first_idx,
+      LevelState &state);
+  static int table_of(const Level &level, const int entity, const int idx);
+  static std::string dump_row(
+      const Level &level,
+      const int table,
+      const int idx);
+  static QByteArray header(const QByteArray &base_hash);
+  static QByteArray record(const QByteArray &payload);
+  static quint32 crc32(const QByteArray &data);
+  // while replaying, the edges of each level touched so far, split into
+  // their four tables (in the same order as the Table enum)
+  typedef std::map<std::string, std::vector<std::vector<Edge> > > EdgeTables;
+
+  static void apply(
+      const QByteArray &payload,
+      const QString &project_dir,
+      Map &map,
+      EdgeTables &edge_tables);
+};
+
+#endif
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "lane_clearance.h"
+using std::vector;
+
+
+/// Mix the bits of a double into a running hash
+static uint64_t hash_double(const uint64_t hash, const double value)
+{
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint64_t h = (hash ^ bits) * 0x100000001b3ULL;
+  return h ^ (h >> 29);
+}
+
+static double point_segment_distance(
+    const QPointF &p,
+    const QPointF &a,
+    const QPointF &b)
+{
+  const double dx = b.x() - a.x();
+  const double dy = b.y() - a.y();
+  const double len2 = dx * dx + dy * dy;
+  double t = len2 > 0.0 ?
+      ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / len2 : 0.0;
+  t = std::max(0.0, std::min(1.0, t));
+  return std::hypot(a.x() + t * dx - p.x(), a.y() + t * dy - p.y());
+}
+
+static int floor_div(const int a, const int b)
+{
+  return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+
+LaneClearance::LaneClearance()
+: radius(-1.0),
+  meters_per_pixel(0.0),
+  spacing(1.0),
+  reach(1.0),
+  num_resampled(0)
+{
+}
+
+LaneClearance::~LaneClearance()
+{
+}
+
+void LaneClearance::clear()
+{
+  radius = -1.0;
+  obstacles.clear();
+  obstacle_keys.clear();
+  obstacle_grid.clear();
+  tiles.clear();
+  lanes.clear();
+  violations.clear();
+  num_resampled = 0;
+}
+
+uint64_t LaneClearance::obstacle_key(const Obstacle &obstacle)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const QPointF &p : obstacle.points) {
+    hash = hash_double(hash, p.x());
+    hash = hash_double(hash, p.y());
+  }
+  hash = hash_double(hash, obstacle.offset);
+  return hash_double(hash, obstacle.closed ? 1.0 : 0.0);
+}
+
+uint64_t LaneClearance::lane_key(const QPointF &start, const QPointF &end)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  hash = hash_double(hash, start.x());
+  hash = hash_double(hash, start.y());
+  hash = hash_double(hash, end.x());
+  return hash_double(hash, end.y());
+}
+
+uint64_t LaneClearance::tile_key(const int tx, const int ty)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(tx)) << 32) |
+      static_cast<uint32_t>(ty);
+}
+
+void LaneClearance::update(
+    const Level &level,
+    const double footprint_radius_meters,
+    const vector<QPolygonF> &model_footprints)
+{
+  const double mpp = level.drawing_meters_per_pixel;
+  if (footprint_radius_meters / mpp != radius || mpp != meters_per_pixel) {
+    // every distance in the field is relative to these
+    clear();
+    radius = footprint_radius_meters / mpp;
+    meters_per_pixel = mpp;
+    spacing = std::max(1.0, radius / 8.0);
+    reach = radius + 2.0 * spacing;
+    obstacle_grid.clear(TILE_SIZE * spacing);
+  }
+
+  // walls are 10 cm thick, as the generators build them, and doors are
+  // only in the way at their jambs
+  vector<Obstacle> new_obstacles;
+  const int num_vertices = static_cast<int>(level.vertices.size());
+  auto vertex_point = [&level](const int idx) {
+    return QPointF(level.vertices[idx].x, level.vertices[idx].y);
+  };
+  for (const Edge &edge : level.edges) {
+    if (edge.start_idx < 0 || edge.start_idx >= num_vertices ||
+        edge.end_idx < 0 || edge.end_idx >= num_vertices)
+      continue;
+    Obstacle obstacle;
+    obstacle.closed = false;
+    obstacle.offset = 0.0;
+    if (edge.type == Edge::WALL) {
+      obstacle.points.push_back(vertex_point(edge.start_idx));
+      obstacle.points.push_back(vertex_point(edge.end_idx));
+      obstacle.offset = 0.05 / mpp;
+      new_obstacles.push_back(obstacle);
+    }
+    else if (edge.type == Edge::DOOR) {
+      obstacle.points.assign(1, vertex_point(edge.start_idx));
+      new_obstacles.push_back(obstacle);
+      obstacle.points.assign(1, vertex_point(edge.end_idx));
+      new_obstacles.push_back(obstacle);
+    }
+  }
+  for (const QPolygonF &footprint : model_footprints) {
+    if (footprint.size() < 3)
+      continue;
+    Obstacle obstacle;
+    obstacle.points.assign(footprint.begin(), footprint.end());
+    obstacle.closed = true;
+    obstacle.offset = 0.0;
+    new_obstacles.push_back(obstacle);
+  }
+  for (Obstacle &obstacle : new_obstacles) {
+    QRectF bounds(obstacle.points[0], obstacle.points[0]);
+    for (const QPointF &p : obstacle.points)
+      bounds |= QRectF(p, p);
+    obstacle.bounds = bounds.adjusted(
+        -obstacle.offset, -obstacle.offset, obstacle.offset, obstacle.offset);
+  }
+
+  vector<QRectF> dirty;
+  set_obstacles(new_obstacles, dirty);
+
+  // lanes that haven't moved keep their results, unless something
+  // changed close enough to them to matter
+  std::unordered_map<uint64_t, Lane> new_lanes;
+  num_resampled = 0;
+  for (const Edge &edge : level.edges) {
+    if (edge.type != Edge::LANE ||
+        edge.start_idx < 0 || edge.start_idx >= num_vertices ||
+        edge.end_idx < 0 || edge.end_idx >= num_vertices)
+      continue;
+    const QPointF start = vertex_point(edge.start_idx);
+    const QPointF end = vertex_point(edge.end_idx);
+    const uint64_t key = lane_key(start, end);
+    if (new_lanes.count(key))
+      continue;  // the same lane twice
+
+    auto it = lanes.find(key);
+    bool stale = it == lanes.end();
+    if (!stale) {
+      const QRectF near = QRectF(start, end).normalized().adjusted(
+          -reach, -reach, reach, reach);
+      for (size_t i = 0; i < dirty.size() && !stale; i++)
+        stale = near.intersects(dirty[i]);
+    }
+
+    Lane &lane = new_lanes[key];
+    if (stale) {
+      lane.start = start;
+      lane.end = end;
+      sample_lane(lane);
+      num_resampled++;
+    }
+    else
+      lane = std::move(it->second);
+  }
+  lanes.swap(new_lanes);
+
+  violations.clear();
+  for (const auto &it : lanes) {
+    violations.insert(
+        violations.end(),
+        it.second.violations.begin(),
+        it.second.violations.end());
+  }
+}
+
+void LaneClearance::set_obstacles(
+    vector<Obstacle> &new_obstacles,
+    vector<QRectF> &dirty)
+{
+  // an obstacle that is only in one of the two sets was added, moved or
+  // removed; the field has to be redone around it
+  std::unordered_set<uint64_t> new_keys;
+  for (const Obstacle &obstacle : new_obstacles)
+    new_keys.insert(obstacle_key(obstacle));
+  for (const Obstacle &obstacle : obstacles) {
+    if (!new_keys.count(obstacle_key(obstacle)))
+      dirty.push_back(obstacle.bounds);
+  }
+  for (const Obstacle &obstacle : new_obstacles) {
+    if (!obstacle_keys.count(obstacle_key(obstacle)))
+      dirty.push_back(obstacle.bounds);
+  }
+
+  // lots of little changes (a new level, say) are cheaper as one
+  if (dirty.size() > 64) {
+    QRectF all;
+    for (const QRectF &rect : dirty)
+      all |= rect;
+    dirty.assign(1, all);
+  }
+
+  obstacles.swap(new_obstacles);
+  obstacle_keys.swap(new_keys);
+  obstacle_grid.clear();
+  for (size_t i = 0; i < obstacles.size(); i++) {
+    const QRectF &b = obstacles[i].bounds;
+    obstacle_grid.insert_box(
+        static_cast<int>(i), b.left(), b.top(), b.right(), b.bottom());
+  }
+
+  for (const QRectF &rect : dirty)
+    drop_tiles(rect);
+}
+
+void LaneClearance::drop_tiles(const QRectF &rect)
+{
+  if (tiles.empty())
+    return;
+  const double tile_extent = TILE_SIZE * spacing;
+  const QRectF r = rect.adjusted(-reach, -reach, reach, reach);
+  const int tx0 = static_cast<int>(std::floor(r.left() / tile_extent));
+  const int ty0 = static_cast<int>(std::floor(r.top() / tile_extent));
+  const int tx1 = static_cast<int>(std::floor(r.right() / tile_extent));
+  const int ty1 = static_cast<int>(std::floor(r.bottom() / tile_extent));
+
+  const double num_in_rect =
+      (static_cast<double>(tx1) - tx0 + 1) *
+      (static_cast<double>(ty1) - ty0 + 1);
+  if (num_in_rect > static_cast<double>(tiles.size())) {
+    for (auto it = tiles.begin(); it != tiles.end(); ) {
+      const int tx = static_cast<int32_t>(it->first >> 32);
+      const int ty = static_cast<int32_t>(it->first & 0xffffffff);
+      if (tx >= tx0 && tx <= tx1 && ty >= ty0 && ty <= ty1)
+        it = tiles.erase(it);
+      else
+        ++it;
+    }
+    return;
+  }
+  for (int ty = ty0; ty <= ty1; ty++)
+    for (int tx = tx0; tx <= tx1; tx++)
+      tiles.erase(tile_key(tx, ty));
+}
+
+const vector<float> &LaneClearance::tile(const int tx, const int ty)
+{
+  const uint64_t key = tile_key(tx, ty);
+  auto it = tiles.find(key);
+  if (it != tiles.end())
+    return it->second;
+
+  vector<float> values(TILE_SIZE * TILE_SIZE, static_cast<float>(reach));
+  const int ix0 = tx * TILE_SIZE;
+  const int iy0 = ty * TILE_SIZE;
+  const double x0 = ix0 * spacing;
+  const double y0 = iy0 * spacing;
+  const double extent = (TILE_SIZE - 1) * spacing;
+
+  candidates.clear();
+  obstacle_grid.query_box(
+      x0 - reach, y0 - reach, x0 + extent + reach, y0 + extent + reach,
+      candidates);
+  for (const int idx : candidates) {
+    // only the samples within reach of the obstacle can change
+    const Obstacle &obstacle = obstacles[idx];
+    const QRectF &b = obstacle.bounds;
+    const int i0 = std::max(
+        0, static_cast<int>(std::ceil((b.left() - reach - x0) / spacing)));
+    const int j0 = std::max(
+        0, static_cast<int>(std::ceil((b.top() - reach - y0) / spacing)));
+    const int i1 = std::min(
+        TILE_SIZE - 1,
+        static_cast<int>(std::floor((b.right() + reach - x0) / spacing)));
+    const int j1 = std::min(
+        TILE_SIZE - 1,
+        static_cast<int>(std::floor((b.bottom() + reach - y0) / spacing)));
+    for (int j = j0; j <= j1; j++) {
+      for (int i = i0; i <= i1; i++) {
+        const QPointF p(x0 + i * spacing, y0 + j * spacing);
+        float &value = values[j * TILE_SIZE + i];
+        value = std::min(
+            value, static_cast<float>(signed_distance(obstacle, p)));
+      }
+    }
+  }
+  return tiles.emplace(key, std::move(values)).first->second;
+}
+
+double LaneClearance::sample(const int ix, const int iy)
+{
+  const int tx = floor_div(ix, TILE_SIZE);
+  const int ty = floor_div(iy, TILE_SIZE);
+  const vector<float> &values = tile(tx, ty);
+  return values[(iy - ty * TILE_SIZE) * TILE_SIZE + (ix - tx * TILE_SIZE)];
+}
+
+double LaneClearance::clearance_at(const QPointF &p)
+{
+  const double gx = p.x() / spacing;
+  const double gy = p.y() / spacing;
+  const int ix = static_cast<int>(std::floor(gx));
+  const int iy = static_cast<int>(std::floor(gy));
+  const double fx = gx - ix;
+  const double fy = gy - iy;
+  const double top =
+      sample(ix, iy) * (1.0 - fx) + sample(ix + 1, iy) * fx;
+  const double bottom =
+      sample(ix, iy + 1) * (1.0 - fx) + sample(ix + 1, iy + 1) * fx;
+  return top * (1.0 - fy) + bottom * fy;
+}
+
+double LaneClearance::signed_distance(
+    const Obstacle &obstacle,
+    const QPointF &p) const
+{
+  const vector<QPointF> &points = obstacle.points;
+  const size_t n = points.size();
+  double dist = std::hypot(p.x() - points[0].x(), p.y() - points[0].y());
+  for (size_t i = 1; i < n; i++)
+    dist = std::min(dist, point_segment_distance(p, points[i - 1], points[i]));
+
+  if (obstacle.closed) {
+    dist = std::min(dist, point_segment_distance(p, points[n - 1], points[0]));
+    bool inside = false;
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+      const QPointF &a = points[i];
+      const QPointF &b = points[j];
+      if ((a.y() > p.y()) != (b.y() > p.y()) &&
+          p.x() < a.x() + (p.y() - a.y()) * (b.x() - a.x()) / (b.y() - a.y()))
+        inside = !inside;
+    }
+    if (inside)
+      dist = -dist;
+  }
+  return dist - obstacle.offset;
+}
+
+void LaneClearance::sample_lane(Lane &lane)
+{
+  lane.violations.clear();
+  const double dx = lane.end.x() - lane.start.x();
+  const double dy = lane.end.y() - lane.start.y();
+  const int n = std::max(
+      1, static_cast<int>(std::ceil(std::hypot(dx, dy) / spacing)));
+
+  // runs of samples below the radius become one violation each
+  bool inside = false;
+  Violation violation;
+  for (int k = 0; k <= n; k++) {
+    const double t = static_cast<double>(k) / n;
+    const QPointF p(lane.start.x() + t * dx, lane.start.y() + t * dy);
+    const double clearance = clearance_at(p);
+    if (clearance < radius) {
+      if (!inside) {
+        violation.start = p;
+        violation.clearance = clearance;
+        inside = true;
+      }
+      violation.end = p;
+      violation.clearance = std::min(violation.clearance, clearance);
+    }
+    else if (inside) {
+      lane.violations.push_back(violation);
+      inside = false;
+    }
+  }
+  if (inside)
+    lane.violations.push_back(violation);
+}
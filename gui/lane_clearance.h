@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef LANE_CLEARANCE_H
+#define LANE_CLEARANCE_H
+
+/*
+ * Checks that the lanes of a level leave room for the robot: finds the
+ * stretches of lane that come closer than the footprint radius to a
+ * wall, a door jamb or a placed model.
+ *
+ * Clearance is read from a signed distance field of those obstacles
+ * (negative inside model footprints), sampled on a grid a fraction of
+ * the footprint radius apart and interpolated bilinearly in between.
+ * The field is computed lazily in square tiles, only where lanes need
+ * it, and only out to a little past the radius.
+ *
+ * update() is meant to be called after every edit. It compares the
+ * level's obstacles and lanes with the ones it saw last time, and only
+ * throws out the field tiles near the obstacles that were added, moved
+ * or removed, and only re-samples the lanes that are new or near them.
+ *
+ * Everything is in level (drawing pixel) coordinates.
+ */
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+
+#include "level.h"
+#include "spatial_grid.h"
+
+
+class LaneClearance
+{
+public:
+  /// A stretch of lane closer to an obstacle than the footprint radius
+  struct Violation
+  {
+    QPointF start, end;
+    double clearance;  // the smallest along the stretch, in pixels
+  };
+
+  LaneClearance();
+  ~LaneClearance();
+
+  /// Forget everything, so the next update() starts from scratch
+  void clear();
+
+  /// Re-analyze the level. model_footprints holds the outline of each
+  /// of the level's models, or an empty polygon where it isn't known.
+  void update(
+      const Level &level,
+      const double footprint_radius_meters,
+      const std::vector<QPolygonF> &model_footprints);
+
+  const std::vector<Violation> &get_violations() const
+  { return violations; }
+
+  double get_radius() const { return radius; }  // in pixels
+
+  /// How many lanes the last update() had to sample again
+  int get_num_resampled() const { return num_resampled; }
+
+  /// The clearance at a point, out to a little past the radius
+  double clearance_at(const QPointF &p);
+
+private:
+  struct Obstacle
+  {
+    std::vector<QPointF> points;
+    bool closed;  // a polygon, rather than a point or a polyline
+    double offset;  // half the thickness of a wall
+    QRectF bounds;  // including the offset
+  };
+
+  struct Lane
+  {
+    QPointF start, end;
+    std::vector<Violation> violations;
+  };
+
+  static const int TILE_SIZE = 32;  // field samples per tile side
+
+  double radius;
+  double meters_per_pixel;
+  double spacing;  // between field samples
+  double reach;  // distances are clamped to this
+
+  std::vector<Obstacle> obstacles;
+  std::unordered_set<uint64_t> obstacle_keys;
+  SpatialGrid obstacle_grid;
+  std::vector<int> candidates;  // reused by tile()
+
+  std::unordered_map<uint64_t, std::vector<float> > tiles;
+  std::unordered_map<uint64_t, Lane> lanes;
+  std::vector<Violation> violations;
+  int num_resampled;
+
+  static uint64_t obstacle_key(const Obstacle &obstacle);
+  static uint64_t lane_key(const QPointF &start, const QPointF &end);
+  static uint64_t tile_key(const int tx, const int ty);
+
+  void set_obstacles(
+      std::vector<Obstacle> &new_obstacles,
+      std::vector<QRectF> &dirty);
+  void drop_tiles(const QRectF &rect);
+  const std::vector<float> &tile(const int tx, const int ty);
+  double sample(const int ix, const int iy);
+  double signed_distance(const Obstacle &obstacle, const QPointF &p) const;
+  void sample_lane(Lane &lane);
+};
+
+#endif
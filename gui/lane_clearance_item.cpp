@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QPainter>
+
+#include "lane_clearance_item.h"
+
+
+LaneClearanceItem::LaneClearanceItem(const LaneClearance &lane_clearance)
+: violations(lane_clearance.get_violations()),
+  radius(lane_clearance.get_radius())
+{
+  for (const LaneClearance::Violation &v : violations) {
+    bounds |= QRectF(v.start, v.end).normalized().adjusted(
+        -radius, -radius, radius, radius);
+  }
+}
+
+LaneClearanceItem::~LaneClearanceItem()
+{
+}
+
+QRectF LaneClearanceItem::boundingRect() const
+{
+  return bounds;
+}
+
+void LaneClearanceItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *,
+    QWidget *)
+{
+  painter->setPen(
+      QPen(
+        QColor::fromRgbF(1.0, 0.0, 0.0, 0.3),
+        2.0 * radius,
+        Qt::SolidLine,
+        Qt::RoundCap));
+  for (const LaneClearance::Violation &v : violations)
+    painter->drawLine(v.start, v.end);
+}
+
+bool LaneClearanceItem::contains(const QPointF &) const
+{
+  return false;
+}
+
+bool LaneClearanceItem::collidesWithPath(
+    const QPainterPath &,
+    Qt::ItemSelectionMode) const
+{
+  return false;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef LANE_CLEARANCE_ITEM_H
+#define LANE_CLEARANCE_ITEM_H
+
+/*
+ * Overlay for the lane stretches that LaneClearance flagged: a
+ * translucent red band as wide as the robot footprint along each one,
+ * so it shows where the footprint would overlap something. The item
+ * ignores the mouse, so clicks go through to the lanes underneath.
+ */
+
+#include <vector>
+
+#include <QGraphicsItem>
+
+#include "lane_clearance.h"
+
+
+class LaneClearanceItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 5 };
+
+  LaneClearanceItem(const LaneClearance &lane_clearance);
+  ~LaneClearanceItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+  bool contains(const QPointF &point) const override;
+  bool collidesWithPath(
+      const QPainterPath &path,
+      Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+private:
+  std::vector<LaneClearance::Violation> violations;
+  double radius;
+  QRectF bounds;
+};
+
+#endif
@@ -16,12 +16,16 @@
 */
 
 #include <algorithm>
+#include <map>
+#include <numeric>
 
+#include <QDir>
+#include <QGraphicsPolygonItem>
 #include <QGraphicsScene>
-#include <QImage>
-#include <QImageReader>
 
+#include "edge_layer_item.h"
 #include "level.h"
+#include "vertex_layer_item.h"
 using std::string;
 using std::vector;
 
@@ -42,7 +46,11 @@ Level::~Level()
 {
 }
 
-bool Level::from_yaml(const std::string &_name, const YAML::Node &_data)
+bool Level::from_yaml(
+    const std::string &_name,
+    const YAML::Node &_data,
+    const QString &project_dir,
+    JobProgress *progress)
 {
   printf("parsing level [%s]\n", _name.c_str());
   name = _name;
@@ -55,41 +63,17 @@ bool Level::from_yaml(const std::string &_name, const YAML::Node &_data)
     if (!drawing_data["filename"])
       throw std::runtime_error("level " + name + " drawing invalid");
     drawing_filename = drawing_data["filename"].as<string>();
-
-    printf("  level %s drawing: %s\n",
-        name.c_str(),
-        drawing_filename.c_str());
-
-    QString qfilename = QString::fromStdString(drawing_filename);
-
-    QImageReader image_reader(qfilename);
-    image_reader.setAutoTransform(true);
-    QImage image = image_reader.read();
-    if (image.isNull()) {
-      qWarning("unable to read %s: %s",
-          qUtf8Printable(qfilename),
-          qUtf8Printable(image_reader.errorString()));
-      return false;
-    }
-    image = image.convertToFormat(QImage::Format_Grayscale8);
-    pixmap = QPixmap::fromImage(image);
-    drawing_width = pixmap.width();
-    drawing_height = pixmap.height();
   }
   else if (_data["x_meters"] && _data["y_meters"]) {
     x_meters = _data["x_meters"].as<double>();
     y_meters = _data["y_meters"].as<double>();
-    drawing_meters_per_pixel = 0.05;  // something reasonable
-    drawing_width = x_meters / drawing_meters_per_pixel;
-    drawing_height = y_meters / drawing_meters_per_pixel;
   }
   else {
     x_meters = 100.0;
     y_meters = 100.0;
-    drawing_meters_per_pixel = 0.05;
-    drawing_width = x_meters / drawing_meters_per_pixel;
-    drawing_height = y_meters / drawing_meters_per_pixel;
   }
+  if (!load_drawing(project_dir, progress))
+    return false;
 
   if (_data["vertices"] && _data["vertices"].IsSequence()) {
     const YAML::Node &pts = _data["vertices"];
@@ -127,6 +111,36 @@ bool Level::from_yaml(const std::string &_name, const YAML::Node &_data)
   return true;
 }
 
+bool Level::load_drawing(const QString &project_dir, JobProgress *progress)
+{
+  if (drawing_filename.empty()) {
+    drawing.reset();
+    drawing_meters_per_pixel = 0.05;  // something reasonable
+    drawing_width = x_meters / drawing_meters_per_pixel;
+    drawing_height = y_meters / drawing_meters_per_pixel;
+    return true;
+  }
+
+  printf("  level %s drawing: %s\n",
+      name.c_str(),
+      drawing_filename.c_str());
+
+  // QDir::filePath() leaves absolute paths alone
+  const QString qfilename = QDir(project_dir).filePath(
+      QString::fromStdString(drawing_filename));
+
+  std::shared_ptr<Drawing> new_drawing = std::make_shared<Drawing>();
+  if (!new_drawing->load(
+      qfilename,
+      Drawing::storage_from_settings(),
+      progress))
+    return false;
+  drawing = new_drawing;
+  drawing_width = drawing->width();
+  drawing_height = drawing->height();
+  return true;
+}
+
 void Level::load_yaml_edge_sequence(
     const YAML::Node &data,
     const char *sequence_name,
@@ -143,6 +157,23 @@ void Level::load_yaml_edge_sequence(
   }
 }
 
+YAML::Node Level::header_to_yaml() const
+{
+  // same keys as to_yaml(), minus the sequences
+  YAML::Node y;
+  if (!drawing_filename.empty()) {
+    YAML::Node drawing_node;
+    drawing_node["filename"] = drawing_filename;
+    y["drawing"] = drawing_node;
+  }
+  else {
+    y["x_meters"] = x_meters;
+    y["y_meters"] = y_meters;
+  }
+  y["elevation"] = elevation;
+  return y;
+}
+
 YAML::Node Level::to_yaml() const
 {
   YAML::Node y;
@@ -204,14 +235,88 @@ YAML::Node Level::to_yaml() const
   return y;
 }
 
-void Level::delete_keypress()
+void Level::delete_keypress(
+    vector<int> &removed_edges,
+    vector<int> &removed_vertices,
+    vector<int> &renumbered_edges,
+    vector<int> &renumbered_polygons)
 {
-  edges.erase(
-      std::remove_if(
-          edges.begin(),
-          edges.end(),
-          [](Edge edge) { return edge.selected; }),
-      edges.end());
+  removed_edges.clear();
+  removed_vertices.clear();
+  renumbered_edges.clear();
+  renumbered_polygons.clear();
+
+  // Look through const references, so that only the chunks that really
+  // change stop being shared with snapshots
+  const Level &level = *this;
+  for (int i = static_cast<int>(level.edges.size()) - 1; i >= 0; i--) {
+    if (level.edges[i].selected)
+      removed_edges.push_back(i);
+  }
+  if (!removed_edges.empty()) {
+    edges.erase(
+        std::remove_if(
+            edges.begin() + removed_edges.back(),
+            edges.end(),
+            [](const Edge &edge) { return edge.selected; }),
+        edges.end());
+  }
+
+  // the vertices that are still needed, even if they are selected
+  vector<bool> used(level.vertices.size(), false);
+  for (const Edge &edge : level.edges) {
+    used[edge.start_idx] = true;
+    used[edge.end_idx] = true;
+  }
+  for (const Polygon &polygon : level.polygons) {
+    for (const int vertex_idx : polygon.vertices)
+      used[vertex_idx] = true;
+  }
+  for (int i = static_cast<int>(level.vertices.size()) - 1; i >= 0; i--) {
+    if (level.vertices[i].selected && !used[i])
+      removed_vertices.push_back(i);
+  }
+  if (removed_vertices.empty())
+    return;
+
+  // where each vertex from the first one removed onwards ends up
+  const int first = removed_vertices.back();
+  vector<int> new_idx(level.vertices.size() - first, -1);
+  int num_kept = first;
+  for (int i = first; i < static_cast<int>(level.vertices.size()); i++) {
+    if (level.vertices[i].selected && !used[i])
+      continue;
+    new_idx[i - first] = num_kept;
+    if (num_kept != i)
+      vertices[num_kept] = level.vertices[i];
+    num_kept++;
+  }
+  vertices.resize(num_kept);
+
+  for (size_t i = 0; i < level.edges.size(); i++) {
+    const Edge &edge = level.edges[i];
+    if (edge.start_idx < first && edge.end_idx < first)
+      continue;
+    Edge &renumbered = edges[i];
+    if (edge.start_idx >= first)
+      renumbered.start_idx = new_idx[edge.start_idx - first];
+    if (edge.end_idx >= first)
+      renumbered.end_idx = new_idx[edge.end_idx - first];
+    renumbered_edges.push_back(static_cast<int>(i));
+  }
+  for (size_t i = 0; i < level.polygons.size(); i++) {
+    const vector<int> &polygon_vertices = level.polygons[i].vertices;
+    if (std::none_of(
+        polygon_vertices.begin(),
+        polygon_vertices.end(),
+        [first](const int vertex_idx) { return vertex_idx >= first; }))
+      continue;
+    for (int &vertex_idx : polygons[i].vertices) {
+      if (vertex_idx >= first)
+        vertex_idx = new_idx[vertex_idx - first];
+    }
+    renumbered_polygons.push_back(static_cast<int>(i));
+  }
 }
 
 void Level::calculate_scale()
@@ -348,406 +453,94 @@ int Level::polygon_edge_drag_press(
   return min_idx;
 }
 
-void Level::draw_lane(QGraphicsScene *scene, const Edge &edge) const
+vector<std::shared_ptr<const EdgeLayer> > Level::create_edge_layers(
+    const vector<int> &edge_indices,
+    const LevelOfDetail &lod) const
 {
-  const auto &v_start = vertices[edge.start_idx];
-  const auto &v_end = vertices[edge.end_idx];
-  const double dx = v_end.x - v_start.x;
-  const double dy = v_end.y - v_start.y;
-  const double len = sqrt(dx*dx + dy*dy);
-
-  const double lane_pen_width = 1.0 / drawing_meters_per_pixel;
-
-  const QPen arrow_pen(
-      QBrush(QColor::fromRgbF(0.0, 0.0, 0.0, 0.5)),
-      lane_pen_width / 8);
-
-  // dimensions for the direction indicators along this path
-  const double arrow_w = lane_pen_width / 2.5;  // width of arrowheads
-  const double arrow_l = lane_pen_width / 2.5;  // length of arrowheads
-  const double arrow_spacing = lane_pen_width / 2.0;
-
-  const double norm_x = dx / len;
-  const double norm_y = dy / len;
-
-  for (double d = 0.0; d < len; d += arrow_spacing) {
-    // first calculate the center vertex of this arrowhead
-    const double cx = v_start.x + d * norm_x;
-    const double cy = v_start.y + d * norm_y;
-    // one edge vertex of arrowhead
-    const double e1x = cx - arrow_w * norm_y;
-    const double e1y = cy + arrow_w * norm_x;
-    // another edge vertex of arrowhead
-    const double e2x = cx + arrow_w * norm_y;
-    const double e2y = cy - arrow_w * norm_x;
-    // tip of arrowhead
-    const double tx = cx + arrow_l * norm_x;
-    const double ty = cy + arrow_l * norm_y;
-    // now add arrowhead lines
-    scene->addLine(e1x, e1y, tx, ty, arrow_pen);
-    scene->addLine(e2x, e2y, tx, ty, arrow_pen);
-
-    if (d > 0.0 && edge.is_bidirectional()) {
-      const double back_tx = cx - arrow_l * norm_x;
-      const double back_ty = cy - arrow_l * norm_y;
-      scene->addLine(e1x, e1y, back_tx, back_ty, arrow_pen);
-      scene->addLine(e2x, e2y, back_tx, back_ty, arrow_pen);
+  // one layer per edge type, and per graph for lanes
+  std::map<std::pair<int, int>, vector<int> > layer_edges;
+  for (const int edge_idx : edge_indices) {
+    const Edge &edge = edges[edge_idx];
+    switch (edge.type) {
+      case Edge::LANE:
+        layer_edges[std::make_pair(
+            static_cast<int>(edge.type), edge.get_graph_idx())]
+                .push_back(edge_idx);
+        break;
+      case Edge::WALL:
+      case Edge::MEAS:
+      case Edge::DOOR:
+        layer_edges[std::make_pair(static_cast<int>(edge.type), 0)]
+            .push_back(edge_idx);
+        break;
+      default:
+        printf("tried to draw unknown edge type: %d\n",
+            static_cast<int>(edge.type));
+        break;
     }
   }
 
-  QColor color;
-  switch (edge.get_graph_idx()) {
-    case 0: color.setRgbF(0.0, 0.5, 0.0); break;
-    case 1: color.setRgbF(0.0, 0.0, 0.5); break;
-    case 2: color.setRgbF(0.0, 0.5, 0.5); break;
-    case 3: color.setRgbF(0.5, 0.5, 0.0); break;
-    case 4: color.setRgbF(0.5, 0.0, 0.5); break;
-    case 5: color.setRgbF(0.5, 0.5, 0.5); break;
-    default: break;  // will render as dark grey
-  }
-
-  // always draw lane as red if it's selected
-  if (edge.selected)
-    color.setRgbF(0.5, 0.0, 0.0);
-
-  // always draw lanes somewhat transparent
-  color.setAlphaF(0.5);
-
-  scene->addLine(
-      v_start.x, v_start.y,
-      v_end.x, v_end.y,
-      QPen(QBrush(color), lane_pen_width, Qt::SolidLine, Qt::RoundCap));
-
-  // draw the orientation icon, if specified
-  auto orientation_it = edge.params.find("orientation");
-  if (orientation_it != edge.params.end()) {
-    // draw robot-outline box midway down this lane
-    const double mx = (v_start.x + v_end.x) / 2.0;
-    const double my = (v_start.y + v_end.y) / 2.0;
-    const double yaw = atan2(norm_y, norm_x);
-
-    // robot-box half-dimensions in meters
-    const double rw = 0.4 / drawing_meters_per_pixel;
-    const double rl = 0.5 / drawing_meters_per_pixel;
-
-    // calculate the corners of the 'robot' box
-
-    // front-left
-    // |mx| + |cos -sin| | rl|
-    // |my|   |sin  cos| | rw|
-    const double flx = mx + rl * cos(yaw) - rw * sin(yaw);
-    const double fly = my + rl * sin(yaw) + rw * cos(yaw);
-
-    // front-right
-    // |mx| + |cos -sin| | rl|
-    // |my|   |sin  cos| |-rw|
-    const double frx = mx + rl * cos(yaw) + rw * sin(yaw);
-    const double fry = my + rl * sin(yaw) - rw * cos(yaw);
-
-    // back-left
-    // |mx| + |cos -sin| |-rl|
-    // |my|   |sin  cos| | rw|
-    const double blx = mx - rl * cos(yaw) - rw * sin(yaw);
-    const double bly = my - rl * sin(yaw) + rw * cos(yaw);
-
-    // back-right
-    // |mx| + |cos -sin| |-rl|
-    // |my|   |sin  cos| |-rw|
-    const double brx = mx - rl * cos(yaw) + rw * sin(yaw);
-    const double bry = my - rl * sin(yaw) - rw * cos(yaw);
-
-    QPainterPath pp;
-    pp.moveTo(QPointF(flx, fly));
-    pp.lineTo(QPointF(frx, fry));
-    pp.lineTo(QPointF(brx, bry));
-    pp.lineTo(QPointF(blx, bly));
-    pp.lineTo(QPointF(flx, fly));
-    pp.moveTo(QPointF(mx, my));
-
-    QPen orientation_pen(Qt::white, 5.0);
-    if (orientation_it->second.value_string == "forward") {
-      const double hix = mx + 1.0 * cos(yaw) / drawing_meters_per_pixel;
-      const double hiy = my + 1.0 * sin(yaw) / drawing_meters_per_pixel;
-      pp.lineTo(QPointF(hix, hiy));
-      scene->addPath(pp, orientation_pen);
-    }
-    else if (orientation_it->second.value_string == "backward") {
-      const double hix = mx - 1.0 * cos(yaw) / drawing_meters_per_pixel;
-      const double hiy = my - 1.0 * sin(yaw) / drawing_meters_per_pixel;
-      pp.lineTo(QPointF(hix, hiy));
-      scene->addPath(pp, orientation_pen);
-    }
+  vector<std::shared_ptr<const EdgeLayer> > layers;
+  for (const auto &it : layer_edges) {
+    layers.push_back(
+        std::make_shared<const EdgeLayer>(
+          *this,
+          static_cast<Edge::Type>(it.first.first),
+          it.first.second,
+          it.second,
+          lod));
   }
+  return layers;
 }
 
-void Level::draw_wall(QGraphicsScene *scene, const Edge &edge) const
+void Level::draw_edges(QGraphicsScene *scene, const LevelOfDetail &lod) const
 {
-  const auto &v_start = vertices[edge.start_idx];
-  const auto &v_end = vertices[edge.end_idx];
-
-  const double r = edge.selected ? 0.5 : 0.0;
-  const double b = edge.selected ? 0.0 : 0.5;
-
-  scene->addLine(
-      v_start.x, v_start.y,
-      v_end.x, v_end.y,
-      QPen(
-        QBrush(QColor::fromRgbF(r, 0.0, b, 0.5)),
-        0.2 / drawing_meters_per_pixel,
-        Qt::SolidLine, Qt::RoundCap));
+  vector<int> edge_indices(edges.size());
+  std::iota(edge_indices.begin(), edge_indices.end(), 0);
+  for (const auto &layer : create_edge_layers(edge_indices, lod))
+    scene->addItem(new EdgeLayerItem(layer));
 }
 
-void Level::draw_meas(QGraphicsScene *scene, const Edge &edge) const
+void Level::draw_vertices(
+    QGraphicsScene *scene,
+    const LevelOfDetail &lod) const
 {
-  const auto &v_start = vertices[edge.start_idx];
-  const auto &v_end = vertices[edge.end_idx];
-  const double b = edge.selected ? 0.0 : 0.5;
-
-  scene->addLine(
-      v_start.x, v_start.y,
-      v_end.x, v_end.y,
-      QPen(
-        QBrush(QColor::fromRgbF(0.5, 0, b, 0.5)),
-        0.5 / drawing_meters_per_pixel,
-        Qt::SolidLine, Qt::RoundCap));
+  vector<int> vertex_indices(vertices.size());
+  std::iota(vertex_indices.begin(), vertex_indices.end(), 0);
+  scene->addItem(
+      new VertexLayerItem(
+        std::make_shared<const VertexLayer>(*this, vertex_indices, lod)));
 }
 
-void Level::draw_door(QGraphicsScene *scene, const Edge &edge) const
+QBrush Level::polygon_brush(const bool selected)
 {
-  const auto &v_start = vertices[edge.start_idx];
-  const auto &v_end = vertices[edge.end_idx];
-  const double g = edge.selected ? 1.0 : 0.0;
-  const double door_thickness = 0.2;  // meters
-  const double door_motion_thickness = 0.05;  // meters
-
-  scene->addLine(
-      v_start.x, v_start.y,
-      v_end.x, v_end.y,
-      QPen(
-        QBrush(QColor::fromRgbF(1.0, g, 0.0, 0.5)),
-        door_thickness / drawing_meters_per_pixel,
-        Qt::SolidLine, Qt::RoundCap));
-
-  auto door_axis_it = edge.params.find("motion_axis");
-  std::string door_axis("start");
-  if (door_axis_it != edge.params.end())
-    door_axis = door_axis_it->second.value_string;
-
-  double door_axis_x = 0;
-  double door_axis_y = 0;
-  if (door_axis == "start")
-  {
-    door_axis_x = v_start.x;
-    door_axis_y = v_start.y;
-  }
-  else if (door_axis == "end")
-  {
-    door_axis_x = v_end.x;
-    door_axis_y = v_end.y;
-  }
-  else
-  {
-    printf("unknown door axis: [%s]\n", door_axis.c_str());
-  }
-
-  double motion_degrees = 90;
-  auto motion_degrees_it = edge.params.find("motion_degrees");
-  if (motion_degrees_it != edge.params.end())
-    motion_degrees = motion_degrees_it->second.value_double;
-
-  int motion_dir = 1;
-  auto motion_dir_it = edge.params.find("motion_direction");
-  if (motion_dir_it != edge.params.end())
-    motion_dir = motion_dir_it->second.value_int;
-
-  QPainterPath door_motion_path;
-
-  const double door_dx = v_end.x - v_start.x;
-  const double door_dy = v_end.y - v_start.y;
-  const double door_length = sqrt(door_dx * door_dx + door_dy * door_dy);
-  const double door_angle = atan2(door_dy, door_dx);
-
-  auto door_type_it = edge.params.find("type");
-  if (door_type_it != edge.params.end())
-  {
-    const double DEG2RAD = M_PI / 180.0;
-
-    const std::string &door_type = door_type_it->second.value_string;
-    if (door_type == "hinged")
-    {
-      const double hinge_x = door_axis == "start" ? v_start.x : v_end.x;
-      const double hinge_y = door_axis == "start" ? v_start.y : v_end.y;
-      const double angle_offset = door_axis == "start" ? 0.0 : M_PI;
-      
-      add_door_swing_path(
-          door_motion_path,
-          hinge_x,
-          hinge_y,
-          door_length,
-          door_angle + angle_offset,
-          door_angle + angle_offset + DEG2RAD * motion_dir * motion_degrees);
-    }
-    else if (door_type == "double_hinged")
-    {
-      // each door section is half as long as door_length
-      add_door_swing_path(
-          door_motion_path,
-          v_start.x,
-          v_start.y,
-          door_length / 2,
-          door_angle,
-          door_angle + DEG2RAD * motion_dir * motion_degrees);
-
-      add_door_swing_path(
-          door_motion_path,
-          v_end.x,
-          v_end.y,
-          door_length / 2,
-          door_angle + M_PI,
-          door_angle + M_PI - DEG2RAD * motion_dir * motion_degrees);
-    }
-    else if (door_type == "sliding")
-    {
-      add_door_slide_path(
-          door_motion_path,
-          v_start.x,
-          v_start.y,
-          door_length,
-          door_angle);
-    }
-    else if (door_type == "double_sliding")
-    {
-      // each door section is half as long as door_length
-      add_door_slide_path(
-          door_motion_path,
-          v_start.x,
-          v_start.y,
-          door_length / 2,
-          door_angle);
-      add_door_slide_path(
-          door_motion_path,
-          v_end.x,
-          v_end.y,
-          door_length / 2,
-          door_angle + M_PI);
-    }
-    else
-    {
-      printf("tried to draw unknown door type: [%s]\n", door_type.c_str());
-    }
-  }
-  scene->addPath(
-      door_motion_path,
-      QPen(Qt::black, door_motion_thickness / drawing_meters_per_pixel));
-}
-
-void Level::add_door_slide_path(
-    QPainterPath &path,
-    double hinge_x,
-    double hinge_y,
-    double door_length,
-    double door_angle) const
-{
-  // first draw the door as a thin line
-  path.moveTo(hinge_x, hinge_y);
-  path.lineTo(
-      hinge_x + door_length * cos(door_angle),
-      hinge_y + door_length * sin(door_angle));
-
-  // now draw a box around where it slides (in the wall, usually)
-  const double th = door_angle;  // makes expressions below single-line...
-  const double pi_2 = M_PI / 2.0;
-  const double s = 0.15 / drawing_meters_per_pixel;  // sliding panel thickness
-
-  const QPointF p1(
-      hinge_x - s * cos(th + pi_2),
-      hinge_y - s * sin(th + pi_2));
-
-  const QPointF p2(
-      hinge_x - s * cos(th + pi_2) - door_length * cos(th),
-      hinge_y - s * sin(th + pi_2) - door_length * sin(th));
-
-  const QPointF p3(
-      hinge_x + s * cos(th + pi_2) - door_length * cos(th),
-      hinge_y + s * sin(th + pi_2) - door_length * sin(th));
-
-  const QPointF p4(
-      hinge_x + s * cos(th + pi_2),
-      hinge_y + s * sin(th + pi_2));
-
-
-  path.moveTo(p1);
-  path.lineTo(p2);
-  path.lineTo(p3);
-  path.lineTo(p4);
-  path.lineTo(p1);
+  if (selected)
+    return QBrush(QColor::fromRgbF(1.0, 0.0, 0.0, 0.5));
+  return QBrush(QColor::fromRgbF(1.0, 1.0, 0.5, 0.5));
 }
 
-void Level::add_door_swing_path(
-    QPainterPath &path,
-    double hinge_x,
-    double hinge_y,
-    double door_length,
-    double start_angle,
-    double end_angle) const
+QPolygonF Level::polygon_shape(const Polygon &polygon) const
 {
-  path.moveTo(hinge_x, hinge_y);
-  path.lineTo(
-      hinge_x + door_length * cos(start_angle),
-      hinge_y + door_length * sin(start_angle));
-
-  const int NUM_MOTION_STEPS = 10;
-  const double angle_inc = (end_angle - start_angle) / (NUM_MOTION_STEPS-1);
-  for (int i = 0; i < NUM_MOTION_STEPS; i++)
-  {
-    // compute door opening angle at this motion step
-    const double a = start_angle + i * angle_inc;
-
-    path.lineTo(
-        hinge_x + door_length * cos(a),
-        hinge_y + door_length * sin(a));
-  }
-
-  path.lineTo(hinge_x, hinge_y);
-}
-
-void Level::draw_edges(QGraphicsScene *scene) const
-{
-  for (const auto &edge : edges) {
-    switch (edge.type) {
-      case Edge::LANE: draw_lane(scene, edge); break;
-      case Edge::WALL: draw_wall(scene, edge); break;
-      case Edge::MEAS: draw_meas(scene, edge); break;
-      case Edge::DOOR: draw_door(scene, edge); break;
-      default:
-        printf("tried to draw unknown edge type: %d\n",
-            static_cast<int>(edge.type));
-        break;
-    }
+  QVector<QPointF> polygon_vertices;
+  for (const auto &vertex_idx: polygon.vertices) {
+    const Vertex &v = vertices[vertex_idx];
+    polygon_vertices.append(QPointF(v.x, v.y));
   }
+  return QPolygonF(polygon_vertices);
 }
 
-void Level::draw_vertices(QGraphicsScene *scene) const
+QGraphicsPolygonItem *Level::draw_polygon(
+    QGraphicsScene *scene,
+    const Polygon &polygon) const
 {
-  for (const auto &v : vertices)
-    v.draw(scene, drawing_meters_per_pixel);
+  return scene->addPolygon(
+      polygon_shape(polygon),
+      QPen(Qt::black),
+      polygon_brush(polygon.selected));
 }
 
 void Level::draw_polygons(QGraphicsScene *scene) const
 {
-  QBrush polygon_brush(QColor::fromRgbF(1.0, 1.0, 0.5, 0.5));
-  QBrush selected_polygon_brush(QColor::fromRgbF(1.0, 0.0, 0.0, 0.5));
-
-  for (const auto &polygon : polygons) {
-    // now draw the polygons
-    QVector<QPointF> polygon_vertices;
-    for (const auto &vertex_idx: polygon.vertices) {
-      const Vertex &v = vertices[vertex_idx];
-      polygon_vertices.append(QPointF(v.x, v.y));
-    }
-    scene->addPolygon(
-        QPolygonF(polygon_vertices),
-        QPen(Qt::black),
-        polygon.selected ? selected_polygon_brush : polygon_brush);
-  }
+  for (const auto &polygon : polygons)
+    draw_polygon(scene, polygon);
 }
@@ -19,15 +19,23 @@
 #define LEVEL_H
 
 #include <yaml-cpp/yaml.h>
+#include <memory>
 #include <string>
 
 #include "vertex.h"
+#include "chunked_vector.h"
+#include "drawing.h"
 #include "edge.h"
+#include "edge_layer.h"
+#include "job.h"
+#include "level_of_detail.h"
 #include "model.h"
 #include "polygon.h"
 
-#include <QPixmap>
-#include <QPainterPath>
+#include <QBrush>
+#include <QPolygonF>
+#include <QString>
+class QGraphicsPolygonItem;
 class QGraphicsScene;
 
 
@@ -45,19 +53,45 @@ public:
 
   double x_meters, y_meters;  // manually specified if no drawing supplied
 
-  std::vector<Vertex> vertices;
-  std::vector<Edge> edges;
-  std::vector<Model> models;
-  std::vector<Polygon> polygons;
-  QPixmap pixmap;
+  // copies of a level share whatever chunks of these haven't changed
+  ChunkedVector<Vertex> vertices;
+  ChunkedVector<Edge> edges;
+  ChunkedVector<Model> models;
+  ChunkedVector<Polygon> polygons;
+  std::shared_ptr<const Drawing> drawing;  // null if there is no drawing
 
   // temporary, just for debugging polygon edge projection...
   double polygon_edge_proj_x, polygon_edge_proj_y;
 
-  bool from_yaml(const std::string &name, const YAML::Node &data);
+  /// Relative drawing filenames are looked up in project_dir
+  bool from_yaml(
+      const std::string &name,
+      const YAML::Node &data,
+      const QString &project_dir = QString(),
+      JobProgress *progress = nullptr);
   YAML::Node to_yaml() const;
 
-  void delete_keypress();
+  /// Load drawing_filename (relative to project_dir), or size the level
+  /// from x_meters and y_meters if there is no drawing. from_yaml() does
+  /// this itself; other loaders call it once those fields are set.
+  bool load_drawing(
+      const QString &project_dir = QString(),
+      JobProgress *progress = nullptr);
+
+  /// Everything in to_yaml() except the vertices, edges, models and
+  /// polygons. Level::from_yaml() accepts this on its own.
+  YAML::Node header_to_yaml() const;
+
+  /// Remove the selected edges, and then the selected vertices that no
+  /// edge or polygon uses anymore, renumbering the references to the
+  /// vertices after them. Says what was removed (in descending order, as
+  /// the indices were before) and which edges and polygons now refer to
+  /// their vertices by other numbers.
+  void delete_keypress(
+      std::vector<int> &removed_edges,
+      std::vector<int> &removed_vertices,
+      std::vector<int> &renumbered_edges,
+      std::vector<int> &renumbered_polygons);
   void calculate_scale();
 
   void remove_polygon_vertex(const int polygon_idx, const int vertex_idx);
@@ -67,9 +101,20 @@ public:
       const double x,
       const double y);
 
-  void draw_edges(QGraphicsScene *scene) const;
-  void draw_vertices(QGraphicsScene *scene) const;
+  /// Group these edges into layers, one per edge type (and lane graph)
+  std::vector<std::shared_ptr<const EdgeLayer> > create_edge_layers(
+      const std::vector<int> &edge_indices,
+      const LevelOfDetail &lod) const;
+
+  void draw_edges(QGraphicsScene *scene, const LevelOfDetail &lod) const;
+  void draw_vertices(QGraphicsScene *scene, const LevelOfDetail &lod) const;
   void draw_polygons(QGraphicsScene *scene) const;
+  QGraphicsPolygonItem *draw_polygon(
+      QGraphicsScene *scene,
+      const Polygon &polygon) const;
+
+  QPolygonF polygon_shape(const Polygon &polygon) const;
+  static QBrush polygon_brush(const bool selected);
 
 private:
   double point_to_line_segment_distance(
@@ -82,30 +127,10 @@ private:
       double &x_proj,
       double &y_proj);
 
-  void draw_lane(QGraphicsScene *scene, const Edge &edge) const;
-  void draw_wall(QGraphicsScene *scene, const Edge &edge) const;
-  void draw_meas(QGraphicsScene *scene, const Edge &edge) const;
-  void draw_door(QGraphicsScene *scene, const Edge &edge) const;
-
   void load_yaml_edge_sequence(
       const YAML::Node &data,
       const char *sequence_name,
       const Edge::Type type);
-
-  void add_door_swing_path(
-      QPainterPath &path,
-      double hinge_x,
-      double hinge_y,
-      double door_length,
-      double start_angle,
-      double end_angle) const;
-
-  void add_door_slide_path(
-      QPainterPath &path,
-      double hinge_x,
-      double hinge_y,
-      double door_length,
-      double door_angle) const;
 };
 
 #endif
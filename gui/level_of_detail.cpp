@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QSettings>
+
+#include "level_of_detail.h"
+#include "preferences_keys.h"
+
+
+LevelOfDetail::LevelOfDetail()
+: min_arrow_pixels(8.0),
+  min_door_pixels(16.0),
+  min_label_pixels(6.0),
+  min_lane_pixels(4.0),
+  view_scale(1.0)
+{
+}
+
+void LevelOfDetail::load_settings()
+{
+  QSettings settings;
+  min_arrow_pixels = settings.value(
+      preferences_keys::lod_arrow_pixels, min_arrow_pixels).toDouble();
+  min_door_pixels = settings.value(
+      preferences_keys::lod_door_pixels, min_door_pixels).toDouble();
+  min_label_pixels = settings.value(
+      preferences_keys::lod_label_pixels, min_label_pixels).toDouble();
+  min_lane_pixels = settings.value(
+      preferences_keys::lod_lane_pixels, min_lane_pixels).toDouble();
+}
+
+bool LevelOfDetail::draw_arrows(const double arrow_spacing) const
+{
+  return arrow_spacing * view_scale >= min_arrow_pixels;
+}
+
+bool LevelOfDetail::draw_door_motion(const double door_length) const
+{
+  return door_length * view_scale >= min_door_pixels;
+}
+
+bool LevelOfDetail::draw_labels(const double label_height) const
+{
+  return label_height * view_scale >= min_label_pixels;
+}
+
+bool LevelOfDetail::thin_lanes(const double lane_width) const
+{
+  return lane_width * view_scale < min_lane_pixels;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef LEVEL_OF_DETAIL_H
+#define LEVEL_OF_DETAIL_H
+
+/*
+ * Decides which decorations are worth drawing at the current zoom.
+ * Everything is decided in screen space: a decoration is skipped when
+ * it would be smaller than a (user-configurable) number of pixels.
+ */
+
+
+class LevelOfDetail
+{
+public:
+  LevelOfDetail();
+
+  // thresholds, in screen pixels
+  double min_arrow_pixels;  // spacing between lane arrowheads
+  double min_door_pixels;  // length of a door
+  double min_label_pixels;  // height of a vertex label
+  double min_lane_pixels;  // width of a lane stroke
+
+  // screen pixels per scene unit; the layer items set this from the
+  // painter transform every time they are painted
+  double view_scale;
+
+  void load_settings();
+
+  bool draw_arrows(const double arrow_spacing) const;
+  bool draw_door_motion(const double door_length) const;
+  bool draw_labels(const double label_height) const;
+  bool thin_lanes(const double lane_width) const;
+};
+
+#endif
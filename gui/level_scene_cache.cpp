@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include "level_scene_cache.h"
+
+
+LevelSceneCache::LevelScene::LevelScene()
+: scene(nullptr),
+  thumbnail_generation(0)
+{
+}
+
+LevelSceneCache::LevelScene::~LevelScene()
+{
+  delete scene;
+}
+
+LevelSceneCache::LevelSceneCache()
+{
+  set_memory_budget(256);
+}
+
+LevelSceneCache::~LevelSceneCache()
+{
+}
+
+void LevelSceneCache::set_memory_budget(const int megabytes)
+{
+  // a budget of 0 turns the cache off: every insert() is dropped
+  scenes.setMaxCost(std::max(0, megabytes) * 1024);
+}
+
+void LevelSceneCache::clear()
+{
+  scenes.clear();
+}
+
+void LevelSceneCache::insert(
+    const int level_idx,
+    const Level &level,
+    LevelScene *level_scene)
+{
+  scenes.insert(level_idx, level_scene, estimate_kb(level));
+}
+
+LevelSceneCache::LevelScene *LevelSceneCache::take(const int level_idx)
+{
+  return scenes.take(level_idx);
+}
+
+int LevelSceneCache::estimate_kb(const Level &level)
+{
+  // Rough bytes per thing in a scene, counting the layer records, their
+  // spatial grid entries and labels, the QGraphicsItems of polygons and
+  // models, and the scene's index of those items. Drawings and model
+  // sprites are shared with their own caches, so they don't count here.
+  const std::size_t vertex_bytes = 100;
+  const std::size_t edge_bytes = 150;
+  const std::size_t polygon_bytes = 400;
+  const std::size_t model_bytes = 300;
+
+  std::size_t polygon_vertices = 0;
+  for (const Polygon &polygon : level.polygons)
+    polygon_vertices += polygon.vertices.size();
+
+  const std::size_t bytes =
+      level.vertices.size() * vertex_bytes +
+      level.edges.size() * edge_bytes +
+      level.polygons.size() * polygon_bytes +
+      polygon_vertices * sizeof(QPointF) +
+      level.models.size() * model_bytes;
+  return static_cast<int>(bytes / 1024) + 1;
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef LEVEL_SCENE_CACHE_H
+#define LEVEL_SCENE_CACHE_H
+
+/*
+ * The scenes of recently visited levels, so that switching back to one
+ * of them is a QGraphicsView::setScene() instead of a create_scene().
+ * The editor puts the scene of the level it leaves in here, and takes
+ * the scene of the level it goes to back out, so the scene on screen is
+ * never in the cache. Scenes are deleted, least recently used first,
+ * once their estimated memory use goes over the budget.
+ *
+ * Only the current level is ever edited, so a parked scene stays right
+ * until the whole map (or the way it is drawn) changes; the editor calls
+ * clear() then.
+ */
+
+#include <cstddef>
+#include <vector>
+
+#include <QCache>
+#include <QGraphicsPixmapItem>
+#include <QGraphicsScene>
+
+#include "level.h"
+
+
+class LevelSceneCache
+{
+public:
+  LevelSceneCache();
+  ~LevelSceneCache();
+
+  /// A parked scene, and what the editor needs to pick it up again
+  struct LevelScene
+  {
+    LevelScene();
+    ~LevelScene();  // deletes the scene, if it wasn't taken back out
+
+    QGraphicsScene *scene;
+    std::vector<QGraphicsPixmapItem *> model_pixmap_items;
+    int thumbnail_generation;  // see Editor::thumbnail_generation
+  };
+
+  void set_memory_budget(const int megabytes);
+  void clear();
+
+  /// Park the scene of a level. The cache owns it from now on, and may
+  /// delete it right away if it is bigger than the whole budget.
+  void insert(
+      const int level_idx,
+      const Level &level,
+      LevelScene *level_scene);
+
+  /// Take a level's scene back out, or null if it isn't here. The caller
+  /// owns the result.
+  LevelScene *take(const int level_idx);
+
+  /// Rough size of the scene of a level, in kilobytes
+  static int estimate_kb(const Level &level);
+
+private:
+  QCache<int, LevelScene> scenes;  // cost is in kilobytes
+};
+
+#endif
@@ -18,10 +18,12 @@
 #include <yaml-cpp/yaml.h>
 #include "./map.h"
 #include <iostream>
-#include <fstream>
+#include <sstream>
 
 #include <QFileInfo>
-#include <QDir>
+#include <QSaveFile>
+
+#include "binary_map.h"
 
 using std::string;
 using std::cout;
@@ -30,7 +32,8 @@ using std::endl;
 
 Map::Map()
 : building_name("building"),
-  changed(false)
+  changed(false),
+  snapshot_serial(0)
 {
 }
 
@@ -41,18 +44,18 @@ Map::~Map()
 /// Load a YAML file description of a traffic-editor map
 ///
 /// This function replaces the contents of this object with what is
-/// in the YAML file.
-void Map::load_yaml(const string &filename)
+/// in the YAML file. It doesn't touch anything outside of this object
+/// (not even the current directory), so it can run on a worker thread.
+void Map::load_yaml(const string &filename, JobProgress *progress)
 {
   // This function may throw exceptions. Caller should be ready for them!
+  if (progress)
+    progress->set_progress(0.0, "parsing");
   YAML::Node y = YAML::LoadFile(filename.c_str());
 
-  // change directory to the path of the file, so that we can correctly open
-  // relative paths recorded in the file
-  QString dir(QFileInfo(QString::fromStdString(filename)).absolutePath());
-  qDebug("changing directory to [%s]", qUtf8Printable(dir));
-  if (!QDir::setCurrent(dir))
-    throw std::runtime_error("couldn't change directory");
+  // relative paths recorded in the file are relative to the file
+  const QString dir(
+      QFileInfo(QString::fromStdString(filename)).absolutePath());
 
   if (y["building_name"])
     building_name = y["building_name"].as<string>();
@@ -62,38 +65,192 @@ void Map::load_yaml(const string &filename)
 
   const YAML::Node yl = y["levels"];
   levels.clear();
+  level_snapshots.clear();
 
+  const double num_levels = static_cast<double>(yl.size());
   for (YAML::const_iterator it = yl.begin(); it != yl.end(); ++it)
   {
+    const string level_name = it->first.as<string>();
+    if (progress) {
+      progress->check_cancelled();
+      progress->set_range(
+          levels.size() / num_levels,
+          (levels.size() + 1) / num_levels);
+      progress->set_progress(0.0, QString::fromStdString(level_name));
+    }
     Level l;
-    l.from_yaml(it->first.as<string>(), it->second);
+    l.from_yaml(level_name, it->second, dir, progress);
     levels.push_back(l);
   }
+  if (progress)
+    progress->set_range(0.0, 1.0);
   changed = false;
 }
 
-bool Map::save_yaml(const std::string &filename)
+void Map::load_binary(const string &filename, JobProgress *progress)
+{
+  // This function may throw exceptions, just like load_yaml()
+  const QString qfilename = QString::fromStdString(filename);
+  BinaryMap binary_map;
+  std::string error;
+  if (!binary_map.open(qfilename, error))
+    throw std::runtime_error(error);
+
+  const QString dir(QFileInfo(qfilename).absolutePath());
+  building_name = binary_map.get_string(binary_map.header().building_name);
+  levels.clear();
+  level_snapshots.clear();
+
+  const int num_levels = binary_map.num_levels();
+  levels.resize(num_levels);
+  for (int i = 0; i < num_levels; i++) {
+    if (progress) {
+      progress->check_cancelled();
+      progress->set_range(
+          static_cast<double>(i) / num_levels,
+          static_cast<double>(i + 1) / num_levels);
+    }
+    binary_map.to_level(i, levels[i], dir, progress);
+  }
+  if (progress)
+    progress->set_range(0.0, 1.0);
+  changed = false;
+}
+
+void Map::load(const string &filename, JobProgress *progress)
+{
+  if (BinaryMap::is_binary_filename(QString::fromStdString(filename)))
+    load_binary(filename, progress);
+  else
+    load_yaml(filename, progress);
+}
+
+bool Map::save_yaml(const std::string &filename, JobProgress *progress)
+{
+  if (!snapshot()->save_yaml(filename, progress))
+    return false;
+  changed = false;
+  return true;
+}
+
+void Map::level_changed(const int level_idx)
+{
+  if (level_idx >= 0 && level_idx < static_cast<int>(level_snapshots.size()))
+    level_snapshots[level_idx].reset();
+}
+
+void Map::notify(const MapChange &change)
+{
+  if (change.action == MapChange::RESET)
+    level_snapshots.clear();
+  else
+    level_changed(change.level_idx);
+  changed = true;
+  change_bus.post(change);
+}
+
+void Map::notify_range(
+    const MapChange::Action action,
+    const MapChange::Entity entity,
+    const int level_idx,
+    const int first_idx,
+    const int end_idx)
+{
+  MapChangeBus::Transaction transaction(change_bus);
+  for (int i = first_idx; i < end_idx; i++)
+    notify(MapChange(action, entity, level_idx, i));
+}
+
+std::shared_ptr<const MapSnapshot> Map::snapshot()
+{
+  // levels are only ever appended or all replaced at once, but be
+  // conservative if the count doesn't match
+  if (level_snapshots.size() != levels.size()) {
+    level_snapshots.clear();
+    level_snapshots.resize(levels.size());
+  }
+
+  std::shared_ptr<MapSnapshot> s = std::make_shared<MapSnapshot>();
+  s->building_name = building_name;
+  s->serial = ++snapshot_serial;
+  s->levels.reserve(levels.size());
+  for (size_t i = 0; i < levels.size(); i++) {
+    if (!level_snapshots[i])
+      level_snapshots[i] = std::make_shared<const Level>(levels[i]);
+    s->levels.push_back(level_snapshots[i]);
+  }
+  return s;
+}
+
+std::string MapSnapshot::to_yaml_string(JobProgress *progress) const
 {
-  printf("Map::save_yaml(%s)\n", filename.c_str());
   YAML::Node levels_node(YAML::NodeType::Map);
-  for (const auto &level : levels) {
-    levels_node[level.name] = level.to_yaml();
+  for (size_t i = 0; i < levels.size(); i++) {
+    if (progress) {
+      progress->check_cancelled();
+      progress->set_progress(
+          static_cast<double>(i) / levels.size(),
+          QString::fromStdString(levels[i]->name));
+    }
+    levels_node[levels[i]->name] = levels[i]->to_yaml();
   }
   YAML::Node y_top;
   y_top["building_name"] = building_name;
   y_top["levels"] = levels_node;
-  std::ofstream fout(filename);
-  fout << y_top << "\n";  // not sure why but std::endl doesn't work here
-  changed = false;
+  std::ostringstream out;
+  out << y_top << "\n";  // not sure why but std::endl doesn't work here
+  return out.str();
+}
+
+QByteArray MapSnapshot::to_file_data(
+    const QString &filename,
+    JobProgress *progress) const
+{
+  if (BinaryMap::is_binary_filename(filename))
+    return BinaryMap::write(*this, progress);
+  return QByteArray::fromStdString(to_yaml_string(progress));
+}
+
+bool MapSnapshot::write_file(
+    const std::string &filename,
+    const QByteArray &data)
+{
+  // QSaveFile writes to a temporary file and renames it over the old
+  // one, so an interrupted save can't leave half a file behind
+  QSaveFile file(QString::fromStdString(filename));
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(data) != data.size() ||
+      !file.commit()) {
+    qWarning("couldn't write %s: %s",
+        filename.c_str(),
+        qUtf8Printable(file.errorString()));
+    return false;
+  }
   return true;
 }
 
+bool MapSnapshot::save_yaml(
+    const std::string &filename,
+    JobProgress *progress) const
+{
+  printf("MapSnapshot::save_yaml(%s)\n", filename.c_str());
+  const QByteArray text = QByteArray::fromStdString(to_yaml_string(progress));
+  if (progress)
+    progress->set_progress(1.0, "writing");
+  return write_file(filename, text);
+}
+
 void Map::add_vertex(int level_index, double x, double y)
 {
   if (level_index >= static_cast<int>(levels.size()))
     return;
   levels[level_index].vertices.push_back(Vertex(x, y));
-  changed = true;
+  notify(
+      MapChange(
+          MapChange::ADDED,
+          MapChange::VERTEX,
+          level_index,
+          static_cast<int>(levels[level_index].vertices.size()) - 1));
 }
 
 int Map::find_nearest_vertex_index(
@@ -170,7 +327,12 @@ void Map::add_edge(
       static_cast<int>(edge_type));
   levels[level_index].edges.push_back(
       Edge(start_vertex_index, end_vertex_index, edge_type));
-  changed = true;
+  notify(
+      MapChange(
+          MapChange::ADDED,
+          MapChange::EDGE,
+          level_index,
+          static_cast<int>(levels[level_index].edges.size()) - 1));
 }
 
 void Map::delete_keypress(const int level_index)
@@ -179,8 +341,42 @@ void Map::delete_keypress(const int level_index)
     return;
 
   printf("Map::delete_keypress()\n");
-  levels[level_index].delete_keypress();
-  changed = true;
+
+  std::vector<int> removed_edges, removed_vertices;
+  std::vector<int> renumbered_edges, renumbered_polygons;
+  levels[level_index].delete_keypress(
+      removed_edges,
+      removed_vertices,
+      renumbered_edges,
+      renumbered_polygons);
+
+  // removals from the back, so each index is still right when it is
+  // removed, and then the renumbering, in the indices after them
+  MapChangeBus::Transaction transaction(change_bus);
+  for (const int idx : removed_edges)
+    notify(MapChange(MapChange::REMOVED, MapChange::EDGE, level_index, idx));
+  for (const int idx : removed_vertices) {
+    notify(
+        MapChange(MapChange::REMOVED, MapChange::VERTEX, level_index, idx));
+  }
+  for (const int idx : renumbered_edges) {
+    notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::EDGE,
+            level_index,
+            idx,
+            MapChange::VERTICES));
+  }
+  for (const int idx : renumbered_polygons) {
+    notify(
+        MapChange(
+            MapChange::MODIFIED,
+            MapChange::POLYGON,
+            level_index,
+            idx,
+            MapChange::VERTICES));
+  }
 }
 
 void Map::add_model(
@@ -197,7 +393,12 @@ void Map::add_model(
       level_idx, x, y, yaw, model_name.c_str());
   levels[level_idx].models.push_back(
       Model(x, y, yaw, model_name, model_name));
-  changed = true;
+  notify(
+      MapChange(
+          MapChange::ADDED,
+          MapChange::MODEL,
+          level_idx,
+          static_cast<int>(levels[level_idx].models.size()) - 1));
 }
 
 void Map::rotate_model(
@@ -213,7 +414,13 @@ void Map::rotate_model(
   const double dx = release_x - model.x;
   const double dy = -(release_y - model.y);  // vertical axis is flipped
   model.yaw = atan2(dy, dx);
-  changed = true;
+  notify(
+      MapChange(
+          MapChange::MODIFIED,
+          MapChange::MODEL,
+          level_idx,
+          model_idx,
+          MapChange::POSITION));
 }
 
 void Map::remove_polygon_vertex(
@@ -224,7 +431,13 @@ void Map::remove_polygon_vertex(
   if (level_idx < 0 || level_idx > static_cast<int>(levels.size()))
     return;  // oh no
   levels[level_idx].remove_polygon_vertex(polygon_idx, vertex_idx);
-  changed = true;
+  notify(
+      MapChange(
+          MapChange::MODIFIED,
+          MapChange::POLYGON,
+          level_idx,
+          polygon_idx,
+          MapChange::VERTICES));
 }
 
 int Map::polygon_edge_drag_press(
@@ -240,9 +453,23 @@ int Map::polygon_edge_drag_press(
 
 void Map::clear()
 {
-  changed = true;
   building_name = "";
   levels.clear();
+  notify(MapChange(MapChange::RESET, MapChange::LEVEL, -1, -1));
+}
+
+void Map::swap(Map &other)
+{
+  std::swap(building_name, other.building_name);
+  std::swap(changed, other.changed);
+  levels.swap(other.levels);
+  level_snapshots.swap(other.level_snapshots);
+  std::swap(snapshot_serial, other.snapshot_serial);
+
+  // the subscribers stay with the Map they subscribed to
+  const MapChange reset(MapChange::RESET, MapChange::LEVEL, -1, -1);
+  change_bus.post(reset);
+  other.change_bus.post(reset);
 }
 
 void Map::add_level(const Level &new_level)
@@ -251,6 +478,11 @@ void Map::add_level(const Level &new_level)
   for (const auto &level : levels)
     if (level.name == new_level.name)
       return;
-  changed = true;
   levels.push_back(new_level);
+  notify(
+      MapChange(
+          MapChange::ADDED,
+          MapChange::LEVEL,
+          static_cast<int>(levels.size()) - 1,
+          -1));
 }
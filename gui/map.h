@@ -18,10 +18,47 @@
 #ifndef NAV_MAP_H
 #define NAV_MAP_H
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include <QByteArray>
+#include <QString>
+
+#include "job.h"
 #include "level.h"
+#include "map_change_bus.h"
+
+
+/// A read-only copy of a Map, for reading on other threads while the Map
+/// itself is edited. Levels that didn't change between two snapshots are
+/// shared by them, and so are the unchanged chunks of the ones that did;
+/// see Map::snapshot().
+class MapSnapshot
+{
+public:
+  MapSnapshot() : serial(0) {}
+
+  std::string building_name;
+  std::vector<std::shared_ptr<const Level> > levels;
+  uint64_t serial;  // later snapshots of the same Map have bigger ones
+
+  std::string to_yaml_string(JobProgress *progress = nullptr) const;
+  bool save_yaml(
+      const std::string &filename,
+      JobProgress *progress = nullptr) const;
+
+  /// The file contents for this snapshot: binary if the filename says
+  /// so (see BinaryMap), YAML otherwise
+  QByteArray to_file_data(
+      const QString &filename,
+      JobProgress *progress = nullptr) const;
+
+  /// Replace the file with this data through a temporary file, so that
+  /// it is never left half-written
+  static bool write_file(const std::string &filename, const QByteArray &data);
+};
 
 
 class Map
@@ -30,14 +67,54 @@ public:
   Map();
   ~Map();
 
-  void load_yaml(const std::string &filename);
-  bool save_yaml(const std::string &filename);
+  // progress, if given, is used to report progress and to cancel
+  void load_yaml(const std::string &filename, JobProgress *progress = nullptr);
+  void load_binary(
+      const std::string &filename,
+      JobProgress *progress = nullptr);
+
+  /// load_binary() or load_yaml(), going by the filename
+  void load(const std::string &filename, JobProgress *progress = nullptr);
+  bool save_yaml(const std::string &filename, JobProgress *progress = nullptr);
   void clear();  // clear all internal data structures
 
+  /// Exchange contents (including cached snapshots) with another Map
+  void swap(Map &other);
+
+  /// Take a snapshot. Levels that haven't changed since the previous one
+  /// are shared with it, and the others only copy their chunk pointers
+  /// (see ChunkedVector): the cost is in proportion to the number of
+  /// chunks, not of vertices, edges, models and polygons.
+  std::shared_ptr<const MapSnapshot> snapshot();
+
+  /// The serial that the next snapshot() will have
+  uint64_t next_snapshot_serial() const { return snapshot_serial + 1; }
+
+  /// Drop the cached copy of a level, so the next snapshot copies it
+  /// again. notify() calls this itself.
+  void level_changed(const int level_idx);
+
+  /// Post a change to the subscribers of change_bus, and mark the map
+  /// (and the level) changed. The Map methods below call this
+  /// themselves; code that edits 'levels' directly has to call it too.
+  void notify(const MapChange &change);
+
+  /// notify() of the things with indices in [first_idx, end_idx), in
+  /// one transaction
+  void notify_range(
+      const MapChange::Action action,
+      const MapChange::Entity entity,
+      const int level_idx,
+      const int first_idx,
+      const int end_idx);
+
   std::string building_name;
   std::vector<Level> levels;
   bool changed;  // true if map changed since last save/open
 
+  /// Not swapped or cleared with the rest; see swap() and clear()
+  MapChangeBus change_bus;
+
   void add_level(const Level &level);
 
   void add_vertex(int level_index, double x, double y);
@@ -84,6 +161,11 @@ public:
       const int polygon_idx,
       const double x,
       const double y);
+
+private:
+  // the levels of the previous snapshot, or null where they have changed
+  std::vector<std::shared_ptr<const Level> > level_snapshots;
+  uint64_t snapshot_serial;
 };
 
 #endif
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <climits>
+#include <cstddef>
+#include <map>
+#include <tuple>
+
+#include "map_change_bus.h"
+using std::vector;
+
+
+MapChange::MapChange()
+: action(MODIFIED),
+  entity(LEVEL),
+  level_idx(-1),
+  idx(-1),
+  fields(ALL_FIELDS)
+{
+}
+
+MapChange::MapChange(
+    const Action _action,
+    const Entity _entity,
+    const int _level_idx,
+    const int _idx,
+    const unsigned _fields)
+: action(_action),
+  entity(_entity),
+  level_idx(_level_idx),
+  idx(_idx),
+  fields(_fields)
+{
+}
+
+MapChangeBus::MapChangeBus()
+: next_subscriber_id(0),
+  transaction_depth(0)
+{
+}
+
+MapChangeBus::~MapChangeBus()
+{
+}
+
+int MapChangeBus::subscribe(const Callback &callback)
+{
+  Subscriber subscriber;
+  subscriber.id = next_subscriber_id++;
+  subscriber.callback = callback;
+  subscribers.push_back(subscriber);
+  return subscriber.id;
+}
+
+void MapChangeBus::unsubscribe(const int subscriber_id)
+{
+  for (size_t i = 0; i < subscribers.size(); i++) {
+    if (subscribers[i].id == subscriber_id) {
+      subscribers.erase(subscribers.begin() + i);
+      return;
+    }
+  }
+}
+
+void MapChangeBus::post(const MapChange &change)
+{
+  if (transaction_depth > 0) {
+    pending.push_back(change);
+    return;
+  }
+  deliver(vector<MapChange>(1, change));
+}
+
+void MapChangeBus::begin_transaction()
+{
+  transaction_depth++;
+}
+
+void MapChangeBus::end_transaction()
+{
+  if (transaction_depth <= 0 || --transaction_depth > 0)
+    return;
+  if (pending.empty())
+    return;
+  vector<MapChange> changes;
+  changes.swap(pending);
+  coalesce(changes);
+  deliver(changes);
+}
+
+void MapChangeBus::deliver(const vector<MapChange> &changes)
+{
+  // a copy, in case a subscriber comes or goes while this is going on
+  const vector<Subscriber> current_subscribers(subscribers);
+  for (const Subscriber &subscriber : current_subscribers)
+    subscriber.callback(changes);
+}
+
+void MapChangeBus::coalesce(vector<MapChange> &changes)
+{
+  // Where the last change of each thing is in 'merged', for as long as
+  // its index can't have shifted since. Ordered, so that the things
+  // after an index can be forgotten in one go.
+  typedef std::tuple<int, int, int> Key;  // level, entity, index
+  std::map<Key, size_t> latest;
+
+  vector<MapChange> merged;
+  merged.reserve(changes.size());
+  for (const MapChange &change : changes) {
+    if (change.action == MapChange::RESET) {
+      // nothing from before it matters anymore
+      merged.clear();
+      latest.clear();
+      merged.push_back(change);
+      continue;
+    }
+
+    const Key key(change.level_idx, change.entity, change.idx);
+    if (change.action == MapChange::MODIFIED) {
+      auto it = latest.find(key);
+      if (it == latest.end()) {
+        latest[key] = merged.size();
+        merged.push_back(change);
+      }
+      else if (merged[it->second].action == MapChange::MODIFIED)
+        merged[it->second].fields |= change.fields;
+      // else it was added in this batch, which covers every field
+      continue;
+    }
+
+    // adding or removing moves whatever comes after it
+    if (change.entity == MapChange::LEVEL) {
+      latest.erase(
+          latest.lower_bound(Key(change.level_idx, INT_MIN, INT_MIN)),
+          latest.end());
+    }
+    else {
+      latest.erase(
+          latest.lower_bound(key),
+          latest.upper_bound(
+              Key(change.level_idx, change.entity, INT_MAX)));
+    }
+    if (change.action == MapChange::ADDED)
+      latest[key] = merged.size();
+    merged.push_back(change);
+  }
+  changes.swap(merged);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef MAP_CHANGE_BUS_H
+#define MAP_CHANGE_BUS_H
+
+/*
+ * Tells whoever is interested what changed in a Map, so that caches,
+ * scenes and exports can redo only what an edit touched instead of
+ * assuming that everything did.
+ *
+ * Each MapChange names one thing on one level, by its index in that
+ * level's vector at the time of the change, and says whether it was
+ * added, removed or modified (and which fields). Removals shift the
+ * indices after them, so changes have to be applied in order.
+ *
+ * Changes posted inside a transaction are held back until the outermost
+ * one ends, and then delivered as one batch, coalesced: repeated
+ * modifications of the same thing become one with all of their fields,
+ * and modifications of something added in the same batch are dropped.
+ *
+ * Levels are copied into snapshots and handed to other threads, so the
+ * bus belongs to the Map, and each change says which level it is on.
+ */
+
+#include <functional>
+#include <vector>
+
+
+struct MapChange
+{
+  enum Action {
+    ADDED = 0,
+    REMOVED,
+    MODIFIED,
+    RESET  // the whole map was replaced; forget everything
+  };
+
+  enum Entity {
+    LEVEL = 0,
+    VERTEX,
+    EDGE,
+    MODEL,
+    POLYGON
+  };
+
+  /// What was modified; anything added or removed has all of them
+  enum Field {
+    POSITION = 1 << 0,  // x and y, and the yaw of models
+    NAME = 1 << 1,
+    PARAMS = 1 << 2,
+    TYPE = 1 << 3,  // edge type, or lane graph
+    VERTICES = 1 << 4,  // the vertices of an edge or polygon
+    ALL_FIELDS = 0xffff
+  };
+
+  Action action;
+  Entity entity;
+  int level_idx;  // -1 for RESET
+  int idx;  // in the level's vector of that entity, or -1 for LEVEL
+  unsigned fields;  // a combination of Field
+
+  MapChange();
+  MapChange(
+      const Action _action,
+      const Entity _entity,
+      const int _level_idx,
+      const int _idx,
+      const unsigned _fields = ALL_FIELDS);
+};
+
+
+class MapChangeBus
+{
+public:
+  MapChangeBus();
+  ~MapChangeBus();
+
+  typedef std::function<void (const std::vector<MapChange> &)> Callback;
+
+  /// Returns an ID for unsubscribe()
+  int subscribe(const Callback &callback);
+  void unsubscribe(const int subscriber_id);
+
+  /// Deliver a change now, or at the end of the current transaction
+  void post(const MapChange &change);
+
+  /// Transactions can nest; only the outermost one delivers
+  void begin_transaction();
+  void end_transaction();
+  bool in_transaction() const { return transaction_depth > 0; }
+
+  /// Holds back the changes until it goes out of scope
+  class Transaction
+  {
+  public:
+    Transaction(MapChangeBus &_bus) : bus(_bus) { bus.begin_transaction(); }
+    ~Transaction() { bus.end_transaction(); }
+
+  private:
+    MapChangeBus &bus;
+  };
+
+  /// Merge the changes that can be merged, keeping their order
+  static void coalesce(std::vector<MapChange> &changes);
+
+private:
+  struct Subscriber
+  {
+    int id;
+    Callback callback;
+  };
+
+  std::vector<Subscriber> subscribers;
+  int next_subscriber_id;
+  int transaction_depth;
+  std::vector<MapChange> pending;
+
+  void deliver(const std::vector<MapChange> &changes);
+};
+
+#endif
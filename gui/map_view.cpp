@@ -36,9 +36,9 @@ void MapView::wheelEvent(QWheelEvent *e)
 
   // scale things
   if (e->delta() > 0)
-    scale(1.1, 1.1);
+    zoom_by(1.1);
   else
-    scale(0.9, 0.9);
+    zoom_by(0.9);
 
   // calculate the mouse map position now that we've scaled
   const QPointF p_end = mapToScene(e->pos());
@@ -100,4 +100,22 @@ void MapView::zoom_fit(const Map &map, int level_index)
   //resetTransform();
   //fitInView(cx, cy, w, h, Qt::KeepAspectRatio);
   //centerOn(cx, cy);
+  emit zoom_changed(get_scale());
+}
+
+void MapView::zoom_by(const double factor)
+{
+  scale(factor, factor);
+  emit zoom_changed(get_scale());
+}
+
+void MapView::reset_zoom()
+{
+  resetMatrix();
+  emit zoom_changed(get_scale());
+}
+
+double MapView::get_scale() const
+{
+  return transform().m11();
 }
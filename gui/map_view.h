@@ -32,6 +32,18 @@ public:
   MapView(QWidget *parent = nullptr);
   void zoom_fit(const Map &map, int level_index);
 
+  /// Zoom by a relative factor, emitting zoom_changed()
+  void zoom_by(const double factor);
+
+  /// Go back to 1:1 zoom, emitting zoom_changed()
+  void reset_zoom();
+
+  /// Screen pixels per scene unit (drawing pixel)
+  double get_scale() const;
+
+signals:
+  void zoom_changed(double scale);
+
 protected:
   void wheelEvent(QWheelEvent *event);
   void mouseMoveEvent(QMouseEvent *e);
@@ -20,7 +20,7 @@ using std::string;
 
 
 Model::Model()
-: x(0), y(0), yaw(0), selected(false)
+: x(0), y(0), yaw(0), selected(false), model_id(-1)
 {
 }
 
@@ -33,7 +33,8 @@ Model::Model(
 : x(_x), y(_y), yaw(_yaw),
   model_name(_model_name),
   instance_name(_instance_name),
-  selected(false)
+  selected(false),
+  model_id(-1)
 {
 }
 
@@ -45,6 +46,7 @@ void Model::from_yaml(const YAML::Node &data)
   y = data["y"].as<double>();
   yaw = data["yaw"].as<double>();
   model_name = data["model_name"].as<string>();
+  model_id = -1;
   instance_name = data["name"].as<string>();
 }
 
@@ -39,6 +39,10 @@ public:
   std::string instance_name;
   bool selected;  // only for visualization, not saved to YAML
 
+  // index into the ModelCatalog, resolved lazily from model_name.
+  // Not saved to YAML; -1 means "not resolved yet".
+  int model_id;
+
   Model();
   Model(
       const double _x,
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include "fuzzy_match.h"
+#include "model_catalog.h"
+using std::string;
+using std::vector;
+
+
+ModelCatalog::ModelCatalog()
+{
+}
+
+ModelCatalog::~ModelCatalog()
+{
+}
+
+void ModelCatalog::clear()
+{
+  models.clear();
+  masks.clear();
+  name_to_id.clear();
+}
+
+int ModelCatalog::add(const string &name, const double meters_per_pixel)
+{
+  auto it = name_to_id.find(name);
+  if (it != name_to_id.end())
+    return it->second;
+
+  const int id = static_cast<int>(models.size());
+  models.push_back(EditorModel(name, meters_per_pixel));
+  masks.push_back(FuzzyMatch::char_mask(models.back().name_lowercase));
+  name_to_id[name] = id;
+  return id;
+}
+
+int ModelCatalog::find_id(const string &name) const
+{
+  auto it = name_to_id.find(name);
+  if (it == name_to_id.end())
+    return -1;
+  return it->second;
+}
+
+vector<int> ModelCatalog::fuzzy_search(
+    const string &query,
+    const size_t max_results) const
+{
+  const string query_lower(FuzzyMatch::to_lowercase(query));
+  const uint64_t query_mask = FuzzyMatch::char_mask(query_lower);
+
+  vector<std::pair<int, int> > scored;  // (score, id)
+  for (size_t i = 0; i < models.size(); i++) {
+    if ((masks[i] & query_mask) != query_mask)
+      continue;  // candidate lacks at least one query character
+    const int score =
+        FuzzyMatch::score(query_lower, models[i].name_lowercase);
+    if (score >= 0)
+      scored.push_back(std::make_pair(score, static_cast<int>(i)));
+  }
+
+  // highest score first; ties are broken by catalog order
+  auto better = [](const std::pair<int, int> &a, const std::pair<int, int> &b)
+  {
+    if (a.first != b.first)
+      return a.first > b.first;
+    return a.second < b.second;
+  };
+  const size_t n = std::min(max_results, scored.size());
+  std::partial_sort(scored.begin(), scored.begin() + n, scored.end(), better);
+
+  vector<int> ids;
+  ids.reserve(n);
+  for (size_t i = 0; i < n; i++)
+    ids.push_back(scored[i].second);
+  return ids;
+}
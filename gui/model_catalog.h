@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef MODEL_CATALOG_H
+#define MODEL_CATALOG_H
+
+/*
+ * The catalog of all model classes that can be placed on a map. Each
+ * model class gets a small integer ID (its index in the models vector),
+ * so that placed Model instances can refer to their class without
+ * re-matching strings every time the scene is drawn.
+ */
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "editor_model.h"
+
+
+class ModelCatalog
+{
+public:
+  ModelCatalog();
+  ~ModelCatalog();
+
+  std::vector<EditorModel> models;  // indexed by model ID
+
+  void clear();
+
+  /// Add a model class to the catalog and return its ID. If a model with
+  /// this name is already present, its existing ID is returned.
+  int add(const std::string &name, const double meters_per_pixel);
+
+  /// Return the ID of the model with this exact name, or -1 if not found
+  int find_id(const std::string &name) const;
+
+  /// Return the IDs of the models matching the query, best match first.
+  /// Matching is case-insensitive: prefixes rank above substrings, which
+  /// rank above scattered subsequences of the query characters.
+  std::vector<int> fuzzy_search(
+      const std::string &query,
+      const size_t max_results) const;
+
+private:
+  std::unordered_map<std::string, int> name_to_id;
+  std::vector<uint64_t> masks;  // parallel to models
+};
+
+#endif
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QIcon>
+
+#include "model_list_model.h"
+
+
+ModelListModel::ModelListModel(
+    const ModelCatalog &_catalog,
+    ThumbnailCache &_thumbnail_cache,
+    QObject *parent)
+: QAbstractListModel(parent),
+  catalog(_catalog),
+  thumbnail_cache(_thumbnail_cache)
+{
+  connect(
+      &thumbnail_cache, &ThumbnailCache::thumbnail_loaded,
+      this, &ModelListModel::thumbnail_loaded);
+}
+
+ModelListModel::~ModelListModel()
+{
+}
+
+int ModelListModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+    return 0;  // this is a flat list
+  return static_cast<int>(catalog.models.size());
+}
+
+QVariant ModelListModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+
+  const int model_id = index.row();
+  if (role == Qt::DisplayRole || role == Qt::ToolTipRole)
+    return QString::fromStdString(catalog.models[model_id].name);
+  else if (role == Qt::DecorationRole)
+    return QIcon(thumbnail_cache.icon(model_id));
+  return QVariant();
+}
+
+void ModelListModel::reset()
+{
+  beginResetModel();
+  endResetModel();
+}
+
+void ModelListModel::thumbnail_loaded(int model_id)
+{
+  if (model_id < 0 || model_id >= rowCount())
+    return;
+  const QModelIndex idx = index(model_id);
+  emit dataChanged(idx, idx, { Qt::DecorationRole });
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef MODEL_LIST_MODEL_H
+#define MODEL_LIST_MODEL_H
+
+/*
+ * Exposes the ModelCatalog to a QListView. Row N is model ID N. The view
+ * only asks for the rows it is currently showing (it uses uniform item
+ * sizes), so only the visible thumbnails are ever requested for decoding.
+ */
+
+#include <QAbstractListModel>
+
+#include "model_catalog.h"
+#include "thumbnail_cache.h"
+
+
+class ModelListModel : public QAbstractListModel
+{
+  Q_OBJECT
+
+public:
+  ModelListModel(
+      const ModelCatalog &_catalog,
+      ThumbnailCache &_thumbnail_cache,
+      QObject *parent = nullptr);
+  ~ModelListModel();
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role) const override;
+
+  /// Call after the catalog has been re-populated
+  void reset();
+
+private:
+  const ModelCatalog &catalog;
+  ThumbnailCache &thumbnail_cache;
+
+  void thumbnail_loaded(int model_id);
+};
+
+#endif
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "model_sprite_cache.h"
+
+const int ModelSpriteCache::MAX_MIP_LEVEL;
+
+
+ModelSpriteCache::ModelSpriteCache(ThumbnailCache &_thumbnail_cache)
+: thumbnail_cache(_thumbnail_cache)
+{
+  set_memory_budget(128);
+}
+
+ModelSpriteCache::~ModelSpriteCache()
+{
+}
+
+void ModelSpriteCache::set_memory_budget(const int megabytes)
+{
+  sprites.setMaxCost(std::max(1, megabytes) * 1024);
+}
+
+void ModelSpriteCache::clear()
+{
+  sprites.clear();
+}
+
+qint64 ModelSpriteCache::key(const int model_id, const int level)
+{
+  return (static_cast<qint64>(model_id) << 8) | level;
+}
+
+int ModelSpriteCache::mip_level(const double device_scale)
+{
+  if (device_scale >= 1.0 || device_scale <= 0.0)
+    return 0;
+  const int level = static_cast<int>(std::floor(std::log2(1.0 / device_scale)));
+  return std::min(std::max(level, 0), MAX_MIP_LEVEL);
+}
+
+QPixmap ModelSpriteCache::sprite(
+    const int model_id,
+    const int requested_level,
+    int &level)
+{
+  level = 0;
+  if (!thumbnail_cache.is_loaded(model_id) || requested_level <= 0)
+    return thumbnail_cache.pixmap(model_id);  // may be the placeholder
+
+  const QPixmap *cached = sprites.object(key(model_id, requested_level));
+  if (cached) {
+    level = requested_level;
+    return *cached;
+  }
+
+  // build the chain down from the largest level we have, halving each
+  // time so that every level is a proper box-filtered version of the
+  // one above it
+  QPixmap source = thumbnail_cache.pixmap(model_id);
+  int source_level = 0;
+  for (int l = requested_level - 1; l > 0; l--) {
+    const QPixmap *p = sprites.object(key(model_id, l));
+    if (p) {
+      source = *p;
+      source_level = l;
+      break;
+    }
+  }
+
+  while (source_level < requested_level) {
+    if (source.width() < 8 || source.height() < 8)
+      break;  // no point in going smaller than this
+    source = source.scaled(
+        source.width() / 2,
+        source.height() / 2,
+        Qt::IgnoreAspectRatio,
+        Qt::SmoothTransformation);
+    source_level++;
+    const int cost_kb = std::max(
+        1,
+        source.width() * source.height() * std::max(8, source.depth()) / 8192);
+    sprites.insert(
+        key(model_id, source_level),
+        new QPixmap(source),
+        std::min(cost_kb, sprites.maxCost()));
+  }
+
+  level = source_level;
+  return source;
+}
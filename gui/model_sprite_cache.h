@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef MODEL_SPRITE_CACHE_H
+#define MODEL_SPRITE_CACHE_H
+
+/*
+ * Mipmapped copies of the model thumbnails. Mip level N is the thumbnail
+ * downsampled by 2^N, so when the map is zoomed out the scene only has
+ * to draw a sprite that is already close to its on-screen size, rather
+ * than resampling the full-resolution thumbnail on every paint.
+ */
+
+#include <QCache>
+#include <QPixmap>
+
+#include "thumbnail_cache.h"
+
+
+class ModelSpriteCache
+{
+public:
+  ModelSpriteCache(ThumbnailCache &_thumbnail_cache);
+  ~ModelSpriteCache();
+
+  static const int MAX_MIP_LEVEL = 8;
+
+  void set_memory_budget(const int megabytes);
+  void clear();
+
+  /// Pick the mip level for a thumbnail drawn at device_scale screen
+  /// pixels per thumbnail pixel: the smallest sprite that is still at
+  /// least as big as it will appear on screen.
+  static int mip_level(const double device_scale);
+
+  /// Return the sprite of this model for the requested mip level. The
+  /// level actually used is written to 'level': it is 0 if the thumbnail
+  /// is still loading (the placeholder is returned) or if the thumbnail
+  /// is too small to be downsampled that far.
+  QPixmap sprite(const int model_id, const int requested_level, int &level);
+
+private:
+  ThumbnailCache &thumbnail_cache;
+  QCache<qint64, QPixmap> sprites;  // cost is in kilobytes
+
+  static qint64 key(const int model_id, const int level);
+};
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <utility>
+
+#include "fuzzy_match.h"
+#include "name_index.h"
+using std::string;
+using std::vector;
+
+
+static bool entry_less(const NameIndex::Entry &a, const NameIndex::Entry &b)
+{
+  if (a.key != b.key)
+    return a.key < b.key;
+  if (a.level_idx != b.level_idx)
+    return a.level_idx < b.level_idx;
+  if (a.kind != b.kind)
+    return a.kind < b.kind;
+  return a.idx < b.idx;
+}
+
+NameIndex::NameIndex()
+: num_levels(-1)
+{
+}
+
+NameIndex::~NameIndex()
+{
+}
+
+void NameIndex::clear()
+{
+  entries.clear();
+  letters.clear();
+  num_levels = -1;
+}
+
+const char *NameIndex::kind_name(const Kind kind)
+{
+  switch (kind) {
+    case VERTEX_NAME: return "vertex";
+    case WORKCELL_NAME: return "workcell";
+    case DOOR_NAME: return "door";
+    case MODEL_NAME: return "model";
+    default: return "unknown";
+  }
+}
+
+void NameIndex::add_entry(
+    vector<Entry> &level_entries,
+    const string &name,
+    const int level_idx,
+    const Kind kind,
+    const int idx)
+{
+  if (name.empty())
+    return;
+  Entry entry;
+  entry.name = name;
+  entry.key = FuzzyMatch::to_lowercase(name);
+  entry.level_idx = level_idx;
+  entry.kind = kind;
+  entry.idx = idx;
+  level_entries.push_back(entry);
+}
+
+void NameIndex::index_level(const Level &level, const int level_idx)
+{
+  entries.erase(
+      std::remove_if(
+          entries.begin(),
+          entries.end(),
+          [level_idx](const Entry &e) { return e.level_idx == level_idx; }),
+      entries.end());
+
+  vector<Entry> level_entries;
+  for (size_t i = 0; i < level.vertices.size(); i++) {
+    const Vertex &vertex = level.vertices[i];
+    const int idx = static_cast<int>(i);
+    add_entry(level_entries, vertex.name, level_idx, VERTEX_NAME, idx);
+    const auto it = vertex.params.find("workcell_name");
+    if (it != vertex.params.end()) {
+      const string &name = it->second.value_string;
+      add_entry(level_entries, name, level_idx, WORKCELL_NAME, idx);
+    }
+  }
+  for (size_t i = 0; i < level.edges.size(); i++) {
+    const Edge &edge = level.edges[i];
+    if (edge.type != Edge::DOOR)
+      continue;
+    const auto it = edge.params.find("name");
+    if (it != edge.params.end()) {
+      const string &name = it->second.value_string;
+      add_entry(
+          level_entries, name, level_idx, DOOR_NAME, static_cast<int>(i));
+    }
+  }
+  for (size_t i = 0; i < level.models.size(); i++) {
+    const string &name = level.models[i].instance_name;
+    add_entry(level_entries, name, level_idx, MODEL_NAME, static_cast<int>(i));
+  }
+
+  // the rest are still sorted, so this is a merge rather than a sort
+  std::sort(level_entries.begin(), level_entries.end(), entry_less);
+  const size_t num_kept = entries.size();
+  entries.insert(
+      entries.end(),
+      std::make_move_iterator(level_entries.begin()),
+      std::make_move_iterator(level_entries.end()));
+  std::inplace_merge(
+      entries.begin(),
+      entries.begin() + num_kept,
+      entries.end(),
+      entry_less);
+
+  letters.resize(entries.size());
+  for (size_t i = 0; i < entries.size(); i++)
+    letters[i] = FuzzyMatch::char_mask(entries[i].key);
+}
+
+void NameIndex::update(const Map &map, const int level_idx)
+{
+  const int map_levels = static_cast<int>(map.levels.size());
+  if (num_levels != map_levels) {
+    entries.clear();
+    for (int i = 0; i < map_levels; i++)
+      index_level(map.levels[i], i);
+    num_levels = map_levels;
+  }
+  else if (level_idx >= 0 && level_idx < map_levels)
+    index_level(map.levels[level_idx], level_idx);
+}
+
+void NameIndex::find(
+    const string &query,
+    const int max_results,
+    vector<const Entry *> &results) const
+{
+  results.clear();
+  const string q = FuzzyMatch::to_lowercase(query);
+  if (q.empty() || max_results <= 0)
+    return;
+
+  auto starts_with_query = [&q](const Entry &e) {
+    return e.key.compare(0, q.size(), q) == 0;
+  };
+
+  // the prefix matches are next to each other, in order
+  auto it = std::lower_bound(
+      entries.begin(),
+      entries.end(),
+      q,
+      [](const Entry &e, const string &key) { return e.key < key; });
+  for (; it != entries.end() && starts_with_query(*it); ++it) {
+    if (static_cast<int>(results.size()) >= max_results)
+      return;
+    results.push_back(&*it);
+  }
+
+  // (negated score, position) of the fuzzy matches, so the best sort first
+  const uint64_t q_letters = FuzzyMatch::char_mask(q);
+  vector<std::pair<int, size_t> > fuzzy;
+  for (size_t i = 0; i < entries.size(); i++) {
+    if ((letters[i] & q_letters) != q_letters)
+      continue;
+    const Entry &e = entries[i];
+    if (starts_with_query(e))
+      continue;
+    const int score = FuzzyMatch::score(q, e.key);
+    if (score >= 0)
+      fuzzy.push_back(std::make_pair(-score, i));
+  }
+  const size_t num_fuzzy = std::min(
+      fuzzy.size(),
+      static_cast<size_t>(max_results) - results.size());
+  std::partial_sort(fuzzy.begin(), fuzzy.begin() + num_fuzzy, fuzzy.end());
+  for (size_t i = 0; i < num_fuzzy; i++)
+    results.push_back(&entries[fuzzy[i].second]);
+}
+
+bool NameIndex::locate(
+    const Map &map,
+    const Entry &entry,
+    double &x,
+    double &y)
+{
+  if (entry.level_idx < 0 ||
+      entry.level_idx >= static_cast<int>(map.levels.size()))
+    return false;
+  const Level &level = map.levels[entry.level_idx];
+  const int num_vertices = static_cast<int>(level.vertices.size());
+
+  switch (entry.kind) {
+    case VERTEX_NAME:
+    case WORKCELL_NAME:
+      if (entry.idx < 0 || entry.idx >= num_vertices)
+        return false;
+      x = level.vertices[entry.idx].x;
+      y = level.vertices[entry.idx].y;
+      return true;
+
+    case DOOR_NAME: {
+      if (entry.idx < 0 || entry.idx >= static_cast<int>(level.edges.size()))
+        return false;
+      const Edge &edge = level.edges[entry.idx];
+      if (edge.start_idx < 0 || edge.start_idx >= num_vertices ||
+          edge.end_idx < 0 || edge.end_idx >= num_vertices)
+        return false;
+      // the middle of the doorway
+      x = (level.vertices[edge.start_idx].x + level.vertices[edge.end_idx].x)
+          / 2.0;
+      y = (level.vertices[edge.start_idx].y + level.vertices[edge.end_idx].y)
+          / 2.0;
+      return true;
+    }
+
+    case MODEL_NAME:
+      if (entry.idx < 0 || entry.idx >= static_cast<int>(level.models.size()))
+        return false;
+      x = level.models[entry.idx].x;
+      y = level.models[entry.idx].y;
+      return true;
+
+    default:
+      return false;
+  }
+}
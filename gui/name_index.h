@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+/*
+ * An index of the named things in the whole building, on every level:
+ * vertex names, workcell names (a vertex parameter), door names (a door
+ * edge parameter) and model instance names, for finding them by name
+ * instead of panning around.
+ *
+ * Names are kept in one array sorted by their lowercase form, so the
+ * names that start with a query are a binary search away. A query that
+ * doesn't prefix enough names is then matched fuzzily: its letters have
+ * to appear in the name in order, but not necessarily next to each
+ * other. A bitmask of the letters and digits in each name, kept in an
+ * array of its own, throws out most names without looking at them.
+ *
+ * update() re-indexes just the one level it is given, so the editor
+ * only has to call it for the levels that the Map's change bus says may
+ * have new names. All of them are indexed again when the number of
+ * levels changes.
+ */
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "map.h"
+
+
+class NameIndex
+{
+public:
+  NameIndex();
+  ~NameIndex();
+
+  enum Kind {
+    VERTEX_NAME = 0,
+    WORKCELL_NAME,
+    DOOR_NAME,
+    MODEL_NAME
+  };
+
+  struct Entry
+  {
+    std::string name;
+    std::string key;  // lowercase name
+    int level_idx;
+    Kind kind;
+    int idx;  // in the level's vertices, edges or models
+  };
+
+  /// Forget everything; the next update() indexes every level
+  void clear();
+
+  /// Index this level of the map again, or all of them if the number of
+  /// levels has changed since last time
+  void update(const Map &map, const int level_idx);
+
+  /// The best matches for a query (case doesn't matter): the names that
+  /// start with it, alphabetically, then the fuzzy matches, best first
+  void find(
+      const std::string &query,
+      const int max_results,
+      std::vector<const Entry *> &results) const;
+
+  /// Where this entry is on its level, if it is still there
+  static bool locate(
+      const Map &map,
+      const Entry &entry,
+      double &x,
+      double &y);
+
+  int size() const { return static_cast<int>(entries.size()); }
+
+  static const char *kind_name(const Kind kind);
+
+private:
+  std::vector<Entry> entries;  // sorted by key
+  std::vector<uint64_t> letters;  // FuzzyMatch::char_mask() of each key
+  int num_levels;  // that are indexed, or -1 if none are
+
+  void index_level(const Level &level, const int level_idx);
+  void add_entry(
+      std::vector<Entry> &level_entries,
+      const std::string &name,
+      const int level_idx,
+      const Kind kind,
+      const int idx);
+};
+
+#endif
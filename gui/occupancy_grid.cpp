@@ -0,0 +1,500 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <QFileInfo>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+
+#include "occupancy_grid.h"
+using std::vector;
+
+
+/*
+ * Worker-thread half of write(). Each task renders one block into its
+ * own columns of the band buffers, so they don't need any locking.
+ */
+class OccupancyBlockTask : public QRunnable
+{
+public:
+  OccupancyBlockTask(
+      const OccupancyGrid *_grid,
+      const QRect &_cells,
+      const double _inflation_cells,
+      uchar *_occupancy,
+      uchar *_inflation,
+      const int _stride)
+  : grid(_grid),
+    cells(_cells),
+    inflation_cells(_inflation_cells),
+    occupancy(_occupancy),
+    inflation(_inflation),
+    stride(_stride)
+  {
+  }
+
+  void run() override
+  {
+    grid->render_block(cells, inflation_cells, occupancy, inflation, stride);
+  }
+
+private:
+  const OccupancyGrid *grid;
+  const QRect cells;
+  const double inflation_cells;
+  uchar *occupancy;
+  uchar *inflation;
+  const int stride;
+};
+
+
+OccupancyGrid::OccupancyGrid(
+    const Level &level,
+    const double _resolution,
+    const double _wall_thickness)
+: resolution(_resolution),
+  grid_width(0),
+  grid_height(0),
+  background(FREE),
+  shape_grid(BLOCK_SIZE)
+{
+  if (!(resolution > 0.0))
+    throw std::runtime_error("occupancy grid resolution must be positive");
+
+  // vertices are in drawing pixels
+  const double scale = level.drawing_meters_per_pixel / resolution;
+  vector<QPointF> points;
+  points.reserve(level.vertices.size());
+  double w = level.x_meters / resolution;
+  double h = level.y_meters / resolution;
+  for (const Vertex &v : level.vertices) {
+    points.push_back(QPointF(v.x * scale, v.y * scale));
+    w = std::max(w, points.back().x());
+    h = std::max(h, points.back().y());
+  }
+  if (!(w < 1e6 && h < 1e6)) {
+    throw std::runtime_error(
+        "level " + level.name + " is too big for an occupancy grid at " +
+        std::to_string(resolution) + " m");
+  }
+  grid_width = std::max(1, static_cast<int>(std::ceil(w)));
+  grid_height = std::max(1, static_cast<int>(std::ceil(h)));
+
+  const int n = static_cast<int>(points.size());
+  for (const Polygon &polygon : level.polygons) {
+    if (polygon.type != Polygon::FLOOR)
+      continue;
+    vector<QPointF> floor;
+    for (const int idx : polygon.vertices) {
+      if (idx >= 0 && idx < n)
+        floor.push_back(points[idx]);
+    }
+    add_shape(floor, FREE);
+    background = UNKNOWN;  // only floors are known to be free
+  }
+
+  // At least two cells thick, so that diagonal walls have no gaps that
+  // a planner moving diagonally could slip through. Walls are extended
+  // by half their thickness at the ends to close the corners; doors
+  // are a cell thicker, so they cut cleanly through the walls they
+  // sit in.
+  const double thickness = std::max(2.0, _wall_thickness / resolution);
+  for (int pass = 0; pass < 2; pass++) {
+    const Edge::Type type = pass == 0 ? Edge::WALL : Edge::DOOR;
+    for (const Edge &edge : level.edges) {
+      if (edge.type != type ||
+          edge.start_idx < 0 || edge.start_idx >= n ||
+          edge.end_idx < 0 || edge.end_idx >= n)
+        continue;
+      if (type == Edge::WALL) {
+        add_band(
+            points[edge.start_idx],
+            points[edge.end_idx],
+            thickness,
+            true,
+            OCCUPIED);
+      }
+      else {
+        add_band(
+            points[edge.start_idx],
+            points[edge.end_idx],
+            thickness + 1.0,
+            false,
+            FREE);
+      }
+    }
+  }
+}
+
+OccupancyGrid::~OccupancyGrid()
+{
+}
+
+void OccupancyGrid::add_shape(const vector<QPointF> &points, const uchar value)
+{
+  if (points.size() < 3)
+    return;
+  Shape shape;
+  shape.points = points;
+  shape.value = value;
+  double min_x = points[0].x(), max_x = min_x;
+  double min_y = points[0].y(), max_y = min_y;
+  for (const QPointF &p : points) {
+    min_x = std::min(min_x, p.x());
+    max_x = std::max(max_x, p.x());
+    min_y = std::min(min_y, p.y());
+    max_y = std::max(max_y, p.y());
+  }
+  shape.bounds = QRectF(min_x, min_y, max_x - min_x, max_y - min_y);
+  const int idx = static_cast<int>(shapes.size());
+  shape_grid.insert_box(idx, min_x, min_y, max_x, max_y);
+  shapes.push_back(shape);
+}
+
+void OccupancyGrid::add_band(
+    const QPointF &a,
+    const QPointF &b,
+    const double thickness,
+    const bool extend,
+    const uchar value)
+{
+  const double dx = b.x() - a.x();
+  const double dy = b.y() - a.y();
+  const double len = std::hypot(dx, dy);
+  if (len <= 0.0)
+    return;
+  const double r = thickness / 2.0;
+  const QPointF along(dx / len * r, dy / len * r);
+  const QPointF across(-along.y(), along.x());
+  const QPointF p0 = extend ? a - along : a;
+  const QPointF p1 = extend ? b + along : b;
+  add_shape({ p0 + across, p1 + across, p1 - across, p0 - across }, value);
+}
+
+void OccupancyGrid::fill(
+    const QRect &cells,
+    const Shape &shape,
+    uchar *out,
+    const int stride,
+    vector<double> &crossings) const
+{
+  // even-odd rule, sampled at the cell centers
+  const int y0 = std::max(
+      cells.y(), static_cast<int>(std::floor(shape.bounds.top())));
+  const int y1 = std::min(
+      cells.y() + cells.height(),
+      static_cast<int>(std::ceil(shape.bounds.bottom())) + 1);
+  const double left = cells.x();
+  const double right = cells.x() + cells.width();
+  const size_t n = shape.points.size();
+  for (int y = y0; y < y1; y++) {
+    const double yc = y + 0.5;
+    crossings.clear();
+    for (size_t i = 0, j = n - 1; i < n; j = i++) {
+      const QPointF &a = shape.points[i];
+      const QPointF &b = shape.points[j];
+      if ((a.y() <= yc) != (b.y() <= yc)) {
+        crossings.push_back(
+            a.x() + (yc - a.y()) * (b.x() - a.x()) / (b.y() - a.y()));
+      }
+    }
+    std::sort(crossings.begin(), crossings.end());
+
+    uchar *line = out + static_cast<size_t>(y - cells.y()) * stride;
+    for (size_t k = 0; k + 1 < crossings.size(); k += 2) {
+      // the cells whose centers are inside the span
+      const int x0 = static_cast<int>(std::ceil(
+          std::max(left, std::min(right, crossings[k] - 0.5))));
+      const int x1 = static_cast<int>(std::ceil(
+          std::max(left, std::min(right, crossings[k + 1] - 0.5))));
+      if (x1 > x0)
+        memset(line + (x0 - cells.x()), shape.value, x1 - x0);
+    }
+  }
+}
+
+void OccupancyGrid::render_block(
+    const QRect &cells,
+    const double inflation_cells,
+    uchar *occupancy,
+    uchar *inflation,
+    const int stride) const
+{
+  // the inflation of a cell depends on the walls within the radius, so
+  // those have to be rendered too
+  const int halo =
+      inflation ? static_cast<int>(std::ceil(inflation_cells)) : 0;
+  const QRect region = cells.adjusted(-halo, -halo, halo, halo) &
+      QRect(0, 0, grid_width, grid_height);
+  const int w = region.width();
+  vector<uchar> pixels(static_cast<size_t>(w) * region.height(), background);
+
+  vector<int> shape_indices;
+  shape_grid.query_box(
+      region.x(),
+      region.y(),
+      region.x() + w,
+      region.y() + region.height(),
+      shape_indices);
+  std::sort(shape_indices.begin(), shape_indices.end());  // drawing order
+  vector<double> crossings;
+  for (const int idx : shape_indices)
+    fill(region, shapes[idx], pixels.data(), w, crossings);
+
+  for (int y = 0; y < cells.height(); y++) {
+    memcpy(
+        occupancy + static_cast<size_t>(y) * stride,
+        &pixels[static_cast<size_t>(cells.y() - region.y() + y) * w +
+          (cells.x() - region.x())],
+        cells.width());
+  }
+
+  if (inflation)
+    inflate(region, pixels.data(), cells, inflation_cells, inflation, stride);
+}
+
+/// One dimension of the squared Euclidean distance transform of
+/// Felzenszwalb and Huttenlocher: d[q] = min over p of (q - p)^2 + f[p]
+static void distance_transform_1d(
+    const float *f,
+    const int n,
+    float *d,
+    int *v,
+    float *z)
+{
+  // the lower envelope of the parabolas rooted at each f[p]
+  auto intersection = [f](const int q, const int p) {
+    return ((f[q] + static_cast<float>(q) * q) -
+        (f[p] + static_cast<float>(p) * p)) / (2.0f * (q - p));
+  };
+  int k = 0;
+  v[0] = 0;
+  z[0] = -HUGE_VALF;
+  z[1] = HUGE_VALF;
+  for (int q = 1; q < n; q++) {
+    float s = intersection(q, v[k]);
+    while (s <= z[k]) {
+      k--;
+      s = intersection(q, v[k]);
+    }
+    k++;
+    v[k] = q;
+    z[k] = s;
+    z[k + 1] = HUGE_VALF;
+  }
+
+  k = 0;
+  for (int q = 0; q < n; q++) {
+    while (z[k + 1] < q)
+      k++;
+    const float dq = static_cast<float>(q - v[k]);
+    d[q] = dq * dq + f[v[k]];
+  }
+}
+
+void OccupancyGrid::inflate(
+    const QRect &region,
+    const uchar *occupancy,
+    const QRect &cells,
+    const double inflation_cells,
+    uchar *inflation,
+    const int stride)
+{
+  const int w = region.width();
+  const int h = region.height();
+  const size_t n = static_cast<size_t>(w) * h;
+
+  if (!memchr(occupancy, OCCUPIED, n)) {
+    // nothing within reach: all of it is clear
+    for (int y = 0; y < cells.height(); y++)
+      memset(inflation + static_cast<size_t>(y) * stride, FREE, cells.width());
+    return;
+  }
+
+  // Vertical distances first, capped just past the radius: one sweep
+  // down and one up the region, a whole row at a time so that the
+  // compiler can vectorize them.
+  const int reach = static_cast<int>(std::ceil(inflation_cells));
+  const int cap = reach + 1;
+  vector<int> vertical(n);
+  for (int y = 0; y < h; y++) {
+    const uchar *occupied = occupancy + static_cast<size_t>(y) * w;
+    int *row = &vertical[static_cast<size_t>(y) * w];
+    const int *above = y > 0 ? row - w : nullptr;
+    for (int x = 0; x < w; x++) {
+      const int from_above = above ? std::min(cap, above[x] + 1) : cap;
+      row[x] = occupied[x] == OCCUPIED ? 0 : from_above;
+    }
+  }
+  for (int y = h - 2; y >= 0; y--) {
+    int *row = &vertical[static_cast<size_t>(y) * w];
+    const int *below = row + w;
+    for (int x = 0; x < w; x++)
+      row[x] = std::min(row[x], below[x] + 1);
+  }
+
+  // then the exact distance along each row, which only the rows of
+  // 'cells' themselves need. Squared distances are whole numbers, so
+  // the shades can be looked up.
+  const int max_d2 = reach * reach;
+  vector<uchar> shades(max_d2 + 1);
+  for (int d2 = 0; d2 <= max_d2; d2++) {
+    const double t = std::sqrt(static_cast<double>(d2)) / inflation_cells;
+    shades[d2] = t >= 1.0 ? FREE : static_cast<uchar>(FREE * t + 0.5);
+  }
+  const float far = 4.0f * static_cast<float>(w) * w;
+  vector<float> f(w), d(w), z(w + 1);
+  vector<int> v(w);
+  const int x0 = cells.x() - region.x();
+  for (int y = 0; y < cells.height(); y++) {
+    const int *row = &vertical[
+        static_cast<size_t>(cells.y() - region.y() + y) * w];
+    uchar *out = inflation + static_cast<size_t>(y) * stride;
+    bool near = false;
+    for (int x = 0; x < w; x++) {
+      f[x] = row[x] < cap ? static_cast<float>(row[x] * row[x]) : far;
+      near = near || row[x] < cap;
+    }
+    if (!near) {
+      memset(out, FREE, cells.width());
+      continue;
+    }
+    distance_transform_1d(f.data(), w, d.data(), v.data(), z.data());
+    for (int x = 0; x < cells.width(); x++) {
+      const float d2 = d[x0 + x];
+      out[x] = d2 <= max_d2 ? shades[static_cast<int>(d2)] : FREE;
+    }
+  }
+}
+
+void OccupancyGrid::write(
+    const QString &basename,
+    const double inflation_radius,
+    JobProgress *progress) const
+{
+  const bool inflated = inflation_radius > 0.0;
+  const double inflation_cells = inflation_radius / resolution;
+
+  QSaveFile occupancy_file(basename + ".pgm");
+  QSaveFile inflation_file(basename + "_inflation.pgm");
+  auto check = [](const bool ok, const QSaveFile &file) {
+    if (!ok) {
+      throw std::runtime_error(
+          "couldn't write " + file.fileName().toStdString() + ": " +
+          file.errorString().toStdString());
+    }
+  };
+  const QByteArray header =
+      QString("P5\n%1 %2\n255\n").arg(grid_width).arg(grid_height).toLatin1();
+  check(occupancy_file.open(QIODevice::WriteOnly), occupancy_file);
+  check(occupancy_file.write(header) == header.size(), occupancy_file);
+  if (inflated) {
+    check(inflation_file.open(QIODevice::WriteOnly), inflation_file);
+    check(inflation_file.write(header) == header.size(), inflation_file);
+  }
+
+  // one band of blocks at a time, written out before the next one
+  const int block = BLOCK_SIZE;
+  const size_t band_size = static_cast<size_t>(grid_width) * block;
+  vector<uchar> occupancy_band(band_size);
+  vector<uchar> inflation_band(inflated ? band_size : 0);
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+  for (int band_y = 0; band_y < grid_height; band_y += block) {
+    if (progress) {
+      progress->check_cancelled();
+      progress->set_progress(static_cast<double>(band_y) / grid_height);
+    }
+    const int band_height = std::min(block, grid_height - band_y);
+    for (int x = 0; x < grid_width; x += block) {
+      pool.start(
+          new OccupancyBlockTask(
+            this,
+            QRect(x, band_y, std::min(block, grid_width - x), band_height),
+            inflation_cells,
+            &occupancy_band[x],
+            inflated ? &inflation_band[x] : nullptr,
+            grid_width));
+    }
+    pool.waitForDone();
+
+    const qint64 bytes = static_cast<qint64>(grid_width) * band_height;
+    check(
+        occupancy_file.write(
+          reinterpret_cast<const char *>(occupancy_band.data()), bytes) ==
+          bytes,
+        occupancy_file);
+    if (inflated) {
+      check(
+          inflation_file.write(
+            reinterpret_cast<const char *>(inflation_band.data()), bytes) ==
+            bytes,
+          inflation_file);
+    }
+  }
+
+  check(occupancy_file.commit(), occupancy_file);
+  const QString name = QFileInfo(basename).fileName();
+  write_yaml(basename + ".yaml", name + ".pgm", false);
+  if (inflated) {
+    check(inflation_file.commit(), inflation_file);
+    write_yaml(basename + "_inflation.yaml", name + "_inflation.pgm", true);
+  }
+}
+
+void OccupancyGrid::write_yaml(
+    const QString &filename,
+    const QString &image_filename,
+    const bool scale) const
+{
+  YAML::Node origin;
+  origin.push_back(0.0);
+  origin.push_back(-grid_height * resolution);  // the bottom left corner
+  origin.push_back(0.0);
+  origin.SetStyle(YAML::EmitterStyle::Flow);
+
+  YAML::Node y;
+  y["image"] = image_filename.toStdString();
+  y["resolution"] = resolution;
+  y["origin"] = origin;
+  y["negate"] = 0;
+  y["occupied_thresh"] = 0.65;
+  y["free_thresh"] = 0.196;
+  if (scale)
+    y["mode"] = "scale";  // the gray levels in between are costs
+
+  std::ostringstream out;
+  out << y << "\n";
+  const std::string text = out.str();
+
+  QSaveFile file(filename);
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(text.data(), text.size()) !=
+        static_cast<qint64>(text.size()) ||
+      !file.commit()) {
+    throw std::runtime_error(
+        "couldn't write " + filename.toStdString() + ": " +
+        file.errorString().toStdString());
+  }
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+/*
+ * Rasterizes a level into an occupancy grid for navigation, written as a
+ * PGM image and a map_server-style YAML file:
+ *
+ *   - floor polygons are free space, and the rest is unknown (if the
+ *     level has no floors, all of it is taken to be free)
+ *   - walls are occupied, drawn as bands wall_thickness wide
+ *   - doors are free again, cut through whatever walls they cross
+ *
+ * The grid's y axis is flipped like the generators', so its origin is
+ * the bottom left corner of the level.
+ *
+ * An inflation layer can be written next to it: a distance transform of
+ * the occupied cells, black at the walls and fading to white at the
+ * inflation radius, for planners that want to keep clear of them.
+ *
+ * The grid is rendered in square blocks of cells, on a thread pool, one
+ * band of blocks at a time, so the whole image never has to be in memory
+ * at once. Shapes are filled a scanline at a time, and each span is a
+ * single memset. Blocks only look at the shapes that a SpatialGrid says
+ * overlap them, and the distance transform only reaches as far as the
+ * inflation radius, so it can be done per block too.
+ */
+
+#include <vector>
+
+#include <QPointF>
+#include <QRect>
+#include <QRectF>
+#include <QString>
+
+#include "job.h"
+#include "level.h"
+#include "spatial_grid.h"
+
+
+class OccupancyGrid
+{
+public:
+  // the PGM values that map_server reads as each state
+  static const uchar OCCUPIED = 0;
+  static const uchar UNKNOWN = 205;
+  static const uchar FREE = 254;
+
+  static const int BLOCK_SIZE = 256;  // cells per side
+
+  OccupancyGrid(
+      const Level &level,
+      const double _resolution,
+      const double _wall_thickness = 0.1);
+  ~OccupancyGrid();
+
+  int width() const { return grid_width; }
+  int height() const { return grid_height; }
+  double get_resolution() const { return resolution; }
+
+  /// Write basename.pgm and basename.yaml, and basename_inflation.pgm
+  /// and .yaml too if inflation_radius is positive. Throws
+  /// std::runtime_error if a file can't be written.
+  void write(
+      const QString &basename,
+      const double inflation_radius,
+      JobProgress *progress = nullptr) const;
+
+  /// Render a rectangle of cells into 'occupancy', and their inflation
+  /// into 'inflation' if it isn't null. Safe to call from any thread.
+  void render_block(
+      const QRect &cells,
+      const double inflation_cells,
+      uchar *occupancy,
+      uchar *inflation,
+      const int stride) const;
+
+private:
+  struct Shape
+  {
+    std::vector<QPointF> points;  // in cells
+    QRectF bounds;
+    uchar value;
+  };
+
+  const double resolution;
+  int grid_width, grid_height;
+  uchar background;
+  std::vector<Shape> shapes;  // in drawing order
+  SpatialGrid shape_grid;  // shape indices, by bounding box
+
+  void add_shape(const std::vector<QPointF> &points, const uchar value);
+  void add_band(
+      const QPointF &a,
+      const QPointF &b,
+      const double thickness,
+      const bool extend,
+      const uchar value);
+
+  void fill(
+      const QRect &cells,
+      const Shape &shape,
+      uchar *out,
+      const int stride,
+      std::vector<double> &crossings) const;
+
+  /// The inflation of 'cells', from the occupancy of the region around
+  /// them (which is region.width() cells wide in memory)
+  static void inflate(
+      const QRect &region,
+      const uchar *occupancy,
+      const QRect &cells,
+      const double inflation_cells,
+      uchar *inflation,
+      const int stride);
+
+  void write_yaml(
+      const QString &filename,
+      const QString &image_filename,
+      const bool scale) const;
+};
+
+#endif
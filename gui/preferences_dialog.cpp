@@ -15,6 +15,8 @@
  *
 */
 
+#include "drawing.h"
+#include "level_of_detail.h"
 #include "preferences_dialog.h"
 #include "preferences_keys.h"
 #include <QtWidgets>
@@ -39,6 +41,47 @@ PreferencesDialog::PreferencesDialog(QWidget *parent)
       thumbnail_path_button, &QAbstractButton::clicked,
       this, &PreferencesDialog::thumbnail_path_button_clicked);
 
+  QHBoxLayout *thumbnail_cache_size_layout = new QHBoxLayout;
+  thumbnail_cache_size_spin_box = new QSpinBox(this);
+  thumbnail_cache_size_spin_box->setRange(16, 16384);
+  thumbnail_cache_size_spin_box->setSuffix(" MB");
+  thumbnail_cache_size_spin_box->setValue(
+      settings.value(preferences_keys::thumbnail_cache_size, 256).toInt());
+  thumbnail_cache_size_layout->addWidget(
+      new QLabel("thumbnail memory budget:"));
+  thumbnail_cache_size_layout->addWidget(thumbnail_cache_size_spin_box);
+
+  QHBoxLayout *scene_cache_size_layout = new QHBoxLayout;
+  scene_cache_size_spin_box = new QSpinBox(this);
+  scene_cache_size_spin_box->setRange(0, 16384);
+  scene_cache_size_spin_box->setSuffix(" MB");
+  scene_cache_size_spin_box->setValue(
+      settings.value(preferences_keys::scene_cache_size, 256).toInt());
+  scene_cache_size_layout->addWidget(
+      new QLabel("recent level scenes memory budget:"));
+  scene_cache_size_layout->addWidget(scene_cache_size_spin_box);
+
+  QHBoxLayout *drawing_storage_layout = new QHBoxLayout;
+  drawing_storage_combo_box = new QComboBox(this);
+  // same order as Drawing::Storage
+  drawing_storage_combo_box->addItem("1-bit where lossless, else 8-bit");
+  drawing_storage_combo_box->addItem("8-bit grayscale");
+  drawing_storage_combo_box->addItem("1-bit (threshold)");
+  drawing_storage_combo_box->setCurrentIndex(
+      Drawing::storage_from_settings());
+  drawing_storage_layout->addWidget(new QLabel("drawing storage:"));
+  drawing_storage_layout->addWidget(drawing_storage_combo_box);
+
+  QHBoxLayout *autosave_layout = new QHBoxLayout;
+  autosave_spin_box = new QSpinBox(this);
+  autosave_spin_box->setRange(0, 120);
+  autosave_spin_box->setSuffix(" min");
+  autosave_spin_box->setSpecialValueText("off");
+  autosave_spin_box->setValue(
+      settings.value(preferences_keys::autosave_minutes, 2).toInt());
+  autosave_layout->addWidget(new QLabel("journal edits every:"));
+  autosave_layout->addWidget(autosave_spin_box);
+
   QHBoxLayout *bottom_buttons_layout = new QHBoxLayout;
   bottom_buttons_layout->addWidget(cancel_button);
   bottom_buttons_layout->addWidget(ok_button);
@@ -57,6 +100,14 @@ PreferencesDialog::PreferencesDialog(QWidget *parent)
 
   vbox_layout->addWidget(open_previous_file_checkbox);
   vbox_layout->addLayout(thumbnail_path_layout);
+  vbox_layout->addLayout(thumbnail_cache_size_layout);
+  vbox_layout->addLayout(scene_cache_size_layout);
+  vbox_layout->addLayout(drawing_storage_layout);
+  vbox_layout->addLayout(autosave_layout);
+  vbox_layout->addWidget(create_lod_group_box());
+  vbox_layout->addWidget(create_occupancy_group_box());
+  vbox_layout->addWidget(create_lane_clearance_group_box());
+  vbox_layout->addWidget(create_snap_group_box());
   // todo: some sort of separator (?)
   vbox_layout->addLayout(bottom_buttons_layout);
 
@@ -67,6 +118,117 @@ PreferencesDialog::~PreferencesDialog()
 {
 }
 
+QGroupBox *PreferencesDialog::create_lod_group_box()
+{
+  LevelOfDetail lod;
+  lod.load_settings();
+
+  auto create_spin_box = [this](const double value)
+  {
+    QDoubleSpinBox *spin_box = new QDoubleSpinBox(this);
+    spin_box->setRange(0.0, 1000.0);
+    spin_box->setDecimals(1);
+    spin_box->setSuffix(" px");
+    spin_box->setValue(value);
+    return spin_box;
+  };
+  lod_arrow_spin_box = create_spin_box(lod.min_arrow_pixels);
+  lod_door_spin_box = create_spin_box(lod.min_door_pixels);
+  lod_label_spin_box = create_spin_box(lod.min_label_pixels);
+  lod_lane_spin_box = create_spin_box(lod.min_lane_pixels);
+
+  QFormLayout *form_layout = new QFormLayout;
+  form_layout->addRow("hide lane arrows below:", lod_arrow_spin_box);
+  form_layout->addRow("hide door motion below:", lod_door_spin_box);
+  form_layout->addRow("hide vertex labels below:", lod_label_spin_box);
+  form_layout->addRow("draw thin lanes below:", lod_lane_spin_box);
+
+  QGroupBox *group_box = new QGroupBox("Level of detail", this);
+  group_box->setLayout(form_layout);
+  return group_box;
+}
+
+QGroupBox *PreferencesDialog::create_occupancy_group_box()
+{
+  QSettings settings;
+
+  occupancy_resolution_spin_box = new QDoubleSpinBox(this);
+  occupancy_resolution_spin_box->setRange(0.01, 10.0);
+  occupancy_resolution_spin_box->setDecimals(2);
+  occupancy_resolution_spin_box->setSingleStep(0.01);
+  occupancy_resolution_spin_box->setSuffix(" m");
+  occupancy_resolution_spin_box->setValue(
+      settings.value(preferences_keys::occupancy_resolution, 0.05).toDouble());
+
+  occupancy_inflation_spin_box = new QDoubleSpinBox(this);
+  occupancy_inflation_spin_box->setRange(0.0, 10.0);
+  occupancy_inflation_spin_box->setDecimals(2);
+  occupancy_inflation_spin_box->setSingleStep(0.05);
+  occupancy_inflation_spin_box->setSuffix(" m");
+  occupancy_inflation_spin_box->setSpecialValueText("off");
+  occupancy_inflation_spin_box->setValue(
+      settings.value(
+        preferences_keys::occupancy_inflation_radius, 0.5).toDouble());
+
+  QFormLayout *form_layout = new QFormLayout;
+  form_layout->addRow("resolution:", occupancy_resolution_spin_box);
+  form_layout->addRow("inflation radius:", occupancy_inflation_spin_box);
+
+  QGroupBox *group_box = new QGroupBox("Occupancy grid export", this);
+  group_box->setLayout(form_layout);
+  return group_box;
+}
+
+QGroupBox *PreferencesDialog::create_lane_clearance_group_box()
+{
+  QSettings settings;
+
+  lane_clearance_spin_box = new QDoubleSpinBox(this);
+  lane_clearance_spin_box->setRange(0.05, 10.0);
+  lane_clearance_spin_box->setDecimals(2);
+  lane_clearance_spin_box->setSingleStep(0.05);
+  lane_clearance_spin_box->setSuffix(" m");
+  lane_clearance_spin_box->setValue(
+      settings.value(preferences_keys::lane_clearance_radius, 0.5).toDouble());
+
+  QFormLayout *form_layout = new QFormLayout;
+  form_layout->addRow("robot footprint radius:", lane_clearance_spin_box);
+
+  QGroupBox *group_box = new QGroupBox("Lane clearance", this);
+  group_box->setLayout(form_layout);
+  return group_box;
+}
+
+QGroupBox *PreferencesDialog::create_snap_group_box()
+{
+  QSettings settings;
+
+  snap_radius_spin_box = new QDoubleSpinBox(this);
+  snap_radius_spin_box->setRange(0.0, 50.0);
+  snap_radius_spin_box->setDecimals(0);
+  snap_radius_spin_box->setSuffix(" px");
+  snap_radius_spin_box->setSpecialValueText("off");
+  snap_radius_spin_box->setValue(
+      settings.value(preferences_keys::snap_radius_pixels, 8.0).toDouble());
+
+  snap_grid_spin_box = new QDoubleSpinBox(this);
+  snap_grid_spin_box->setRange(0.0, 10.0);
+  snap_grid_spin_box->setDecimals(2);
+  snap_grid_spin_box->setSingleStep(0.05);
+  snap_grid_spin_box->setSuffix(" m");
+  snap_grid_spin_box->setSpecialValueText("off");
+  snap_grid_spin_box->setValue(
+      settings.value(preferences_keys::snap_grid_meters, 0.5).toDouble());
+
+  QFormLayout *form_layout = new QFormLayout;
+  form_layout->addRow("snap radius:", snap_radius_spin_box);
+  form_layout->addRow("grid spacing:", snap_grid_spin_box);
+
+  QGroupBox *group_box = new QGroupBox("Vertex snapping", this);
+  group_box->setLayout(form_layout);
+  return group_box;
+}
+
 void PreferencesDialog::thumbnail_path_button_clicked()
 {
   QFileDialog file_dialog(this, "Find Thumbnail Path");
@@ -110,5 +272,57 @@ void PreferencesDialog::ok_button_clicked()
       preferences_keys::open_previous_file,
       open_previous_file_checkbox->isChecked());
 
+  settings.setValue(
+      preferences_keys::thumbnail_cache_size,
+      thumbnail_cache_size_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::scene_cache_size,
+      scene_cache_size_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::drawing_storage,
+      drawing_storage_combo_box->currentIndex());
+
+  settings.setValue(
+      preferences_keys::autosave_minutes,
+      autosave_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::lod_arrow_pixels,
+      lod_arrow_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::lod_door_pixels,
+      lod_door_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::lod_label_pixels,
+      lod_label_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::lod_lane_pixels,
+      lod_lane_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::occupancy_resolution,
+      occupancy_resolution_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::occupancy_inflation_radius,
+      occupancy_inflation_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::lane_clearance_radius,
+      lane_clearance_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::snap_radius_pixels,
+      snap_radius_spin_box->value());
+
+  settings.setValue(
+      preferences_keys::snap_grid_meters,
+      snap_grid_spin_box->value());
+
   accept();
 }
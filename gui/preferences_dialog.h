@@ -21,6 +21,10 @@
 #include <QDialog>
 class QLineEdit;
 class QCheckBox;
+class QComboBox;
+class QSpinBox;
+class QDoubleSpinBox;
+class QGroupBox;
 
 
 class PreferencesDialog : public QDialog
@@ -33,6 +37,23 @@ private:
   QLineEdit *thumbnail_path_line_edit;
   QPushButton *thumbnail_path_button;
   QCheckBox *open_previous_file_checkbox;
+  QSpinBox *thumbnail_cache_size_spin_box;
+  QSpinBox *scene_cache_size_spin_box;
+  QComboBox *drawing_storage_combo_box;
+  QSpinBox *autosave_spin_box;
+  QDoubleSpinBox *lod_arrow_spin_box, *lod_door_spin_box;
+  QDoubleSpinBox *lod_label_spin_box, *lod_lane_spin_box;
+  QGroupBox *create_lod_group_box();
+  QDoubleSpinBox *occupancy_resolution_spin_box;
+  QDoubleSpinBox *occupancy_inflation_spin_box;
+  QGroupBox *create_occupancy_group_box();
+
+  QDoubleSpinBox *lane_clearance_spin_box;
+  QGroupBox *create_lane_clearance_group_box();
+
+  QDoubleSpinBox *snap_radius_spin_box;
+  QDoubleSpinBox *snap_grid_spin_box;
+  QGroupBox *create_snap_group_box();
   QPushButton *ok_button, *cancel_button;
 
 private slots:
@@ -8,3 +8,42 @@ const QString preferences_keys::open_previous_file(
 
 const QString preferences_keys::previous_project_path(
     "editor/previous_project_path");
+
+const QString preferences_keys::thumbnail_cache_size(
+    "editor/thumbnail_cache_size");
+
+const QString preferences_keys::lod_arrow_pixels(
+    "editor/lod_arrow_pixels");
+
+const QString preferences_keys::lod_door_pixels(
+    "editor/lod_door_pixels");
+
+const QString preferences_keys::lod_label_pixels(
+    "editor/lod_label_pixels");
+
+const QString preferences_keys::lod_lane_pixels(
+    "editor/lod_lane_pixels");
+
+const QString preferences_keys::drawing_storage(
+    "editor/drawing_storage");
+
+const QString preferences_keys::autosave_minutes(
+    "editor/autosave_minutes");
+
+const QString preferences_keys::scene_cache_size(
+    "editor/scene_cache_size");
+
+const QString preferences_keys::occupancy_resolution(
+    "editor/occupancy_resolution");
+
+const QString preferences_keys::occupancy_inflation_radius(
+    "editor/occupancy_inflation_radius");
+
+const QString preferences_keys::lane_clearance_radius(
+    "editor/lane_clearance_radius");
+
+const QString preferences_keys::snap_radius_pixels(
+    "editor/snap_radius_pixels");
+
+const QString preferences_keys::snap_grid_meters(
+    "editor/snap_grid_meters");
@@ -8,6 +8,19 @@ namespace preferences_keys {
 extern const QString thumbnail_path;
 extern const QString open_previous_file;
 extern const QString previous_project_path;
+extern const QString thumbnail_cache_size;
+extern const QString lod_arrow_pixels;
+extern const QString lod_door_pixels;
+extern const QString lod_label_pixels;
+extern const QString lod_lane_pixels;
+extern const QString drawing_storage;
+extern const QString autosave_minutes;
+extern const QString scene_cache_size;
+extern const QString occupancy_resolution;
+extern const QString occupancy_inflation_radius;
+extern const QString lane_clearance_radius;
+extern const QString snap_radius_pixels;
+extern const QString snap_grid_meters;
 
 };
 
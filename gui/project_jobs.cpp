@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <stdexcept>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "floorplan_importer.h"
+#include "occupancy_grid.h"
+#include "project_jobs.h"
+#include "wall_extractor.h"
+
+
+LoadProjectJob::LoadProjectJob(const QString &_filename)
+: Job("Loading " + QFileInfo(_filename).fileName()),
+  filename(_filename),
+  num_replayed(0)
+{
+}
+
+LoadProjectJob::~LoadProjectJob()
+{
+}
+
+void LoadProjectJob::run(JobProgress &_progress)
+{
+  QFile file(filename);
+  if (!file.open(QIODevice::ReadOnly))
+    throw std::runtime_error("couldn't open " + filename.toStdString());
+  const QByteArray base_hash = Journal::file_hash(file.readAll());
+  file.close();
+
+  map.load(filename.toStdString(), &_progress);
+
+  // edits made since the last save are in the journal
+  _progress.set_progress(1.0, "replaying journal");
+  const std::string journal_filename = Journal::filename_for_project(filename);
+  qint64 valid_size = 0;
+  std::string journal_error;
+  num_replayed = Journal::replay(
+      journal_filename,
+      base_hash,
+      QFileInfo(filename).absolutePath(),
+      map,
+      valid_size,
+      journal_error);
+  if (num_replayed < 0) {
+    // Most likely the file was changed by something else since. Keep the
+    // journal around for a human to look at, and go with the file.
+    qWarning("ignoring the journal: %s", journal_error.c_str());
+    const QString qjournal = QString::fromStdString(journal_filename);
+    QFile::remove(qjournal + ".bad");
+    QFile::rename(qjournal, qjournal + ".bad");
+    if (valid_size > 0)  // it got as far as editing the map
+      map.load(filename.toStdString(), &_progress);
+    num_replayed = 0;
+  }
+
+  journal = std::make_shared<Journal>(journal_filename);
+  journal->open(
+      base_hash,
+      *map.snapshot(),
+      num_replayed > 0 ? valid_size : 0);
+}
+
+
+// a save that is abandoned halfway would lose the user's work, so
+// these can't be cancelled
+SaveProjectJob::SaveProjectJob(
+    const QString &_filename,
+    const std::shared_ptr<const MapSnapshot> &_snapshot,
+    const std::shared_ptr<Journal> &_journal)
+: Job("Saving " + QFileInfo(_filename).fileName(), false),
+  filename(_filename),
+  snapshot(_snapshot),
+  journal(_journal)
+{
+}
+
+SaveProjectJob::~SaveProjectJob()
+{
+}
+
+void SaveProjectJob::run(JobProgress &_progress)
+{
+  _progress.set_progress(0.0, "journaling");
+  journal->append(*snapshot);
+
+  const QByteArray data = snapshot->to_file_data(filename, &_progress);
+  _progress.set_progress(1.0, "writing");
+  if (!MapSnapshot::write_file(filename.toStdString(), data))
+    throw std::runtime_error("couldn't write " + filename.toStdString());
+
+  // the file has everything now, so the journal starts over on top of it.
+  // If that fails the save itself still went fine; autosaves will warn.
+  journal->open(Journal::file_hash(data), *snapshot, 0);
+}
+
+
+JournalAppendJob::JournalAppendJob(
+    const std::shared_ptr<Journal> &_journal,
+    const std::shared_ptr<const MapSnapshot> &_snapshot)
+: Job("Journaling"),
+  journal(_journal),
+  snapshot(_snapshot),
+  num_records(0)
+{
+}
+
+JournalAppendJob::~JournalAppendJob()
+{
+}
+
+void JournalAppendJob::run(JobProgress &)
+{
+  num_records = journal->append(*snapshot);
+  if (num_records < 0)
+    throw std::runtime_error(
+        "couldn't append to " + journal->get_filename());
+}
+
+
+ImportFloorplanJob::ImportFloorplanJob(
+    const QString &_filename,
+    const std::string &_level_name,
+    const double _meters_per_pixel)
+: Job("Importing " + QFileInfo(_filename).fileName()),
+  filename(_filename),
+  level_name(_level_name),
+  meters_per_pixel(_meters_per_pixel),
+  width_meters(0.0),
+  height_meters(0.0)
+{
+}
+
+ImportFloorplanJob::~ImportFloorplanJob()
+{
+}
+
+void ImportFloorplanJob::run(JobProgress &_progress)
+{
+  FloorplanImporter importer;
+  importer.read(filename, &_progress);
+
+  const QRectF bounds = importer.get_bounds();
+  const double meters_per_unit = importer.get_meters_per_unit();
+  const double scale = meters_per_unit / meters_per_pixel;
+  width_meters = bounds.width() * meters_per_unit;
+  height_meters = bounds.height() * meters_per_unit;
+
+  const std::vector<QPointF> &points = importer.get_points();
+  vertices.reserve(points.size());
+  for (const QPointF &p : points) {
+    const double y = importer.is_y_up() ?
+        bounds.bottom() - p.y() :
+        p.y() - bounds.top();
+    vertices.push_back(Vertex((p.x() - bounds.left()) * scale, y * scale));
+  }
+
+  edges.reserve(importer.get_segments().size());
+  for (const auto &segment : importer.get_segments())
+    edges.push_back(Edge(segment.first, segment.second, Edge::WALL));
+}
+
+ExportOccupancyGridsJob::ExportOccupancyGridsJob(
+    const std::shared_ptr<const MapSnapshot> &_snapshot,
+    const QString &_directory,
+    const double _resolution,
+    const double _inflation_radius)
+: Job("Exporting occupancy grids"),
+  snapshot(_snapshot),
+  directory(_directory),
+  resolution(_resolution),
+  inflation_radius(_inflation_radius)
+{
+}
+
+ExportOccupancyGridsJob::~ExportOccupancyGridsJob()
+{
+}
+
+void ExportOccupancyGridsJob::run(JobProgress &_progress)
+{
+  const size_t n = snapshot->levels.size();
+  for (size_t i = 0; i < n; i++) {
+    const Level &level = *snapshot->levels[i];
+    _progress.set_range(
+        static_cast<double>(i) / n,
+        static_cast<double>(i + 1) / n);
+    _progress.set_progress(0.0, QString::fromStdString(level.name));
+    OccupancyGrid grid(level, resolution);
+    grid.write(
+        QDir(directory).filePath(QString::fromStdString(level.name)),
+        inflation_radius,
+        &_progress);
+  }
+  _progress.set_range(0.0, 1.0);
+}
+
+ExtractWallsJob::ExtractWallsJob(
+    const std::string &_level_name,
+    const std::shared_ptr<const Drawing> &_drawing,
+    const double _meters_per_pixel)
+: Job("Extracting walls on " + QString::fromStdString(_level_name)),
+  level_name(_level_name),
+  drawing(_drawing),
+  meters_per_pixel(_meters_per_pixel)
+{
+}
+
+ExtractWallsJob::~ExtractWallsJob()
+{
+}
+
+void ExtractWallsJob::run(JobProgress &_progress)
+{
+  WallExtractor extractor(meters_per_pixel);
+  extractor.extract(*drawing, &_progress);
+
+  vertices.reserve(extractor.get_points().size());
+  for (const QPointF &p : extractor.get_points()) {
+    vertices.push_back(Vertex(p.x(), p.y()));
+    vertices.back().selected = true;
+  }
+
+  edges.reserve(extractor.get_segments().size());
+  for (const auto &segment : extractor.get_segments()) {
+    edges.push_back(Edge(segment.first, segment.second, Edge::WALL));
+    edges.back().selected = true;
+  }
+}
@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef PROJECT_JOBS_H
+#define PROJECT_JOBS_H
+
+/*
+ * Jobs for loading and saving a whole project, and for importing into
+ * one. None of them touch the editor's Map: the load, import and wall
+ * extraction jobs fill in data of their own for the editor to take over
+ * once they're done, and the others write out a MapSnapshot, to the
+ * journal and/or the project file.
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QByteArray>
+#include <QString>
+
+#include "job.h"
+#include "journal.h"
+#include "map.h"
+
+
+class LoadProjectJob : public Job
+{
+public:
+  LoadProjectJob(const QString &_filename);
+  ~LoadProjectJob();
+
+  /// Loads the project file, replays the journal over it, and opens the
+  /// journal for further edits
+  void run(JobProgress &_progress) override;
+
+  const QString filename;
+  Map map;
+  std::shared_ptr<Journal> journal;
+  int num_replayed;  // journal records applied to the map
+};
+
+
+class SaveProjectJob : public Job
+{
+public:
+  SaveProjectJob(
+      const QString &_filename,
+      const std::shared_ptr<const MapSnapshot> &_snapshot,
+      const std::shared_ptr<Journal> &_journal);
+  ~SaveProjectJob();
+
+  /// Appends to the journal, so the edits are safe right away, then
+  /// rewrites the project file and starts the journal over on top of it
+  void run(JobProgress &_progress) override;
+
+  const QString filename;
+  const std::shared_ptr<const MapSnapshot> snapshot;
+  const std::shared_ptr<Journal> journal;
+};
+
+
+/// Appends the edits in a snapshot to the journal. Unlike a save, this
+/// doesn't touch the project file, and it can be cancelled.
+class JournalAppendJob : public Job
+{
+public:
+  JournalAppendJob(
+      const std::shared_ptr<Journal> &_journal,
+      const std::shared_ptr<const MapSnapshot> &_snapshot);
+  ~JournalAppendJob();
+
+  void run(JobProgress &_progress) override;
+
+  const std::shared_ptr<Journal> journal;
+  const std::shared_ptr<const MapSnapshot> snapshot;
+  int num_records;
+};
+
+/// Reads the line work of a DXF or SVG floorplan (see FloorplanImporter)
+/// as vertices and walls in the pixel coordinates of a level, with the
+/// top left corner of the plan at the origin.
+class ImportFloorplanJob : public Job
+{
+public:
+  ImportFloorplanJob(
+      const QString &_filename,
+      const std::string &_level_name,
+      const double _meters_per_pixel);
+  ~ImportFloorplanJob();
+
+  void run(JobProgress &_progress) override;
+
+  const QString filename;
+  const std::string level_name;  // to find the level again afterwards
+  const double meters_per_pixel;
+  std::vector<Vertex> vertices;
+  std::vector<Edge> edges;  // WALLs, indexing into vertices
+  double width_meters, height_meters;  // of the plan
+};
+
+/// Writes an occupancy grid for each level (see OccupancyGrid) into a
+/// directory, named after the levels
+class ExportOccupancyGridsJob : public Job
+{
+public:
+  ExportOccupancyGridsJob(
+      const std::shared_ptr<const MapSnapshot> &_snapshot,
+      const QString &_directory,
+      const double _resolution,
+      const double _inflation_radius);
+  ~ExportOccupancyGridsJob();
+
+  void run(JobProgress &_progress) override;
+
+  const std::shared_ptr<const MapSnapshot> snapshot;
+  const QString directory;
+  const double resolution;
+  const double inflation_radius;  // 0 for no inflation layer
+};
+
+/// Traces walls in a level's drawing (see WallExtractor), for the user
+/// to review before keeping them
+class ExtractWallsJob : public Job
+{
+public:
+  ExtractWallsJob(
+      const std::string &_level_name,
+      const std::shared_ptr<const Drawing> &_drawing,
+      const double _meters_per_pixel);
+  ~ExtractWallsJob();
+
+  void run(JobProgress &_progress) override;
+
+  const std::string level_name;
+  const std::shared_ptr<const Drawing> drawing;
+  const double meters_per_pixel;
+  std::vector<Vertex> vertices;
+  std::vector<Edge> edges;  // WALLs, indexing into vertices
+};
+
+#endif
@@ -0,0 +1,330 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include <QBrush>
+#include <QFont>
+
+#include "property_table_model.h"
+using std::string;
+using std::vector;
+
+
+PropertyTableModel::PropertyTableModel(QObject *parent)
+: QAbstractTableModel(parent),
+  map(nullptr),
+  level_idx(0),
+  target(NONE)
+{
+}
+
+PropertyTableModel::~PropertyTableModel()
+{
+}
+
+void PropertyTableModel::update(
+    Map &_map,
+    const int _level_idx,
+    const Selection &selection)
+{
+  beginResetModel();
+  map = &_map;
+  level_idx = _level_idx;
+  target = NONE;
+  selected.clear();
+  rows.clear();
+
+  if (level_idx >= 0 && level_idx < static_cast<int>(map->levels.size())) {
+    const Level &level = map->levels[level_idx];
+
+    // polygons don't have any properties to show yet
+    const bool polygon_selected = !selection.get(Selection::POLYGON).empty();
+    if (!polygon_selected && !selection.get(Selection::EDGE).empty())
+      target = EDGES;
+    else if (!polygon_selected && !selection.get(Selection::MODEL).empty())
+      target = MODELS;
+    else if (!polygon_selected && !selection.get(Selection::VERTEX).empty())
+      target = VERTICES;
+
+    switch (target) {
+      case EDGES: selected = selection.get(Selection::EDGE); break;
+      case MODELS: selected = selection.get(Selection::MODEL); break;
+      case VERTICES: selected = selection.get(Selection::VERTEX); break;
+      default: break;
+    }
+    // in level order, so the rows don't depend on the order of selection
+    std::sort(selected.begin(), selected.end());
+
+    switch (target) {
+      case EDGES: add_edge_rows(level); break;
+      case MODELS: add_model_rows(level); break;
+      case VERTICES: add_vertex_rows(level); break;
+      default: break;
+    }
+  }
+  endResetModel();
+}
+
+void PropertyTableModel::add_row(
+    const QString &label,
+    const QString &value,
+    const RowType row_type)
+{
+  Row row;
+  row.label = label;
+  row.value = value;
+  row.various = false;
+  row.row_type = row_type;
+  rows.push_back(row);
+}
+
+void PropertyTableModel::add_shared_row(
+    const QString &label,
+    const vector<QString> &values,
+    const RowType row_type)
+{
+  bool various = false;
+  for (size_t i = 1; i < values.size() && !various; i++)
+    various = values[i] != values[0];
+  add_row(label, various ? QString() : values[0], row_type);
+  rows.back().various = various;
+}
+
+void PropertyTableModel::add_param_rows(const vector<const Params *> &params)
+{
+  // only the ones that all of them have, with the same type
+  for (const auto &first : *params[0]) {
+    vector<QString> values;
+    values.reserve(params.size());
+    for (const Params *p : params) {
+      auto it = p->find(first.first);
+      if (it == p->end() || it->second.type != first.second.type)
+        break;
+      values.push_back(it->second.to_qstring());
+    }
+    if (values.size() != params.size())
+      continue;
+    add_shared_row(QString::fromStdString(first.first), values, PARAM);
+    rows.back().param_name = first.first;
+  }
+}
+
+void PropertyTableModel::add_edge_rows(const Level &level)
+{
+  if (selected.size() > 1)
+    add_row("edges", QString::number(selected.size()));
+
+  vector<QString> types;
+  vector<const Params *> params;
+  for (const int edge_idx : selected) {
+    types.push_back(level.edges[edge_idx].type_to_qstring());
+    params.push_back(&level.edges[edge_idx].params);
+  }
+  add_shared_row("edge_type", types);
+
+  if (selected.size() == 1) {
+    const Edge &edge = level.edges[selected[0]];
+    const double scale = level.drawing_meters_per_pixel;
+    const Vertex &sv = level.vertices[edge.start_idx];
+    const Vertex &ev = level.vertices[edge.end_idx];
+    const double sx = sv.x * scale;
+    const double sy = sv.y * scale;
+    const double ex = ev.x * scale;
+    const double ey = ev.y * scale;
+    const double dx = ex - sx;
+    const double dy = ey - sy;
+
+    add_row("start_idx", QString::number(edge.start_idx));
+    add_row("end_idx", QString::number(edge.end_idx));
+    add_row("start x (m)", QString::number(sx, 'g', 4));
+    add_row("start y (m)", QString::number(sy, 'g', 4));
+    add_row("end x (m)", QString::number(ex, 'g', 4));
+    add_row("end y (m)", QString::number(ey, 'g', 4));
+    add_row("length (m)", QString::number(std::sqrt(dx*dx + dy*dy), 'g', 4));
+  }
+
+  add_param_rows(params);
+}
+
+void PropertyTableModel::add_model_rows(const Level &level)
+{
+  if (selected.size() > 1)
+    add_row("models", QString::number(selected.size()));
+
+  vector<QString> names, model_names;
+  for (const int model_idx : selected) {
+    const Model &model = level.models[model_idx];
+    names.push_back(QString::fromStdString(model.instance_name));
+    model_names.push_back(QString::fromStdString(model.model_name));
+  }
+  add_shared_row("name", names);
+  add_shared_row("model_name", model_names);
+}
+
+void PropertyTableModel::add_vertex_rows(const Level &level)
+{
+  vector<const Params *> params;
+  for (const int vertex_idx : selected)
+    params.push_back(&level.vertices[vertex_idx].params);
+
+  if (selected.size() == 1) {
+    const Vertex &vertex = level.vertices[selected[0]];
+    const double scale = level.drawing_meters_per_pixel;
+    add_row("x (pixels)", QString::number(vertex.x, 'g', 4));
+    add_row("y (pixels)", QString::number(vertex.y, 'g', 4));
+    add_row("x (m)", QString::number(vertex.x * scale, 'g', 4));
+    add_row("y (m)", QString::number(vertex.y * scale, 'g', 4));
+    add_row("name", QString::fromStdString(vertex.name), VERTEX_NAME);
+  }
+  else {
+    // names are meant to be unique, so they can't be set all at once
+    add_row("vertices", QString::number(selected.size()));
+    vector<QString> names;
+    for (const int vertex_idx : selected)
+      names.push_back(QString::fromStdString(level.vertices[vertex_idx].name));
+    add_shared_row("name", names);
+  }
+
+  add_param_rows(params);
+}
+
+int PropertyTableModel::rowCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return static_cast<int>(rows.size());
+}
+
+int PropertyTableModel::columnCount(const QModelIndex &parent) const
+{
+  if (parent.isValid())
+    return 0;
+  return 2;
+}
+
+QVariant PropertyTableModel::data(const QModelIndex &index, int role) const
+{
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+  const Row &row = rows[index.row()];
+
+  if (index.column() == 0) {
+    if (role == Qt::DisplayRole)
+      return row.label;
+    return QVariant();
+  }
+
+  switch (role) {
+    case Qt::DisplayRole:
+      return row.various ? QString("(various)") : row.value;
+    case Qt::EditRole:
+      return row.value;
+    case Qt::FontRole:
+      if (row.various) {
+        QFont font;
+        font.setItalic(true);
+        return font;
+      }
+      break;
+    case Qt::BackgroundRole:
+      if (row.row_type != READ_ONLY)
+        return QBrush(Qt::white);
+      break;
+    default:
+      break;
+  }
+  return QVariant();
+}
+
+Qt::ItemFlags PropertyTableModel::flags(const QModelIndex &index) const
+{
+  if (!index.isValid() || index.column() != 1 || index.row() >= rowCount())
+    return Qt::NoItemFlags;
+  if (rows[index.row()].row_type == READ_ONLY)
+    return Qt::NoItemFlags;
+  return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+bool PropertyTableModel::setData(
+    const QModelIndex &index,
+    const QVariant &value,
+    int role)
+{
+  if (role != Qt::EditRole || !(flags(index) & Qt::ItemIsEditable))
+    return false;
+  if (!map || level_idx >= static_cast<int>(map->levels.size()))
+    return false;
+  Row &row = rows[index.row()];
+  const QString text = value.toString();
+  if (!row.various && text == row.value)
+    return false;  // nothing to do, so don't redraw anything
+
+  Level &level = map->levels[level_idx];
+  MapChangeBus::Transaction transaction(map->change_bus);
+  if (row.row_type == VERTEX_NAME) {
+    for (const int vertex_idx : selected) {
+      level.vertices[vertex_idx].name = text.toStdString();
+      map->notify(
+          MapChange(
+              MapChange::MODIFIED,
+              MapChange::VERTEX,
+              level_idx,
+              vertex_idx,
+              MapChange::NAME));
+    }
+    row.value = text;
+  }
+  else if (row.row_type == PARAM) {
+    // parse it once, and then copy the result into all of them
+    Params &first = target == EDGES ?
+        level.edges[selected[0]].params :
+        level.vertices[selected[0]].params;
+    Param param = first[row.param_name];
+    try {
+      param.set(text.toStdString());
+    }
+    catch (const std::exception &e) {
+      qWarning("can't set %s to [%s]: %s",
+          row.param_name.c_str(),
+          qUtf8Printable(text),
+          e.what());
+      return false;
+    }
+    for (const int idx : selected) {
+      if (target == EDGES)
+        level.edges[idx].params[row.param_name] = param;
+      else
+        level.vertices[idx].params[row.param_name] = param;
+      map->notify(
+          MapChange(
+              MapChange::MODIFIED,
+              target == EDGES ? MapChange::EDGE : MapChange::VERTEX,
+              level_idx,
+              idx,
+              MapChange::PARAMS));
+    }
+    row.value = param.to_qstring();
+  }
+  row.various = false;
+
+  emit dataChanged(index, index);
+  emit edited(target);
+  return true;
+}
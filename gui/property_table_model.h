@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef PROPERTY_TABLE_MODEL_H
+#define PROPERTY_TABLE_MODEL_H
+
+/*
+ * The property editor's table: one row per property of whatever is
+ * selected on the current level, property names on the left and values
+ * on the right. Everything selected of one kind is shown at once (all
+ * the selected edges, say), so a single edit can be applied to
+ * thousands of lanes:
+ *
+ *   - a value that all of them share is shown as is; one that differs
+ *     is shown as "(various)" and starts out blank when edited
+ *   - only the parameters that all of them have can be edited
+ *   - an edit is parsed once, and then copied into every one of them
+ *
+ * Edits go straight into the Map, which is notified of each one; the
+ * 'edited' signal tells the editor which kind of thing changed, so it
+ * can redraw just that.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QAbstractTableModel>
+
+#include "map.h"
+#include "selection.h"
+
+
+class PropertyTableModel : public QAbstractTableModel
+{
+  Q_OBJECT
+
+public:
+  enum Target {
+    NONE = 0,
+    EDGES,
+    MODELS,
+    VERTICES
+  };
+
+  PropertyTableModel(QObject *parent = nullptr);
+  ~PropertyTableModel();
+
+  /// Show the selection on this level. Edges win over models, and
+  /// models over vertices, if more than one kind is selected.
+  void update(Map &_map, const int _level_idx, const Selection &selection);
+
+  Target get_target() const { return target; }
+  int num_selected() const { return static_cast<int>(selected.size()); }
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index, int role) const override;
+  Qt::ItemFlags flags(const QModelIndex &index) const override;
+  bool setData(
+      const QModelIndex &index,
+      const QVariant &value,
+      int role = Qt::EditRole) override;
+
+signals:
+  /// Some of the selected things were changed through the table
+  void edited(PropertyTableModel::Target target);
+
+private:
+  typedef std::map<std::string, Param> Params;
+
+  enum RowType {
+    READ_ONLY = 0,
+    VERTEX_NAME,
+    PARAM
+  };
+
+  struct Row
+  {
+    QString label;
+    QString value;  // empty if 'various'
+    bool various;  // not the same for everything selected
+    RowType row_type;
+    std::string param_name;  // for PARAM rows
+  };
+
+  Map *map;
+  int level_idx;
+  Target target;
+  std::vector<int> selected;  // indices of the selected edges, etc.
+  std::vector<Row> rows;
+
+  void add_row(
+      const QString &label,
+      const QString &value,
+      const RowType row_type = READ_ONLY);
+  void add_shared_row(
+      const QString &label,
+      const std::vector<QString> &values,
+      const RowType row_type = READ_ONLY);
+  void add_param_rows(const std::vector<const Params *> &param_maps);
+
+  void add_edge_rows(const Level &level);
+  void add_model_rows(const Level &level);
+  void add_vertex_rows(const Level &level);
+};
+
+#endif
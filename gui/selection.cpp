@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+
+#include "selection.h"
+using std::vector;
+
+
+Selection::Selection()
+{
+}
+
+Selection::~Selection()
+{
+}
+
+Selection::Mode Selection::mode_from_keys(
+    const bool shift,
+    const bool control)
+{
+  if (shift && control)
+    return REMOVE;
+  if (shift)
+    return ADD;
+  if (control)
+    return TOGGLE;
+  return REPLACE;
+}
+
+bool Selection::SparseSet::contains(const int idx) const
+{
+  return idx >= 0 &&
+      idx < static_cast<int>(sparse.size()) &&
+      sparse[idx] >= 0;
+}
+
+void Selection::SparseSet::insert(const int idx)
+{
+  if (idx < 0 || contains(idx))
+    return;
+  if (idx >= static_cast<int>(sparse.size()))
+    sparse.resize(idx + 1, -1);
+  sparse[idx] = static_cast<int>(dense.size());
+  dense.push_back(idx);
+}
+
+void Selection::SparseSet::erase(const int idx)
+{
+  if (!contains(idx))
+    return;
+  // move the last member into the hole
+  const int pos = sparse[idx];
+  const int last = dense.back();
+  dense[pos] = last;
+  sparse[last] = pos;
+  dense.pop_back();
+  sparse[idx] = -1;
+}
+
+void Selection::SparseSet::clear()
+{
+  // only touch the entries that are in use; 'sparse' stays allocated
+  for (const int idx : dense)
+    sparse[idx] = -1;
+  dense.clear();
+}
+
+bool *Selection::flag(Level &level, const Handle &handle)
+{
+  const int i = handle.idx;
+  switch (handle.kind) {
+    case VERTEX:
+      if (i >= 0 && i < static_cast<int>(level.vertices.size()))
+        return &level.vertices[i].selected;
+      break;
+    case EDGE:
+      if (i >= 0 && i < static_cast<int>(level.edges.size()))
+        return &level.edges[i].selected;
+      break;
+    case MODEL:
+      if (i >= 0 && i < static_cast<int>(level.models.size()))
+        return &level.models[i].selected;
+      break;
+    case POLYGON:
+      if (i >= 0 && i < static_cast<int>(level.polygons.size()))
+        return &level.polygons[i].selected;
+      break;
+    default:
+      break;
+  }
+  return nullptr;
+}
+
+void Selection::rebuild(const Level &level)
+{
+  for (SparseSet &set : sets) {
+    set.dense.clear();
+    set.sparse.clear();
+  }
+  for (size_t i = 0; i < level.vertices.size(); i++) {
+    if (level.vertices[i].selected)
+      sets[VERTEX].insert(static_cast<int>(i));
+  }
+  for (size_t i = 0; i < level.edges.size(); i++) {
+    if (level.edges[i].selected)
+      sets[EDGE].insert(static_cast<int>(i));
+  }
+  for (size_t i = 0; i < level.models.size(); i++) {
+    if (level.models[i].selected)
+      sets[MODEL].insert(static_cast<int>(i));
+  }
+  for (size_t i = 0; i < level.polygons.size(); i++) {
+    if (level.polygons[i].selected)
+      sets[POLYGON].insert(static_cast<int>(i));
+  }
+}
+
+void Selection::clear(Level &level)
+{
+  for (int kind = 0; kind < NUM_KINDS; kind++) {
+    Handle handle;
+    handle.kind = static_cast<Kind>(kind);
+    for (const int idx : sets[kind].dense) {
+      handle.idx = idx;
+      bool *selected = flag(level, handle);
+      if (selected)
+        *selected = false;
+    }
+    sets[kind].clear();
+  }
+}
+
+void Selection::reset()
+{
+  for (SparseSet &set : sets)
+    set.clear();
+}
+
+void Selection::removed(const Kind kind, const vector<int> &removed_idx)
+{
+  if (removed_idx.empty())
+    return;
+  // in one pass: each member either went, or moved down by the number of
+  // things removed before it
+  SparseSet &set = sets[kind];
+  const vector<int> members(set.dense);
+  set.clear();
+  for (const int member : members) {
+    const auto it =
+        std::lower_bound(removed_idx.begin(), removed_idx.end(), member);
+    if (it != removed_idx.end() && *it == member)
+      continue;
+    set.insert(member - static_cast<int>(it - removed_idx.begin()));
+  }
+}
+
+void Selection::set(Level &level, const Handle &handle, const bool selected)
+{
+  bool *f = flag(level, handle);
+  if (!f)
+    return;
+  *f = selected;
+  if (selected)
+    sets[handle.kind].insert(handle.idx);
+  else
+    sets[handle.kind].erase(handle.idx);
+}
+
+void Selection::apply(
+    Level &level,
+    const vector<Handle> &handles,
+    const Mode mode)
+{
+  if (mode == REPLACE)
+    clear(level);
+  for (const Handle &handle : handles) {
+    switch (mode) {
+      case REPLACE:
+      case ADD:
+        set(level, handle, true);
+        break;
+      case REMOVE:
+        set(level, handle, false);
+        break;
+      case TOGGLE:
+        set(level, handle, !contains(handle));
+        break;
+    }
+  }
+}
+
+bool Selection::contains(const Handle &handle) const
+{
+  return sets[handle.kind].contains(handle.idx);
+}
+
+bool Selection::empty() const
+{
+  return size() == 0;
+}
+
+int Selection::size() const
+{
+  int n = 0;
+  for (const SparseSet &set : sets)
+    n += static_cast<int>(set.dense.size());
+  return n;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SELECTION_H
+#define SELECTION_H
+
+/*
+ * What is selected on the current level: for each kind of thing, a
+ * sparse set of indices into the level's vectors. Adding, removing and
+ * testing a handle is O(1), and clearing or going through the selection
+ * is O(number selected), however big the level is.
+ *
+ * This is what is selected; the 'selected' flags in the level's vertices,
+ * edges, models and polygons only mirror it for the layers that draw
+ * them, so every change made through here is written into the flags
+ * too. When things are removed, removed() shifts the indices after them
+ * as the level's vectors did. rebuild() reads the flags back, once, when
+ * switching to a level.
+ */
+
+#include <vector>
+
+#include "level.h"
+
+
+class Selection
+{
+public:
+  enum Kind {
+    VERTEX = 0,
+    EDGE,
+    MODEL,
+    POLYGON,
+    NUM_KINDS
+  };
+
+  struct Handle
+  {
+    Kind kind;
+    int idx;  // into the level's vector of that kind
+  };
+
+  /// How a click or drag combines with what is already selected
+  enum Mode {
+    REPLACE = 0,
+    ADD,
+    REMOVE,
+    TOGGLE
+  };
+
+  Selection();
+  ~Selection();
+
+  /// Shift adds, Ctrl toggles, and both together remove
+  static Mode mode_from_keys(const bool shift, const bool control);
+
+  /// Start over from the flags in the level, in O(size of the level)
+  void rebuild(const Level &level);
+
+  /// Deselect everything
+  void clear(Level &level);
+
+  /// Forget everything without touching the flags, for when the level
+  /// itself has been replaced
+  void reset();
+
+  /// Things of this kind were removed from the level at these indices,
+  /// sorted, as they were numbered before any of them went
+  void removed(const Kind kind, const std::vector<int> &removed_idx);
+
+  void set(Level &level, const Handle &handle, const bool selected);
+
+  /// Combine these handles with the selection. REPLACE clears it first.
+  void apply(
+      Level &level,
+      const std::vector<Handle> &handles,
+      const Mode mode);
+
+  bool contains(const Handle &handle) const;
+  bool empty() const;
+  int size() const;
+
+  /// The selected indices of one kind, in no particular order
+  const std::vector<int> &get(const Kind kind) const
+  { return sets[kind].dense; }
+
+private:
+  struct SparseSet
+  {
+    std::vector<int> dense;  // the members
+    std::vector<int> sparse;  // where each index is in 'dense', or -1
+
+    bool contains(const int idx) const;
+    void insert(const int idx);
+    void erase(const int idx);
+    void clear();
+  };
+
+  SparseSet sets[NUM_KINDS];
+
+  /// The flag for this handle, or nullptr if it is out of range
+  static bool *flag(Level &level, const Handle &handle);
+};
+
+#endif
@@ -0,0 +1,375 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include <QSettings>
+
+#include "preferences_keys.h"
+#include "snap_engine.h"
+using std::vector;
+
+
+SnapEngine::SnapEngine()
+: radius_pixels(8.0),
+  grid_meters(0.5),
+  built(false),
+  moving_vertex_idx(-1),
+  meters_per_pixel(1.0)
+{
+}
+
+SnapEngine::~SnapEngine()
+{
+}
+
+void SnapEngine::load_settings()
+{
+  QSettings settings;
+  radius_pixels = settings.value(
+      preferences_keys::snap_radius_pixels, radius_pixels).toDouble();
+  grid_meters = settings.value(
+      preferences_keys::snap_grid_meters, grid_meters).toDouble();
+}
+
+void SnapEngine::clear()
+{
+  built = false;
+  moving_vertex_idx = -1;
+  vertices.clear();
+  vertex_indices.clear();
+  vertex_grid.clear();
+  segments.clear();
+  segment_grid.clear();
+  neighbour_alignments.clear();
+}
+
+void SnapEngine::build(const Level &level, const int _moving_vertex_idx)
+{
+  clear();
+  moving_vertex_idx = _moving_vertex_idx;
+  meters_per_pixel = level.drawing_meters_per_pixel;
+
+  const double cell_size = 2.0 / meters_per_pixel;  // 2-meter cells
+  vertex_grid.clear(cell_size);
+  segment_grid.clear(cell_size);
+
+  const int num_vertices = static_cast<int>(level.vertices.size());
+  for (int i = 0; i < num_vertices; i++) {
+    if (i == moving_vertex_idx)
+      continue;
+    const Vertex &v = level.vertices[i];
+    vertex_grid.insert_point(static_cast<int>(vertices.size()), v.x, v.y);
+    vertices.push_back(QPointF(v.x, v.y));
+    vertex_indices.push_back(i);
+  }
+
+  vector<int> neighbours;
+  for (const Edge &edge : level.edges) {
+    if (edge.start_idx < 0 || edge.start_idx >= num_vertices ||
+        edge.end_idx < 0 || edge.end_idx >= num_vertices)
+      continue;
+    if (edge.start_idx == moving_vertex_idx) {
+      neighbours.push_back(edge.end_idx);
+      continue;
+    }
+    if (edge.end_idx == moving_vertex_idx) {
+      neighbours.push_back(edge.start_idx);
+      continue;
+    }
+    if (edge.type != Edge::WALL && edge.type != Edge::LANE)
+      continue;
+    const Vertex &v1 = level.vertices[edge.start_idx];
+    const Vertex &v2 = level.vertices[edge.end_idx];
+    segment_grid.insert_segment(
+        static_cast<int>(segments.size()), v1.x, v1.y, v2.x, v2.y, 0.0);
+    segments.push_back(QLineF(v1.x, v1.y, v2.x, v2.y));
+  }
+
+  std::sort(neighbours.begin(), neighbours.end());
+  neighbours.erase(
+      std::unique(neighbours.begin(), neighbours.end()),
+      neighbours.end());
+  for (const int neighbour_idx : neighbours) {
+    const Vertex &n = level.vertices[neighbour_idx];
+    const QPointF origin(n.x, n.y);
+    add_alignments(origin, QPointF(1.0, 0.0), neighbour_alignments);
+
+    // carry on straight from the neighbour's other edges, or turn square
+    for (const Edge &edge : level.edges) {
+      int other_idx = -1;
+      if (edge.start_idx == neighbour_idx)
+        other_idx = edge.end_idx;
+      else if (edge.end_idx == neighbour_idx)
+        other_idx = edge.start_idx;
+      if (other_idx < 0 || other_idx >= num_vertices ||
+          other_idx == moving_vertex_idx)
+        continue;
+      const Vertex &other = level.vertices[other_idx];
+      add_alignments(
+          origin,
+          QPointF(n.x - other.x, n.y - other.y),
+          neighbour_alignments);
+    }
+  }
+
+  built = true;
+}
+
+void SnapEngine::add_alignments(
+    const QPointF &origin,
+    const QPointF &direction,
+    vector<Alignment> &alignments) const
+{
+  const double length = std::hypot(direction.x(), direction.y());
+  if (length <= 0.0)
+    return;
+  Alignment a;
+  a.origin = origin;
+  a.direction = direction / length;
+  alignments.push_back(a);
+  a.direction = QPointF(-a.direction.y(), a.direction.x());
+  alignments.push_back(a);
+}
+
+void SnapEngine::nearby_alignments(
+    const QPointF &p,
+    const double radius,
+    vector<Alignment> &alignments) const
+{
+  // a new vertex lines up with the closest few vertices around it
+  const double reach = std::max(radius, 10.0 / meters_per_pixel);
+  vector<int> candidates;
+  vertex_grid.query_box(
+      p.x() - reach,
+      p.y() - reach,
+      p.x() + reach,
+      p.y() + reach,
+      candidates);
+  if (candidates.size() > static_cast<size_t>(MAX_CANDIDATES))
+    candidates.resize(MAX_CANDIDATES);
+
+  vector<std::pair<double, int> > by_distance;
+  for (const int i : candidates) {
+    const QPointF d = vertices[i] - p;
+    by_distance.push_back(std::make_pair(QPointF::dotProduct(d, d), i));
+  }
+  const size_t n = std::min(
+      by_distance.size(), static_cast<size_t>(MAX_ALIGNMENT_VERTICES));
+  std::partial_sort(
+      by_distance.begin(), by_distance.begin() + n, by_distance.end());
+  for (size_t i = 0; i < n; i++)
+    add_alignments(vertices[by_distance[i].second], QPointF(1, 0), alignments);
+}
+
+double SnapEngine::distance_to_line(const QPointF &p, const Alignment &line)
+{
+  const QPointF d = p - line.origin;
+  return std::abs(
+      d.x() * line.direction.y() - d.y() * line.direction.x());
+}
+
+QPointF SnapEngine::project(const QPointF &p, const Alignment &line)
+{
+  return line.origin +
+      QPointF::dotProduct(p - line.origin, line.direction) * line.direction;
+}
+
+bool SnapEngine::intersect_lines(
+    const Alignment &a,
+    const Alignment &b,
+    QPointF &point)
+{
+  const double d =
+      a.direction.x() * b.direction.y() - a.direction.y() * b.direction.x();
+  if (std::abs(d) < 1e-6)
+    return false;  // parallel, or as good as
+  const QPointF q = b.origin - a.origin;
+  const double t = (q.x() * b.direction.y() - q.y() * b.direction.x()) / d;
+  point = a.origin + t * a.direction;
+  return true;
+}
+
+bool SnapEngine::intersect_segment(
+    const Alignment &line,
+    const QLineF &segment,
+    QPointF &point)
+{
+  const QPointF s = segment.p2() - segment.p1();
+  const double d = line.direction.x() * s.y() - line.direction.y() * s.x();
+  if (std::abs(d) < 1e-9 * segment.length())
+    return false;
+  const QPointF q = segment.p1() - line.origin;
+  const double u =
+      (q.x() * line.direction.y() - q.y() * line.direction.x()) / d;
+  if (u < 0.0 || u > 1.0)
+    return false;
+  point = segment.p1() + u * s;
+  return true;
+}
+
+SnapEngine::Snap SnapEngine::unsnapped(const QPointF &p)
+{
+  Snap s;
+  s.point = p;
+  s.kind = NONE;
+  s.vertex_idx = -1;
+  return s;
+}
+
+SnapEngine::Snap SnapEngine::snap(
+    const QPointF &p,
+    const double view_scale) const
+{
+  Snap s = unsnapped(p);
+  if (!built || radius_pixels <= 0.0 || view_scale <= 0.0)
+    return s;
+  const double r = radius_pixels / view_scale;
+
+  vector<int> candidates;
+  if (moving_vertex_idx < 0) {
+    vertex_grid.query_box(p.x() - r, p.y() - r, p.x() + r, p.y() + r,
+        candidates);
+    if (candidates.size() > static_cast<size_t>(MAX_CANDIDATES))
+      candidates.resize(MAX_CANDIDATES);
+    int nearest = -1;
+    double nearest_dist = r;
+    for (const int i : candidates) {
+      const double dist = QLineF(p, vertices[i]).length();
+      if (dist <= nearest_dist) {
+        nearest = i;
+        nearest_dist = dist;
+      }
+    }
+    if (nearest >= 0) {
+      s.point = vertices[nearest];
+      s.kind = VERTEX;
+      s.vertex_idx = vertex_indices[nearest];
+      return s;
+    }
+  }
+
+  // the alignment lines within reach, closest first
+  vector<Alignment> all_alignments;
+  if (moving_vertex_idx >= 0)
+    all_alignments = neighbour_alignments;
+  else
+    nearby_alignments(p, r, all_alignments);
+  vector<std::pair<double, int> > in_reach;
+  for (size_t i = 0; i < all_alignments.size(); i++) {
+    const double dist = distance_to_line(p, all_alignments[i]);
+    if (dist <= r)
+      in_reach.push_back(std::make_pair(dist, static_cast<int>(i)));
+  }
+  std::sort(in_reach.begin(), in_reach.end());
+
+  // the closest wall or lane
+  candidates.clear();
+  segment_grid.query_box(p.x() - r, p.y() - r, p.x() + r, p.y() + r,
+      candidates);
+  if (candidates.size() > static_cast<size_t>(MAX_CANDIDATES))
+    candidates.resize(MAX_CANDIDATES);
+  int nearest_segment = -1;
+  double nearest_dist = r;
+  QPointF nearest_point;
+  for (const int i : candidates) {
+    const QLineF &segment = segments[i];
+    const QPointF d = segment.p2() - segment.p1();
+    const double length_sq = QPointF::dotProduct(d, d);
+    if (length_sq <= 0.0)
+      continue;
+    const double t = std::max(0.0, std::min(1.0,
+        QPointF::dotProduct(p - segment.p1(), d) / length_sq));
+    const QPointF q = segment.p1() + t * d;
+    const double dist = QLineF(p, q).length();
+    if (dist <= nearest_dist) {
+      nearest_segment = i;
+      nearest_dist = dist;
+      nearest_point = q;
+    }
+  }
+
+  if (nearest_segment >= 0) {
+    const QLineF &segment = segments[nearest_segment];
+    s.point = nearest_point;
+    s.kind = EDGE;
+    s.guides.push_back(segment);
+    // better yet, where an alignment line crosses it
+    for (const auto &entry : in_reach) {
+      const Alignment &line = all_alignments[entry.second];
+      QPointF x;
+      if (intersect_segment(line, segment, x) && QLineF(p, x).length() <= r) {
+        s.point = x;
+        s.guides.push_back(QLineF(line.origin, x));
+        break;
+      }
+    }
+    return s;
+  }
+
+  if (!in_reach.empty()) {
+    const Alignment &best = all_alignments[in_reach[0].second];
+    for (size_t i = 1; i < in_reach.size(); i++) {
+      const Alignment &other = all_alignments[in_reach[i].second];
+      QPointF x;
+      if (intersect_lines(best, other, x) && QLineF(p, x).length() <= r) {
+        s.point = x;
+        s.kind = ALIGNMENT;
+        s.guides.push_back(QLineF(best.origin, x));
+        s.guides.push_back(QLineF(other.origin, x));
+        return s;
+      }
+    }
+
+    // slide along a horizontal or vertical line to the grid
+    QPointF q = project(p, best);
+    if (grid_meters > 0.0) {
+      const double g = grid_meters / meters_per_pixel;
+      if (std::abs(best.direction.y()) < 1e-9) {
+        const double gx = std::round(q.x() / g) * g;
+        if (std::abs(gx - q.x()) <= r)
+          q.setX(gx);
+      }
+      else if (std::abs(best.direction.x()) < 1e-9) {
+        const double gy = std::round(q.y() / g) * g;
+        if (std::abs(gy - q.y()) <= r)
+          q.setY(gy);
+      }
+    }
+    s.point = q;
+    s.kind = ALIGNMENT;
+    s.guides.push_back(QLineF(best.origin, q));
+    return s;
+  }
+
+  if (grid_meters > 0.0) {
+    const double g = grid_meters / meters_per_pixel;
+    const double gx = std::round(p.x() / g) * g;
+    const double gy = std::round(p.y() / g) * g;
+    if (std::abs(gx - p.x()) <= r) {
+      s.point.setX(gx);
+      s.kind = GRID;
+    }
+    if (std::abs(gy - p.y()) <= r) {
+      s.point.setY(gy);
+      s.kind = GRID;
+    }
+  }
+  return s;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SNAP_ENGINE_H
+#define SNAP_ENGINE_H
+
+/*
+ * Snaps a vertex that is being placed or dragged onto nearby things, so
+ * that walls and lanes can be lined up without doing it by eye. From
+ * the most to the least specific, the targets are:
+ *
+ *   - an existing vertex (only for new vertices; a dragged vertex would
+ *     end up on top of it)
+ *   - the nearest point on a wall or lane, or where that wall or lane
+ *     crosses one of the alignment lines below
+ *   - alignment lines: horizontal and vertical through the neighbours
+ *     of the vertex, and through its neighbours' other edges, both
+ *     straight on and square to them. A new vertex has no neighbours,
+ *     so the vertices around it are used instead.
+ *   - a metric grid
+ *
+ * The level is copied into spatial grids once, when a drag starts, so
+ * each mouse event only looks at the cells around the cursor and a
+ * capped number of candidates in them: the cost of a snap doesn't grow
+ * with the size of the map.
+ */
+
+#include <vector>
+
+#include <QLineF>
+#include <QPointF>
+
+#include "level.h"
+#include "spatial_grid.h"
+
+
+class SnapEngine
+{
+public:
+  enum Kind {
+    NONE = 0,
+    VERTEX,
+    EDGE,
+    ALIGNMENT,
+    GRID
+  };
+
+  struct Snap
+  {
+    QPointF point;  // where the vertex goes; the cursor if kind is NONE
+    Kind kind;
+    int vertex_idx;  // the vertex snapped onto, or -1
+    std::vector<QLineF> guides;  // what it lined up with, to be shown
+  };
+
+  SnapEngine();
+  ~SnapEngine();
+
+  // from the preferences; both can be zero to turn them off
+  double radius_pixels;  // how far (on screen) to look for targets
+  double grid_meters;
+
+  void load_settings();
+
+  /// Copy what a vertex can snap to out of the level. The moving vertex
+  /// (-1 for a new one) and the edges attached to it are left out.
+  void build(const Level &level, const int _moving_vertex_idx);
+
+  /// Forget the level; call this whenever it changes
+  void clear();
+
+  bool is_built() const { return built; }
+  int get_moving_vertex_idx() const { return moving_vertex_idx; }
+
+  /// Where a vertex at p should go, at this many screen pixels per
+  /// scene unit
+  Snap snap(const QPointF &p, const double view_scale) const;
+
+  /// Leave the vertex at p
+  static Snap unsnapped(const QPointF &p);
+
+private:
+  /// An infinite line through a vertex, in a unit direction
+  struct Alignment
+  {
+    QPointF origin;
+    QPointF direction;
+  };
+
+  /// Caps on the work done per snap, however crowded the map is
+  static const int MAX_CANDIDATES = 64;
+  static const int MAX_ALIGNMENT_VERTICES = 8;
+
+  bool built;
+  int moving_vertex_idx;
+  double meters_per_pixel;
+
+  std::vector<QPointF> vertices;
+  std::vector<int> vertex_indices;  // in Level::vertices
+  SpatialGrid vertex_grid;  // indices into 'vertices'
+
+  std::vector<QLineF> segments;  // walls and lanes
+  SpatialGrid segment_grid;  // indices into 'segments'
+
+  std::vector<Alignment> neighbour_alignments;
+
+  void add_alignments(
+      const QPointF &origin,
+      const QPointF &direction,
+      std::vector<Alignment> &alignments) const;
+  void nearby_alignments(
+      const QPointF &p,
+      const double radius,
+      std::vector<Alignment> &alignments) const;
+
+  static double distance_to_line(const QPointF &p, const Alignment &line);
+  static QPointF project(const QPointF &p, const Alignment &line);
+  static bool intersect_lines(
+      const Alignment &a,
+      const Alignment &b,
+      QPointF &point);
+  static bool intersect_segment(
+      const Alignment &line,
+      const QLineF &segment,
+      QPointF &point);
+};
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QPainter>
+
+#include "snap_guide_item.h"
+
+
+SnapGuideItem::SnapGuideItem(
+    const SnapEngine::Snap &snap,
+    const double _marker_radius)
+: point(snap.point),
+  kind(snap.kind),
+  guides(snap.guides),
+  marker_radius(_marker_radius)
+{
+  bounds = QRectF(
+      point.x() - marker_radius,
+      point.y() - marker_radius,
+      2.0 * marker_radius,
+      2.0 * marker_radius);
+  for (const QLineF &guide : guides)
+    bounds |= QRectF(guide.p1(), guide.p2()).normalized();
+  // room for the cosmetic pen at any zoom
+  bounds.adjust(-marker_radius, -marker_radius, marker_radius, marker_radius);
+}
+
+SnapGuideItem::~SnapGuideItem()
+{
+}
+
+QRectF SnapGuideItem::boundingRect() const
+{
+  return bounds;
+}
+
+void SnapGuideItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *,
+    QWidget *)
+{
+  // magenta doesn't appear anywhere else in the editor
+  const QColor color = QColor::fromRgbF(1.0, 0.0, 1.0, 0.8);
+  QPen pen(color, 0.0, Qt::DashLine);  // zero width: cosmetic
+  painter->setPen(pen);
+  painter->setBrush(Qt::NoBrush);
+  for (const QLineF &guide : guides)
+    painter->drawLine(guide);
+
+  pen.setStyle(Qt::SolidLine);
+  painter->setPen(pen);
+  if (kind == SnapEngine::VERTEX || kind == SnapEngine::EDGE)
+    painter->setBrush(color);
+  painter->drawRect(
+      QRectF(
+        point.x() - marker_radius,
+        point.y() - marker_radius,
+        2.0 * marker_radius,
+        2.0 * marker_radius));
+}
+
+bool SnapGuideItem::contains(const QPointF &) const
+{
+  return false;
+}
+
+bool SnapGuideItem::collidesWithPath(
+    const QPainterPath &,
+    Qt::ItemSelectionMode) const
+{
+  return false;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SNAP_GUIDE_ITEM_H
+#define SNAP_GUIDE_ITEM_H
+
+/*
+ * Shows what a vertex snapped to while it is placed or dragged: dashed
+ * lines along the walls, lanes and alignments it lined up with, and a
+ * small square where it will go. Like the other overlays, the item
+ * ignores the mouse.
+ */
+
+#include <vector>
+
+#include <QGraphicsItem>
+
+#include "snap_engine.h"
+
+
+class SnapGuideItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 6 };
+
+  /// The marker is 'marker_radius' scene units from its center to its
+  /// sides; the lines are always drawn one screen pixel wide
+  SnapGuideItem(const SnapEngine::Snap &snap, const double _marker_radius);
+  ~SnapGuideItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+  bool contains(const QPointF &point) const override;
+  bool collidesWithPath(
+      const QPainterPath &path,
+      Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+private:
+  QPointF point;
+  SnapEngine::Kind kind;
+  std::vector<QLineF> guides;
+  double marker_radius;
+  QRectF bounds;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include "spatial_grid.h"
+using std::vector;
+
+
+SpatialGrid::SpatialGrid(const double _cell_size)
+: cell_size(_cell_size > 0.0 ? _cell_size : 1.0)
+{
+}
+
+SpatialGrid::~SpatialGrid()
+{
+}
+
+void SpatialGrid::clear()
+{
+  cells.clear();
+}
+
+void SpatialGrid::clear(const double _cell_size)
+{
+  cells.clear();
+  cell_size = _cell_size > 0.0 ? _cell_size : 1.0;
+}
+
+int SpatialGrid::cell_coord(const double v) const
+{
+  return static_cast<int>(std::floor(v / cell_size));
+}
+
+uint64_t SpatialGrid::cell_key(const int cx, const int cy)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) |
+      static_cast<uint32_t>(cy);
+}
+
+void SpatialGrid::insert_cell(const int id, const int cx, const int cy)
+{
+  vector<int> &cell = cells[cell_key(cx, cy)];
+  // the same ID is usually inserted into a cell several times in a row
+  // by insert_segment(), so checking the last entry catches most repeats
+  if (cell.empty() || cell.back() != id)
+    cell.push_back(id);
+}
+
+void SpatialGrid::insert_point(const int id, const double x, const double y)
+{
+  insert_cell(id, cell_coord(x), cell_coord(y));
+}
+
+void SpatialGrid::insert_box(
+    const int id,
+    const double min_x,
+    const double min_y,
+    const double max_x,
+    const double max_y)
+{
+  const int cx0 = cell_coord(min_x);
+  const int cy0 = cell_coord(min_y);
+  const int cx1 = cell_coord(max_x);
+  const int cy1 = cell_coord(max_y);
+  for (int cy = cy0; cy <= cy1; cy++)
+    for (int cx = cx0; cx <= cx1; cx++)
+      insert_cell(id, cx, cy);
+}
+
+void SpatialGrid::insert_segment(
+    const int id,
+    const double x0,
+    const double y0,
+    const double x1,
+    const double y1,
+    const double radius)
+{
+  const double dx = x1 - x0;
+  const double dy = y1 - y0;
+  const double len = std::sqrt(dx * dx + dy * dy);
+
+  // step along the segment in half-cell increments, inserting the
+  // (small) box around each step. This over-covers slightly, which is
+  // fine for a candidate list.
+  const double step = cell_size / 2.0;
+  const int num_steps = static_cast<int>(std::ceil(len / step));
+  const double r = radius + step / 2.0;
+  for (int i = 0; i <= num_steps; i++) {
+    const double t = num_steps > 0 ? static_cast<double>(i) / num_steps : 0.0;
+    const double x = x0 + t * dx;
+    const double y = y0 + t * dy;
+    insert_box(id, x - r, y - r, x + r, y + r);
+  }
+}
+
+void SpatialGrid::remove_box(
+    const int id,
+    const double min_x,
+    const double min_y,
+    const double max_x,
+    const double max_y)
+{
+  const int cx0 = cell_coord(min_x);
+  const int cy0 = cell_coord(min_y);
+  const int cx1 = cell_coord(max_x);
+  const int cy1 = cell_coord(max_y);
+  for (int cy = cy0; cy <= cy1; cy++) {
+    for (int cx = cx0; cx <= cx1; cx++) {
+      auto it = cells.find(cell_key(cx, cy));
+      if (it == cells.end())
+        continue;
+      vector<int> &cell = it->second;
+      cell.erase(std::remove(cell.begin(), cell.end(), id), cell.end());
+      if (cell.empty())
+        cells.erase(it);
+    }
+  }
+}
+
+void SpatialGrid::query_box(
+    const double min_x,
+    const double min_y,
+    const double max_x,
+    const double max_y,
+    vector<int> &ids) const
+{
+  const size_t first = ids.size();
+  const int cx0 = cell_coord(min_x);
+  const int cy0 = cell_coord(min_y);
+  const int cx1 = cell_coord(max_x);
+  const int cy1 = cell_coord(max_y);
+
+  // For huge query boxes (zoomed all the way out) it is cheaper to walk
+  // the occupied cells than every cell of the box.
+  const double box_cells =
+      (static_cast<double>(cx1) - cx0 + 1) * (static_cast<double>(cy1) - cy0 + 1);
+  if (box_cells > static_cast<double>(cells.size())) {
+    for (const auto &it : cells) {
+      const int cx = static_cast<int32_t>(it.first >> 32);
+      const int cy = static_cast<int32_t>(it.first & 0xffffffff);
+      if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1)
+        ids.insert(ids.end(), it.second.begin(), it.second.end());
+    }
+  }
+  else {
+    for (int cy = cy0; cy <= cy1; cy++) {
+      for (int cx = cx0; cx <= cx1; cx++) {
+        auto it = cells.find(cell_key(cx, cy));
+        if (it != cells.end())
+          ids.insert(ids.end(), it->second.begin(), it->second.end());
+      }
+    }
+  }
+
+  // an ID that spans several cells was found several times
+  std::sort(ids.begin() + first, ids.end());
+  ids.erase(std::unique(ids.begin() + first, ids.end()), ids.end());
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+/*
+ * A uniform-grid spatial hash of integer IDs (usually indices into one
+ * of the Level vectors). Only the occupied cells are stored, so it works
+ * for sparse maps of any size. Queries return each ID at most once.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+class SpatialGrid
+{
+public:
+  SpatialGrid(const double _cell_size = 64.0);
+  ~SpatialGrid();
+
+  /// Remove everything and (optionally) change the cell size
+  void clear();
+  void clear(const double _cell_size);
+
+  double get_cell_size() const { return cell_size; }
+
+  void insert_point(const int id, const double x, const double y);
+
+  /// Insert an ID into every cell overlapping this box
+  void insert_box(
+      const int id,
+      const double min_x,
+      const double min_y,
+      const double max_x,
+      const double max_y);
+
+  /// Insert an ID into the cells within 'radius' of this line segment.
+  /// Unlike insert_box(), long diagonal segments only touch the cells
+  /// along their length, not the whole bounding box.
+  void insert_segment(
+      const int id,
+      const double x0,
+      const double y0,
+      const double x1,
+      const double y1,
+      const double radius);
+
+  /// Remove an ID from the cells overlapping this box. The box must
+  /// cover the box (or segment) that it was inserted with.
+  void remove_box(
+      const int id,
+      const double min_x,
+      const double min_y,
+      const double max_x,
+      const double max_y);
+
+  /// Append the IDs in the cells overlapping this box to 'ids'. These
+  /// are candidates only: callers should do their own exact test.
+  void query_box(
+      const double min_x,
+      const double min_y,
+      const double max_x,
+      const double max_y,
+      std::vector<int> &ids) const;
+
+  std::size_t num_cells() const { return cells.size(); }
+
+private:
+  double cell_size;
+  std::unordered_map<uint64_t, std::vector<int> > cells;
+
+  int cell_coord(const double v) const;
+  static uint64_t cell_key(const int cx, const int cy);
+  void insert_cell(const int id, const int cx, const int cy);
+};
+
+#endif
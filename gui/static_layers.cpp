@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QPainter>
+
+#include "static_layers.h"
+
+
+StaticLayers::StaticLayers()
+{
+}
+
+StaticLayers::~StaticLayers()
+{
+}
+
+QRectF StaticLayers::bounding_rect() const
+{
+  QRectF bounds(scene_rect);
+  for (const QPolygonF &polygon : polygons)
+    bounds |= polygon.boundingRect();
+  for (const auto &layer : edge_layers)
+    bounds |= layer->bounding_rect();
+  if (vertex_layer)
+    bounds |= vertex_layer->bounding_rect();
+  return bounds;
+}
+
+void StaticLayers::paint(
+    QPainter *painter,
+    const QRectF &exposed,
+    const double view_scale) const
+{
+  if (drawing)
+    drawing->paint(painter, exposed, view_scale);
+  else {
+    painter->setPen(QPen());
+    painter->setBrush(Qt::white);
+    painter->drawRect(scene_rect);
+  }
+
+  painter->setPen(QPen(Qt::black));
+  for (size_t i = 0; i < polygons.size(); i++) {
+    if (!polygons[i].boundingRect().intersects(exposed))
+      continue;
+    painter->setBrush(polygon_brushes[i]);
+    painter->drawPolygon(polygons[i]);
+  }
+
+  for (const auto &layer : edge_layers)
+    layer->paint(painter, exposed, view_scale);
+
+  if (vertex_layer)
+    vertex_layer->paint(painter, exposed, view_scale);
+}
@@ -0,0 +1,71 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef STATIC_LAYERS_H
+#define STATIC_LAYERS_H
+
+/*
+ * A read-only snapshot of the parts of a level that don't change while
+ * something is being dragged around: the drawing, and the polygons,
+ * edges and vertices that aren't attached to the thing being dragged.
+ * Everything in here is safe to paint from worker threads, so there is
+ * no QPixmap or QGraphicsItem in sight; the drawing is shared with the
+ * level, not copied.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <QBrush>
+#include <QPolygonF>
+#include <QRectF>
+
+#include "drawing.h"
+#include "edge_layer.h"
+#include "vertex_layer.h"
+class QPainter;
+
+
+class StaticLayers
+{
+public:
+  StaticLayers();
+  ~StaticLayers();
+
+  QRectF scene_rect;
+  // if null, the scene rect is drawn as a blank sheet
+  std::shared_ptr<const Drawing> drawing;
+
+  std::vector<QPolygonF> polygons;
+  std::vector<QBrush> polygon_brushes;
+
+  std::vector<std::shared_ptr<const EdgeLayer> > edge_layers;
+  std::shared_ptr<const VertexLayer> vertex_layer;
+
+  /// The union of the scene rect and everything drawn in it
+  QRectF bounding_rect() const;
+
+  /// Paint everything near the exposed rectangle, in the same style as
+  /// Editor::create_scene(). The models are left out: they stay scene
+  /// items, drawn on top of the tiles.
+  void paint(
+      QPainter *painter,
+      const QRectF &exposed,
+      const double view_scale) const;
+};
+
+#endif
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+
+#include <QHash>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+
+#include "static_tile_cache.h"
+
+
+QRectF StaticTileKey::scene_rect(const int tile_size) const
+{
+  const double s = tile_size / scale;
+  return QRectF(x * s, y * s, s, s);
+}
+
+uint qHash(const StaticTileKey &key, uint seed)
+{
+  return qHash(key.x, seed) ^
+      (qHash(key.y, seed) * 31) ^
+      qHash(key.scale, seed);
+}
+
+
+/*
+ * Worker-thread half of the cache. The layers are immutable and shared,
+ * so the task only has to hold a reference to them while it paints.
+ */
+class StaticTileRenderTask : public QRunnable
+{
+public:
+  StaticTileRenderTask(
+      StaticTileCache *_cache,
+      const std::shared_ptr<const StaticLayers> &_layers,
+      const StaticTileKey &_key,
+      const int _generation)
+  : cache(_cache),
+    layers(_layers),
+    key(_key),
+    generation(_generation)
+  {
+  }
+
+  void run() override
+  {
+    const int size = StaticTileCache::TILE_SIZE;
+    const QRectF rect = key.scene_rect(size);
+
+    QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.scale(key.scale, key.scale);
+    painter.translate(-rect.topLeft());
+    painter.setClipRect(rect);
+    layers->paint(&painter, rect, key.scale);
+    painter.end();
+
+    QMetaObject::invokeMethod(
+        cache,
+        "tile_rendered",
+        Qt::QueuedConnection,
+        Q_ARG(int, key.x),
+        Q_ARG(int, key.y),
+        Q_ARG(double, key.scale),
+        Q_ARG(QImage, image),
+        Q_ARG(int, generation));
+  }
+
+private:
+  StaticTileCache *cache;
+  const std::shared_ptr<const StaticLayers> layers;
+  const StaticTileKey key;
+  const int generation;
+};
+
+
+StaticTileCache::StaticTileCache(QObject *parent)
+: QObject(parent),
+  generation(0)
+{
+  // leave one core for the UI thread if we can
+  pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+  set_memory_budget(64);
+}
+
+StaticTileCache::~StaticTileCache()
+{
+  pool.clear();  // drop the tasks that haven't started yet
+  pool.waitForDone();
+}
+
+void StaticTileCache::set_memory_budget(const int megabytes)
+{
+  tiles.setMaxCost(std::max(1, megabytes) * 1024);
+}
+
+void StaticTileCache::set_layers(
+    const std::shared_ptr<const StaticLayers> &_layers)
+{
+  layers = _layers;
+  layers_bounds = layers ? layers->bounding_rect() : QRectF();
+}
+
+void StaticTileCache::invalidate(const QRectF &rect)
+{
+  // Tiles in flight may have been painted from the old layers. Rather
+  // than tracking which ones overlap, drop them all; the ones that are
+  // still needed will simply be requested again.
+  pool.clear();
+  generation++;
+  pending.clear();
+
+  if (rect.isEmpty())
+    return;
+  for (const StaticTileKey &key : tiles.keys()) {
+    if (key.scene_rect(TILE_SIZE).intersects(rect))
+      tiles.remove(key);
+  }
+}
+
+void StaticTileCache::clear()
+{
+  pool.clear();
+  generation++;
+  pending.clear();
+  tiles.clear();
+  layers.reset();
+  layers_bounds = QRectF();
+}
+
+void StaticTileCache::paint(
+    QPainter *painter,
+    const QRectF &exposed,
+    const double view_scale)
+{
+  if (!layers || view_scale <= 0.0)
+    return;
+
+  const QRectF r = exposed & layers_bounds;
+  if (r.isEmpty())
+    return;
+
+  const double s = TILE_SIZE / view_scale;  // tile size in scene units
+  const int x0 = static_cast<int>(std::floor(r.left() / s));
+  const int y0 = static_cast<int>(std::floor(r.top() / s));
+  const int x1 = static_cast<int>(std::floor(r.right() / s));
+  const int y1 = static_cast<int>(std::floor(r.bottom() / s));
+
+  for (int y = y0; y <= y1; y++) {
+    for (int x = x0; x <= x1; x++) {
+      const StaticTileKey key { x, y, view_scale };
+      const QRectF tile_rect = key.scene_rect(TILE_SIZE);
+
+      const QImage *image = tiles.object(key);
+      if (image) {
+        painter->drawImage(tile_rect, *image);
+        continue;
+      }
+
+      request(key);
+
+      // paint this part directly in the meantime
+      const QRectF missing = tile_rect & exposed;
+      painter->save();
+      painter->setClipRect(missing, Qt::IntersectClip);
+      layers->paint(painter, missing, view_scale);
+      painter->restore();
+    }
+  }
+}
+
+void StaticTileCache::request(const StaticTileKey &key)
+{
+  if (pending.contains(key))
+    return;  // already on its way
+  pending.insert(key);
+  pool.start(new StaticTileRenderTask(this, layers, key, generation));
+}
+
+void StaticTileCache::tile_rendered(
+    int x,
+    int y,
+    double scale,
+    QImage image,
+    int request_generation)
+{
+  if (request_generation != generation)
+    return;  // the layers changed since the request
+
+  const StaticTileKey key { x, y, scale };
+  pending.remove(key);
+  const int cost_kb = std::max(1, image.byteCount() / 1024);
+  tiles.insert(key, new QImage(image), cost_kb);
+}
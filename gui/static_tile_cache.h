@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef STATIC_TILE_CACHE_H
+#define STATIC_TILE_CACHE_H
+
+/*
+ * Rasterizes a StaticLayers snapshot into square tiles of TILE_SIZE
+ * screen pixels, on a pool of worker threads, and keeps them in an LRU
+ * cache bounded by a memory budget. Tiles are aligned to the scene
+ * origin at the current zoom, so a tile is blitted 1:1 to the screen.
+ *
+ * Tiles that aren't ready yet are painted directly from the snapshot,
+ * so nothing ever flickers; the next frame will likely have the tile.
+ */
+
+#include <memory>
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QRectF>
+#include <QSet>
+#include <QThreadPool>
+
+#include "static_layers.h"
+class QPainter;
+
+
+struct StaticTileKey
+{
+  int x;
+  int y;
+  double scale;  // screen pixels per scene unit
+
+  bool operator==(const StaticTileKey &k) const
+  {
+    return x == k.x && y == k.y && scale == k.scale;
+  }
+
+  QRectF scene_rect(const int tile_size) const;
+};
+
+uint qHash(const StaticTileKey &key, uint seed = 0);
+
+
+class StaticTileCache : public QObject
+{
+  Q_OBJECT
+
+public:
+  StaticTileCache(QObject *parent = nullptr);
+  ~StaticTileCache();
+
+  static const int TILE_SIZE = 256;  // screen pixels
+
+  void set_memory_budget(const int megabytes);
+
+  /// Paint these layers from now on. This does not invalidate anything:
+  /// callers are expected to invalidate() where the new layers differ.
+  void set_layers(const std::shared_ptr<const StaticLayers> &_layers);
+
+  /// Drop the tiles overlapping this rectangle (in scene coordinates)
+  void invalidate(const QRectF &rect);
+
+  /// Drop all the tiles and the layers
+  void clear();
+
+  void paint(
+      QPainter *painter,
+      const QRectF &exposed,
+      const double view_scale);
+
+private:
+  std::shared_ptr<const StaticLayers> layers;
+  QRectF layers_bounds;
+
+  QThreadPool pool;
+  int generation;  // bumped whenever in-flight tiles become stale
+
+  QCache<StaticTileKey, QImage> tiles;  // costs are in kilobytes
+  QSet<StaticTileKey> pending;
+
+  void request(const StaticTileKey &key);
+
+  // called through a queued connection from the worker threads
+  Q_INVOKABLE void tile_rendered(
+      int x,
+      int y,
+      double scale,
+      QImage image,
+      int request_generation);
+};
+
+#endif
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <QStyleOptionGraphicsItem>
+
+#include "static_tile_cache.h"
+#include "static_tile_item.h"
+
+
+StaticTileItem::StaticTileItem(
+    StaticTileCache &_cache,
+    const QRectF &_bounds)
+: cache(_cache),
+  bounds(_bounds)
+{
+  // exposedRect is only filled in with this flag set
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+StaticTileItem::~StaticTileItem()
+{
+}
+
+QRectF StaticTileItem::boundingRect() const
+{
+  return bounds;
+}
+
+void StaticTileItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *option,
+    QWidget *)
+{
+  cache.paint(
+      painter,
+      option->exposedRect,
+      QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform()));
+}
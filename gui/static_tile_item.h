@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef STATIC_TILE_ITEM_H
+#define STATIC_TILE_ITEM_H
+
+/*
+ * Stands in for all the static items of the scene while something is
+ * being dragged, painting them from a StaticTileCache. The cache is
+ * owned by the editor, so it survives the scene being rebuilt.
+ */
+
+#include <QGraphicsItem>
+
+class StaticTileCache;
+
+
+class StaticTileItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 3 };
+
+  StaticTileItem(StaticTileCache &_cache, const QRectF &_bounds);
+  ~StaticTileItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+private:
+  StaticTileCache &cache;
+  const QRectF bounds;
+};
+
+#endif
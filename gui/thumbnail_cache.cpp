@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <climits>
+
+#include <QImageReader>
+#include <QPainter>
+#include <QRunnable>
+#include <QThread>
+
+#include "thumbnail_cache.h"
+
+
+/*
+ * Worker-thread half of the cache. Only QImage is used here, since
+ * QPixmap may only be touched by the UI thread.
+ */
+class ThumbnailDecodeTask : public QRunnable
+{
+public:
+  ThumbnailDecodeTask(
+      ThumbnailCache *_cache,
+      const int _model_id,
+      const QString &_filename,
+      const int _generation)
+  : cache(_cache),
+    model_id(_model_id),
+    filename(_filename),
+    generation(_generation)
+  {
+  }
+
+  void run() override
+  {
+    QImageReader image_reader(filename);
+    image_reader.setAutoTransform(true);
+    QImage image = image_reader.read();
+    QImage icon_image;
+    if (image.isNull()) {
+      qWarning("unable to read %s: %s",
+          qUtf8Printable(filename),
+          qUtf8Printable(image_reader.errorString()));
+    }
+    else {
+      icon_image = image.scaled(
+          ThumbnailCache::ICON_SIZE,
+          ThumbnailCache::ICON_SIZE,
+          Qt::KeepAspectRatio,
+          Qt::SmoothTransformation);
+    }
+
+    // hand the result back to the UI thread. If the cache has been
+    // destroyed in the meantime, it waits for this task before dying.
+    QMetaObject::invokeMethod(
+        cache,
+        "image_decoded",
+        Qt::QueuedConnection,
+        Q_ARG(int, model_id),
+        Q_ARG(QImage, image),
+        Q_ARG(QImage, icon_image),
+        Q_ARG(int, generation));
+  }
+
+private:
+  ThumbnailCache *cache;
+  const int model_id;
+  const QString filename;
+  const int generation;
+};
+
+
+ThumbnailCache::ThumbnailCache(
+    const ModelCatalog &_catalog,
+    QObject *parent)
+: QObject(parent),
+  catalog(_catalog),
+  request_priority(0),
+  generation(0)
+{
+  // leave one core for the UI thread if we can
+  pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+
+  set_memory_budget(256);
+
+  // a neutral grey square with an outline, shown while we wait
+  QImage placeholder_image(ICON_SIZE, ICON_SIZE, QImage::Format_ARGB32);
+  placeholder_image.fill(QColor(160, 160, 160, 128));
+  QPainter painter(&placeholder_image);
+  painter.setPen(QColor(96, 96, 96));
+  painter.drawRect(0, 0, ICON_SIZE - 1, ICON_SIZE - 1);
+  painter.end();
+  placeholder_pixmap = QPixmap::fromImage(placeholder_image);
+  placeholder_icon = placeholder_pixmap;
+}
+
+ThumbnailCache::~ThumbnailCache()
+{
+  pool.clear();  // drop the tasks that haven't started yet
+  pool.waitForDone();
+}
+
+void ThumbnailCache::set_thumbnail_path(const QString &path)
+{
+  if (path == thumbnail_path)
+    return;
+  thumbnail_path = path;
+  clear();
+}
+
+void ThumbnailCache::set_memory_budget(const int megabytes)
+{
+  // the icons are tiny, so give them a small fixed slice of the budget
+  const int budget_kb = std::max(1, megabytes) * 1024;
+  pixmaps.setMaxCost(budget_kb - budget_kb / 16);
+  icons.setMaxCost(budget_kb / 16);
+}
+
+void ThumbnailCache::clear()
+{
+  pool.clear();
+  generation++;  // anything still in flight is now stale
+  request_priority = 0;
+  pending.clear();
+  failed.clear();
+  pixmaps.clear();
+  icons.clear();
+}
+
+int ThumbnailCache::cost_kb(const QPixmap &pixmap)
+{
+  const qint64 bytes =
+      static_cast<qint64>(pixmap.width()) * pixmap.height() *
+      std::max(8, pixmap.depth()) / 8;
+  return static_cast<int>(std::max<qint64>(1, bytes / 1024));
+}
+
+bool ThumbnailCache::is_loaded(const int model_id) const
+{
+  return pixmaps.contains(model_id);
+}
+
+QPixmap ThumbnailCache::pixmap(const int model_id)
+{
+  const QPixmap *p = pixmaps.object(model_id);  // also marks it as used
+  if (p)
+    return *p;
+  if (failed.count(model_id))
+    return QPixmap();
+  request(model_id);
+  return placeholder_pixmap;
+}
+
+QPixmap ThumbnailCache::icon(const int model_id)
+{
+  const QPixmap *p = icons.object(model_id);
+  if (p)
+    return *p;
+  if (failed.count(model_id))
+    return QPixmap();
+  request(model_id);
+  return placeholder_icon;
+}
+
+void ThumbnailCache::request(const int model_id)
+{
+  if (model_id < 0 || model_id >= static_cast<int>(catalog.models.size()))
+    return;
+  if (pending.count(model_id))
+    return;  // already on its way
+
+  // priorities only order the requests still queued, so the count can
+  // start over whenever the queue drains, and wraps rather than overflow
+  if (pending.empty() || request_priority == INT_MAX)
+    request_priority = 0;
+  pending.insert(model_id);
+
+  const QString filename =
+      thumbnail_path +
+      "/images/cropped/" +
+      QString::fromStdString(catalog.models[model_id].name) +
+      ".png";
+
+  // QThreadPool runs higher priorities first, so the most recently
+  // requested thumbnails (usually the ones on screen) are decoded first
+  pool.start(
+      new ThumbnailDecodeTask(this, model_id, filename, generation),
+      request_priority++);
+}
+
+void ThumbnailCache::image_decoded(
+    int model_id,
+    QImage image,
+    QImage icon_image,
+    int request_generation)
+{
+  if (request_generation != generation)
+    return;  // the catalog or thumbnail path changed since the request
+  pending.erase(model_id);
+
+  if (image.isNull()) {
+    failed.insert(model_id);
+  }
+  else {
+    QPixmap *p = new QPixmap(QPixmap::fromImage(image));
+    // a single thumbnail bigger than the whole budget still has to be
+    // stored, otherwise it would be decoded over and over again
+    pixmaps.insert(model_id, p, std::min(cost_kb(*p), pixmaps.maxCost()));
+
+    QPixmap *i = new QPixmap(QPixmap::fromImage(icon_image));
+    icons.insert(model_id, i, std::min(cost_kb(*i), icons.maxCost()));
+  }
+  emit thumbnail_loaded(model_id);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef THUMBNAIL_CACHE_H
+#define THUMBNAIL_CACHE_H
+
+/*
+ * Loads model thumbnails on a pool of worker threads and keeps the
+ * decoded pixmaps in an LRU cache bounded by a memory budget. Callers
+ * get a placeholder pixmap back while the thumbnail is loading, and
+ * the thumbnail_loaded() signal is emitted (on the UI thread) once the
+ * real thumbnail is available.
+ */
+
+#include <unordered_set>
+
+#include <QCache>
+#include <QImage>
+#include <QObject>
+#include <QPixmap>
+#include <QString>
+#include <QThreadPool>
+
+#include "model_catalog.h"
+
+
+class ThumbnailCache : public QObject
+{
+  Q_OBJECT
+
+public:
+  ThumbnailCache(const ModelCatalog &_catalog, QObject *parent = nullptr);
+  ~ThumbnailCache();
+
+  static const int ICON_SIZE = 64;  // pixels, for the model browser
+
+  void set_thumbnail_path(const QString &path);
+  void set_memory_budget(const int megabytes);
+
+  /// Drop everything, for example after the catalog has been reloaded
+  void clear();
+
+  /// Returns the thumbnail of this model, the placeholder if it is still
+  /// loading, or a null pixmap if it could not be loaded.
+  QPixmap pixmap(const int model_id);
+
+  /// Same as pixmap(), but scaled down to fit in ICON_SIZE x ICON_SIZE
+  QPixmap icon(const int model_id);
+
+  bool is_loaded(const int model_id) const;
+
+  const QPixmap &placeholder() const { return placeholder_pixmap; }
+
+signals:
+  void thumbnail_loaded(int model_id);
+
+private:
+  const ModelCatalog &catalog;
+  QString thumbnail_path;
+
+  QThreadPool pool;
+  int request_priority;  // newer requests are decoded first
+  int generation;  // bumped whenever in-flight results become stale
+
+  // costs are in kilobytes
+  QCache<int, QPixmap> pixmaps;
+  QCache<int, QPixmap> icons;
+
+  std::unordered_set<int> pending;
+  std::unordered_set<int> failed;
+
+  QPixmap placeholder_pixmap;
+  QPixmap placeholder_icon;
+
+  void request(const int model_id);
+  static int cost_kb(const QPixmap &pixmap);
+
+  // called through a queued connection from the worker threads
+  Q_INVOKABLE void image_decoded(
+      int model_id,
+      QImage image,
+      QImage icon_image,
+      int request_generation);
+};
+
+#endif
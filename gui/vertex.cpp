@@ -15,9 +15,6 @@
  *
 */
 
-#include <QGraphicsScene>
-#include <QGraphicsSimpleTextItem>
-
 #include "vertex.h"
 using std::string;
 using std::vector;
@@ -87,34 +84,6 @@ YAML::Node Vertex::to_yaml() const
   return vertex_node;
 }
 
-void Vertex::draw(
-    QGraphicsScene *scene,
-    const double meters_per_pixel) const
-{
-  QPen vertex_pen(Qt::black);
-  vertex_pen.setWidth(0.05 / meters_per_pixel);
-  const double radius = 0.1 / meters_per_pixel;
-
-  const double a = 0.5;
-  QColor color = QColor::fromRgbF(0.0, 1.0, 0.0, a);
-  QColor selected_color = QColor::fromRgbF(1.0, 0.0, 0.0, a);
-
-  scene->addEllipse(
-      x - radius,
-      y - radius,
-      2 * radius,
-      2 * radius,
-      vertex_pen,
-      selected ? QBrush(selected_color) : QBrush(color));
-
-  if (!name.empty()) {
-    QGraphicsSimpleTextItem *item = scene->addSimpleText(
-        QString::fromStdString(name));
-    item->setBrush(QColor(255, 0, 0, 255));
-    item->setPos(x, y + radius);
-  }
-}
-
 void Vertex::set_param(const std::string &param_name, const std::string& value)
 {
   auto it = params.find(param_name);
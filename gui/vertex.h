@@ -25,8 +25,6 @@
 
 #include "param.h"
 
-class QGraphicsScene;
-
 
 class Vertex
 {
@@ -47,8 +45,6 @@ public:
 
   void set_param(const std::string& name, const std::string& value);
 
-  void draw(QGraphicsScene *, const double meters_per_pixel) const;
-
   ////////////////////////////////////////////////////////////
   static const std::vector<std::pair<std::string, Param::Type> > allowed_params;
 };
@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cmath>
+
+#include <QFontMetricsF>
+#include <QPainter>
+
+#include "level.h"
+#include "vertex_layer.h"
+using std::vector;
+
+
+VertexLayer::VertexLayer(
+    const Level &level,
+    const vector<int> &_vertex_indices,
+    const LevelOfDetail &_lod)
+: lod(_lod),
+  radius(0.1 / level.drawing_meters_per_pixel),
+  pen_width(0.05 / level.drawing_meters_per_pixel),
+  label_height(0.0),
+  label_ascent(0.0),
+  vertex_indices(_vertex_indices),
+  grid(2.0 / level.drawing_meters_per_pixel),  // 2-meter cells
+  label_grid(10.0 / level.drawing_meters_per_pixel)
+{
+  const QFontMetricsF font_metrics(label_font);
+  label_height = font_metrics.height();
+  label_ascent = font_metrics.ascent();
+
+  positions.reserve(vertex_indices.size());
+  selected.reserve(vertex_indices.size());
+  for (size_t i = 0; i < vertex_indices.size(); i++) {
+    const Vertex &v = level.vertices[vertex_indices[i]];
+    positions.push_back(QPointF(v.x, v.y));
+    selected.push_back(v.selected);
+    grid.insert_point(static_cast<int>(i), v.x, v.y);
+
+    if (!v.name.empty()) {
+      // the label hangs off the bottom of the vertex circle
+      Label label;
+      label.text = QString::fromStdString(v.name);
+      label.rect = QRectF(
+          v.x,
+          v.y + radius,
+          font_metrics.width(label.text),
+          label_height);
+      label_grid.insert_box(
+          static_cast<int>(labels.size()),
+          label.rect.left(),
+          label.rect.top(),
+          label.rect.right(),
+          label.rect.bottom());
+      bounds |= label.rect;
+      labels.push_back(label);
+    }
+  }
+
+  // the grid only holds the vertex centers, so queries are padded by
+  // the radius instead
+  const double r = radius + pen_width;
+  for (const QPointF &p : positions)
+    bounds |= QRectF(p.x() - r, p.y() - r, 2 * r, 2 * r);
+}
+
+VertexLayer::~VertexLayer()
+{
+}
+
+void VertexLayer::paint(
+    QPainter *painter,
+    const QRectF &exposed,
+    const double view_scale) const
+{
+  const double r = radius + pen_width;
+  vector<int> visible;
+  grid.query_box(
+      exposed.left() - r,
+      exposed.top() - r,
+      exposed.right() + r,
+      exposed.bottom() + r,
+      visible);
+
+  // unselected vertices first, then the selected ones, so that the
+  // brush only changes once
+  const double a = 0.5;
+  painter->setPen(QPen(Qt::black, pen_width));
+  painter->setBrush(QColor::fromRgbF(0.0, 1.0, 0.0, a));
+  for (const int i : visible) {
+    if (!selected[i])
+      painter->drawEllipse(positions[i], radius, radius);
+  }
+  painter->setBrush(QColor::fromRgbF(1.0, 0.0, 0.0, a));
+  for (const int i : visible) {
+    if (selected[i])
+      painter->drawEllipse(positions[i], radius, radius);
+  }
+
+  LevelOfDetail view_lod(lod);
+  view_lod.view_scale = view_scale;
+  if (labels.empty() || !view_lod.draw_labels(label_height))
+    return;
+
+  vector<int> visible_labels;
+  label_grid.query_box(
+      exposed.left(),
+      exposed.top(),
+      exposed.right(),
+      exposed.bottom(),
+      visible_labels);
+
+  painter->setPen(QColor(255, 0, 0, 255));
+  painter->setFont(label_font);
+  for (const int i : visible_labels) {
+    const Label &label = labels[i];
+    painter->drawText(
+        QPointF(label.rect.left(), label.rect.top() + label_ascent),
+        label.text);
+  }
+}
+
+int VertexLayer::vertex_at(
+    const QPointF &point,
+    const double tolerance) const
+{
+  const double r = radius + tolerance;
+  vector<int> candidates;
+  grid.query_box(
+      point.x() - r,
+      point.y() - r,
+      point.x() + r,
+      point.y() + r,
+      candidates);
+
+  int nearest_idx = -1;
+  double nearest_dist = r;
+  for (const int i : candidates) {
+    const double dx = positions[i].x() - point.x();
+    const double dy = positions[i].y() - point.y();
+    const double dist = std::sqrt(dx * dx + dy * dy);
+    if (dist <= nearest_dist) {
+      nearest_idx = vertex_indices[i];
+      nearest_dist = dist;
+    }
+  }
+  return nearest_idx;
+}
+
+void VertexLayer::vertices_in(
+    const QPolygonF &region,
+    vector<int> &_vertex_indices) const
+{
+  const QRectF rect = region.boundingRect();
+  vector<int> candidates;
+  grid.query_box(
+      rect.left(),
+      rect.top(),
+      rect.right(),
+      rect.bottom(),
+      candidates);
+  for (const int i : candidates) {
+    if (region.containsPoint(positions[i], Qt::OddEvenFill))
+      _vertex_indices.push_back(vertex_indices[i]);
+  }
+}
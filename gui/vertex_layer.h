@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef VERTEX_LAYER_H
+#define VERTEX_LAYER_H
+
+/*
+ * Some (usually all) of the vertices of a level. The positions are kept
+ * in a contiguous array and the selection in a bitmap, so building the
+ * layer is a couple of allocations regardless of the vertex count. Like
+ * EdgeLayer, it is immutable once built and safe to paint from several
+ * threads at once.
+ */
+
+#include <vector>
+
+#include <QFont>
+#include <QPointF>
+#include <QPolygonF>
+#include <QRectF>
+#include <QString>
+
+#include "level_of_detail.h"
+#include "spatial_grid.h"
+class Level;
+class QPainter;
+
+
+class VertexLayer
+{
+public:
+  /// Copies the positions of these vertices (indices into level.vertices)
+  VertexLayer(
+      const Level &level,
+      const std::vector<int> &_vertex_indices,
+      const LevelOfDetail &_lod);
+  ~VertexLayer();
+
+  const QRectF &bounding_rect() const { return bounds; }
+
+  /// Paint the vertices near the exposed rectangle (in scene coordinates),
+  /// with the level of detail for this many screen pixels per scene unit
+  void paint(
+      QPainter *painter,
+      const QRectF &exposed,
+      const double view_scale) const;
+
+  /// Returns the index (in Level::vertices) of the vertex closest to this
+  /// point, if it is within 'tolerance' of the vertex's circle, or -1.
+  int vertex_at(const QPointF &point, const double tolerance) const;
+
+  /// Appends the indices (in Level::vertices) of the vertices whose
+  /// centers are inside this region
+  void vertices_in(
+      const QPolygonF &region,
+      std::vector<int> &_vertex_indices) const;
+
+private:
+  struct Label
+  {
+    QString text;
+    QRectF rect;
+  };
+
+  const LevelOfDetail lod;  // thresholds only; the scale comes with paint()
+  const double radius;
+  const double pen_width;
+
+  QFont label_font;  // the application font, like QGraphicsSimpleTextItem
+  double label_height;
+  double label_ascent;
+
+  std::vector<QPointF> positions;
+  std::vector<int> vertex_indices;  // in Level::vertices
+  std::vector<bool> selected;  // one bit per vertex
+  std::vector<Label> labels;  // only the named vertices
+
+  SpatialGrid grid;  // indices into 'positions'
+  SpatialGrid label_grid;  // indices into 'labels'
+  QRectF bounds;
+};
+
+#endif
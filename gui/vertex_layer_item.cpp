@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <cmath>
+
+#include <QStyleOptionGraphicsItem>
+
+#include "vertex_layer_item.h"
+
+
+VertexLayerItem::VertexLayerItem(
+    const std::shared_ptr<const VertexLayer> &_layer)
+: layer(_layer)
+{
+  // exposedRect is only filled in with this flag set
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+}
+
+VertexLayerItem::~VertexLayerItem()
+{
+}
+
+QRectF VertexLayerItem::boundingRect() const
+{
+  return layer->bounding_rect();
+}
+
+void VertexLayerItem::paint(
+    QPainter *painter,
+    const QStyleOptionGraphicsItem *option,
+    QWidget *)
+{
+  layer->paint(
+      painter,
+      option->exposedRect,
+      QStyleOptionGraphicsItem::levelOfDetailFromTransform(
+        painter->worldTransform()));
+}
+
+int VertexLayerItem::vertex_at(
+    const QPointF &point,
+    const double tolerance) const
+{
+  return layer->vertex_at(point, tolerance);
+}
+
+void VertexLayerItem::vertices_in(
+    const QPolygonF &region,
+    std::vector<int> &vertex_indices) const
+{
+  layer->vertices_in(region, vertex_indices);
+}
+
+bool VertexLayerItem::contains(const QPointF &point) const
+{
+  return layer->vertex_at(point, 0.0) >= 0;
+}
+
+bool VertexLayerItem::collidesWithPath(
+    const QPainterPath &path,
+    Qt::ItemSelectionMode mode) const
+{
+  // see EdgeLayerItem::collidesWithPath()
+  if (mode != Qt::IntersectsItemShape)
+    return QGraphicsItem::collidesWithPath(path, mode);
+
+  const QRectF rect = path.boundingRect();
+  const double r = std::sqrt(
+      rect.width() * rect.width() + rect.height() * rect.height()) / 2.0;
+  return layer->vertex_at(rect.center(), r) >= 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef VERTEX_LAYER_ITEM_H
+#define VERTEX_LAYER_ITEM_H
+
+/*
+ * One QGraphicsItem for a whole VertexLayer, instead of an ellipse item
+ * (and maybe a text item) per vertex. Only the vertices in the exposed
+ * rectangle are painted.
+ */
+
+#include <memory>
+
+#include <QGraphicsItem>
+
+#include "vertex_layer.h"
+
+
+class VertexLayerItem : public QGraphicsItem
+{
+public:
+  enum { Type = UserType + 2 };
+
+  VertexLayerItem(const std::shared_ptr<const VertexLayer> &_layer);
+  ~VertexLayerItem();
+
+  int type() const override { return Type; }
+
+  QRectF boundingRect() const override;
+
+  void paint(
+      QPainter *painter,
+      const QStyleOptionGraphicsItem *option,
+      QWidget *widget) override;
+
+  bool contains(const QPointF &point) const override;
+  bool collidesWithPath(
+      const QPainterPath &path,
+      Qt::ItemSelectionMode mode = Qt::IntersectsItemShape) const override;
+
+  /// see VertexLayer::vertex_at()
+  int vertex_at(const QPointF &point, const double tolerance) const;
+
+  /// see VertexLayer::vertices_in()
+  void vertices_in(
+      const QPolygonF &region,
+      std::vector<int> &vertex_indices) const;
+
+private:
+  std::shared_ptr<const VertexLayer> layer;
+};
+
+#endif
@@ -0,0 +1,680 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <unordered_set>
+
+#include <QImage>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "spatial_grid.h"
+#include "wall_extractor.h"
+using std::vector;
+
+
+/////////////////////////////////////////////////////////////////////////
+// pixel loops
+
+/// out[i] = 1 where gray[i] < threshold, else 0. threshold must be > 0.
+static void binarize_row(
+    const uchar *gray,
+    uchar *out,
+    const int n,
+    const int threshold)
+{
+  int i = 0;
+#ifdef __SSE2__
+  // there is no unsigned byte compare, but x < t exactly when
+  // min(x, t - 1) == x
+  const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold - 1));
+  const __m128i one = _mm_set1_epi8(1);
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(gray + i));
+    const __m128i dark = _mm_cmpeq_epi8(_mm_min_epu8(x, limit), x);
+    _mm_storeu_si128(
+        reinterpret_cast<__m128i *>(out + i), _mm_and_si128(dark, one));
+  }
+#endif
+  for (; i < n; i++)
+    out[i] = gray[i] < threshold ? 1 : 0;
+}
+
+/// Number of zero bytes at the start of p[0..n)
+static int count_zeros(const uchar *p, const int n)
+{
+  int i = 0;
+#ifdef __SSE2__
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= n; i += 16) {
+    const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(x, zero)) != 0xffff)
+      break;
+  }
+#endif
+  while (i < n && p[i] == 0)
+    i++;
+  return i;
+}
+
+/*
+ * The 8 neighbours of a pixel, clockwise from north, as the bits of a
+ * byte (north is bit 0). Zhang and Suen call these P2..P9.
+ */
+static inline int neighbour_mask(const uchar *p, const int stride)
+{
+  return (p[-stride] != 0) |
+      ((p[-stride + 1] != 0) << 1) |
+      ((p[1] != 0) << 2) |
+      ((p[stride + 1] != 0) << 3) |
+      ((p[stride] != 0) << 4) |
+      ((p[stride - 1] != 0) << 5) |
+      ((p[-1] != 0) << 6) |
+      ((p[-stride - 1] != 0) << 7);
+}
+
+static inline int popcount8(const int mask)
+{
+  int n = 0;
+  for (int m = mask; m; m &= m - 1)
+    n++;
+  return n;
+}
+
+/*
+ * Which neighbourhoods each of the two Zhang-Suen sub-iterations may
+ * delete the center pixel of, indexed by neighbour_mask()
+ */
+struct ThinningTables
+{
+  bool deletable[2][256];
+
+  ThinningTables()
+  {
+    for (int mask = 0; mask < 256; mask++) {
+      const bool p2 = mask & 1, p4 = mask & 4, p6 = mask & 16, p8 = mask & 64;
+      int transitions = 0;  // 0 -> 1, going around the neighbours
+      for (int k = 0; k < 8; k++) {
+        if (!(mask & (1 << k)) && (mask & (1 << ((k + 1) % 8))))
+          transitions++;
+      }
+      const int count = popcount8(mask);
+      const bool shape = count >= 2 && count <= 6 && transitions == 1;
+      deletable[0][mask] = shape && !(p2 && p4 && p6) && !(p4 && p6 && p8);
+      deletable[1][mask] = shape && !(p2 && p4 && p8) && !(p2 && p6 && p8);
+    }
+  }
+};
+
+static const ThinningTables thinning_tables;
+
+
+/////////////////////////////////////////////////////////////////////////
+// worker threads
+
+class WallTileTask : public QRunnable
+{
+public:
+  WallTileTask(
+      const WallExtractor *_extractor,
+      const Drawing *_drawing,
+      const int _tile_idx,
+      vector<QLineF> *_lines,
+      const std::atomic<bool> *_stop,
+      std::atomic<int> *_num_done)
+  : extractor(_extractor),
+    drawing(_drawing),
+    tile_idx(_tile_idx),
+    lines(_lines),
+    stop(_stop),
+    num_done(_num_done)
+  {
+  }
+
+  void run() override
+  {
+    if (!*stop)
+      extractor->extract_tile(*drawing, tile_idx, *lines, *stop);
+    (*num_done)++;
+  }
+
+private:
+  const WallExtractor *extractor;
+  const Drawing *drawing;
+  const int tile_idx;
+  vector<QLineF> *lines;
+  const std::atomic<bool> *stop;
+  std::atomic<int> *num_done;
+};
+
+
+/////////////////////////////////////////////////////////////////////////
+
+WallExtractor::WallExtractor(
+    const double _meters_per_pixel,
+    const int _threshold,
+    const double _max_wall_meters,
+    const double _min_wall_meters)
+: threshold(std::max(1, std::min(255, _threshold))),
+  num_blank_tiles(0)
+{
+  // each full thinning iteration peels about a pixel off both sides of
+  // a wall, and its effects spread by two pixels, so that's how far the
+  // halo has to reach for the tile's own pixels to come out right
+  const double max_wall_pixels = _max_wall_meters / _meters_per_pixel;
+  max_iterations = std::max(
+      2, std::min(32, static_cast<int>(std::ceil(max_wall_pixels / 2)) + 1));
+  halo = 2 * max_iterations + 2;
+
+  min_length = _min_wall_meters / _meters_per_pixel;
+  tolerance = std::max(1.5, 0.05 / _meters_per_pixel);
+  // chains from neighbouring tiles end a pixel apart
+  weld_distance = std::max(2.0, 0.02 / _meters_per_pixel);
+}
+
+WallExtractor::~WallExtractor()
+{
+}
+
+bool WallExtractor::is_blank(const Drawing &drawing, const int tile_idx) const
+{
+  return drawing.tile_image(tile_idx).isNull() &&
+      drawing.tile_fill_gray(tile_idx) >= threshold;
+}
+
+void WallExtractor::extract(const Drawing &drawing, JobProgress *progress)
+{
+  points.clear();
+  segments.clear();
+  num_blank_tiles = 0;
+
+  const int n = drawing.num_tiles();
+  vector<vector<QLineF> > tile_lines(n);
+  std::atomic<bool> stop(false);
+  std::atomic<int> num_done(0);
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount() - 1));
+  for (int tile_idx = 0; tile_idx < n; tile_idx++) {
+    if (is_blank(drawing, tile_idx)) {
+      num_blank_tiles++;
+      num_done++;
+      continue;
+    }
+    pool.start(
+        new WallTileTask(
+          this, &drawing, tile_idx, &tile_lines[tile_idx], &stop, &num_done));
+  }
+
+  if (progress)
+    progress->set_progress(0.0, "tracing walls");
+  while (!pool.waitForDone(100)) {
+    if (!progress)
+      continue;
+    if (progress->is_cancelled()) {
+      pool.clear();
+      stop = true;
+      pool.waitForDone();
+      progress->check_cancelled();
+    }
+    progress->set_progress(0.9 * num_done / std::max(1, n));
+  }
+
+  if (progress)
+    progress->set_progress(0.9, "joining walls");
+  build_graph(tile_lines);
+  tile_lines.clear();
+  merge_collinear();
+  remove_spurs();
+}
+
+void WallExtractor::extract_tile(
+    const Drawing &drawing,
+    const int tile_idx,
+    vector<QLineF> &lines,
+    const std::atomic<bool> &stop) const
+{
+  const QRect core = drawing.tile_rect(tile_idx);
+  const QRect region = core.adjusted(-halo, -halo, halo, halo) &
+      QRect(0, 0, drawing.width(), drawing.height());
+
+  // 1 for ink, 0 for paper, with a blank border so that every pixel of
+  // the region has 8 neighbours
+  const int w = region.width();
+  const int h = region.height();
+  const int stride = w + 2;
+  vector<uchar> ink(static_cast<size_t>(stride) * (h + 2), 0);
+  auto row = [&](const int x, const int y) {
+    return &ink[static_cast<size_t>(y - region.y() + 1) * stride +
+        (x - region.x() + 1)];
+  };
+
+  vector<int> tile_indices;
+  drawing.tiles_in_rect(QRectF(region), tile_indices);
+  for (const int i : tile_indices) {
+    const QRect tile = drawing.tile_rect(i);
+    const QRect r = tile & region;
+    if (r.isEmpty() || is_blank(drawing, i))
+      continue;
+    const QImage &image = drawing.tile_image(i);
+    if (image.isNull()) {
+      for (int y = r.y(); y < r.y() + r.height(); y++)
+        memset(row(r.x(), y), 1, r.width());
+      continue;
+    }
+    const QImage gray = image.format() == QImage::Format_Grayscale8 ?
+        image : image.convertToFormat(QImage::Format_Grayscale8);
+    for (int y = r.y(); y < r.y() + r.height(); y++) {
+      binarize_row(
+          gray.constScanLine(y - tile.y()) + (r.x() - tile.x()),
+          row(r.x(), y),
+          r.width(),
+          threshold);
+    }
+  }
+
+  // everything from here on only looks at the ink pixels
+  vector<int> skeleton;
+  for (int y = 1; y <= h; y++) {
+    const uchar *line = &ink[static_cast<size_t>(y) * stride];
+    for (int x = 1; x <= w; x++) {
+      x += count_zeros(line + x, w + 1 - x);
+      if (x <= w)
+        skeleton.push_back(y * stride + x);
+    }
+  }
+
+  vector<int> deleted;
+  for (int iteration = 0; iteration < max_iterations; iteration++) {
+    if (stop)
+      return;
+    bool changed = false;
+    for (int step = 0; step < 2; step++) {
+      // every decision in a step is made before anything is deleted
+      const bool *deletable = thinning_tables.deletable[step];
+      deleted.clear();
+      for (const int p : skeleton) {
+        if (deletable[neighbour_mask(&ink[p], stride)])
+          deleted.push_back(p);
+      }
+      for (const int p : deleted)
+        ink[p] = 0;
+      if (!deleted.empty()) {
+        changed = true;
+        skeleton.erase(
+            std::remove_if(
+              skeleton.begin(),
+              skeleton.end(),
+              [&ink](const int p) { return ink[p] == 0; }),
+            skeleton.end());
+      }
+    }
+    if (!changed)
+      break;
+  }
+
+  // Grow chains along the skeleton. A chain runs from a junction or an
+  // end to the next one, or to the first pixel outside the tile, where
+  // the neighbouring tile's chain picks up. Pixels inside chains are
+  // marked with 2 as they are passed.
+  const int x0 = core.x() - region.x() + 1;
+  const int y0 = core.y() - region.y() + 1;
+  const int x1 = x0 + core.width();
+  const int y1 = y0 + core.height();
+  auto in_core = [&](const int p) {
+    const int x = p % stride;
+    const int y = p / stride;
+    return x >= x0 && x < x1 && y >= y0 && y < y1;
+  };
+  const int offsets[8] = {
+    -stride, -stride + 1, 1, stride + 1, stride, stride - 1, -1, -stride - 1
+  };
+
+  enum End { END_FREE, END_JUNCTION, END_BORDER, END_LOOP };
+  auto end_type = [&](const int p) {
+    return popcount8(neighbour_mask(&ink[p], stride)) == 1 ?
+        END_FREE : END_JUNCTION;
+  };
+
+  auto walk = [&](const int start, const int next, vector<int> &chain) {
+    int prev = start;
+    int cur = next;
+    for (;;) {
+      chain.push_back(cur);
+      if (!in_core(cur))
+        return END_BORDER;
+      const int mask = neighbour_mask(&ink[cur], stride);
+      if (popcount8(mask) != 2)
+        return end_type(cur);
+      if (ink[cur] == 2)
+        return END_LOOP;
+      ink[cur] = 2;
+      int following = -1;
+      for (int k = 0; k < 8 && following < 0; k++) {
+        if ((mask & (1 << k)) && cur + offsets[k] != prev)
+          following = cur + offsets[k];
+      }
+      prev = cur;
+      cur = following;
+    }
+  };
+
+  vector<int> chain, back;
+  vector<QPointF> chain_points;
+  auto emit_chain = [&](const End start_end, const End end_end) {
+    chain_points.clear();
+    double length = 0.0;
+    for (const int p : chain) {
+      const QPointF point(
+          region.x() + p % stride - 1 + 0.5,
+          region.y() + p / stride - 1 + 0.5);
+      if (!chain_points.empty()) {
+        length += std::hypot(
+            point.x() - chain_points.back().x(),
+            point.y() - chain_points.back().y());
+      }
+      chain_points.push_back(point);
+    }
+    // spurs, text and specks
+    if (length < min_length && (start_end == END_FREE || end_end == END_FREE))
+      return;
+    simplify(chain_points, tolerance, lines);
+  };
+
+  // chains with a junction or an end in this tile
+  for (const int p : skeleton) {
+    if (!in_core(p))
+      continue;
+    const int mask = neighbour_mask(&ink[p], stride);
+    const int degree = popcount8(mask);
+    if (degree == 0 || degree == 2)
+      continue;
+    for (int k = 0; k < 8; k++) {
+      if (!(mask & (1 << k)))
+        continue;
+      const int q = p + offsets[k];
+      if (ink[q] == 2)
+        continue;  // already traced from its other end
+      if (q < p && popcount8(neighbour_mask(&ink[q], stride)) != 2)
+        continue;  // two adjacent junctions: trace the link once
+      chain.assign(1, p);
+      const End end = walk(p, q, chain);
+      emit_chain(degree == 1 ? END_FREE : END_JUNCTION, end);
+    }
+    if (stop)
+      return;
+  }
+
+  // what is left are closed loops and lines that cross the tile without
+  // ending in it; trace those both ways from wherever they are found
+  for (const int p : skeleton) {
+    if (ink[p] != 1 || !in_core(p))
+      continue;
+    const int mask = neighbour_mask(&ink[p], stride);
+    if (popcount8(mask) != 2)
+      continue;
+    int a = -1, b = -1;
+    for (int k = 0; k < 8; k++) {
+      if (mask & (1 << k))
+        (a < 0 ? a : b) = p + offsets[k];
+    }
+    ink[p] = 2;
+    chain.assign(1, p);
+    const End a_end = walk(p, a, chain);
+    if (a_end == END_LOOP) {
+      emit_chain(END_LOOP, END_LOOP);
+      continue;
+    }
+    back.assign(1, p);
+    const End b_end = walk(p, b, back);
+    std::reverse(back.begin(), back.end());
+    back.insert(back.end(), chain.begin() + 1, chain.end());
+    chain.swap(back);
+    emit_chain(b_end, a_end);
+  }
+}
+
+void WallExtractor::simplify(
+    const vector<QPointF> &chain,
+    const double _tolerance,
+    vector<QLineF> &lines)
+{
+  if (chain.size() < 2)
+    return;
+
+  // Douglas-Peucker, with a stack instead of recursion since chains can
+  // be thousands of pixels long
+  vector<bool> keep(chain.size(), false);
+  keep.front() = keep.back() = true;
+  vector<std::pair<size_t, size_t> > stack;
+  stack.push_back(std::make_pair(0, chain.size() - 1));
+  while (!stack.empty()) {
+    const size_t first = stack.back().first;
+    const size_t last = stack.back().second;
+    stack.pop_back();
+    if (last <= first + 1)
+      continue;
+
+    const QPointF &a = chain[first];
+    const QPointF &b = chain[last];
+    const double dx = b.x() - a.x();
+    const double dy = b.y() - a.y();
+    const double len = std::hypot(dx, dy);
+    size_t farthest = first;
+    double farthest_dist = -1.0;
+    for (size_t i = first + 1; i < last; i++) {
+      const QPointF &p = chain[i];
+      // loops start and end on the same pixel
+      const double dist = len > 0.0 ?
+          std::abs(dx * (p.y() - a.y()) - dy * (p.x() - a.x())) / len :
+          std::hypot(p.x() - a.x(), p.y() - a.y());
+      if (dist > farthest_dist) {
+        farthest = i;
+        farthest_dist = dist;
+      }
+    }
+    if (farthest_dist > _tolerance) {
+      keep[farthest] = true;
+      stack.push_back(std::make_pair(first, farthest));
+      stack.push_back(std::make_pair(farthest, last));
+    }
+  }
+
+  size_t prev = 0;
+  for (size_t i = 1; i < chain.size(); i++) {
+    if (keep[i]) {
+      lines.push_back(QLineF(chain[prev], chain[i]));
+      prev = i;
+    }
+  }
+}
+
+void WallExtractor::build_graph(const vector<vector<QLineF> > &tile_lines)
+{
+  SpatialGrid grid(weld_distance * 4.0);
+  vector<int> candidates;
+  auto add_point = [&](const QPointF &p) {
+    candidates.clear();
+    grid.query_box(
+        p.x() - weld_distance,
+        p.y() - weld_distance,
+        p.x() + weld_distance,
+        p.y() + weld_distance,
+        candidates);
+    int nearest_idx = -1;
+    double nearest_dist = weld_distance;
+    for (const int i : candidates) {
+      const double dist =
+          std::hypot(points[i].x() - p.x(), points[i].y() - p.y());
+      if (dist <= nearest_dist) {
+        nearest_idx = i;
+        nearest_dist = dist;
+      }
+    }
+    if (nearest_idx >= 0)
+      return nearest_idx;
+    const int idx = static_cast<int>(points.size());
+    points.push_back(p);
+    grid.insert_point(idx, p.x(), p.y());
+    return idx;
+  };
+
+  std::unordered_set<uint64_t> keys;
+  for (const vector<QLineF> &lines : tile_lines) {
+    for (const QLineF &line : lines) {
+      const int a = add_point(line.p1());
+      const int b = add_point(line.p2());
+      if (a == b)
+        continue;
+      const uint64_t key =
+          (static_cast<uint64_t>(std::min(a, b)) << 32) |
+          static_cast<uint64_t>(std::max(a, b));
+      if (keys.insert(key).second)
+        segments.push_back(std::make_pair(a, b));
+    }
+  }
+}
+
+void WallExtractor::merge_collinear()
+{
+  // Chains are cut at tile edges and wherever the simplification had to
+  // bend, so a vertex joining just two segments is dropped if the line
+  // between its neighbours passes within the tolerance of it, and of
+  // every vertex that the two segments already replaced.
+  const int n = static_cast<int>(points.size());
+  vector<vector<int> > vertex_segments(n);
+  for (size_t i = 0; i < segments.size(); i++) {
+    vertex_segments[segments[i].first].push_back(static_cast<int>(i));
+    vertex_segments[segments[i].second].push_back(static_cast<int>(i));
+  }
+  vector<bool> alive(segments.size(), true);
+  vector<vector<int> > absorbed(segments.size());
+
+  auto distance_to_line = [this](const int v, const int a, const int b) {
+    const QPointF &p = points[v];
+    const QPointF &pa = points[a];
+    const QPointF &pb = points[b];
+    const double dx = pb.x() - pa.x();
+    const double dy = pb.y() - pa.y();
+    const double len2 = dx * dx + dy * dy;
+    double t = len2 > 0.0 ?
+        ((p.x() - pa.x()) * dx + (p.y() - pa.y()) * dy) / len2 : 0.0;
+    t = std::max(0.0, std::min(1.0, t));
+    return std::hypot(pa.x() + t * dx - p.x(), pa.y() + t * dy - p.y());
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (int v = 0; v < n; v++) {
+      vector<int> &vs = vertex_segments[v];
+      if (vs.size() != 2)
+        continue;
+      const int s1 = vs[0];
+      const int s2 = vs[1];
+      const int a = segments[s1].first == v ?
+          segments[s1].second : segments[s1].first;
+      const int b = segments[s2].first == v ?
+          segments[s2].second : segments[s2].first;
+      if (a == b)
+        continue;
+
+      vector<int> merged(absorbed[s1]);
+      merged.insert(merged.end(), absorbed[s2].begin(), absorbed[s2].end());
+      merged.push_back(v);
+      bool straight = true;
+      for (size_t i = 0; i < merged.size() && straight; i++)
+        straight = distance_to_line(merged[i], a, b) <= tolerance;
+      if (!straight)
+        continue;
+
+      // don't create a second segment between the same two vertices
+      bool exists = false;
+      for (const int s : vertex_segments[a]) {
+        if (segments[s].first == b || segments[s].second == b)
+          exists = true;
+      }
+      if (exists)
+        continue;
+
+      const int s = static_cast<int>(segments.size());
+      segments.push_back(std::make_pair(a, b));
+      alive.push_back(true);
+      absorbed.push_back(merged);
+      alive[s1] = alive[s2] = false;
+      absorbed[s1].clear();
+      absorbed[s2].clear();
+      std::replace(
+          vertex_segments[a].begin(), vertex_segments[a].end(), s1, s);
+      std::replace(
+          vertex_segments[b].begin(), vertex_segments[b].end(), s2, s);
+      vs.clear();
+      changed = true;
+    }
+  }
+
+  vector<std::pair<int, int> > kept;
+  for (size_t i = 0; i < segments.size(); i++) {
+    if (alive[i])
+      kept.push_back(segments[i]);
+  }
+  segments.swap(kept);
+}
+
+void WallExtractor::remove_spurs()
+{
+  // spurs that only showed up once the tiles were joined, then drop the
+  // vertices that nothing uses any more
+  vector<int> degree(points.size(), 0);
+  for (const auto &s : segments) {
+    degree[s.first]++;
+    degree[s.second]++;
+  }
+  vector<std::pair<int, int> > kept;
+  kept.reserve(segments.size());
+  for (const auto &s : segments) {
+    const double length = std::hypot(
+        points[s.first].x() - points[s.second].x(),
+        points[s.first].y() - points[s.second].y());
+    if (length < min_length && (degree[s.first] == 1 || degree[s.second] == 1))
+      continue;
+    kept.push_back(s);
+  }
+
+  vector<int> new_idx(points.size(), -1);
+  vector<QPointF> used;
+  for (auto &s : kept) {
+    for (int *v : { &s.first, &s.second }) {
+      if (new_idx[*v] < 0) {
+        new_idx[*v] = static_cast<int>(used.size());
+        used.push_back(points[*v]);
+      }
+      *v = new_idx[*v];
+    }
+  }
+  points.swap(used);
+  segments.swap(kept);
+}
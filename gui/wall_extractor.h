@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2019 Open Source Robotics Foundation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+*/
+
+#ifndef WALL_EXTRACTOR_H
+#define WALL_EXTRACTOR_H
+
+/*
+ * Proposes walls by tracing the line work of a level's drawing, so that
+ * they don't all have to be clicked in by hand:
+ *
+ *   1. binarize: pixels darker than the threshold are ink
+ *   2. thin the ink to one-pixel-wide skeletons (Zhang-Suen)
+ *   3. grow segments along the skeletons: chains of pixels between
+ *      junctions and ends, simplified with Douglas-Peucker
+ *   4. weld the chain ends into vertices, merge collinear segments, and
+ *      drop short spurs (text, hatching, dirt on the scan)
+ *
+ * Steps 1-3 work one drawing tile at a time on a thread pool. Each tile
+ * is read with a halo of its neighbours around it, thick enough that
+ * thinning comes out the same as it would on the whole image, and only
+ * the chains that start inside the tile itself are traced. Blank tiles
+ * (most of a typical scan) are skipped without being looked at, and the
+ * binarization and blank-run scans use SSE2 where it is available.
+ *
+ * Walls thicker than max_wall_meters are only partly thinned.
+ */
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include <QLineF>
+#include <QPointF>
+#include <QRect>
+
+#include "drawing.h"
+#include "job.h"
+
+
+class WallExtractor
+{
+public:
+  WallExtractor(
+      const double _meters_per_pixel,
+      const int _threshold = 128,
+      const double _max_wall_meters = 0.5,
+      const double _min_wall_meters = 0.3);
+  ~WallExtractor();
+
+  /// Trace the whole drawing. Throws JobCancelled if progress is
+  /// cancelled (the tiles in flight are abandoned, not waited out).
+  void extract(const Drawing &drawing, JobProgress *progress = nullptr);
+
+  /// In drawing pixels, which are also the level's coordinates
+  const std::vector<QPointF> &get_points() const { return points; }
+  const std::vector<std::pair<int, int> > &get_segments() const
+  { return segments; }
+
+  int get_num_blank_tiles() const { return num_blank_tiles; }
+
+  /// Trace one tile into line segments. Called from the worker threads;
+  /// gives up early (with whatever it has) once 'stop' is set.
+  void extract_tile(
+      const Drawing &drawing,
+      const int tile_idx,
+      std::vector<QLineF> &lines,
+      const std::atomic<bool> &stop) const;
+
+private:
+  const int threshold;  // gray values below this are ink
+  int max_iterations;  // of thinning
+  int halo;  // pixels read around each tile
+  double min_length;  // shorter spurs and specks are dropped
+  double tolerance;  // of the segment simplification
+  double weld_distance;
+
+  std::vector<QPointF> points;
+  std::vector<std::pair<int, int> > segments;
+  int num_blank_tiles;
+
+  bool is_blank(const Drawing &drawing, const int tile_idx) const;
+
+  static void simplify(
+      const std::vector<QPointF> &chain,
+      const double _tolerance,
+      std::vector<QLineF> &lines);
+
+  void build_graph(const std::vector<std::vector<QLineF> > &tile_lines);
+  void merge_collinear();
+  void remove_spurs();
+};
+
+#endif